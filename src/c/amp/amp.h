@@ -82,13 +82,24 @@
 #include <amp/amp_stdint.h>
 #include <amp/amp_return_code.h>
 #include <amp/amp_memory.h>
+#include <amp/amp_arena_allocator.h>
+#include <amp/amp_pool_allocator.h>
+#include <amp/amp_atomic.h>
 #include <amp/amp_platform.h>
 #include <amp/amp_thread.h>
 #include <amp/amp_thread_array.h>
+#include <amp/amp_thread_pool.h>
+#include <amp/amp_mpmc_queue.h>
+#include <amp/amp_mpsc_queue.h>
+#include <amp/amp_spsc_ring.h>
+#include <amp/amp_epoch.h>
+#include <amp/amp_hazard_domain.h>
+#include <amp/amp_parallel_for.h>
 #include <amp/amp_thread_local_slot.h>
 #include <amp/amp_semaphore.h>
 #include <amp/amp_mutex.h>
 #include <amp/amp_condition_variable.h>
 #include <amp/amp_barrier.h>
+#include <amp/amp_rwlock.h>
 
 #endif /* AMP_amp_H */
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the arena allocator. The allocator, the arena state, 
+ * and the arena memory are allocated in one block.
+ */
+
+#include "amp_arena_allocator.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+
+
+
+/**
+ * Union of the types with the strictest fundamental alignment requirements.
+ */
+union amp_internal_arena_max_align_u {
+    void* pointer;
+    long integer;
+    long double real;
+    void (*function)(void);
+};
+
+/**
+ * Struct to determine the alignment of amp_internal_arena_max_align_u.
+ */
+struct amp_internal_arena_alignment_probe_s {
+    char offset;
+    union amp_internal_arena_max_align_u aligned;
+};
+
+/**
+ * Alignment of all arena allocations, suitable for any fundamental type.
+ */
+#define AMP_INTERNAL_ARENA_ALIGNMENT (offsetof(struct amp_internal_arena_alignment_probe_s, aligned))
+
+
+
+struct amp_internal_arena_s {
+    unsigned char* memory;
+    size_t capacity;
+    size_t used;
+};
+
+
+/**
+ * Block layout: the allocator, the arena, and the memory.
+ */
+struct amp_internal_arena_block_s {
+    struct amp_raw_allocator_s allocator;
+    struct amp_internal_arena_s arena;
+    union amp_internal_arena_max_align_u memory_alignment;
+};
+
+
+
+/**
+ * Bumps the arena position for bytes_to_allocate bytes or returns NULL if the
+ * arena is exhausted.
+ */
+static void* amp_internal_arena_alloc(void* allocator_context, 
+                                      size_t bytes_to_allocate,
+                                      char const* filename,
+                                      int line);
+
+/**
+ * Bumps the arena position past padding to align the allocation to at
+ * least alignment and past bytes_to_allocate or returns NULL if the arena is
+ * exhausted.
+ */
+static void* amp_internal_arena_aligned_alloc(void* allocator_context,
+                                              size_t alignment,
+                                              size_t bytes_to_allocate,
+                                              char const* filename,
+                                              int line);
+
+/**
+ * Like amp_internal_arena_alloc but zeroes the memory.
+ */
+static void* amp_internal_arena_calloc(void* allocator_context,
+                                       size_t elem_count,
+                                       size_t bytes_per_elem,
+                                       char const* filename,
+                                       int line);
+
+/**
+ * No-op, arena memory is released via reset or marks.
+ */
+static int amp_internal_arena_dealloc(void* allocator_context, 
+                                      void *pointer,
+                                      char const* filename,
+                                      int line);
+
+/**
+ * Returns the arena of an arena allocator.
+ */
+static struct amp_internal_arena_s* amp_internal_arena(amp_allocator_t arena_allocator);
+
+
+
+static void* amp_internal_arena_alloc(void* allocator_context, 
+                                      size_t bytes_to_allocate,
+                                      char const* filename,
+                                      int line)
+{
+    return amp_internal_arena_aligned_alloc(allocator_context,
+                                            AMP_INTERNAL_ARENA_ALIGNMENT,
+                                            bytes_to_allocate,
+                                            filename,
+                                            line);
+}
+
+
+
+static void* amp_internal_arena_aligned_alloc(void* allocator_context,
+                                              size_t alignment,
+                                              size_t bytes_to_allocate,
+                                              char const* filename,
+                                              int line)
+{
+    struct amp_internal_arena_s* arena = (struct amp_internal_arena_s*)allocator_context;
+    uintptr_t position = 0;
+    size_t begin = 0;
+    
+    (void)filename;
+    (void)line;
+    
+    assert(NULL != arena);
+    assert(0 != alignment);
+    assert(0 == (alignment & (alignment - 1)));
+    
+    if (alignment < AMP_INTERNAL_ARENA_ALIGNMENT) {
+        alignment = AMP_INTERNAL_ARENA_ALIGNMENT;
+    }
+    
+    position = (uintptr_t)(arena->memory + arena->used);
+    begin = arena->used + (size_t)((alignment - (position & (alignment - 1))) & (alignment - 1));
+    
+    if ((begin < arena->used)
+        || (begin > arena->capacity)
+        || (bytes_to_allocate > arena->capacity - begin)) {
+        return NULL;
+    }
+    
+    arena->used = begin + bytes_to_allocate;
+    
+    return arena->memory + begin;
+}
+
+
+
+static void* amp_internal_arena_calloc(void* allocator_context,
+                                       size_t elem_count,
+                                       size_t bytes_per_elem,
+                                       char const* filename,
+                                       int line)
+{
+    size_t bytes_to_allocate = 0;
+    void* memory = NULL;
+    
+    if ((0 != bytes_per_elem)
+        && (elem_count > AMP_SIZE_MAX / bytes_per_elem)) {
+        return NULL;
+    }
+    
+    bytes_to_allocate = elem_count * bytes_per_elem;
+    
+    memory = amp_internal_arena_alloc(allocator_context,
+                                      bytes_to_allocate,
+                                      filename,
+                                      line);
+    if (NULL != memory) {
+        memset(memory, 0, bytes_to_allocate);
+    }
+    
+    return memory;
+}
+
+
+
+static int amp_internal_arena_dealloc(void* allocator_context, 
+                                      void *pointer,
+                                      char const* filename,
+                                      int line)
+{
+    struct amp_internal_arena_s* arena = (struct amp_internal_arena_s*)allocator_context;
+    
+    (void)filename;
+    (void)line;
+    (void)arena;
+    (void)pointer;
+    
+    assert(NULL != arena);
+    assert((NULL == pointer) 
+           || (((unsigned char*)pointer >= arena->memory)
+               && ((unsigned char*)pointer <= arena->memory + arena->capacity)));
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static struct amp_internal_arena_s* amp_internal_arena(amp_allocator_t arena_allocator)
+{
+    assert(NULL != arena_allocator);
+    assert(&amp_internal_arena_alloc == arena_allocator->alloc_func);
+    
+    return (struct amp_internal_arena_s*)arena_allocator->allocator_context;
+}
+
+
+
+int amp_arena_allocator_create(amp_allocator_t* arena,
+                               amp_allocator_t source_allocator,
+                               size_t capacity)
+{
+    struct amp_internal_arena_block_s* block = NULL;
+    
+    assert(NULL != arena);
+    assert(NULL != source_allocator);
+    assert(0 < capacity);
+    
+    if (0 == capacity) {
+        return AMP_ERROR;
+    }
+    
+    if (capacity > AMP_SIZE_MAX - offsetof(struct amp_internal_arena_block_s, memory_alignment)) {
+        return AMP_NOMEM;
+    }
+    
+    block = (struct amp_internal_arena_block_s*)AMP_ALLOC(source_allocator,
+                                                          offsetof(struct amp_internal_arena_block_s, memory_alignment) + capacity);
+    if (NULL == block) {
+        return AMP_NOMEM;
+    }
+    
+    block->arena.memory = (unsigned char*)&block->memory_alignment;
+    block->arena.capacity = capacity;
+    block->arena.used = 0;
+    
+    block->allocator.alloc_func = &amp_internal_arena_alloc;
+    block->allocator.calloc_func = &amp_internal_arena_calloc;
+    block->allocator.dealloc_func = &amp_internal_arena_dealloc;
+    block->allocator.aligned_alloc_func = &amp_internal_arena_aligned_alloc;
+    block->allocator.aligned_dealloc_func = &amp_internal_arena_dealloc;
+    block->allocator.allocator_context = &block->arena;
+    block->allocator.aligned_allocator_context = &block->arena;
+    
+    *arena = &block->allocator;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_arena_allocator_destroy(amp_allocator_t* arena,
+                                amp_allocator_t source_allocator)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != arena);
+    assert(NULL != source_allocator);
+    assert(&amp_internal_arena_alloc == (*arena)->alloc_func);
+    
+    /* The allocator is the first member of the block. */
+    retval = AMP_DEALLOC(source_allocator, *arena);
+    if (AMP_SUCCESS == retval) {
+        *arena = AMP_ALLOCATOR_UNINITIALIZED;
+    } else {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+void amp_arena_allocator_reset(amp_allocator_t arena)
+{
+    amp_internal_arena(arena)->used = 0;
+}
+
+
+
+void amp_arena_allocator_get_mark(amp_allocator_t arena,
+                                  amp_arena_allocator_mark_t* mark)
+{
+    assert(NULL != mark);
+    
+    *mark = amp_internal_arena(arena)->used;
+}
+
+
+
+int amp_arena_allocator_release_to_mark(amp_allocator_t arena,
+                                        amp_arena_allocator_mark_t mark)
+{
+    struct amp_internal_arena_s* internal_arena = amp_internal_arena(arena);
+    
+    assert(mark <= internal_arena->used);
+    
+    if (mark > internal_arena->used) {
+        return AMP_ERROR;
+    }
+    
+    internal_arena->used = mark;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_arena_allocator_get_usage(amp_allocator_t arena,
+                                   size_t* used_bytes,
+                                   size_t* capacity)
+{
+    struct amp_internal_arena_s* internal_arena = amp_internal_arena(arena);
+    
+    if (NULL != used_bytes) {
+        *used_bytes = internal_arena->used;
+    }
+    
+    if (NULL != capacity) {
+        *capacity = internal_arena->capacity;
+    }
+}
+
+
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Arena (bump) allocator that hands out memory from one contiguous block via
+ * the amp_allocator_t interface. Allocation bumps a pointer, deallocation is 
+ * a no-op, and all memory is released at once by resetting the arena or 
+ * releasing it to a previously taken mark.
+ *
+ * Use an arena for bursts of short-lived allocations with a common end of 
+ * life, e.g. to create many mutexes, semaphores, or barriers for one
+ * parallel phase without calling malloc for each. Destroy the primitives 
+ * before resetting the arena or releasing their memory to a mark.
+ *
+ * An arena isn't thread-safe - use one arena per thread or protect it.
+ *
+ * Never pass an allocator not created by amp_arena_allocator_create to the
+ * other arena functions.
+ */
+
+#ifndef AMP_amp_arena_allocator_H
+#define AMP_amp_arena_allocator_H
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+    
+    
+    /**
+     * Position in an arena to release all later allocations to.
+     */
+    typedef size_t amp_arena_allocator_mark_t;
+    
+    
+    /**
+     * Creates an arena allocator able to hand out capacity bytes, minus 
+     * padding to align allocations, using source_allocator to allocate the 
+     * arena and its memory block.
+     *
+     * Allocations return NULL if the arena is exhausted.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if not enough memory is available.
+     *         AMP_ERROR might be returned if capacity is 0.
+     */
+    int amp_arena_allocator_create(amp_allocator_t* arena,
+                                   amp_allocator_t source_allocator,
+                                   size_t capacity);
+    
+    /**
+     * Destroys the arena and frees its memory block with source_allocator 
+     * which must be able to free the memory allocated in 
+     * amp_arena_allocator_create.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_arena_allocator_destroy(amp_allocator_t* arena,
+                                    amp_allocator_t source_allocator);
+    
+    /**
+     * Releases all allocations of the arena at once.
+     */
+    void amp_arena_allocator_reset(amp_allocator_t arena);
+    
+    /**
+     * Returns the current position of the arena in mark to release all 
+     * later allocations via amp_arena_allocator_release_to_mark. Marks can
+     * be nested.
+     */
+    void amp_arena_allocator_get_mark(amp_allocator_t arena,
+                                      amp_arena_allocator_mark_t* mark);
+    
+    /**
+     * Releases all allocations done after mark has been taken. Marks taken 
+     * after mark are invalidated.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_ERROR might be returned if mark lies behind the current 
+     *         position of the arena, e.g. because the arena has been reset
+     *         or released to an earlier mark since mark has been taken.
+     */
+    int amp_arena_allocator_release_to_mark(amp_allocator_t arena,
+                                            amp_arena_allocator_mark_t mark);
+    
+    /**
+     * Returns the number of bytes in use in used_bytes and the capacity of
+     * the arena in capacity, both might be NULL.
+     */
+    void amp_arena_allocator_get_usage(amp_allocator_t arena,
+                                       size_t* used_bytes,
+                                       size_t* capacity);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_arena_allocator_H */
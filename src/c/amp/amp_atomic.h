@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Atomic operations on 32bit and 64bit integers and on pointers.
+ *
+ * amp_atomic offers load, store, exchange, compare-and-exchange and fetch-add
+ * operations. Each operation exists in a sequentially consistent flavor and in
+ * an _explicit flavor that takes the memory order to use. The memory orders
+ * follow the C1x/C++0x memory model. Backends are free to use a stronger
+ * memory order than the one requested, e.g. Windows Interlocked functions
+ * always act as full memory barriers.
+ *
+ * Atomic variables are placed inside other data structures or on the stack by
+ * using the raw types defined in amp_raw_atomic.h - there are no create or
+ * destroy functions as atomics don't own any resources. Set the initial value
+ * via a store (or the AMP_RAW_ATOMIC_*_INITIALIZER macros) before sharing an
+ * atomic variable with other threads.
+ *
+ * Only access atomic variables via the amp_atomic functions, otherwise
+ * behavior is undefined.
+ *
+ * @attention Don't pass NULL or invalid atomic pointers to any of the
+ *            functions.
+ *
+ * @attention Load operations must not use AMP_MEMORY_ORDER_RELEASE or
+ *            AMP_MEMORY_ORDER_ACQ_REL, store operations must not use
+ *            AMP_MEMORY_ORDER_ACQUIRE or AMP_MEMORY_ORDER_ACQ_REL, otherwise
+ *            behavior is undefined.
+ *
+ * TODO: @todo Add fetch_and, fetch_or, and fetch_xor if bit flags are needed.
+ */
+
+#ifndef AMP_amp_atomic_H
+#define AMP_amp_atomic_H
+
+#include <stddef.h>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Memory ordering constraints for atomic operations. Modelled after the
+     * C1x memory_order enumeration (without consume).
+     */
+    enum amp_memory_order {
+        amp_relaxed_memory_order = 0, /**< Only atomicity is guaranteed */
+        amp_acquire_memory_order, /**< Later accesses aren't moved before */
+        amp_release_memory_order, /**< Earlier accesses aren't moved after */
+        amp_acq_rel_memory_order, /**< Acquire and release combined */
+        amp_seq_cst_memory_order /**< Single total order of all seq_cst ops */
+    };
+
+    typedef enum amp_memory_order amp_memory_order_t;
+
+
+#define AMP_MEMORY_ORDER_RELAXED (amp_relaxed_memory_order)
+#define AMP_MEMORY_ORDER_ACQUIRE (amp_acquire_memory_order)
+#define AMP_MEMORY_ORDER_RELEASE (amp_release_memory_order)
+#define AMP_MEMORY_ORDER_ACQ_REL (amp_acq_rel_memory_order)
+#define AMP_MEMORY_ORDER_SEQ_CST (amp_seq_cst_memory_order)
+
+
+    /**
+     * Opaque atomic types. See amp_raw_atomic.h for their definitions.
+     */
+    typedef struct amp_raw_atomic_int32_s *amp_atomic_int32_t;
+    typedef struct amp_raw_atomic_int64_s *amp_atomic_int64_t;
+    typedef struct amp_raw_atomic_pointer_s *amp_atomic_pointer_t;
+
+
+
+    /**
+     * Returns the value stored in atomic.
+     */
+    int32_t amp_atomic_int32_load(amp_atomic_int32_t atomic);
+    int32_t amp_atomic_int32_load_explicit(amp_atomic_int32_t atomic,
+                                           amp_memory_order_t order);
+
+    /**
+     * Stores value in atomic.
+     */
+    void amp_atomic_int32_store(amp_atomic_int32_t atomic,
+                                int32_t value);
+    void amp_atomic_int32_store_explicit(amp_atomic_int32_t atomic,
+                                         int32_t value,
+                                         amp_memory_order_t order);
+
+    /**
+     * Stores value in atomic and returns the previously stored value.
+     */
+    int32_t amp_atomic_int32_exchange(amp_atomic_int32_t atomic,
+                                      int32_t value);
+    int32_t amp_atomic_int32_exchange_explicit(amp_atomic_int32_t atomic,
+                                               int32_t value,
+                                               amp_memory_order_t order);
+
+    /**
+     * Stores desired in atomic if atomic contains the value expected points
+     * to and returns AMP_TRUE. Otherwise the value of atomic is stored where
+     * expected points to and AMP_FALSE is returned.
+     *
+     * Doesn't fail spuriously.
+     *
+     * failure_order must not be stronger than success_order and must not be
+     * AMP_MEMORY_ORDER_RELEASE or AMP_MEMORY_ORDER_ACQ_REL.
+     */
+    amp_bool_t amp_atomic_int32_compare_exchange(amp_atomic_int32_t atomic,
+                                                 int32_t* expected,
+                                                 int32_t desired);
+    amp_bool_t amp_atomic_int32_compare_exchange_explicit(amp_atomic_int32_t atomic,
+                                                          int32_t* expected,
+                                                          int32_t desired,
+                                                          amp_memory_order_t success_order,
+                                                          amp_memory_order_t failure_order);
+
+    /**
+     * Adds value to atomic and returns the value atomic had before the
+     * addition. Pass a negative value to subtract. Overflow wraps around.
+     */
+    int32_t amp_atomic_int32_fetch_add(amp_atomic_int32_t atomic,
+                                       int32_t value);
+    int32_t amp_atomic_int32_fetch_add_explicit(amp_atomic_int32_t atomic,
+                                                int32_t value,
+                                                amp_memory_order_t order);
+
+
+
+    /**
+     * 64bit versions of the int32 functions. Atomic even on 32bit platforms
+     * that offer a double-word compare-and-exchange instruction.
+     */
+    int64_t amp_atomic_int64_load(amp_atomic_int64_t atomic);
+    int64_t amp_atomic_int64_load_explicit(amp_atomic_int64_t atomic,
+                                           amp_memory_order_t order);
+
+    void amp_atomic_int64_store(amp_atomic_int64_t atomic,
+                                int64_t value);
+    void amp_atomic_int64_store_explicit(amp_atomic_int64_t atomic,
+                                         int64_t value,
+                                         amp_memory_order_t order);
+
+    int64_t amp_atomic_int64_exchange(amp_atomic_int64_t atomic,
+                                      int64_t value);
+    int64_t amp_atomic_int64_exchange_explicit(amp_atomic_int64_t atomic,
+                                               int64_t value,
+                                               amp_memory_order_t order);
+
+    amp_bool_t amp_atomic_int64_compare_exchange(amp_atomic_int64_t atomic,
+                                                 int64_t* expected,
+                                                 int64_t desired);
+    amp_bool_t amp_atomic_int64_compare_exchange_explicit(amp_atomic_int64_t atomic,
+                                                          int64_t* expected,
+                                                          int64_t desired,
+                                                          amp_memory_order_t success_order,
+                                                          amp_memory_order_t failure_order);
+
+    int64_t amp_atomic_int64_fetch_add(amp_atomic_int64_t atomic,
+                                       int64_t value);
+    int64_t amp_atomic_int64_fetch_add_explicit(amp_atomic_int64_t atomic,
+                                                int64_t value,
+                                                amp_memory_order_t order);
+
+
+
+    /**
+     * Pointer versions of the int32 functions. fetch_add adds byte_offset
+     * bytes to the stored address.
+     */
+    void* amp_atomic_pointer_load(amp_atomic_pointer_t atomic);
+    void* amp_atomic_pointer_load_explicit(amp_atomic_pointer_t atomic,
+                                           amp_memory_order_t order);
+
+    void amp_atomic_pointer_store(amp_atomic_pointer_t atomic,
+                                  void* value);
+    void amp_atomic_pointer_store_explicit(amp_atomic_pointer_t atomic,
+                                           void* value,
+                                           amp_memory_order_t order);
+
+    void* amp_atomic_pointer_exchange(amp_atomic_pointer_t atomic,
+                                      void* value);
+    void* amp_atomic_pointer_exchange_explicit(amp_atomic_pointer_t atomic,
+                                               void* value,
+                                               amp_memory_order_t order);
+
+    amp_bool_t amp_atomic_pointer_compare_exchange(amp_atomic_pointer_t atomic,
+                                                   void** expected,
+                                                   void* desired);
+    amp_bool_t amp_atomic_pointer_compare_exchange_explicit(amp_atomic_pointer_t atomic,
+                                                            void** expected,
+                                                            void* desired,
+                                                            amp_memory_order_t success_order,
+                                                            amp_memory_order_t failure_order);
+
+    void* amp_atomic_pointer_fetch_add(amp_atomic_pointer_t atomic,
+                                       ptrdiff_t byte_offset);
+    void* amp_atomic_pointer_fetch_add_explicit(amp_atomic_pointer_t atomic,
+                                                ptrdiff_t byte_offset,
+                                                amp_memory_order_t order);
+
+
+
+    /**
+     * Memory fence with the given ordering that isn't bound to a specific
+     * atomic variable. AMP_MEMORY_ORDER_RELAXED is a no-op.
+     */
+    void amp_atomic_thread_fence(amp_memory_order_t order);
+    
+    
+    /**
+     * Hints the processor that the calling thread is busy-waiting, e.g.
+     * via the x86 PAUSE or the ARM YIELD instruction. Call inside spin loops
+     * to reduce power consumption and to free resources for a sibling
+     * hardware thread. Has no memory ordering effects.
+     */
+    void amp_atomic_spin_pause(void);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_atomic_H */
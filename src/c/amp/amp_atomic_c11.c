@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Atomic operations backend based on the C1x stdatomic.h header. This source
+ * file must be compiled in C1x (C11) mode.
+ *
+ * The raw atomic structs contain plain integer and pointer fields because the
+ * raw headers are also included from C++ code. The fields are accessed as
+ * _Atomic qualified objects of the same size and alignment.
+ */
+
+#include "amp_atomic.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_raw_atomic.h"
+
+
+
+#if !defined(AMP_USE_C11_ATOMICS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+/**
+ * Maps amp memory orders to the C1x memory orders.
+ */
+static memory_order amp_internal_c11_order(amp_memory_order_t order);
+
+
+
+static memory_order amp_internal_c11_order(amp_memory_order_t order)
+{
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return memory_order_relaxed;
+        case amp_acquire_memory_order:
+            return memory_order_acquire;
+        case amp_release_memory_order:
+            return memory_order_release;
+        case amp_acq_rel_memory_order:
+            return memory_order_acq_rel;
+        default:
+            return memory_order_seq_cst;
+    }
+}
+
+
+
+int32_t amp_atomic_int32_load(amp_atomic_int32_t atomic)
+{
+    assert(NULL != atomic);
+
+    return atomic_load((_Atomic(int32_t)*)&atomic->value);
+}
+
+
+
+int32_t amp_atomic_int32_load_explicit(amp_atomic_int32_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_load_explicit((_Atomic(int32_t)*)&atomic->value,
+                                amp_internal_c11_order(order));
+}
+
+
+
+void amp_atomic_int32_store(amp_atomic_int32_t atomic,
+                            int32_t value)
+{
+    assert(NULL != atomic);
+
+    atomic_store((_Atomic(int32_t)*)&atomic->value, value);
+}
+
+
+
+void amp_atomic_int32_store_explicit(amp_atomic_int32_t atomic,
+                                     int32_t value,
+                                     amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    atomic_store_explicit((_Atomic(int32_t)*)&atomic->value,
+                          value,
+                          amp_internal_c11_order(order));
+}
+
+
+
+int32_t amp_atomic_int32_exchange(amp_atomic_int32_t atomic,
+                                  int32_t value)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange((_Atomic(int32_t)*)&atomic->value, value);
+}
+
+
+
+int32_t amp_atomic_int32_exchange_explicit(amp_atomic_int32_t atomic,
+                                           int32_t value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange_explicit((_Atomic(int32_t)*)&atomic->value,
+                                    value,
+                                    amp_internal_c11_order(order));
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange(amp_atomic_int32_t atomic,
+                                             int32_t* expected,
+                                             int32_t desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong((_Atomic(int32_t)*)&atomic->value,
+                                          expected,
+                                          desired) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange_explicit(amp_atomic_int32_t atomic,
+                                                      int32_t* expected,
+                                                      int32_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong_explicit((_Atomic(int32_t)*)&atomic->value,
+                                                   expected,
+                                                   desired,
+                                                   amp_internal_c11_order(success_order),
+                                                   amp_internal_c11_order(failure_order)) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add(amp_atomic_int32_t atomic,
+                                   int32_t value)
+{
+    assert(NULL != atomic);
+
+    return atomic_fetch_add((_Atomic(int32_t)*)&atomic->value, value);
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add_explicit(amp_atomic_int32_t atomic,
+                                            int32_t value,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_fetch_add_explicit((_Atomic(int32_t)*)&atomic->value,
+                                     value,
+                                     amp_internal_c11_order(order));
+}
+
+
+
+int64_t amp_atomic_int64_load(amp_atomic_int64_t atomic)
+{
+    assert(NULL != atomic);
+
+    return atomic_load((_Atomic(int64_t)*)&atomic->value);
+}
+
+
+
+int64_t amp_atomic_int64_load_explicit(amp_atomic_int64_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_load_explicit((_Atomic(int64_t)*)&atomic->value,
+                                amp_internal_c11_order(order));
+}
+
+
+
+void amp_atomic_int64_store(amp_atomic_int64_t atomic,
+                            int64_t value)
+{
+    assert(NULL != atomic);
+
+    atomic_store((_Atomic(int64_t)*)&atomic->value, value);
+}
+
+
+
+void amp_atomic_int64_store_explicit(amp_atomic_int64_t atomic,
+                                     int64_t value,
+                                     amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    atomic_store_explicit((_Atomic(int64_t)*)&atomic->value,
+                          value,
+                          amp_internal_c11_order(order));
+}
+
+
+
+int64_t amp_atomic_int64_exchange(amp_atomic_int64_t atomic,
+                                  int64_t value)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange((_Atomic(int64_t)*)&atomic->value, value);
+}
+
+
+
+int64_t amp_atomic_int64_exchange_explicit(amp_atomic_int64_t atomic,
+                                           int64_t value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange_explicit((_Atomic(int64_t)*)&atomic->value,
+                                    value,
+                                    amp_internal_c11_order(order));
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange(amp_atomic_int64_t atomic,
+                                             int64_t* expected,
+                                             int64_t desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong((_Atomic(int64_t)*)&atomic->value,
+                                          expected,
+                                          desired) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange_explicit(amp_atomic_int64_t atomic,
+                                                      int64_t* expected,
+                                                      int64_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong_explicit((_Atomic(int64_t)*)&atomic->value,
+                                                   expected,
+                                                   desired,
+                                                   amp_internal_c11_order(success_order),
+                                                   amp_internal_c11_order(failure_order)) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add(amp_atomic_int64_t atomic,
+                                   int64_t value)
+{
+    assert(NULL != atomic);
+
+    return atomic_fetch_add((_Atomic(int64_t)*)&atomic->value, value);
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add_explicit(amp_atomic_int64_t atomic,
+                                            int64_t value,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_fetch_add_explicit((_Atomic(int64_t)*)&atomic->value,
+                                     value,
+                                     amp_internal_c11_order(order));
+}
+
+
+
+void* amp_atomic_pointer_load(amp_atomic_pointer_t atomic)
+{
+    assert(NULL != atomic);
+
+    return atomic_load((_Atomic(void*)*)&atomic->value);
+}
+
+
+
+void* amp_atomic_pointer_load_explicit(amp_atomic_pointer_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_load_explicit((_Atomic(void*)*)&atomic->value,
+                                amp_internal_c11_order(order));
+}
+
+
+
+void amp_atomic_pointer_store(amp_atomic_pointer_t atomic,
+                              void* value)
+{
+    assert(NULL != atomic);
+
+    atomic_store((_Atomic(void*)*)&atomic->value, value);
+}
+
+
+
+void amp_atomic_pointer_store_explicit(amp_atomic_pointer_t atomic,
+                                       void* value,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    atomic_store_explicit((_Atomic(void*)*)&atomic->value,
+                          value,
+                          amp_internal_c11_order(order));
+}
+
+
+
+void* amp_atomic_pointer_exchange(amp_atomic_pointer_t atomic,
+                                  void* value)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange((_Atomic(void*)*)&atomic->value, value);
+}
+
+
+
+void* amp_atomic_pointer_exchange_explicit(amp_atomic_pointer_t atomic,
+                                           void* value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    return atomic_exchange_explicit((_Atomic(void*)*)&atomic->value,
+                                    value,
+                                    amp_internal_c11_order(order));
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange(amp_atomic_pointer_t atomic,
+                                               void** expected,
+                                               void* desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong((_Atomic(void*)*)&atomic->value,
+                                          expected,
+                                          desired) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange_explicit(amp_atomic_pointer_t atomic,
+                                                        void** expected,
+                                                        void* desired,
+                                                        amp_memory_order_t success_order,
+                                                        amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return atomic_compare_exchange_strong_explicit((_Atomic(void*)*)&atomic->value,
+                                                   expected,
+                                                   desired,
+                                                   amp_internal_c11_order(success_order),
+                                                   amp_internal_c11_order(failure_order)) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+void* amp_atomic_pointer_fetch_add(amp_atomic_pointer_t atomic,
+                                   ptrdiff_t byte_offset)
+{
+    return amp_atomic_pointer_fetch_add_explicit(atomic,
+                                                 byte_offset,
+                                                 AMP_MEMORY_ORDER_SEQ_CST);
+}
+
+
+
+void* amp_atomic_pointer_fetch_add_explicit(amp_atomic_pointer_t atomic,
+                                            ptrdiff_t byte_offset,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    /* atomic_fetch_add on pointers scales by the pointee size, therefore
+     * add the byte offset via a compare-exchange loop.
+     */
+    void* expected = atomic_load_explicit((_Atomic(void*)*)&atomic->value,
+                                          memory_order_relaxed);
+    while (AMP_FALSE == amp_atomic_pointer_compare_exchange_explicit(atomic,
+                                                                     &expected,
+                                                                     (char*)expected + byte_offset,
+                                                                     order,
+                                                                     AMP_MEMORY_ORDER_RELAXED)) {
+        /* expected has been updated, try again. */
+    }
+
+    return expected;
+}
+
+
+
+void amp_atomic_thread_fence(amp_memory_order_t order)
+{
+    if (AMP_MEMORY_ORDER_RELAXED != order) {
+        atomic_thread_fence(amp_internal_c11_order(order));
+    }
+}
+
+
+
+void amp_atomic_spin_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__ ("yield" ::: "memory");
+#else
+    atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+
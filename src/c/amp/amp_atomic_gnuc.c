@@ -0,0 +1,642 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Atomic operations backend based on the __atomic builtins of gcc (4.7 and
+ * later) and clang.
+ *
+ * The builtins treat memory orders that aren't compile-time constants as
+ * sequentially consistent, therefore all _explicit functions switch over the
+ * requested order and call the builtins with constant orders.
+ */
+
+#include "amp_atomic.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_raw_atomic.h"
+
+
+
+#if !defined(AMP_USE_GNUC_ATOMICS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+/**
+ * Returns a success order for compare-exchange that is at least as strong as
+ * failure_order so the failure order can be derived from the success order.
+ */
+static amp_memory_order_t amp_internal_combined_cas_order(amp_memory_order_t success_order,
+                                                          amp_memory_order_t failure_order);
+
+
+
+static amp_memory_order_t amp_internal_combined_cas_order(amp_memory_order_t success_order,
+                                                          amp_memory_order_t failure_order)
+{
+    assert((AMP_MEMORY_ORDER_RELEASE != failure_order)
+           && (AMP_MEMORY_ORDER_ACQ_REL != failure_order));
+
+    if (AMP_MEMORY_ORDER_SEQ_CST == failure_order) {
+        return AMP_MEMORY_ORDER_SEQ_CST;
+    }
+
+    if (AMP_MEMORY_ORDER_ACQUIRE == failure_order) {
+        if (AMP_MEMORY_ORDER_RELAXED == success_order) {
+            return AMP_MEMORY_ORDER_ACQUIRE;
+        } else if (AMP_MEMORY_ORDER_RELEASE == success_order) {
+            return AMP_MEMORY_ORDER_ACQ_REL;
+        }
+    }
+
+    return success_order;
+}
+
+
+
+int32_t amp_atomic_int32_load(amp_atomic_int32_t atomic)
+{
+    assert(NULL != atomic);
+
+    return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int32_t amp_atomic_int32_load_explicit(amp_atomic_int32_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_ACQUIRE);
+        default:
+            return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void amp_atomic_int32_store(amp_atomic_int32_t atomic,
+                            int32_t value)
+{
+    assert(NULL != atomic);
+
+    __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+void amp_atomic_int32_store_explicit(amp_atomic_int32_t atomic,
+                                     int32_t value,
+                                     amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELAXED);
+            break;
+        case amp_release_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELEASE);
+            break;
+        default:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+int32_t amp_atomic_int32_exchange(amp_atomic_int32_t atomic,
+                                  int32_t value)
+{
+    assert(NULL != atomic);
+
+    return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int32_t amp_atomic_int32_exchange_explicit(amp_atomic_int32_t atomic,
+                                           int32_t value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQUIRE);
+        case amp_release_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELEASE);
+        case amp_acq_rel_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQ_REL);
+        default:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange(amp_atomic_int32_t atomic,
+                                             int32_t* expected,
+                                             int32_t desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return __atomic_compare_exchange_n(&atomic->value, expected, desired, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange_explicit(amp_atomic_int32_t atomic,
+                                                      int32_t* expected,
+                                                      int32_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    int32_t* const value = &atomic->value;
+    int exchanged = 0;
+
+    switch (amp_internal_combined_cas_order(success_order, failure_order)) {
+        case amp_relaxed_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            break;
+        case amp_acquire_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+            break;
+        case amp_release_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            break;
+        case amp_acq_rel_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            break;
+        default:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    return exchanged ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add(amp_atomic_int32_t atomic,
+                                   int32_t value)
+{
+    assert(NULL != atomic);
+
+    return __atomic_fetch_add(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add_explicit(amp_atomic_int32_t atomic,
+                                            int32_t value,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_ACQUIRE);
+        case amp_release_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_RELEASE);
+        case amp_acq_rel_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_ACQ_REL);
+        default:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+int64_t amp_atomic_int64_load(amp_atomic_int64_t atomic)
+{
+    assert(NULL != atomic);
+
+    return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int64_t amp_atomic_int64_load_explicit(amp_atomic_int64_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_ACQUIRE);
+        default:
+            return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void amp_atomic_int64_store(amp_atomic_int64_t atomic,
+                            int64_t value)
+{
+    assert(NULL != atomic);
+
+    __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+void amp_atomic_int64_store_explicit(amp_atomic_int64_t atomic,
+                                     int64_t value,
+                                     amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELAXED);
+            break;
+        case amp_release_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELEASE);
+            break;
+        default:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+int64_t amp_atomic_int64_exchange(amp_atomic_int64_t atomic,
+                                  int64_t value)
+{
+    assert(NULL != atomic);
+
+    return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int64_t amp_atomic_int64_exchange_explicit(amp_atomic_int64_t atomic,
+                                           int64_t value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQUIRE);
+        case amp_release_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELEASE);
+        case amp_acq_rel_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQ_REL);
+        default:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange(amp_atomic_int64_t atomic,
+                                             int64_t* expected,
+                                             int64_t desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return __atomic_compare_exchange_n(&atomic->value, expected, desired, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange_explicit(amp_atomic_int64_t atomic,
+                                                      int64_t* expected,
+                                                      int64_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    int64_t* const value = &atomic->value;
+    int exchanged = 0;
+
+    switch (amp_internal_combined_cas_order(success_order, failure_order)) {
+        case amp_relaxed_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            break;
+        case amp_acquire_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+            break;
+        case amp_release_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            break;
+        case amp_acq_rel_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            break;
+        default:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    return exchanged ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add(amp_atomic_int64_t atomic,
+                                   int64_t value)
+{
+    assert(NULL != atomic);
+
+    return __atomic_fetch_add(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add_explicit(amp_atomic_int64_t atomic,
+                                            int64_t value,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_ACQUIRE);
+        case amp_release_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_RELEASE);
+        case amp_acq_rel_memory_order:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_ACQ_REL);
+        default:
+            return __atomic_fetch_add(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void* amp_atomic_pointer_load(amp_atomic_pointer_t atomic)
+{
+    assert(NULL != atomic);
+
+    return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+}
+
+
+
+void* amp_atomic_pointer_load_explicit(amp_atomic_pointer_t atomic,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_load_n(&atomic->value, __ATOMIC_ACQUIRE);
+        default:
+            return __atomic_load_n(&atomic->value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void amp_atomic_pointer_store(amp_atomic_pointer_t atomic,
+                              void* value)
+{
+    assert(NULL != atomic);
+
+    __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+void amp_atomic_pointer_store_explicit(amp_atomic_pointer_t atomic,
+                                       void* value,
+                                       amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELAXED);
+            break;
+        case amp_release_memory_order:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_RELEASE);
+            break;
+        default:
+            __atomic_store_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void* amp_atomic_pointer_exchange(amp_atomic_pointer_t atomic,
+                                  void* value)
+{
+    assert(NULL != atomic);
+
+    return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+
+
+void* amp_atomic_pointer_exchange_explicit(amp_atomic_pointer_t atomic,
+                                           void* value,
+                                           amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    switch (order) {
+        case amp_relaxed_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELAXED);
+        case amp_acquire_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQUIRE);
+        case amp_release_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_RELEASE);
+        case amp_acq_rel_memory_order:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_ACQ_REL);
+        default:
+            return __atomic_exchange_n(&atomic->value, value, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange(amp_atomic_pointer_t atomic,
+                                               void** expected,
+                                               void* desired)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    return __atomic_compare_exchange_n(&atomic->value, expected, desired, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange_explicit(amp_atomic_pointer_t atomic,
+                                                        void** expected,
+                                                        void* desired,
+                                                        amp_memory_order_t success_order,
+                                                        amp_memory_order_t failure_order)
+{
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    void** const value = &atomic->value;
+    int exchanged = 0;
+
+    switch (amp_internal_combined_cas_order(success_order, failure_order)) {
+        case amp_relaxed_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            break;
+        case amp_acquire_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+            break;
+        case amp_release_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            break;
+        case amp_acq_rel_memory_order:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            break;
+        default:
+            exchanged = __atomic_compare_exchange_n(value, expected, desired, 0,
+                                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    return exchanged ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+void* amp_atomic_pointer_fetch_add(amp_atomic_pointer_t atomic,
+                                   ptrdiff_t byte_offset)
+{
+    return amp_atomic_pointer_fetch_add_explicit(atomic,
+                                                 byte_offset,
+                                                 AMP_MEMORY_ORDER_SEQ_CST);
+}
+
+
+
+void* amp_atomic_pointer_fetch_add_explicit(amp_atomic_pointer_t atomic,
+                                            ptrdiff_t byte_offset,
+                                            amp_memory_order_t order)
+{
+    assert(NULL != atomic);
+
+    /* Pointer arithmetic of the builtins differs between gcc and clang,
+     * therefore add the byte offset via a compare-exchange loop.
+     */
+    void* expected = __atomic_load_n(&atomic->value, __ATOMIC_RELAXED);
+    while (AMP_FALSE == amp_atomic_pointer_compare_exchange_explicit(atomic,
+                                                                     &expected,
+                                                                     (char*)expected + byte_offset,
+                                                                     order,
+                                                                     AMP_MEMORY_ORDER_RELAXED)) {
+        /* expected has been updated, try again. */
+    }
+
+    return expected;
+}
+
+
+
+void amp_atomic_thread_fence(amp_memory_order_t order)
+{
+    switch (order) {
+        case amp_relaxed_memory_order:
+            break;
+        case amp_acquire_memory_order:
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            break;
+        case amp_release_memory_order:
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            break;
+        case amp_acq_rel_memory_order:
+            __atomic_thread_fence(__ATOMIC_ACQ_REL);
+            break;
+        default:
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+
+
+void amp_atomic_spin_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__ ("yield" ::: "memory");
+#else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+
@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Atomic operations backend based on the Windows Interlocked functions.
+ *
+ * All Interlocked functions act as full memory barriers, therefore the
+ * requested memory orders are ignored and every operation is sequentially
+ * consistent. 64bit operations are implemented via
+ * InterlockedCompareExchange64 loops to also work on 32bit Windows.
+ */
+
+#include "amp_atomic.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_raw_atomic.h"
+
+
+
+#if !defined(AMP_USE_WINTHREADS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+int32_t amp_atomic_int32_load(amp_atomic_int32_t atomic)
+{
+    assert(NULL != atomic);
+
+    return (int32_t)InterlockedCompareExchange((LONG volatile*)&atomic->value, 0, 0);
+}
+
+
+
+int32_t amp_atomic_int32_load_explicit(amp_atomic_int32_t atomic,
+                                       amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int32_load(atomic);
+}
+
+
+
+void amp_atomic_int32_store(amp_atomic_int32_t atomic,
+                            int32_t value)
+{
+    assert(NULL != atomic);
+
+    (void)InterlockedExchange((LONG volatile*)&atomic->value, (LONG)value);
+}
+
+
+
+void amp_atomic_int32_store_explicit(amp_atomic_int32_t atomic,
+                                     int32_t value,
+                                     amp_memory_order_t order)
+{
+    (void)order;
+
+    amp_atomic_int32_store(atomic, value);
+}
+
+
+
+int32_t amp_atomic_int32_exchange(amp_atomic_int32_t atomic,
+                                  int32_t value)
+{
+    assert(NULL != atomic);
+
+    return (int32_t)InterlockedExchange((LONG volatile*)&atomic->value, (LONG)value);
+}
+
+
+
+int32_t amp_atomic_int32_exchange_explicit(amp_atomic_int32_t atomic,
+                                           int32_t value,
+                                           amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int32_exchange(atomic, value);
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange(amp_atomic_int32_t atomic,
+                                             int32_t* expected,
+                                             int32_t desired)
+{
+    int32_t previous = 0;
+
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    previous = (int32_t)InterlockedCompareExchange((LONG volatile*)&atomic->value,
+                                                   (LONG)desired,
+                                                   (LONG)*expected);
+    if (previous == *expected) {
+        return AMP_TRUE;
+    }
+
+    *expected = previous;
+
+    return AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int32_compare_exchange_explicit(amp_atomic_int32_t atomic,
+                                                      int32_t* expected,
+                                                      int32_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    (void)success_order;
+    (void)failure_order;
+
+    return amp_atomic_int32_compare_exchange(atomic, expected, desired);
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add(amp_atomic_int32_t atomic,
+                                   int32_t value)
+{
+    assert(NULL != atomic);
+
+    return (int32_t)InterlockedExchangeAdd((LONG volatile*)&atomic->value, (LONG)value);
+}
+
+
+
+int32_t amp_atomic_int32_fetch_add_explicit(amp_atomic_int32_t atomic,
+                                            int32_t value,
+                                            amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int32_fetch_add(atomic, value);
+}
+
+
+
+int64_t amp_atomic_int64_load(amp_atomic_int64_t atomic)
+{
+    assert(NULL != atomic);
+
+    return (int64_t)InterlockedCompareExchange64((LONGLONG volatile*)&atomic->value, 0, 0);
+}
+
+
+
+int64_t amp_atomic_int64_load_explicit(amp_atomic_int64_t atomic,
+                                       amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int64_load(atomic);
+}
+
+
+
+void amp_atomic_int64_store(amp_atomic_int64_t atomic,
+                            int64_t value)
+{
+    (void)amp_atomic_int64_exchange(atomic, value);
+}
+
+
+
+void amp_atomic_int64_store_explicit(amp_atomic_int64_t atomic,
+                                     int64_t value,
+                                     amp_memory_order_t order)
+{
+    (void)order;
+
+    amp_atomic_int64_store(atomic, value);
+}
+
+
+
+int64_t amp_atomic_int64_exchange(amp_atomic_int64_t atomic,
+                                  int64_t value)
+{
+    int64_t expected = 0;
+
+    assert(NULL != atomic);
+
+    expected = atomic->value;
+    while (AMP_FALSE == amp_atomic_int64_compare_exchange(atomic, &expected, value)) {
+        /* expected has been updated, try again. */
+    }
+
+    return expected;
+}
+
+
+
+int64_t amp_atomic_int64_exchange_explicit(amp_atomic_int64_t atomic,
+                                           int64_t value,
+                                           amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int64_exchange(atomic, value);
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange(amp_atomic_int64_t atomic,
+                                             int64_t* expected,
+                                             int64_t desired)
+{
+    int64_t previous = 0;
+
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    previous = (int64_t)InterlockedCompareExchange64((LONGLONG volatile*)&atomic->value,
+                                                     (LONGLONG)desired,
+                                                     (LONGLONG)*expected);
+    if (previous == *expected) {
+        return AMP_TRUE;
+    }
+
+    *expected = previous;
+
+    return AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_int64_compare_exchange_explicit(amp_atomic_int64_t atomic,
+                                                      int64_t* expected,
+                                                      int64_t desired,
+                                                      amp_memory_order_t success_order,
+                                                      amp_memory_order_t failure_order)
+{
+    (void)success_order;
+    (void)failure_order;
+
+    return amp_atomic_int64_compare_exchange(atomic, expected, desired);
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add(amp_atomic_int64_t atomic,
+                                   int64_t value)
+{
+    int64_t expected = 0;
+
+    assert(NULL != atomic);
+
+    expected = atomic->value;
+    while (AMP_FALSE == amp_atomic_int64_compare_exchange(atomic, &expected, expected + value)) {
+        /* expected has been updated, try again. */
+    }
+
+    return expected;
+}
+
+
+
+int64_t amp_atomic_int64_fetch_add_explicit(amp_atomic_int64_t atomic,
+                                            int64_t value,
+                                            amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_int64_fetch_add(atomic, value);
+}
+
+
+
+void* amp_atomic_pointer_load(amp_atomic_pointer_t atomic)
+{
+    assert(NULL != atomic);
+
+    return InterlockedCompareExchangePointer((PVOID volatile*)&atomic->value, NULL, NULL);
+}
+
+
+
+void* amp_atomic_pointer_load_explicit(amp_atomic_pointer_t atomic,
+                                       amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_pointer_load(atomic);
+}
+
+
+
+void amp_atomic_pointer_store(amp_atomic_pointer_t atomic,
+                              void* value)
+{
+    assert(NULL != atomic);
+
+    (void)InterlockedExchangePointer((PVOID volatile*)&atomic->value, value);
+}
+
+
+
+void amp_atomic_pointer_store_explicit(amp_atomic_pointer_t atomic,
+                                       void* value,
+                                       amp_memory_order_t order)
+{
+    (void)order;
+
+    amp_atomic_pointer_store(atomic, value);
+}
+
+
+
+void* amp_atomic_pointer_exchange(amp_atomic_pointer_t atomic,
+                                  void* value)
+{
+    assert(NULL != atomic);
+
+    return InterlockedExchangePointer((PVOID volatile*)&atomic->value, value);
+}
+
+
+
+void* amp_atomic_pointer_exchange_explicit(amp_atomic_pointer_t atomic,
+                                           void* value,
+                                           amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_pointer_exchange(atomic, value);
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange(amp_atomic_pointer_t atomic,
+                                               void** expected,
+                                               void* desired)
+{
+    void* previous = NULL;
+
+    assert(NULL != atomic);
+    assert(NULL != expected);
+
+    previous = InterlockedCompareExchangePointer((PVOID volatile*)&atomic->value,
+                                                 desired,
+                                                 *expected);
+    if (previous == *expected) {
+        return AMP_TRUE;
+    }
+
+    *expected = previous;
+
+    return AMP_FALSE;
+}
+
+
+
+amp_bool_t amp_atomic_pointer_compare_exchange_explicit(amp_atomic_pointer_t atomic,
+                                                        void** expected,
+                                                        void* desired,
+                                                        amp_memory_order_t success_order,
+                                                        amp_memory_order_t failure_order)
+{
+    (void)success_order;
+    (void)failure_order;
+
+    return amp_atomic_pointer_compare_exchange(atomic, expected, desired);
+}
+
+
+
+void* amp_atomic_pointer_fetch_add(amp_atomic_pointer_t atomic,
+                                   ptrdiff_t byte_offset)
+{
+    void* expected = NULL;
+
+    assert(NULL != atomic);
+
+    expected = atomic->value;
+    while (AMP_FALSE == amp_atomic_pointer_compare_exchange(atomic,
+                                                            &expected,
+                                                            (char*)expected + byte_offset)) {
+        /* expected has been updated, try again. */
+    }
+
+    return expected;
+}
+
+
+
+void* amp_atomic_pointer_fetch_add_explicit(amp_atomic_pointer_t atomic,
+                                            ptrdiff_t byte_offset,
+                                            amp_memory_order_t order)
+{
+    (void)order;
+
+    return amp_atomic_pointer_fetch_add(atomic, byte_offset);
+}
+
+
+
+void amp_atomic_thread_fence(amp_memory_order_t order)
+{
+    if (AMP_MEMORY_ORDER_RELAXED != order) {
+        MemoryBarrier();
+    }
+}
+
+
+
+void amp_atomic_spin_pause(void)
+{
+    YieldProcessor();
+}
+
+
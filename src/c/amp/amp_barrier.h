@@ -61,6 +61,7 @@
 
 #include <stddef.h>
 
+#include <amp/amp_stdint.h>
 #include <amp/amp_memory.h>
 
 
@@ -169,6 +170,31 @@ extern "C" {
      */
     int amp_barrier_wait(amp_barrier_t barrier);
     
+    /**
+     * Like amp_barrier_wait but gives up after timeout_ns nanoseconds,
+     * measured on a monotonic clock, if not enough threads arrived at the 
+     * barrier. A timed out thread withdraws its arrival, the barrier then
+     * waits for another thread to take its place in the current phase.
+     *
+     * Backends that combine arrivals (tree barrier) can't withdraw an arrival
+     * that has already been combined with the arrivals of other threads. 
+     * Such a thread waits until the combining thread either completes the
+     * phase or withdraws itself, therefore it might return later than the
+     * timeout.
+     *
+     * @return AMP_SUCCESS or AMP_BARRIER_SERIAL_THREAD like 
+     *         amp_barrier_wait.
+     *         AMP_TIMEOUT if the timeout expired and the arrival of the
+     *         calling thread has been withdrawn.
+     *         Error codes might be returned to signal 
+     *         errors, too. These are programming errors and mustn't 
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     *         AMP_ERROR might be returned if barrier is not valid.
+     */
+    int amp_barrier_timedwait(amp_barrier_t barrier,
+                              uint64_t timeout_ns);
+    
     
     
 #if defined(__cplusplus)
@@ -42,6 +42,7 @@
 
 #include "amp_stddef.h"
 #include "amp_return_code.h"
+#include "amp_memory.h"
 
 
 
@@ -50,6 +51,9 @@ int amp_barrier_create(amp_barrier_t* barrier,
                        amp_barrier_count_t init_count)
 {
     amp_barrier_t tmp_barrier = AMP_BARRIER_UNINITIALIZED;
+    size_t const header_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_barrier));
+    size_t memory_size = 0;
+    void* memory = NULL;
     int retval = AMP_UNSUPPORTED;
     
     assert(NULL != barrier);
@@ -63,17 +67,30 @@ int amp_barrier_create(amp_barrier_t* barrier,
     
     *barrier = AMP_BARRIER_UNINITIALIZED;
     
-    tmp_barrier = (amp_barrier_t)AMP_ALLOC(allocator,
-                                           sizeof(*tmp_barrier));
+    /* Backends needing memory get it behind the barrier from the same 
+     * allocation.
+     */
+    memory_size = amp_raw_barrier_memory_size(init_count);
+    if (memory_size > (AMP_SIZE_MAX - header_size)) {
+        return AMP_NOMEM;
+    }
+    
+    tmp_barrier = (amp_barrier_t)AMP_ALIGNED_ALLOC(allocator,
+                                                   AMP_CACHE_LINE_SIZE,
+                                                   header_size + memory_size);
     if (NULL == tmp_barrier) {
         return AMP_NOMEM;
     }
     
-    retval = amp_raw_barrier_init(tmp_barrier, init_count);
+    if (0 != memory_size) {
+        memory = (char*)tmp_barrier + header_size;
+    }
+    
+    retval = amp_raw_barrier_init(tmp_barrier, init_count, memory);
     if (AMP_SUCCESS == retval) {
         *barrier = tmp_barrier;
     } else {
-        int const rv = AMP_DEALLOC(allocator, tmp_barrier);
+        int const rv = AMP_ALIGNED_DEALLOC(allocator, tmp_barrier);
         assert(AMP_SUCCESS == rv);
         (void)rv;
     }
@@ -95,7 +112,7 @@ int amp_barrier_destroy(amp_barrier_t* barrier,
     
     retval = amp_raw_barrier_finalize(*barrier);
     if (AMP_SUCCESS == retval) {
-        retval = AMP_DEALLOC(allocator, *barrier);
+        retval = AMP_ALIGNED_DEALLOC(allocator, *barrier);
         assert(AMP_SUCCESS == retval);
         if (AMP_SUCCESS == retval) {
             *barrier = AMP_BARRIER_UNINITIALIZED;
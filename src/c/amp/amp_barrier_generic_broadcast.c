@@ -48,6 +48,7 @@
 
 #include "amp_stddef.h"
 #include "amp_return_code.h"
+#include "amp_internal_time.h"
 
 
 
@@ -63,12 +64,34 @@ enum amp_internal_raw_barrier_lifecycle_state {
 
 
 
+/**
+ * Shared implementation of wait and timedwait. Waits until the phase
+ * completes or until deadline_ns passed.
+ */
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns);
+
+
+
+size_t amp_raw_barrier_memory_size(amp_barrier_count_t init_count)
+{
+    (void)init_count;
+    
+    return 0;
+}
+
+
+
 int amp_raw_barrier_init(amp_barrier_t barrier,
-                         amp_barrier_count_t init_count)
+                         amp_barrier_count_t init_count,
+                         void* memory)
 {
     int errc = AMP_UNSUPPORTED;
     
+    (void)memory;
+    
     assert(NULL != barrier);
+    assert(NULL == memory);
     assert(0 < init_count);
     
     if (0 == init_count) {
@@ -156,6 +179,24 @@ int amp_raw_barrier_finalize(amp_barrier_t barrier)
 
 
 int amp_barrier_wait(amp_barrier_t barrier)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_barrier_timedwait(amp_barrier_t barrier,
+                          uint64_t timeout_ns)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns)
 {
     int return_code = AMP_UNSUPPORTED;
     int errc = AMP_UNSUPPORTED;
@@ -195,9 +236,25 @@ int amp_barrier_wait(amp_barrier_t barrier)
             amp_barrier_count_t waiting_period = barrier->period;
             
             while (waiting_period == barrier->period) {
-                return_code = amp_condition_variable_wait(&barrier->waking_condition,
-                                                          &barrier->count_mutex);
-                if (AMP_SUCCESS != return_code) {
+                if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+                    return_code = amp_condition_variable_wait(&barrier->waking_condition,
+                                                              &barrier->count_mutex);
+                } else {
+                    return_code = amp_condition_variable_timedwait(&barrier->waking_condition,
+                                                                   &barrier->count_mutex,
+                                                                   amp_internal_time_remaining_ns(deadline_ns));
+                }
+                
+                if (AMP_TIMEOUT == return_code) {
+                    if (waiting_period == barrier->period) {
+                        /* Withdraw the arrival of this thread. */
+                        ++(barrier->count);
+                    } else {
+                        /* The phase completed while timing out. */
+                        return_code = AMP_SUCCESS;
+                    }
+                    break;
+                } else if (AMP_SUCCESS != return_code) {
                     break;
                 }
             }
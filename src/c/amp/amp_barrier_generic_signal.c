@@ -48,6 +48,7 @@
 
 #include "amp_stddef.h"
 #include "amp_return_code.h"
+#include "amp_internal_time.h"
 
 
 
@@ -77,12 +78,58 @@ enum amp_internal_raw_barrier_state {
 
 
 
+/**
+ * Waits on cond like amp_condition_variable_wait if deadline_ns is
+ * AMP_INTERNAL_TIME_INFINITE_DEADLINE, otherwise like 
+ * amp_condition_variable_timedwait until deadline_ns.
+ */
+static int amp_internal_barrier_condition_wait(amp_condition_variable_t cond,
+                                               amp_mutex_t mutex,
+                                               uint64_t deadline_ns);
+
+/**
+ * Shared implementation of wait and timedwait. Waits until the phase
+ * completes or until deadline_ns passed.
+ */
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns);
+
+
+
+static int amp_internal_barrier_condition_wait(amp_condition_variable_t cond,
+                                               amp_mutex_t mutex,
+                                               uint64_t deadline_ns)
+{
+    if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+        return amp_condition_variable_wait(cond, mutex);
+    }
+    
+    return amp_condition_variable_timedwait(cond,
+                                            mutex,
+                                            amp_internal_time_remaining_ns(deadline_ns));
+}
+
+
+
+size_t amp_raw_barrier_memory_size(amp_barrier_count_t init_count)
+{
+    (void)init_count;
+    
+    return 0;
+}
+
+
+
 int amp_raw_barrier_init(amp_barrier_t barrier,
-                         amp_barrier_count_t init_count)
+                         amp_barrier_count_t init_count,
+                         void* memory)
 {
     int errc = AMP_UNSUPPORTED;
     
+    (void)memory;
+    
     assert(NULL != barrier);
+    assert(NULL == memory);
     assert(0 < init_count);
     
     if (0 == init_count) {
@@ -187,6 +234,24 @@ int amp_raw_barrier_finalize(amp_barrier_t barrier)
 
 
 int amp_barrier_wait(amp_barrier_t barrier)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_barrier_timedwait(amp_barrier_t barrier,
+                          uint64_t timeout_ns)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns)
 {
     int return_code = AMP_UNSUPPORTED;
     int ec = AMP_UNSUPPORTED;
@@ -208,10 +273,18 @@ int amp_barrier_wait(amp_barrier_t barrier)
         amp_barrier_count_t current_count = 0;
         
         while (amp_internal_counting_raw_barrier_state != barrier->state) {
-            return_code = amp_condition_variable_wait(&barrier->counting_condition,
-                                                      &barrier->count_mutex);
-            assert(AMP_SUCCESS == return_code);
-            if (AMP_SUCCESS != return_code) {
+            return_code = amp_internal_barrier_condition_wait(&barrier->counting_condition,
+                                                              &barrier->count_mutex,
+                                                              deadline_ns);
+            assert((AMP_SUCCESS == return_code) || (AMP_TIMEOUT == return_code));
+            if (AMP_TIMEOUT == return_code) {
+                if (amp_internal_counting_raw_barrier_state != barrier->state) {
+                    /* Timed out before arriving - nothing to withdraw. */
+                    goto unlock_and_out;
+                }
+                /* Counting resumed while timing out - arrive. */
+                return_code = AMP_SUCCESS;
+            } else if (AMP_SUCCESS != return_code) {
                 goto unlock_and_out;
             }
         }
@@ -227,9 +300,24 @@ int amp_barrier_wait(amp_barrier_t barrier)
                 
                 ec1 = amp_condition_variable_signal(&barrier->counting_condition);
                 assert(AMP_SUCCESS == ec1);
-                ec2 = amp_condition_variable_wait(&barrier->waking_condition,
-                                                  &barrier->count_mutex);
-                assert(AMP_SUCCESS == ec2);
+                ec2 = amp_internal_barrier_condition_wait(&barrier->waking_condition,
+                                                          &barrier->count_mutex,
+                                                          deadline_ns);
+                assert((AMP_SUCCESS == ec2) || (AMP_TIMEOUT == ec2));
+                if (AMP_TIMEOUT == ec2) {
+                    if (amp_internal_waking_raw_barrier_state != barrier->state) {
+                        /* Withdraw the arrival of this thread. The counting
+                         * condition has already been signaled to let the
+                         * next thread arrive.
+                         */
+                        ++(barrier->count);
+                        return_code = AMP_TIMEOUT;
+                        goto unlock_and_out;
+                    }
+                    /* The phase completed while timing out - pass. */
+                    ec2 = AMP_SUCCESS;
+                }
+                
                 if (AMP_SUCCESS != ec1) {
                     return_code = ec1;
                     goto unlock_and_out;
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of amp_barrier as a centralized sense-reversing barrier.
+ *
+ * Arriving threads decrement an atomic counter. The last arriving thread
+ * resets the counter and advances the generation of the barrier which all 
+ * other threads spin on with a processor pause hint. Threads which spin for
+ * longer than AMP_INTERNAL_BARRIER_SPIN_COUNT iterations park on a condition
+ * variable. The last arriving thread only touches the mutex and condition
+ * variable if threads are parked, so short phases never enter the kernel.
+ *
+ * The counter shares one atomic word with the generation so a timed out
+ * thread can withdraw its arrival with a compare-and-swap that fails if the
+ * phase it arrived in has completed in the meantime.
+ *
+ * amp_barrier_create and amp_barrier_destroy are implemented in
+ * amp_barrier_common.c.
+ */
+
+#include "amp_raw_barrier.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_mutex.h"
+#include "amp_raw_mutex.h"
+#include "amp_condition_variable.h"
+#include "amp_raw_condition_variable.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_SPIN_BARRIERS)
+#   error Compiling wrong source file for selected backend.
+#endif
+
+
+
+/**
+ * Number of times a waiting thread checks the generation of the barrier 
+ * before it parks.
+ */
+#define AMP_INTERNAL_BARRIER_SPIN_COUNT 4000
+
+/**
+ * The counter occupies the lower 32 bits of the state word.
+ */
+#define AMP_INTERNAL_BARRIER_MAX_COUNT ((amp_barrier_count_t)0x7fffffff)
+
+/**
+ * Packs generation and count into a state word and extracts them again.
+ */
+#define AMP_INTERNAL_BARRIER_STATE(generation, count) ((int64_t)(((uint64_t)(uint32_t)(generation) << 32) | (uint64_t)(uint32_t)(count)))
+#define AMP_INTERNAL_BARRIER_STATE_GENERATION(state) ((int32_t)(uint32_t)((uint64_t)(state) >> 32))
+#define AMP_INTERNAL_BARRIER_STATE_COUNT(state) ((int32_t)(uint32_t)((uint64_t)(state) & 0xffffffffu))
+
+
+
+enum amp_internal_raw_barrier_lifecycle_state {
+    amp_internal_valid_raw_barrier_lifecycle_state = 0xabcdef
+};
+
+
+
+/**
+ * Blocks the calling thread on the condition variable of barrier until the
+ * generation of barrier differs from local_generation or until deadline_ns
+ * passed.
+ *
+ * @return AMP_SUCCESS after the generation advanced, AMP_TIMEOUT if the
+ *         deadline passed before.
+ */
+static int amp_internal_barrier_park(amp_barrier_t barrier,
+                                     int32_t local_generation,
+                                     uint64_t deadline_ns);
+
+/**
+ * Withdraws the arrival of the calling thread in local_generation.
+ *
+ * @return AMP_TIMEOUT if the arrival has been withdrawn, AMP_SUCCESS if
+ *         the phase completed and the calling thread passed the barrier.
+ */
+static int amp_internal_barrier_withdraw(amp_barrier_t barrier,
+                                         int32_t local_generation);
+
+/**
+ * Shared implementation of wait and timedwait. Waits until the phase
+ * completes or until deadline_ns passed.
+ */
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns);
+
+
+
+static int amp_internal_barrier_park(amp_barrier_t barrier,
+                                     int32_t local_generation,
+                                     uint64_t deadline_ns)
+{
+    int retval = AMP_SUCCESS;
+    int errc = amp_mutex_lock(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc);
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    }
+    {
+        /* Sequentially consistent registration and generation check pair
+         * with the generation advance and parked count check of the last
+         * arriving thread - at least one of both sees the write of the other.
+         */
+        (void)amp_atomic_int32_fetch_add_explicit(&barrier->parked_count,
+                                                  1,
+                                                  AMP_MEMORY_ORDER_SEQ_CST);
+
+        while (local_generation == amp_atomic_int32_load_explicit(&barrier->generation,
+                                                                  AMP_MEMORY_ORDER_SEQ_CST)) {
+            if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+                retval = amp_condition_variable_wait(&barrier->waking_condition,
+                                                     &barrier->park_mutex);
+            } else {
+                retval = amp_condition_variable_timedwait(&barrier->waking_condition,
+                                                          &barrier->park_mutex,
+                                                          amp_internal_time_remaining_ns(deadline_ns));
+            }
+            
+            if (AMP_SUCCESS != retval) {
+                break;
+            }
+        }
+
+        (void)amp_atomic_int32_fetch_add_explicit(&barrier->parked_count,
+                                                  -1,
+                                                  AMP_MEMORY_ORDER_RELAXED);
+    }
+    errc = amp_mutex_unlock(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc);
+    (void)errc;
+
+    return retval;
+}
+
+
+
+static int amp_internal_barrier_withdraw(amp_barrier_t barrier,
+                                         int32_t local_generation)
+{
+    int64_t state = amp_atomic_int64_load_explicit(&barrier->state,
+                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    
+    while (local_generation == AMP_INTERNAL_BARRIER_STATE_GENERATION(state)) {
+        
+        if (0 == AMP_INTERNAL_BARRIER_STATE_COUNT(state)) {
+            /* The last thread arrived and is about to release the phase. */
+            while (local_generation == amp_atomic_int32_load_explicit(&barrier->generation,
+                                                                      AMP_MEMORY_ORDER_ACQUIRE)) {
+                amp_atomic_spin_pause();
+            }
+            
+            return AMP_SUCCESS;
+        }
+        
+        if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&barrier->state,
+                                                                   &state,
+                                                                   state + 1,
+                                                                   AMP_MEMORY_ORDER_ACQ_REL,
+                                                                   AMP_MEMORY_ORDER_ACQUIRE)) {
+            return AMP_TIMEOUT;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns)
+{
+    int64_t previous_state = 0;
+    int32_t local_generation = 0;
+    
+    assert(NULL != barrier);
+    assert((int)amp_internal_valid_raw_barrier_lifecycle_state == barrier->valid);
+
+    if (NULL == barrier
+        || (int)amp_internal_valid_raw_barrier_lifecycle_state != barrier->valid) {
+
+        return AMP_ERROR;
+    }
+
+    /* The count never borrows from the generation as it is positive before
+     * each arrival.
+     */
+    previous_state = amp_atomic_int64_fetch_add_explicit(&barrier->state,
+                                                         -1,
+                                                         AMP_MEMORY_ORDER_ACQ_REL);
+    local_generation = AMP_INTERNAL_BARRIER_STATE_GENERATION(previous_state);
+    assert(0 < AMP_INTERNAL_BARRIER_STATE_COUNT(previous_state) && "Barrier count underflow");
+
+    if (1 == AMP_INTERNAL_BARRIER_STATE_COUNT(previous_state)) {
+        int retval = AMP_SUCCESS;
+        /* Unsigned arithmetic so the generation wraps without overflow. */
+        uint32_t const next_generation = (uint32_t)local_generation + 1u;
+
+        /* Reset the counter for the next phase before releasing the waiting
+         * threads which might enter it immediately.
+         */
+        amp_atomic_int64_store_explicit(&barrier->state,
+                                        AMP_INTERNAL_BARRIER_STATE(next_generation, barrier->init_count),
+                                        AMP_MEMORY_ORDER_RELEASE);
+        amp_atomic_int32_store_explicit(&barrier->generation,
+                                        (int32_t)next_generation,
+                                        AMP_MEMORY_ORDER_SEQ_CST);
+
+        if (0 != amp_atomic_int32_load_explicit(&barrier->parked_count,
+                                                AMP_MEMORY_ORDER_SEQ_CST)) {
+            int errc = amp_mutex_lock(&barrier->park_mutex);
+            assert(AMP_SUCCESS == errc);
+            if (AMP_SUCCESS != errc) {
+                return errc;
+            }
+            {
+                retval = amp_condition_variable_broadcast(&barrier->waking_condition);
+                assert(AMP_SUCCESS == retval);
+            }
+            errc = amp_mutex_unlock(&barrier->park_mutex);
+            assert(AMP_SUCCESS == errc);
+            (void)errc;
+        }
+
+        return (AMP_SUCCESS == retval) ? AMP_BARRIER_SERIAL_THREAD : retval;
+    } else {
+        unsigned int spin_count = 0;
+        int retval = AMP_SUCCESS;
+
+        while (local_generation == amp_atomic_int32_load_explicit(&barrier->generation,
+                                                                  AMP_MEMORY_ORDER_ACQUIRE)) {
+            if (spin_count < AMP_INTERNAL_BARRIER_SPIN_COUNT) {
+                ++spin_count;
+                amp_atomic_spin_pause();
+                
+                if ((0 == (spin_count & 255u))
+                    && (AMP_INTERNAL_TIME_INFINITE_DEADLINE != deadline_ns)
+                    && (0 == amp_internal_time_remaining_ns(deadline_ns))) {
+                    
+                    return amp_internal_barrier_withdraw(barrier, local_generation);
+                }
+            } else {
+                retval = amp_internal_barrier_park(barrier, 
+                                                   local_generation,
+                                                   deadline_ns);
+                if (AMP_TIMEOUT == retval) {
+                    retval = amp_internal_barrier_withdraw(barrier, local_generation);
+                }
+                
+                return retval;
+            }
+        }
+
+        return AMP_SUCCESS;
+    }
+}
+
+
+
+size_t amp_raw_barrier_memory_size(amp_barrier_count_t init_count)
+{
+    (void)init_count;
+    
+    return 0;
+}
+
+
+
+int amp_raw_barrier_init(amp_barrier_t barrier,
+                         amp_barrier_count_t init_count,
+                         void* memory)
+{
+    int errc = AMP_UNSUPPORTED;
+
+    (void)memory;
+    
+    assert(NULL != barrier);
+    assert(NULL == memory);
+    assert(0 < init_count);
+    assert(AMP_INTERNAL_BARRIER_MAX_COUNT >= init_count);
+
+    if ((0 == init_count) || (AMP_INTERNAL_BARRIER_MAX_COUNT < init_count)) {
+        return AMP_ERROR;
+    }
+
+    errc = amp_raw_mutex_init(&barrier->park_mutex);
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    }
+
+    errc = amp_raw_condition_variable_init(&barrier->waking_condition);
+    if (AMP_SUCCESS != errc) {
+        int const ec = amp_raw_mutex_finalize(&barrier->park_mutex);
+        assert(AMP_SUCCESS == ec);
+        (void)ec;
+
+        return errc;
+    }
+
+    amp_atomic_int64_store_explicit(&barrier->state,
+                                    AMP_INTERNAL_BARRIER_STATE(0, init_count),
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&barrier->generation,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&barrier->parked_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    barrier->init_count = init_count;
+    barrier->valid = (int)amp_internal_valid_raw_barrier_lifecycle_state;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_barrier_finalize(amp_barrier_t barrier)
+{
+    int errc = AMP_UNSUPPORTED;
+    int errc2 = AMP_UNSUPPORTED;
+
+    assert(NULL != barrier);
+    assert((int)amp_internal_valid_raw_barrier_lifecycle_state == barrier->valid);
+
+    if ((int)amp_internal_valid_raw_barrier_lifecycle_state != barrier->valid) {
+
+        return AMP_ERROR;
+    }
+
+#if !defined(NDEBUG)
+    /* Weak check in debug mode that no threads wait for the barrier. */
+    if ((int32_t)barrier->init_count != AMP_INTERNAL_BARRIER_STATE_COUNT(amp_atomic_int64_load(&barrier->state))) {
+        return AMP_BUSY;
+    }
+#endif
+
+    barrier->valid = ~((int)amp_internal_valid_raw_barrier_lifecycle_state);
+
+    errc = amp_raw_condition_variable_finalize(&barrier->waking_condition);
+    assert(AMP_SUCCESS == errc);
+
+    errc2 = amp_raw_mutex_finalize(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc2);
+
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    } else if (AMP_SUCCESS != errc2) {
+        return errc2;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_barrier_wait(amp_barrier_t barrier)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_barrier_timedwait(amp_barrier_t barrier,
+                          uint64_t timeout_ns)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
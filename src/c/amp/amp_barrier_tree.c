@@ -0,0 +1,758 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of amp_barrier as a combining tree barrier for high thread
+ * counts.
+ *
+ * Arriving threads first claim one of init_count arrival slots for the
+ * current phase, starting at a slot picked by hashing their thread id. Slots
+ * are grouped into the leaves of a tree with a fan-in of
+ * AMP_INTERNAL_BARRIER_TREE_FAN_IN. Each tree node counts its arrivals on
+ * its own cache line, the last thread arriving at a node resets it and
+ * climbs to the parent node while the others spin on the release phase of
+ * the node. The thread completing the root is the serial thread. It
+ * advances the phase and releases the nodes it completed, and every
+ * released thread releases the nodes it completed on its way up, so arrival
+ * and departure take O(log N) steps and no cache line is written by more
+ * than AMP_INTERNAL_BARRIER_TREE_FAN_IN threads per phase.
+ *
+ * The amp barrier API doesn't identify threads and different threads may
+ * wait on a barrier in different phases, therefore the leaf of a thread is
+ * decided per phase by claiming a slot instead of by a fixed thread index.
+ *
+ * Threads spinning for longer than AMP_INTERNAL_BARRIER_SPIN_COUNT
+ * iterations park on a condition variable.
+ *
+ * The arrival count of a node shares one atomic word with the phase it
+ * counts for. A thread whose timed wait expires withdraws its arrival from
+ * the node it waits at with a compare-and-swap that fails if the node has
+ * been completed in the meantime. It then restores the nodes it completed
+ * on its way up to the arrival counts without itself, so the threads
+ * waiting there can withdraw, too, or another thread can take the freed
+ * arrival slot. A thread whose arrival has already been combined by a node
+ * completion keeps waiting until the node is released or restored.
+ *
+ * amp_barrier_create and amp_barrier_destroy are implemented in
+ * amp_barrier_common.c.
+ */
+
+#include "amp_raw_barrier.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_mutex.h"
+#include "amp_raw_mutex.h"
+#include "amp_condition_variable.h"
+#include "amp_raw_condition_variable.h"
+#include "amp_internal_thread.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_TREE_BARRIERS)
+#   error Compiling wrong source file for selected backend.
+#endif
+
+
+
+/**
+ * Number of children of each tree node.
+ */
+#define AMP_INTERNAL_BARRIER_TREE_FAN_IN 4
+
+/**
+ * Maximal number of tree levels - enough for a fan-in of 2 and the maximal
+ * count.
+ */
+#define AMP_INTERNAL_BARRIER_TREE_MAX_DEPTH 32
+
+/**
+ * Number of times a waiting thread checks the release phase of its node
+ * before it parks.
+ */
+#define AMP_INTERNAL_BARRIER_SPIN_COUNT 4000
+
+/**
+ * Node arrival counts occupy the lower 32 bits of the node state.
+ */
+#define AMP_INTERNAL_BARRIER_MAX_COUNT ((amp_barrier_count_t)0x7fffffff)
+
+/**
+ * Packs the lower 32 bits of a phase and an arrival count into a node state
+ * and extracts them again.
+ */
+#define AMP_INTERNAL_BARRIER_NODE_STATE(phase, count) ((int64_t)(((uint64_t)(uint32_t)(phase) << 32) | (uint64_t)(uint32_t)(count)))
+#define AMP_INTERNAL_BARRIER_NODE_STATE_PHASE(state) ((uint32_t)((uint64_t)(state) >> 32))
+#define AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(state) ((int32_t)(uint32_t)((uint64_t)(state) & 0xffffffffu))
+
+/**
+ * Parent index of the root node.
+ */
+#define AMP_INTERNAL_BARRIER_TREE_NO_PARENT AMP_SIZE_MAX
+
+
+
+enum amp_internal_raw_barrier_lifecycle_state {
+    amp_internal_valid_raw_barrier_lifecycle_state = 0xabcdef
+};
+
+
+
+/**
+ * Arrival slot - contains the phase number plus one of the last phase it
+ * has been claimed in.
+ */
+struct amp_internal_barrier_slot_s {
+    struct amp_raw_atomic_int64_s claimed_phase;
+    char padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+};
+
+
+/**
+ * Combining tree node. released_phase contains the phase number plus one of
+ * the last phase the node has been released in. arrival_state contains the
+ * phase the node counts arrivals for and the arrival count, see
+ * AMP_INTERNAL_BARRIER_NODE_STATE.
+ */
+struct amp_internal_barrier_tree_node_s {
+    struct amp_raw_atomic_int64_s released_phase;
+    struct amp_raw_atomic_int64_s arrival_state;
+    size_t parent;
+    int32_t expected_count;
+    char padding[AMP_CACHE_LINE_SIZE - 2 * sizeof(struct amp_raw_atomic_int64_s) - sizeof(size_t) - sizeof(int32_t)];
+};
+
+
+
+/**
+ * Returns the number of combining tree nodes of all levels for slot_count
+ * arrival slots.
+ */
+static size_t amp_internal_barrier_tree_node_count(size_t slot_count);
+
+/**
+ * Claims a free arrival slot for the current phase and returns the phase in
+ * phase and the slot index in slot_index.
+ *
+ * @return AMP_SUCCESS after claiming a slot.
+ *         AMP_ERROR if more threads than the barrier count wait on the
+ *         barrier.
+ */
+static int amp_internal_barrier_claim_slot(amp_barrier_t barrier,
+                                           int64_t* phase,
+                                           size_t* slot_index);
+
+/**
+ * Returns AMP_TRUE if arrivals at node can be withdrawn in phase, that is
+ * if node counts for phase and hasn't been completed.
+ */
+static amp_bool_t amp_internal_barrier_is_withdrawable(struct amp_internal_barrier_tree_node_s* node,
+                                                       int64_t phase);
+
+/**
+ * Blocks until node has been released for the phase after phase by
+ * spinning and finally parking on the condition variable of barrier. 
+ * If until_withdrawable is AMP_TRUE also returns when arrivals at node can
+ * be withdrawn.
+ *
+ * @return AMP_SUCCESS after node has been released or became withdrawable.
+ *         AMP_TIMEOUT if deadline_ns passed before.
+ */
+static int amp_internal_barrier_wait_for_release(amp_barrier_t barrier,
+                                                 struct amp_internal_barrier_tree_node_s* node,
+                                                 int64_t phase,
+                                                 uint64_t deadline_ns,
+                                                 amp_bool_t until_withdrawable);
+
+/**
+ * Withdraws one arrival from node if it is withdrawable in phase.
+ *
+ * @return AMP_TRUE if an arrival has been withdrawn.
+ */
+static amp_bool_t amp_internal_barrier_withdraw(struct amp_internal_barrier_tree_node_s* node,
+                                                int64_t phase);
+
+/**
+ * Wakes up all parked threads if there are any.
+ */
+static int amp_internal_barrier_wake_parked(amp_barrier_t barrier);
+
+/**
+ * Shared implementation of wait and timedwait. Waits until the phase
+ * completes or until deadline_ns passed and the arrival of the calling
+ * thread could be withdrawn.
+ */
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns);
+
+
+
+static size_t amp_internal_barrier_tree_node_count(size_t slot_count)
+{
+    size_t node_count = 0;
+    size_t level_size = slot_count;
+    
+    do {
+        level_size = (level_size + AMP_INTERNAL_BARRIER_TREE_FAN_IN - 1) / AMP_INTERNAL_BARRIER_TREE_FAN_IN;
+        node_count += level_size;
+    } while (1 < level_size);
+    
+    return node_count;
+}
+
+
+
+static int amp_internal_barrier_claim_slot(amp_barrier_t barrier,
+                                           int64_t* phase,
+                                           size_t* slot_index)
+{
+    size_t const slot_count = (size_t)barrier->init_count;
+    size_t first_index = 0;
+
+    /* Thread ids are often aligned addresses - mix their bits before picking
+     * a slot.
+     */
+    uintptr_t hash = (uintptr_t)amp_internal_thread_current_id();
+    hash ^= hash >> 16;
+    hash *= (uintptr_t)0x45d9f3b;
+    hash ^= hash >> 16;
+    first_index = (size_t)(hash % slot_count);
+
+    for (;;) {
+        int64_t const current_phase = amp_atomic_int64_load_explicit(&barrier->phase,
+                                                                     AMP_MEMORY_ORDER_ACQUIRE);
+        size_t i = 0;
+
+        for (i = 0; i < slot_count; ++i) {
+            size_t const index = (first_index + i) % slot_count;
+            struct amp_internal_barrier_slot_s* slot = &barrier->slots[index];
+            int64_t claimed_phase = amp_atomic_int64_load_explicit(&slot->claimed_phase,
+                                                                   AMP_MEMORY_ORDER_RELAXED);
+
+            /* Slots claimed for a later phase mean current_phase is
+             * outdated - never take them.
+             */
+            while (claimed_phase <= current_phase) {
+                if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&slot->claimed_phase,
+                                                                            &claimed_phase,
+                                                                            current_phase + 1,
+                                                                            AMP_MEMORY_ORDER_RELAXED,
+                                                                            AMP_MEMORY_ORDER_RELAXED)) {
+                    *phase = current_phase;
+                    *slot_index = index;
+
+                    return AMP_SUCCESS;
+                }
+            }
+        }
+
+        /* All slots are claimed - either the phase advanced while searching
+         * or more threads than the barrier count arrived.
+         */
+        if (current_phase == amp_atomic_int64_load_explicit(&barrier->phase,
+                                                            AMP_MEMORY_ORDER_ACQUIRE)) {
+            assert(0 && "More threads than the barrier count are waiting.");
+            return AMP_ERROR;
+        }
+    }
+}
+
+
+
+static amp_bool_t amp_internal_barrier_is_withdrawable(struct amp_internal_barrier_tree_node_s* node,
+                                                       int64_t phase)
+{
+    int64_t const state = amp_atomic_int64_load_explicit(&node->arrival_state,
+                                                         AMP_MEMORY_ORDER_SEQ_CST);
+    int32_t const count = AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(state);
+    
+    /* A full count means the last arriving thread is about to complete the
+     * node.
+     */
+    return (((uint32_t)phase == AMP_INTERNAL_BARRIER_NODE_STATE_PHASE(state))
+            && (0 < count)
+            && (count < node->expected_count)) ? AMP_TRUE : AMP_FALSE;
+}
+
+
+
+static int amp_internal_barrier_wait_for_release(amp_barrier_t barrier,
+                                                 struct amp_internal_barrier_tree_node_s* node,
+                                                 int64_t phase,
+                                                 uint64_t deadline_ns,
+                                                 amp_bool_t until_withdrawable)
+{
+    unsigned int spin_count = 0;
+    int retval = AMP_SUCCESS;
+    int errc = AMP_UNSUPPORTED;
+
+    while (phase >= amp_atomic_int64_load_explicit(&node->released_phase,
+                                                   AMP_MEMORY_ORDER_ACQUIRE)) {
+        if ((AMP_TRUE == until_withdrawable)
+            && (AMP_TRUE == amp_internal_barrier_is_withdrawable(node, phase))) {
+            return AMP_SUCCESS;
+        }
+        
+        if (spin_count < AMP_INTERNAL_BARRIER_SPIN_COUNT) {
+            ++spin_count;
+            amp_atomic_spin_pause();
+            
+            if ((0 == (spin_count & 255u))
+                && (AMP_INTERNAL_TIME_INFINITE_DEADLINE != deadline_ns)
+                && (0 == amp_internal_time_remaining_ns(deadline_ns))) {
+                
+                return AMP_TIMEOUT;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (spin_count < AMP_INTERNAL_BARRIER_SPIN_COUNT) {
+        return AMP_SUCCESS;
+    }
+
+    errc = amp_mutex_lock(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc);
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    }
+    {
+        /* Sequentially consistent registration and release check pair with
+         * the release or restoration and parked count check of the 
+         * releasing or restoring thread.
+         */
+        (void)amp_atomic_int32_fetch_add_explicit(&barrier->parked_count,
+                                                  1,
+                                                  AMP_MEMORY_ORDER_SEQ_CST);
+
+        while (phase >= amp_atomic_int64_load_explicit(&node->released_phase,
+                                                       AMP_MEMORY_ORDER_SEQ_CST)) {
+            if ((AMP_TRUE == until_withdrawable)
+                && (AMP_TRUE == amp_internal_barrier_is_withdrawable(node, phase))) {
+                break;
+            }
+            
+            if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+                retval = amp_condition_variable_wait(&barrier->waking_condition,
+                                                     &barrier->park_mutex);
+            } else {
+                retval = amp_condition_variable_timedwait(&barrier->waking_condition,
+                                                          &barrier->park_mutex,
+                                                          amp_internal_time_remaining_ns(deadline_ns));
+            }
+            
+            if (AMP_SUCCESS != retval) {
+                break;
+            }
+        }
+
+        (void)amp_atomic_int32_fetch_add_explicit(&barrier->parked_count,
+                                                  -1,
+                                                  AMP_MEMORY_ORDER_RELAXED);
+    }
+    errc = amp_mutex_unlock(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc);
+    (void)errc;
+
+    return retval;
+}
+
+
+
+static amp_bool_t amp_internal_barrier_withdraw(struct amp_internal_barrier_tree_node_s* node,
+                                                int64_t phase)
+{
+    int64_t state = amp_atomic_int64_load_explicit(&node->arrival_state,
+                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    
+    while (((uint32_t)phase == AMP_INTERNAL_BARRIER_NODE_STATE_PHASE(state))
+           && (0 < AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(state))
+           && (AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(state) < node->expected_count)) {
+        
+        if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&node->arrival_state,
+                                                                   &state,
+                                                                   state - 1,
+                                                                   AMP_MEMORY_ORDER_ACQ_REL,
+                                                                   AMP_MEMORY_ORDER_ACQUIRE)) {
+            return AMP_TRUE;
+        }
+    }
+    
+    return AMP_FALSE;
+}
+
+
+
+static int amp_internal_barrier_wake_parked(amp_barrier_t barrier)
+{
+    int retval = AMP_SUCCESS;
+    
+    if (0 != amp_atomic_int32_load_explicit(&barrier->parked_count,
+                                            AMP_MEMORY_ORDER_SEQ_CST)) {
+        int errc = amp_mutex_lock(&barrier->park_mutex);
+        assert(AMP_SUCCESS == errc);
+        if (AMP_SUCCESS != errc) {
+            return errc;
+        }
+        {
+            retval = amp_condition_variable_broadcast(&barrier->waking_condition);
+            assert(AMP_SUCCESS == retval);
+        }
+        errc = amp_mutex_unlock(&barrier->park_mutex);
+        assert(AMP_SUCCESS == errc);
+        (void)errc;
+    }
+    
+    return retval;
+}
+
+
+
+size_t amp_raw_barrier_memory_size(amp_barrier_count_t init_count)
+{
+    size_t const slot_count = (size_t)init_count;
+    size_t node_count = 0;
+    
+    if ((0 == init_count) || (AMP_INTERNAL_BARRIER_MAX_COUNT < init_count)) {
+        return 0;
+    }
+    
+    node_count = amp_internal_barrier_tree_node_count(slot_count);
+    
+    if ((slot_count + node_count) > (AMP_SIZE_MAX / AMP_CACHE_LINE_SIZE)) {
+        return AMP_SIZE_MAX;
+    }
+    
+    return (slot_count + node_count) * AMP_CACHE_LINE_SIZE;
+}
+
+
+
+int amp_raw_barrier_init(amp_barrier_t barrier,
+                         amp_barrier_count_t init_count,
+                         void* memory)
+{
+    size_t const slot_count = (size_t)init_count;
+    size_t node_count = 0;
+    size_t level_begin = 0;
+    size_t level_size = 0;
+    size_t child_count = 0;
+    size_t i = 0;
+    int errc = AMP_UNSUPPORTED;
+
+    assert(NULL != barrier);
+    assert(0 < init_count);
+    assert(AMP_INTERNAL_BARRIER_MAX_COUNT >= init_count);
+    assert(NULL != memory);
+    assert(0 == ((uintptr_t)memory & (uintptr_t)(AMP_CACHE_LINE_SIZE - 1)));
+
+    if ((0 == init_count) 
+        || (AMP_INTERNAL_BARRIER_MAX_COUNT < init_count)
+        || (NULL == memory)) {
+        return AMP_ERROR;
+    }
+
+    node_count = amp_internal_barrier_tree_node_count(slot_count);
+
+    errc = amp_raw_mutex_init(&barrier->park_mutex);
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    }
+
+    errc = amp_raw_condition_variable_init(&barrier->waking_condition);
+    if (AMP_SUCCESS != errc) {
+        int const ec = amp_raw_mutex_finalize(&barrier->park_mutex);
+        assert(AMP_SUCCESS == ec);
+        (void)ec;
+
+        return errc;
+    }
+
+    barrier->slots = (struct amp_internal_barrier_slot_s*)memory;
+    barrier->nodes = (struct amp_internal_barrier_tree_node_s*)(barrier->slots + slot_count);
+    barrier->node_count = node_count;
+
+    for (i = 0; i < slot_count; ++i) {
+        amp_atomic_int64_store_explicit(&barrier->slots[i].claimed_phase,
+                                        0,
+                                        AMP_MEMORY_ORDER_RELAXED);
+    }
+
+    /* Build the tree level by level. child_count is the number of slots or
+     * nodes of the level below.
+     */
+    level_begin = 0;
+    child_count = slot_count;
+    do {
+        size_t const next_level_begin = level_begin + (child_count + AMP_INTERNAL_BARRIER_TREE_FAN_IN - 1) / AMP_INTERNAL_BARRIER_TREE_FAN_IN;
+
+        level_size = next_level_begin - level_begin;
+
+        for (i = 0; i < level_size; ++i) {
+            struct amp_internal_barrier_tree_node_s* node = &barrier->nodes[level_begin + i];
+            size_t const first_child = i * AMP_INTERNAL_BARRIER_TREE_FAN_IN;
+            size_t const remaining_children = child_count - first_child;
+
+            amp_atomic_int64_store_explicit(&node->released_phase,
+                                            0,
+                                            AMP_MEMORY_ORDER_RELAXED);
+            amp_atomic_int64_store_explicit(&node->arrival_state,
+                                            AMP_INTERNAL_BARRIER_NODE_STATE(0, 0),
+                                            AMP_MEMORY_ORDER_RELAXED);
+            node->expected_count = (int32_t)((remaining_children < AMP_INTERNAL_BARRIER_TREE_FAN_IN) ? remaining_children : AMP_INTERNAL_BARRIER_TREE_FAN_IN);
+            node->parent = (1 < level_size) ? (next_level_begin + i / AMP_INTERNAL_BARRIER_TREE_FAN_IN) : AMP_INTERNAL_BARRIER_TREE_NO_PARENT;
+        }
+
+        child_count = level_size;
+        level_begin = next_level_begin;
+    } while (1 < level_size);
+
+    assert(level_begin == node_count);
+
+    amp_atomic_int64_store_explicit(&barrier->phase,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&barrier->parked_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    barrier->init_count = init_count;
+    barrier->valid = (int)amp_internal_valid_raw_barrier_lifecycle_state;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_barrier_finalize(amp_barrier_t barrier)
+{
+    int errc = AMP_UNSUPPORTED;
+    int errc2 = AMP_UNSUPPORTED;
+
+    assert(NULL != barrier);
+    assert((int)amp_internal_valid_raw_barrier_lifecycle_state == barrier->valid);
+
+    if ((int)amp_internal_valid_raw_barrier_lifecycle_state != barrier->valid) {
+
+        return AMP_ERROR;
+    }
+
+#if !defined(NDEBUG)
+    {
+        /* Weak check in debug mode that no threads wait for the barrier. */
+        size_t i = 0;
+
+        for (i = 0; i < barrier->node_count; ++i) {
+            if (0 != AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(amp_atomic_int64_load(&barrier->nodes[i].arrival_state))) {
+                return AMP_BUSY;
+            }
+        }
+    }
+#endif
+
+    barrier->valid = ~((int)amp_internal_valid_raw_barrier_lifecycle_state);
+
+    errc = amp_raw_condition_variable_finalize(&barrier->waking_condition);
+    assert(AMP_SUCCESS == errc);
+
+    errc2 = amp_raw_mutex_finalize(&barrier->park_mutex);
+    assert(AMP_SUCCESS == errc2);
+
+    if (AMP_SUCCESS != errc) {
+        return errc;
+    }
+
+    return errc2;
+}
+
+
+
+static int amp_internal_barrier_wait_until(amp_barrier_t barrier,
+                                           uint64_t deadline_ns)
+{
+    size_t completed_nodes[AMP_INTERNAL_BARRIER_TREE_MAX_DEPTH];
+    size_t completed_node_count = 0;
+    size_t slot_index = 0;
+    size_t node_index = 0;
+    int64_t phase = 0;
+    amp_bool_t is_serial_thread = AMP_FALSE;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != barrier);
+    assert((int)amp_internal_valid_raw_barrier_lifecycle_state == barrier->valid);
+
+    if (NULL == barrier
+        || (int)amp_internal_valid_raw_barrier_lifecycle_state != barrier->valid) {
+
+        return AMP_ERROR;
+    }
+
+    retval = amp_internal_barrier_claim_slot(barrier, &phase, &slot_index);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    node_index = slot_index / AMP_INTERNAL_BARRIER_TREE_FAN_IN;
+
+    /* Climb the tree as long as this thread is the last to arrive at a
+     * node.
+     */
+    for (;;) {
+        struct amp_internal_barrier_tree_node_s* node = &barrier->nodes[node_index];
+        int64_t const previous_state = amp_atomic_int64_fetch_add_explicit(&node->arrival_state,
+                                                                           1,
+                                                                           AMP_MEMORY_ORDER_ACQ_REL);
+        int32_t const arrival_count = 1 + AMP_INTERNAL_BARRIER_NODE_STATE_COUNT(previous_state);
+        assert((uint32_t)phase == AMP_INTERNAL_BARRIER_NODE_STATE_PHASE(previous_state));
+        assert(arrival_count <= node->expected_count && "Barrier count overflow");
+
+        if (arrival_count < node->expected_count) {
+            uint64_t wait_deadline_ns = deadline_ns;
+            amp_bool_t until_withdrawable = AMP_FALSE;
+            
+            for (;;) {
+                retval = amp_internal_barrier_wait_for_release(barrier, 
+                                                               node, 
+                                                               phase,
+                                                               wait_deadline_ns,
+                                                               until_withdrawable);
+                if ((AMP_SUCCESS != retval) && (AMP_TIMEOUT != retval)) {
+                    return retval;
+                }
+                
+                if (phase < amp_atomic_int64_load_explicit(&node->released_phase,
+                                                           AMP_MEMORY_ORDER_ACQUIRE)) {
+                    break;
+                }
+                
+                if (AMP_TRUE == amp_internal_barrier_withdraw(node, phase)) {
+                    /* Hand the nodes completed by this thread back to the
+                     * threads waiting there, top-down, and free the slot.
+                     */
+                    while (0 < completed_node_count) {
+                        struct amp_internal_barrier_tree_node_s* const completed_node = &barrier->nodes[completed_nodes[--completed_node_count]];
+                        
+                        amp_atomic_int64_store_explicit(&completed_node->arrival_state,
+                                                        AMP_INTERNAL_BARRIER_NODE_STATE(phase, completed_node->expected_count - 1),
+                                                        AMP_MEMORY_ORDER_SEQ_CST);
+                    }
+                    
+                    amp_atomic_int64_store_explicit(&barrier->slots[slot_index].claimed_phase,
+                                                    phase,
+                                                    AMP_MEMORY_ORDER_RELEASE);
+                    
+                    retval = amp_internal_barrier_wake_parked(barrier);
+                    
+                    return (AMP_SUCCESS == retval) ? AMP_TIMEOUT : retval;
+                }
+                
+                /* The arrival of this thread has been combined - wait until
+                 * the node is released or restored by the combining thread.
+                 */
+                wait_deadline_ns = AMP_INTERNAL_TIME_INFINITE_DEADLINE;
+                until_withdrawable = AMP_TRUE;
+            }
+            break;
+        }
+
+        /* Arrivals for the next phase only happen after the phase advanced
+         * and count from zero.
+         */
+        amp_atomic_int64_store_explicit(&node->arrival_state,
+                                        AMP_INTERNAL_BARRIER_NODE_STATE(phase + 1, 0),
+                                        AMP_MEMORY_ORDER_RELAXED);
+
+        assert(completed_node_count < AMP_INTERNAL_BARRIER_TREE_MAX_DEPTH);
+        completed_nodes[completed_node_count++] = node_index;
+
+        if (AMP_INTERNAL_BARRIER_TREE_NO_PARENT == node->parent) {
+            is_serial_thread = AMP_TRUE;
+
+            /* Advance the phase before any thread can leave and arrive
+             * again.
+             */
+            amp_atomic_int64_store_explicit(&barrier->phase,
+                                            phase + 1,
+                                            AMP_MEMORY_ORDER_RELEASE);
+            break;
+        }
+
+        node_index = node->parent;
+    }
+
+    if (0 == completed_node_count) {
+        return AMP_SUCCESS;
+    }
+
+    /* Release the completed nodes top-down. */
+    for (node_index = completed_node_count; 0 < node_index; --node_index) {
+        amp_atomic_int64_store_explicit(&barrier->nodes[completed_nodes[node_index - 1]].released_phase,
+                                        phase + 1,
+                                        AMP_MEMORY_ORDER_SEQ_CST);
+    }
+
+    retval = amp_internal_barrier_wake_parked(barrier);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    return (AMP_TRUE == is_serial_thread) ? AMP_BARRIER_SERIAL_THREAD : AMP_SUCCESS;
+}
+
+
+
+int amp_barrier_wait(amp_barrier_t barrier)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_barrier_timedwait(amp_barrier_t barrier,
+                          uint64_t timeout_ns)
+{
+    return amp_internal_barrier_wait_until(barrier,
+                                           amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
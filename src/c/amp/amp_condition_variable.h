@@ -53,6 +53,7 @@
 
 #include <amp/amp_mutex.h>
 #include <amp/amp_memory.h>
+#include <amp/amp_stdint.h>
 
 
 #if defined(__cplusplus)
@@ -182,6 +183,30 @@ extern "C" {
     int amp_condition_variable_wait(amp_condition_variable_t cond,
                                     amp_mutex_t mutex);
     
+    /**
+     * Like amp_condition_variable_wait but stops waiting after timeout_ns
+     * nanoseconds, measured on a monotonic clock, if the calling thread
+     * hasn't been awoken by a signal or broadcast before.
+     *
+     * The associated mutex is re-locked in both cases. Re-check the predicate
+     * after a timeout, too - it might have become true in the meantime.
+     * A timed out thread doesn't consume a signal.
+     *
+     * @return AMP_SUCCESS after the calling thread has been awoken and has
+     *         locked the associated mutex.
+     *         AMP_TIMEOUT if the timeout expired, the associated mutex is
+     *         locked by the calling thread.
+     *         Error codes might be returned to signal errors while
+     *         waiting, too. These are programming errors and mustn't 
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     *         AMP_ERROR is the condition variable or the mutex are invalid, or
+     *         if the mutex isn't owned by the calling thread.
+     */
+    int amp_condition_variable_timedwait(amp_condition_variable_t cond,
+                                         amp_mutex_t mutex,
+                                         uint64_t timeout_ns);
+    
     
 #if defined(__cplusplus)
 } /* extern "C" */
@@ -42,6 +42,7 @@
 #include <stddef.h>
 
 #include "amp_raw_condition_variable.h"
+#include "amp_stddef.h"
 #include "amp_return_code.h"
 
 
@@ -58,8 +59,9 @@ int amp_condition_variable_create(amp_condition_variable_t* cond,
     *cond = AMP_CONDITION_VARIABLE_UNINITIALIZED;
     
     
-    tmp_cond = (amp_condition_variable_t)AMP_ALLOC(allocator,
-                                                   sizeof(*tmp_cond));
+    tmp_cond = (amp_condition_variable_t)AMP_ALIGNED_ALLOC(allocator,
+                                                           AMP_CACHE_LINE_SIZE,
+                                                           AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_cond)));
     if (NULL == tmp_cond) {
         return AMP_NOMEM;
     }
@@ -68,8 +70,8 @@ int amp_condition_variable_create(amp_condition_variable_t* cond,
     if (AMP_SUCCESS == retval) {
         *cond = tmp_cond;
     } else {
-        int const rc = AMP_DEALLOC(allocator,
-                                   tmp_cond);
+        int const rc = AMP_ALIGNED_DEALLOC(allocator,
+                                           tmp_cond);
         assert(AMP_SUCCESS == rc);
         (void)rc;
     }
@@ -90,8 +92,8 @@ int amp_condition_variable_destroy(amp_condition_variable_t* cond,
     
     retval = amp_raw_condition_variable_finalize(*cond);
     if (AMP_SUCCESS == retval) {
-        retval = AMP_DEALLOC(allocator,
-                             *cond);
+        retval = AMP_ALIGNED_DEALLOC(allocator,
+                                     *cond);
         assert(AMP_SUCCESS == retval);
         if (AMP_SUCCESS == retval) {
             *cond = AMP_CONDITION_VARIABLE_UNINITIALIZED;
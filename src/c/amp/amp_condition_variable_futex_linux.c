@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Linux futex based condition variable backend that is used together with 
+ * the futex mutex backend.
+ *
+ * Each waiter enqueues a node living on its stack into a FIFO list while
+ * holding an internal lock before it releases the user mutex. Signal
+ * dequeues and grants the oldest waiter, broadcast grants all enqueued
+ * waiters, therefore no wakeup is lost, stolen by a thread that started
+ * waiting after the signal, or spurious. A waiter whose timed wait expires
+ * before it has been granted removes its node again so it doesn't consume
+ * a later signal.
+ *
+ * Waiters sleep on the sequence futex word which is incremented whenever
+ * wakeups are granted. Each waiter sleeps with a futex bitset assigned
+ * round-robin and signal only wakes the waiters sharing the bit of the
+ * granted waiter instead of all of them. Threads woken without being
+ * granted go back to sleep.
+ */
+
+#include "amp_condition_variable.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+
+#include "amp_return_code.h"
+#include "amp_stdint.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_mutex.h"
+#include "amp_raw_mutex.h"
+#include "amp_raw_condition_variable.h"
+#include "amp_internal_futex_linux.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_FUTEX_MUTEXES)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+/**
+ * Queue node of a waiting thread. Protected by the lock of the condition
+ * variable.
+ */
+struct amp_internal_condition_variable_waiter_s {
+    struct amp_internal_condition_variable_waiter_s* next;
+    struct amp_internal_condition_variable_waiter_s* prev;
+    uint32_t bitset;
+    amp_bool_t granted;
+};
+
+
+
+/**
+ * Appends waiter to the queue of cond. Call while holding cond->lock.
+ */
+static void amp_internal_condition_variable_enqueue(amp_condition_variable_t cond,
+                                                    struct amp_internal_condition_variable_waiter_s* waiter);
+
+/**
+ * Removes waiter from the queue of cond. Call while holding cond->lock.
+ */
+static void amp_internal_condition_variable_unlink(amp_condition_variable_t cond,
+                                                   struct amp_internal_condition_variable_waiter_s* waiter);
+
+/**
+ * Shared implementation of wait and timedwait. Waits until the calling
+ * thread is granted a wakeup or until deadline_ns passed.
+ */
+static int amp_internal_condition_variable_wait_until(amp_condition_variable_t cond,
+                                                      amp_mutex_t mutex,
+                                                      uint64_t deadline_ns);
+
+
+
+static void amp_internal_condition_variable_enqueue(amp_condition_variable_t cond,
+                                                    struct amp_internal_condition_variable_waiter_s* waiter)
+{
+    waiter->next = NULL;
+    waiter->prev = cond->last_waiter;
+    
+    if (NULL == cond->last_waiter) {
+        cond->first_waiter = waiter;
+    } else {
+        cond->last_waiter->next = waiter;
+    }
+    cond->last_waiter = waiter;
+}
+
+
+
+static void amp_internal_condition_variable_unlink(amp_condition_variable_t cond,
+                                                   struct amp_internal_condition_variable_waiter_s* waiter)
+{
+    if (NULL == waiter->prev) {
+        cond->first_waiter = waiter->next;
+    } else {
+        waiter->prev->next = waiter->next;
+    }
+    
+    if (NULL == waiter->next) {
+        cond->last_waiter = waiter->prev;
+    } else {
+        waiter->next->prev = waiter->prev;
+    }
+    
+    waiter->next = NULL;
+    waiter->prev = NULL;
+}
+
+
+
+static int amp_internal_condition_variable_wait_until(amp_condition_variable_t cond,
+                                                      amp_mutex_t mutex,
+                                                      uint64_t deadline_ns)
+{
+    assert(NULL != cond);
+    assert(NULL != mutex);
+    
+    struct amp_internal_condition_variable_waiter_s waiter;
+    
+    int retval = amp_mutex_lock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    
+    waiter.bitset = ((uint32_t)1) << (cond->next_bitset_index & 31u);
+    waiter.granted = AMP_FALSE;
+    ++(cond->next_bitset_index);
+    ++(cond->waiter_count);
+    amp_internal_condition_variable_enqueue(cond, &waiter);
+    
+    retval = amp_mutex_unlock(mutex);
+    assert(AMP_SUCCESS == retval);
+    
+    int wait_retval = AMP_SUCCESS;
+    while ((AMP_FALSE == waiter.granted) && (AMP_SUCCESS == wait_retval)) {
+        int32_t const sequence = amp_atomic_int32_load_explicit(&cond->sequence,
+                                                                AMP_MEMORY_ORDER_RELAXED);
+        
+        retval = amp_mutex_unlock(&cond->lock);
+        assert(AMP_SUCCESS == retval);
+        
+        wait_retval = amp_internal_futex_timedwait_bitset(&cond->sequence.value, 
+                                                          sequence,
+                                                          waiter.bitset,
+                                                          deadline_ns);
+        
+        retval = amp_mutex_lock(&cond->lock);
+        assert(AMP_SUCCESS == retval);
+    }
+    
+    if (AMP_TRUE == waiter.granted) {
+        /* A wakeup granted while timing out wins. */
+        wait_retval = AMP_SUCCESS;
+    } else {
+        amp_internal_condition_variable_unlink(cond, &waiter);
+    }
+    
+    --(cond->waiter_count);
+    
+    retval = amp_mutex_unlock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    
+    retval = amp_mutex_lock(mutex);
+    assert(AMP_SUCCESS == retval);
+    
+    if (AMP_SUCCESS != wait_retval) {
+        retval = wait_retval;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_raw_condition_variable_init(amp_condition_variable_t cond)
+{
+    assert(NULL != cond);
+    
+    int const retval = amp_raw_mutex_init(&cond->lock);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    cond->first_waiter = NULL;
+    cond->last_waiter = NULL;
+    cond->next_bitset_index = 0;
+    cond->waiter_count = 0;
+    amp_atomic_int32_store_explicit(&cond->sequence, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_condition_variable_finalize(amp_condition_variable_t cond)
+{
+    assert(NULL != cond);
+    
+    int retval = amp_mutex_lock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    unsigned int const waiter_count = cond->waiter_count;
+    retval = amp_mutex_unlock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+    
+    if (0 != waiter_count) {
+        assert(0); /* Programming error */
+        return AMP_BUSY;
+    }
+    
+    return amp_raw_mutex_finalize(&cond->lock);
+}
+
+
+
+int amp_condition_variable_broadcast(amp_condition_variable_t cond)
+{
+    assert(NULL != cond);
+    
+    amp_bool_t wake = AMP_FALSE;
+    
+    int retval = amp_mutex_lock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    {
+        struct amp_internal_condition_variable_waiter_s* waiter = cond->first_waiter;
+        
+        if (NULL != waiter) {
+            while (NULL != waiter) {
+                struct amp_internal_condition_variable_waiter_s* const next = waiter->next;
+                
+                waiter->next = NULL;
+                waiter->prev = NULL;
+                waiter->granted = AMP_TRUE;
+                
+                waiter = next;
+            }
+            
+            cond->first_waiter = NULL;
+            cond->last_waiter = NULL;
+            (void)amp_atomic_int32_fetch_add_explicit(&cond->sequence, 
+                                                      1,
+                                                      AMP_MEMORY_ORDER_RELAXED);
+            wake = AMP_TRUE;
+        }
+    }
+    retval = amp_mutex_unlock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    
+    if (wake) {
+        retval = amp_internal_futex_wake(&cond->sequence.value, INT_MAX);
+    }
+    
+    return retval;
+}
+
+
+
+int amp_condition_variable_signal(amp_condition_variable_t cond)
+{
+    assert(NULL != cond);
+    
+    uint32_t bitset = 0;
+    
+    int retval = amp_mutex_lock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    {
+        struct amp_internal_condition_variable_waiter_s* const waiter = cond->first_waiter;
+        
+        if (NULL != waiter) {
+            amp_internal_condition_variable_unlink(cond, waiter);
+            waiter->granted = AMP_TRUE;
+            bitset = waiter->bitset;
+            (void)amp_atomic_int32_fetch_add_explicit(&cond->sequence, 
+                                                      1,
+                                                      AMP_MEMORY_ORDER_RELAXED);
+        }
+    }
+    retval = amp_mutex_unlock(&cond->lock);
+    assert(AMP_SUCCESS == retval);
+    
+    if (0 != bitset) {
+        retval = amp_internal_futex_wake_bitset(&cond->sequence.value, 
+                                                INT_MAX,
+                                                bitset);
+    }
+    
+    return retval;
+}
+
+
+
+int amp_condition_variable_wait(amp_condition_variable_t cond,
+                                amp_mutex_t mutex)
+{
+    return amp_internal_condition_variable_wait_until(cond,
+                                                      mutex,
+                                                      AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_condition_variable_timedwait(amp_condition_variable_t cond,
+                                     amp_mutex_t mutex,
+                                     uint64_t timeout_ns)
+{
+    return amp_internal_condition_variable_wait_until(cond,
+                                                      mutex,
+                                                      amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
@@ -44,9 +44,11 @@
 #include <stddef.h>
 
 #include "amp_return_code.h"
+#include "amp_atomic.h"
 #include "amp_mutex.h"
 #include "amp_raw_mutex.h"
 #include "amp_raw_condition_variable.h"
+#include "amp_internal_time.h"
 
 
 
@@ -54,7 +56,8 @@ int amp_raw_condition_variable_init(amp_condition_variable_t cond)
 {
     assert(NULL != cond);
     
-    int retval = pthread_cond_init(&cond->cond, NULL);
+    /* Measure timed waits against the monotonic clock. */
+    int retval = amp_internal_time_cond_init(&cond->cond);
     switch (retval){
         case 0:
             /* retval is already equal to AMP_SUCCES */
@@ -132,6 +135,11 @@ int amp_condition_variable_wait(amp_condition_variable_t cond,
     assert(NULL != cond);
     assert(NULL != mutex);
 
+    /* Keep the mutex locked hint in sync while waiting releases the mutex. */
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
     int retval = pthread_cond_wait(&cond->cond, &mutex->mutex);
     if (0 != retval) {
         /* Condition variable or mutex are invalid which must not happen */
@@ -139,6 +147,48 @@ int amp_condition_variable_wait(amp_condition_variable_t cond,
         retval = AMP_ERROR;
     }
     
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    1, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    return retval;
+}
+
+
+
+
+
+int amp_condition_variable_timedwait(amp_condition_variable_t cond,
+                                     amp_mutex_t mutex,
+                                     uint64_t timeout_ns)
+{
+    assert(NULL != cond);
+    assert(NULL != mutex);
+    
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    int retval = amp_internal_time_cond_timedwait(&cond->cond, 
+                                                  &mutex->mutex,
+                                                  amp_internal_time_deadline_ns(timeout_ns));
+    
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    1, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            break;
+        case ETIMEDOUT:
+            retval = AMP_TIMEOUT;
+            break;
+        default: /* EINVAL, EPERM - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
     return retval;
 }
 
@@ -65,6 +65,17 @@
 #include "amp_mutex.h"
 #include "amp_raw_mutex.h"
 #include "amp_raw_condition_variable.h"
+#include "amp_internal_time.h"
+
+
+
+/**
+ * Shared implementation of wait and timedwait. Waits until the calling
+ * thread is woken by a signal or broadcast or until deadline_ns passed.
+ */
+static int amp_internal_condition_variable_wait_until(amp_condition_variable_t cond,
+                                                      amp_mutex_t mutex,
+                                                      uint64_t deadline_ns);
 
 
 
@@ -350,8 +361,9 @@ int amp_condition_variable_signal(amp_condition_variable_t cond)
 
 
 
-int amp_condition_variable_wait(amp_condition_variable_t cond,
-                                amp_mutex_t mutex)
+static int amp_internal_condition_variable_wait_until(amp_condition_variable_t cond,
+                                                      amp_mutex_t mutex,
+                                                      uint64_t deadline_ns)
 {
     int retval = AMP_UNSUPPORTED;
     DWORD wait_retval = 0;
@@ -411,9 +423,42 @@ int amp_condition_variable_wait(amp_condition_variable_t cond,
      * TODO: @todo Decide if to spin here if the assumption doesn't hold
      *             true in the future?
      */
-    wait_retval = WaitForSingleObject(                                                             cond->waking_waiting_threads_count_control_sem, 
-                                      INFINITE
+    wait_retval = WaitForSingleObject(cond->waking_waiting_threads_count_control_sem, 
+                                      amp_internal_time_remaining_ms(deadline_ns)
                                       );
+    while (WAIT_TIMEOUT == wait_retval) {
+        if (0 != amp_internal_time_remaining_ns(deadline_ns)) {
+            /* Deadlines beyond INFINITE - 1 milliseconds need multiple 
+             * waits.
+             */
+            wait_retval = WaitForSingleObject(cond->waking_waiting_threads_count_control_sem,
+                                              amp_internal_time_remaining_ms(deadline_ns));
+            continue;
+        }
+        
+        /* If no signal or broadcast is in progress no semaphore count is
+         * left for this thread and it can withdraw from the waiting count.
+         * Otherwise the waking thread might have released the semaphore for
+         * this thread and waits for it to wake up, therefore try to grab the
+         * semaphore again until the waking thread is done.
+         */
+        if (TryEnterCriticalSection(&cond->wake_waiting_threads_critsec)) {
+            EnterCriticalSection(&cond->access_waiting_threads_count_critsec);
+            {
+                --(cond->waiting_thread_count);
+            }
+            LeaveCriticalSection(&cond->access_waiting_threads_count_critsec);
+            LeaveCriticalSection(&cond->wake_waiting_threads_critsec);
+            
+            retval = amp_mutex_lock(mutex);
+            assert(AMP_SUCCESS == retval);
+            
+            return (AMP_SUCCESS == retval) ? AMP_TIMEOUT : retval;
+        }
+        
+        wait_retval = WaitForSingleObject(cond->waking_waiting_threads_count_control_sem,
+                                          1);
+    }
     assert(WAIT_OBJECT_0 == wait_retval);
     if (WAIT_OBJECT_0 != wait_retval) {
         /* If wait_retval indicates an error occured then the semaphore might
@@ -505,3 +550,25 @@ int amp_condition_variable_wait(amp_condition_variable_t cond,
 }
 
 
+
+int amp_condition_variable_wait(amp_condition_variable_t cond,
+                                amp_mutex_t mutex)
+{
+    return amp_internal_condition_variable_wait_until(cond,
+                                                      mutex,
+                                                      AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_condition_variable_timedwait(amp_condition_variable_t cond,
+                                     amp_mutex_t mutex,
+                                     uint64_t timeout_ns)
+{
+    return amp_internal_condition_variable_wait_until(cond,
+                                                      mutex,
+                                                      amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
@@ -49,6 +49,7 @@
 #include "amp_mutex.h"
 #include "amp_raw_mutex.h"
 #include "amp_raw_condition_variable.h"
+#include "amp_internal_time.h"
 
 
 int amp_raw_condition_variable_init(amp_condition_variable_t cond)
@@ -121,3 +122,37 @@ int amp_condition_variable_wait(amp_condition_variable_t cond,
 
 
 
+int amp_condition_variable_timedwait(amp_condition_variable_t cond,
+                                     amp_mutex_t mutex,
+                                     uint64_t timeout_ns)
+{
+    BOOL retval = FALSE;
+    uint64_t deadline_ns = 0;
+    
+    assert(NULL != cond);
+    assert(NULL != mutex);
+    
+    deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+    retval = SleepConditionVariableCS(&cond->cond, 
+                                      &mutex->critical_section, 
+                                      amp_internal_time_remaining_ms(deadline_ns));
+    if (FALSE == retval) {
+        DWORD const last_error = GetLastError();
+        if (ERROR_TIMEOUT == last_error) {
+            /* Deadlines beyond INFINITE - 1 milliseconds return early which
+             * is reported like a spurious wakeup.
+             */
+            return (0 == amp_internal_time_remaining_ns(deadline_ns)) ? AMP_TIMEOUT : AMP_SUCCESS;
+        }
+        
+        assert(0);
+        
+        return AMP_ERROR;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
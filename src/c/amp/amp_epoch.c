@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the epoch-based memory reclamation domain after Keir 
+ * Fraser's scheme. Each thread record announces the epoch observed when 
+ * entering its outermost critical region together with an active flag. The
+ * global epoch advances from e to e + 1 once all active records announce e.
+ * A node retired while the global epoch was r can only be accessed by 
+ * regions announcing r or an earlier epoch, therefore it is reclaimable 
+ * when the global epoch reached r + 2.
+ *
+ * Every record keeps three retire lists, one per epoch modulo 3. A list
+ * reused for epoch e held nodes of epoch e - 3 or earlier which are all 
+ * reclaimable. The lists store the node pointers in chunks that are kept 
+ * for reuse, retiring doesn't write to the nodes which might still be read.
+ *
+ * Entering a region stores the announcement and issues a full fence that 
+ * pairs with the fence of a thread trying to advance the epoch - either the
+ * advancing thread sees the announcement or the entering thread sees all 
+ * unlinks preceding the advance.
+ */
+
+#include "amp_epoch.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_thread_local_slot.h"
+#include "amp_internal_thread_local_record.h"
+
+
+
+#define AMP_INTERNAL_EPOCH_LIST_COUNT 3
+
+/**
+ * Node pointers per retire list chunk, filling 256 bytes on 64 bit 
+ * platforms.
+ */
+#define AMP_INTERNAL_EPOCH_CHUNK_CAPACITY 30
+
+/**
+ * A thread tries to advance the epoch and to free its reclaimable nodes
+ * after retiring AMP_INTERNAL_EPOCH_COLLECT_THRESHOLD nodes.
+ */
+#define AMP_INTERNAL_EPOCH_COLLECT_THRESHOLD ((size_t)64)
+
+/**
+ * The announcement of a record is the epoch shifted left by one bit or'ed 
+ * with the active flag.
+ */
+#define AMP_INTERNAL_EPOCH_ACTIVE ((int64_t)1)
+
+
+
+struct amp_internal_epoch_chunk_s {
+    struct amp_internal_epoch_chunk_s* next;
+    size_t count;
+    void* nodes[AMP_INTERNAL_EPOCH_CHUNK_CAPACITY];
+};
+
+
+/**
+ * Nodes retired by one thread during epoch.
+ */
+struct amp_internal_epoch_list_s {
+    int64_t epoch;
+    struct amp_internal_epoch_chunk_s* chunks;
+};
+
+
+/**
+ * Per-thread record. The announcement is written only by the owning thread
+ * and read by threads trying to advance the epoch, everything else is 
+ * private to the owning thread apart from next which doesn't change after
+ * registration.
+ */
+struct amp_internal_epoch_record_s {
+    struct amp_raw_atomic_int64_s announcement;
+    char announcement_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    
+    size_t nesting_depth;
+    size_t retired_count;
+    struct amp_internal_epoch_list_s lists[AMP_INTERNAL_EPOCH_LIST_COUNT];
+    struct amp_internal_epoch_chunk_s* spare_chunks;
+    struct amp_internal_epoch_record_s* next;
+};
+
+
+/**
+ * The global epoch lives on its own cache line as it is read by all threads
+ * entering critical regions.
+ */
+struct amp_epoch_s {
+    struct amp_raw_atomic_int64_s global_epoch;
+    char global_epoch_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    
+    struct amp_raw_atomic_pointer_s records;
+    amp_thread_local_slot_key_t record_key;
+    amp_allocator_t allocator;
+};
+
+
+
+/**
+ * Returns the record of the calling thread, allocates and registers it on
+ * first use. Returns NULL if the record can't be allocated.
+ */
+static struct amp_internal_epoch_record_s* amp_internal_epoch_record(amp_epoch_t epoch);
+
+/**
+ * Frees the nodes of list and moves its chunks to the spare chunks of 
+ * record.
+ */
+static void amp_internal_epoch_free_list(amp_epoch_t epoch,
+                                         struct amp_internal_epoch_record_s* record,
+                                         struct amp_internal_epoch_list_s* list);
+
+/**
+ * Advances the global epoch if all active records announce it. Returns the
+ * global epoch afterwards.
+ */
+static int64_t amp_internal_epoch_try_advance(amp_epoch_t epoch);
+
+/**
+ * Tries to advance the epoch and frees the reclaimable lists of record.
+ */
+static void amp_internal_epoch_collect(amp_epoch_t epoch,
+                                       struct amp_internal_epoch_record_s* record);
+
+/**
+ * Frees all nodes and chunks of record and the record itself.
+ */
+static void amp_internal_epoch_free_record(amp_epoch_t epoch,
+                                           struct amp_internal_epoch_record_s* record);
+
+
+
+static struct amp_internal_epoch_record_s* amp_internal_epoch_record(amp_epoch_t epoch)
+{
+    struct amp_internal_epoch_record_s* record = (struct amp_internal_epoch_record_s*)amp_thread_local_slot_value(epoch->record_key);
+    size_t i = 0;
+    
+    if (NULL != record) {
+        return record;
+    }
+    
+    record = (struct amp_internal_epoch_record_s*)AMP_ALIGNED_ALLOC(epoch->allocator,
+                                                                    AMP_CACHE_LINE_SIZE,
+                                                                    AMP_CACHE_LINE_ROUND_UP(sizeof(*record)));
+    if (NULL == record) {
+        return NULL;
+    }
+    
+    amp_atomic_int64_store_explicit(&record->announcement, 0, AMP_MEMORY_ORDER_RELAXED);
+    record->nesting_depth = 0;
+    record->retired_count = 0;
+    for (i = 0; i < AMP_INTERNAL_EPOCH_LIST_COUNT; ++i) {
+        record->lists[i].epoch = 0;
+        record->lists[i].chunks = NULL;
+    }
+    record->spare_chunks = NULL;
+    
+    if (AMP_SUCCESS != amp_internal_thread_local_record_register(epoch->record_key,
+                                                                 &epoch->records,
+                                                                 record,
+                                                                 offsetof(struct amp_internal_epoch_record_s, next))) {
+        int const rc = AMP_ALIGNED_DEALLOC(epoch->allocator, record);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return NULL;
+    }
+    
+    return record;
+}
+
+
+
+static void amp_internal_epoch_free_list(amp_epoch_t epoch,
+                                         struct amp_internal_epoch_record_s* record,
+                                         struct amp_internal_epoch_list_s* list)
+{
+    struct amp_internal_epoch_chunk_s* chunk = list->chunks;
+    
+    while (NULL != chunk) {
+        struct amp_internal_epoch_chunk_s* const next = chunk->next;
+        size_t i = 0;
+        
+        for (i = 0; i < chunk->count; ++i) {
+            int const rc = AMP_DEALLOC(epoch->allocator, chunk->nodes[i]);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+        
+        chunk->count = 0;
+        chunk->next = record->spare_chunks;
+        record->spare_chunks = chunk;
+        
+        chunk = next;
+    }
+    
+    list->chunks = NULL;
+}
+
+
+
+static int64_t amp_internal_epoch_try_advance(amp_epoch_t epoch)
+{
+    int64_t global_epoch = 0;
+    struct amp_internal_epoch_record_s* record = NULL;
+    
+    global_epoch = amp_atomic_int64_load_explicit(&epoch->global_epoch,
+                                                  AMP_MEMORY_ORDER_ACQUIRE);
+    
+    /* Pairs with the fence in amp_epoch_enter. */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    
+    record = (struct amp_internal_epoch_record_s*)amp_atomic_pointer_load_explicit(&epoch->records,
+                                                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    while (NULL != record) {
+        int64_t const announcement = amp_atomic_int64_load_explicit(&record->announcement,
+                                                                    AMP_MEMORY_ORDER_ACQUIRE);
+        
+        if ((0 != (announcement & AMP_INTERNAL_EPOCH_ACTIVE))
+            && (global_epoch != (announcement >> 1))) {
+            
+            return global_epoch;
+        }
+        
+        record = record->next;
+    }
+    
+    /* On failure another thread advanced the epoch and global_epoch is 
+     * updated.
+     */
+    if (amp_atomic_int64_compare_exchange_explicit(&epoch->global_epoch,
+                                                   &global_epoch,
+                                                   global_epoch + 1,
+                                                   AMP_MEMORY_ORDER_ACQ_REL,
+                                                   AMP_MEMORY_ORDER_ACQUIRE)) {
+        ++global_epoch;
+    }
+    
+    return global_epoch;
+}
+
+
+
+static void amp_internal_epoch_collect(amp_epoch_t epoch,
+                                       struct amp_internal_epoch_record_s* record)
+{
+    int64_t const global_epoch = amp_internal_epoch_try_advance(epoch);
+    size_t i = 0;
+    
+    for (i = 0; i < AMP_INTERNAL_EPOCH_LIST_COUNT; ++i) {
+        struct amp_internal_epoch_list_s* const list = &record->lists[i];
+        
+        if (list->epoch + 2 <= global_epoch) {
+            amp_internal_epoch_free_list(epoch, record, list);
+        }
+    }
+    
+    record->retired_count = 0;
+}
+
+
+
+static void amp_internal_epoch_free_record(amp_epoch_t epoch,
+                                           struct amp_internal_epoch_record_s* record)
+{
+    struct amp_internal_epoch_chunk_s* chunk = NULL;
+    size_t i = 0;
+    int rc = AMP_SUCCESS;
+    
+    for (i = 0; i < AMP_INTERNAL_EPOCH_LIST_COUNT; ++i) {
+        amp_internal_epoch_free_list(epoch, record, &record->lists[i]);
+    }
+    
+    chunk = record->spare_chunks;
+    while (NULL != chunk) {
+        struct amp_internal_epoch_chunk_s* const next = chunk->next;
+        
+        rc = AMP_DEALLOC(epoch->allocator, chunk);
+        assert(AMP_SUCCESS == rc);
+        
+        chunk = next;
+    }
+    
+    rc = AMP_ALIGNED_DEALLOC(epoch->allocator, record);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+}
+
+
+
+int amp_epoch_create(amp_epoch_t* epoch,
+                     amp_allocator_t allocator)
+{
+    struct amp_epoch_s* tmp_epoch = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != epoch);
+    assert(NULL != allocator);
+    
+    tmp_epoch = (struct amp_epoch_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                       AMP_CACHE_LINE_SIZE,
+                                                       AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_epoch)));
+    if (NULL == tmp_epoch) {
+        return AMP_NOMEM;
+    }
+    
+    retval = amp_thread_local_slot_create(&tmp_epoch->record_key,
+                                          allocator);
+    if (AMP_SUCCESS != retval) {
+        int const rc = AMP_ALIGNED_DEALLOC(allocator, tmp_epoch);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    amp_atomic_int64_store_explicit(&tmp_epoch->global_epoch, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_pointer_store_explicit(&tmp_epoch->records,
+                                      NULL,
+                                      AMP_MEMORY_ORDER_RELAXED);
+    tmp_epoch->allocator = allocator;
+    
+    *epoch = tmp_epoch;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_epoch_destroy(amp_epoch_t* epoch,
+                      amp_allocator_t allocator)
+{
+    struct amp_internal_epoch_record_s* record = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != epoch);
+    assert(NULL != *epoch);
+    assert(allocator == (*epoch)->allocator);
+    
+    retval = amp_thread_local_slot_destroy(&(*epoch)->record_key,
+                                           allocator);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    record = (struct amp_internal_epoch_record_s*)amp_atomic_pointer_load_explicit(&(*epoch)->records,
+                                                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    while (NULL != record) {
+        struct amp_internal_epoch_record_s* const next = record->next;
+        
+        assert(0 == record->nesting_depth);
+        
+        amp_internal_epoch_free_record(*epoch, record);
+        
+        record = next;
+    }
+    
+    retval = AMP_ALIGNED_DEALLOC(allocator, *epoch);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    *epoch = AMP_EPOCH_UNINITIALIZED;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_epoch_enter(amp_epoch_t epoch)
+{
+    struct amp_internal_epoch_record_s* record = NULL;
+    int64_t global_epoch = 0;
+    
+    assert(NULL != epoch);
+    
+    record = amp_internal_epoch_record(epoch);
+    if (NULL == record) {
+        return AMP_NOMEM;
+    }
+    
+    if (0 != record->nesting_depth++) {
+        return AMP_SUCCESS;
+    }
+    
+    global_epoch = amp_atomic_int64_load_explicit(&epoch->global_epoch,
+                                                  AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int64_store_explicit(&record->announcement, 
+                                    (global_epoch << 1) | AMP_INTERNAL_EPOCH_ACTIVE,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    /* Makes the announcement visible before any shared node is read. */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_epoch_exit(amp_epoch_t epoch)
+{
+    struct amp_internal_epoch_record_s* record = NULL;
+    
+    assert(NULL != epoch);
+    
+    record = (struct amp_internal_epoch_record_s*)amp_thread_local_slot_value(epoch->record_key);
+    
+    assert(NULL != record);
+    assert(0 < record->nesting_depth);
+    
+    if (0 == --record->nesting_depth) {
+        /* All reads of shared nodes happen before the region is left. */
+        amp_atomic_int64_store_explicit(&record->announcement, 
+                                        0,
+                                        AMP_MEMORY_ORDER_RELEASE);
+    }
+}
+
+
+
+int amp_epoch_retire(amp_epoch_t epoch,
+                     void* node)
+{
+    struct amp_internal_epoch_record_s* record = NULL;
+    struct amp_internal_epoch_list_s* list = NULL;
+    struct amp_internal_epoch_chunk_s* chunk = NULL;
+    int64_t global_epoch = 0;
+    
+    assert(NULL != epoch);
+    assert(NULL != node);
+    
+    record = amp_internal_epoch_record(epoch);
+    if (NULL == record) {
+        return AMP_NOMEM;
+    }
+    
+    /* The store unlinking the node must be ordered before the epoch is
+     * read, otherwise the node could be tagged with a stale epoch and be
+     * freed while a thread that entered later still sees it. Pairs with 
+     * the fence in amp_epoch_enter.
+     */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    global_epoch = amp_atomic_int64_load_explicit(&epoch->global_epoch,
+                                                  AMP_MEMORY_ORDER_ACQUIRE);
+    list = &record->lists[global_epoch % AMP_INTERNAL_EPOCH_LIST_COUNT];
+    
+    if (list->epoch != global_epoch) {
+        /* Holds nodes of epoch global_epoch - 3 or earlier. */
+        amp_internal_epoch_free_list(epoch, record, list);
+        list->epoch = global_epoch;
+    }
+    
+    chunk = list->chunks;
+    if ((NULL == chunk) || (AMP_INTERNAL_EPOCH_CHUNK_CAPACITY == chunk->count)) {
+        chunk = record->spare_chunks;
+        if (NULL != chunk) {
+            record->spare_chunks = chunk->next;
+        } else {
+            chunk = (struct amp_internal_epoch_chunk_s*)AMP_ALLOC(epoch->allocator,
+                                                                 sizeof(*chunk));
+            if (NULL == chunk) {
+                return AMP_NOMEM;
+            }
+        }
+        
+        chunk->count = 0;
+        chunk->next = list->chunks;
+        list->chunks = chunk;
+    }
+    
+    chunk->nodes[chunk->count++] = node;
+    
+    if (AMP_INTERNAL_EPOCH_COLLECT_THRESHOLD <= ++record->retired_count) {
+        amp_internal_epoch_collect(epoch, record);
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_epoch_collect(amp_epoch_t epoch)
+{
+    struct amp_internal_epoch_record_s* record = NULL;
+    
+    assert(NULL != epoch);
+    
+    record = (struct amp_internal_epoch_record_s*)amp_thread_local_slot_value(epoch->record_key);
+    if (NULL != record) {
+        amp_internal_epoch_collect(epoch, record);
+    } else {
+        (void)amp_internal_epoch_try_advance(epoch);
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Epoch-based memory reclamation to free the nodes of lock-free data 
+ * structures once no thread can access them anymore.
+ *
+ * Threads access the shared nodes only inside critical regions bracketed by
+ * amp_epoch_enter and amp_epoch_exit. A node unlinked from a data structure
+ * is retired with amp_epoch_retire instead of being freed immediately. The
+ * domain maintains a global epoch which advances only once all threads in 
+ * critical regions have observed its current value - retired nodes are 
+ * freed with the allocator of the domain after the epoch advanced twice, 
+ * when no critical region which might have seen them can exist anymore.
+ *
+ * Each thread registers a record with the domain on first use and finds it
+ * via a thread-local slot. Entering and exiting a critical region only 
+ * stores to the record of the calling thread, no shared cache line is 
+ * written. Retired nodes are collected in per-thread lists and freed in 
+ * batches when a thread retired enough nodes to try to advance the epoch.
+ *
+ * A thread stalling inside a critical region prevents all reclamation of 
+ * the domain and the retired nodes pile up without bound - use 
+ * amp_hazard_domain if the memory footprint must stay bounded.
+ *
+ * Records and the nodes retired by a thread but not freed yet aren't 
+ * released when the thread ends, only when the domain is destroyed.
+ *
+ * Never pass an invalid, e.g. non-created domain to any of the functions 
+ * other than the create function.
+ */
+
+#ifndef AMP_amp_epoch_H
+#define AMP_amp_epoch_H
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+    
+
+#define AMP_EPOCH_UNINITIALIZED NULL
+    
+    
+    typedef struct amp_epoch_s *amp_epoch_t;
+    
+    
+    /**
+     * Creates an epoch domain that frees retired nodes with allocator, 
+     * which is used to allocate the domain and the per-thread records, too.
+     * allocator must be thread-safe.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if not enough memory is available.
+     *         AMP_ERROR might be returned if no thread-local slot is 
+     *         available for the domain.
+     */
+    int amp_epoch_create(amp_epoch_t* epoch,
+                         amp_allocator_t allocator);
+    
+    /**
+     * Frees all retired nodes, all per-thread records, and the domain with
+     * allocator which must be the allocator passed to amp_epoch_create.
+     *
+     * Only call after all threads stopped using the domain.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_epoch_destroy(amp_epoch_t* epoch,
+                          amp_allocator_t allocator);
+    
+    /**
+     * Enters a critical region of the calling thread. Nodes reachable from
+     * the data structures protected by epoch while inside the region won't
+     * be freed until the region is exited. Critical regions can be nested.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_NOMEM if the record of the calling thread can't be 
+     *         allocated on its first use of the domain - the thread isn't in
+     *         a critical region then.
+     */
+    int amp_epoch_enter(amp_epoch_t epoch);
+    
+    /**
+     * Exits the critical region entered by the matching amp_epoch_enter.
+     */
+    void amp_epoch_exit(amp_epoch_t epoch);
+    
+    /**
+     * Hands node, allocated with the allocator of the domain and already 
+     * unlinked from all shared data structures, to the domain to free it 
+     * once no critical region can access it anymore. Can be called inside 
+     * and outside of critical regions.
+     *
+     * Every few calls try to advance the epoch and free the reclaimable
+     * nodes retired by the calling thread.
+     *
+     * @return AMP_SUCCESS if node has been retired.
+     *         AMP_NOMEM if the retire list or the record of the calling 
+     *         thread can't grow, node hasn't been retired.
+     */
+    int amp_epoch_retire(amp_epoch_t epoch,
+                         void* node);
+    
+    /**
+     * Tries to advance the epoch and frees the reclaimable nodes retired by
+     * the calling thread, e.g. before it goes idle. Call outside of critical
+     * regions, inside a region it can't free the nodes retired during it.
+     */
+    void amp_epoch_collect(amp_epoch_t epoch);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_epoch_H */
@@ -0,0 +1,691 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the hazard pointer domain after Maged Michael's scheme.
+ * The per-thread records are allocated individually and registered in a 
+ * list that only grows at its head. The hazard slots of a record follow it
+ * on their own cache lines as they are only written by the owning thread 
+ * but read by all scanning threads.
+ *
+ * Protecting stores the node to the slot, issues a full fence, and checks
+ * that the source still holds the node. A scan issues a full fence between
+ * the unlinks preceding the retires and loading the records and reading 
+ * their slots - either the scan sees the published node or the protecting
+ * thread sees the unlink and tries again.
+ *
+ * Each record carries an active flag. A thread claims a record by setting
+ * the flag of an inactive one via compare-exchange and only allocates a new
+ * record if all are taken. Releasing a record clears its slots and resets
+ * the flag. Nodes left in the retire list of an inactive record are adopted
+ * by its next owner, or moved by a scanning thread that claims the record
+ * for the duration of the move, so they aren't stranded.
+ *
+ * A scan collects the non-NULL slots into a per-record buffer, sorts it, 
+ * and frees each retired node not found in it. Scans start when a thread 
+ * retired 2 * H + AMP_INTERNAL_HAZARD_SCAN_SLACK nodes with H the current
+ * total number of slots, a scan keeps at most H nodes so at least half of
+ * the retired nodes are freed per scan.
+ */
+
+#include "amp_hazard_domain.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_thread_local_slot.h"
+#include "amp_internal_thread_local_record.h"
+
+
+
+/**
+ * Additional retired nodes per thread before a scan starts to amortize 
+ * scans while few slots exist.
+ */
+#define AMP_INTERNAL_HAZARD_SCAN_SLACK ((size_t)16)
+
+
+
+/**
+ * Per-thread record. Everything but the slots and active is private to the
+ * thread that set active, apart from next which doesn't change after
+ * registration.
+ */
+struct amp_internal_hazard_record_s {
+    struct amp_raw_atomic_pointer_s* slots;
+    struct amp_raw_atomic_int32_s active;
+    
+    void** retired_nodes;
+    size_t retired_count;
+    size_t retired_capacity;
+    
+    void** hazards;
+    size_t hazard_capacity;
+    
+    struct amp_internal_hazard_record_s* next;
+};
+
+
+struct amp_hazard_domain_s {
+    struct amp_raw_atomic_pointer_s records;
+    struct amp_raw_atomic_int64_s record_count;
+    amp_thread_local_slot_key_t record_key;
+    amp_allocator_t allocator;
+    size_t slot_count;
+};
+
+
+
+/**
+ * Returns the record of the calling thread. On first use claims an
+ * inactive record or allocates and registers a new one. Returns NULL if
+ * the record can't be allocated.
+ */
+static struct amp_internal_hazard_record_s* amp_internal_hazard_record(amp_hazard_domain_t domain);
+
+/**
+ * Grows the retire list of record to hold at least capacity nodes.
+ */
+static int amp_internal_hazard_reserve(amp_hazard_domain_t domain,
+                                       struct amp_internal_hazard_record_s* record,
+                                       size_t capacity);
+
+/**
+ * Moves the retired nodes of inactive records into the retire list of
+ * record. Records claimed by other threads meanwhile are skipped.
+ */
+static void amp_internal_hazard_adopt(amp_hazard_domain_t domain,
+                                      struct amp_internal_hazard_record_s* record,
+                                      struct amp_internal_hazard_record_s* records);
+
+/**
+ * Orders node pointers for qsort and bsearch.
+ */
+static int amp_internal_hazard_compare(void const* lhs,
+                                       void const* rhs);
+
+/**
+ * Frees the retired nodes of record not protected by any hazard slot.
+ */
+static int amp_internal_hazard_scan(amp_hazard_domain_t domain,
+                                    struct amp_internal_hazard_record_s* record);
+
+/**
+ * Frees all retired nodes and buffers of record and the record itself.
+ */
+static void amp_internal_hazard_free_record(amp_hazard_domain_t domain,
+                                            struct amp_internal_hazard_record_s* record);
+
+
+
+static struct amp_internal_hazard_record_s* amp_internal_hazard_record(amp_hazard_domain_t domain)
+{
+    struct amp_internal_hazard_record_s* record = (struct amp_internal_hazard_record_s*)amp_thread_local_slot_value(domain->record_key);
+    size_t const header_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*record));
+    size_t i = 0;
+    
+    if (NULL != record) {
+        return record;
+    }
+    
+    /* Claim a released record and adopt the nodes its owner left behind. */
+    for (record = (struct amp_internal_hazard_record_s*)amp_atomic_pointer_load_explicit(&domain->records,
+                                                                                         AMP_MEMORY_ORDER_ACQUIRE);
+         NULL != record;
+         record = record->next) {
+        int32_t expected_active = 0;
+    
+        if (0 == amp_atomic_int32_load_explicit(&record->active,
+                                                AMP_MEMORY_ORDER_RELAXED)
+            && amp_atomic_int32_compare_exchange_explicit(&record->active,
+                                                          &expected_active,
+                                                          1,
+                                                          AMP_MEMORY_ORDER_ACQUIRE,
+                                                          AMP_MEMORY_ORDER_RELAXED)) {
+    
+            if (AMP_SUCCESS != amp_thread_local_slot_set_value(domain->record_key, record)) {
+                amp_atomic_int32_store_explicit(&record->active,
+                                                0,
+                                                AMP_MEMORY_ORDER_RELEASE);
+                return NULL;
+            }
+    
+            return record;
+        }
+    }
+    
+    record = (struct amp_internal_hazard_record_s*)AMP_ALIGNED_ALLOC(domain->allocator,
+                                                                     AMP_CACHE_LINE_SIZE,
+                                                                     AMP_CACHE_LINE_ROUND_UP(header_size + domain->slot_count * sizeof(struct amp_raw_atomic_pointer_s)));
+    if (NULL == record) {
+        return NULL;
+    }
+    
+    record->slots = (struct amp_raw_atomic_pointer_s*)((char*)record + header_size);
+    for (i = 0; i < domain->slot_count; ++i) {
+        amp_atomic_pointer_store_explicit(&record->slots[i], NULL, AMP_MEMORY_ORDER_RELAXED);
+    }
+    amp_atomic_int32_store_explicit(&record->active, 1, AMP_MEMORY_ORDER_RELAXED);
+    record->retired_nodes = NULL;
+    record->retired_count = 0;
+    record->retired_capacity = 0;
+    record->hazards = NULL;
+    record->hazard_capacity = 0;
+    
+    if (AMP_SUCCESS != amp_internal_thread_local_record_register(domain->record_key,
+                                                                 &domain->records,
+                                                                 record,
+                                                                 offsetof(struct amp_internal_hazard_record_s, next))) {
+        int const rc = AMP_ALIGNED_DEALLOC(domain->allocator, record);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return NULL;
+    }
+    
+    (void)amp_atomic_int64_fetch_add_explicit(&domain->record_count, 
+                                              1, 
+                                              AMP_MEMORY_ORDER_RELAXED);
+    
+    return record;
+}
+
+
+
+static int amp_internal_hazard_reserve(amp_hazard_domain_t domain,
+                                       struct amp_internal_hazard_record_s* record,
+                                       size_t capacity)
+{
+    void** retired_nodes = NULL;
+    size_t i = 0;
+    
+    if (capacity <= record->retired_capacity) {
+        return AMP_SUCCESS;
+    }
+    
+    if ((AMP_SIZE_MAX / sizeof(void*)) < capacity) {
+        return AMP_NOMEM;
+    }
+    
+    retired_nodes = (void**)AMP_ALLOC(domain->allocator,
+                                      capacity * sizeof(void*));
+    if (NULL == retired_nodes) {
+        return AMP_NOMEM;
+    }
+    
+    for (i = 0; i < record->retired_count; ++i) {
+        retired_nodes[i] = record->retired_nodes[i];
+    }
+    
+    if (NULL != record->retired_nodes) {
+        int const rc = AMP_DEALLOC(domain->allocator, record->retired_nodes);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+    }
+    
+    record->retired_nodes = retired_nodes;
+    record->retired_capacity = capacity;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static void amp_internal_hazard_adopt(amp_hazard_domain_t domain,
+                                      struct amp_internal_hazard_record_s* record,
+                                      struct amp_internal_hazard_record_s* records)
+{
+    struct amp_internal_hazard_record_s* other = NULL;
+    
+    for (other = records; NULL != other; other = other->next) {
+        int32_t expected_active = 0;
+        size_t i = 0;
+    
+        if (0 != amp_atomic_int32_load_explicit(&other->active,
+                                                AMP_MEMORY_ORDER_RELAXED)
+            || !amp_atomic_int32_compare_exchange_explicit(&other->active,
+                                                           &expected_active,
+                                                           1,
+                                                           AMP_MEMORY_ORDER_ACQUIRE,
+                                                           AMP_MEMORY_ORDER_RELAXED)) {
+            continue;
+        }
+    
+        /* Without memory the nodes wait for the next owner or scan. */
+        if (0 != other->retired_count
+            && (AMP_SIZE_MAX - record->retired_count) >= other->retired_count
+            && AMP_SUCCESS == amp_internal_hazard_reserve(domain,
+                                                          record,
+                                                          record->retired_count + other->retired_count)) {
+    
+            for (i = 0; i < other->retired_count; ++i) {
+                record->retired_nodes[record->retired_count++] = other->retired_nodes[i];
+            }
+            other->retired_count = 0;
+        }
+    
+        amp_atomic_int32_store_explicit(&other->active,
+                                        0,
+                                        AMP_MEMORY_ORDER_RELEASE);
+    }
+}
+
+
+
+static int amp_internal_hazard_compare(void const* lhs,
+                                       void const* rhs)
+{
+    uintptr_t const lhs_address = (uintptr_t)*(void* const*)lhs;
+    uintptr_t const rhs_address = (uintptr_t)*(void* const*)rhs;
+    
+    if (lhs_address < rhs_address) {
+        return -1;
+    } else if (lhs_address > rhs_address) {
+        return 1;
+    }
+    
+    return 0;
+}
+
+
+
+static int amp_internal_hazard_scan(amp_hazard_domain_t domain,
+                                    struct amp_internal_hazard_record_s* record)
+{
+    struct amp_internal_hazard_record_s* records = (struct amp_internal_hazard_record_s*)amp_atomic_pointer_load_explicit(&domain->records,
+                                                                                                                           AMP_MEMORY_ORDER_ACQUIRE);
+    struct amp_internal_hazard_record_s* other = NULL;
+    size_t slot_total = 0;
+    size_t hazard_count = 0;
+    size_t kept_count = 0;
+    size_t i = 0;
+    
+    amp_internal_hazard_adopt(domain, record, records);
+    
+    /* Pairs with the fence in amp_hazard_domain_protect. The records are 
+     * loaded afterwards as a thread that registered a record and fenced 
+     * before this fence might still see the unlinked node.
+     */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    
+    records = (struct amp_internal_hazard_record_s*)amp_atomic_pointer_load_explicit(&domain->records,
+                                                                                     AMP_MEMORY_ORDER_ACQUIRE);
+    for (other = records; NULL != other; other = other->next) {
+        slot_total += domain->slot_count;
+    }
+    
+    if (record->hazard_capacity < slot_total) {
+        void** hazards = (void**)AMP_ALLOC(domain->allocator, 
+                                           slot_total * sizeof(void*));
+        if (NULL == hazards) {
+            return AMP_NOMEM;
+        }
+        
+        if (NULL != record->hazards) {
+            int const rc = AMP_DEALLOC(domain->allocator, record->hazards);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+        
+        record->hazards = hazards;
+        record->hazard_capacity = slot_total;
+    }
+    
+    for (other = records; NULL != other; other = other->next) {
+        for (i = 0; i < domain->slot_count; ++i) {
+            void* const hazard = amp_atomic_pointer_load_explicit(&other->slots[i],
+                                                                  AMP_MEMORY_ORDER_ACQUIRE);
+            if (NULL != hazard) {
+                record->hazards[hazard_count++] = hazard;
+            }
+        }
+    }
+    
+    qsort(record->hazards, 
+          hazard_count, 
+          sizeof(void*), 
+          &amp_internal_hazard_compare);
+    
+    for (i = 0; i < record->retired_count; ++i) {
+        void* const node = record->retired_nodes[i];
+        
+        if (NULL != bsearch(&node, 
+                            record->hazards, 
+                            hazard_count, 
+                            sizeof(void*), 
+                            &amp_internal_hazard_compare)) {
+            record->retired_nodes[kept_count++] = node;
+        } else {
+            int const rc = AMP_DEALLOC(domain->allocator, node);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+    }
+    
+    record->retired_count = kept_count;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static void amp_internal_hazard_free_record(amp_hazard_domain_t domain,
+                                            struct amp_internal_hazard_record_s* record)
+{
+    size_t i = 0;
+    int rc = AMP_SUCCESS;
+    
+    for (i = 0; i < record->retired_count; ++i) {
+        rc = AMP_DEALLOC(domain->allocator, record->retired_nodes[i]);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    if (NULL != record->retired_nodes) {
+        rc = AMP_DEALLOC(domain->allocator, record->retired_nodes);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    if (NULL != record->hazards) {
+        rc = AMP_DEALLOC(domain->allocator, record->hazards);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    rc = AMP_ALIGNED_DEALLOC(domain->allocator, record);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+}
+
+
+
+int amp_hazard_domain_create(amp_hazard_domain_t* domain,
+                             amp_allocator_t allocator,
+                             size_t slot_count)
+{
+    struct amp_hazard_domain_s* tmp_domain = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != domain);
+    assert(NULL != allocator);
+    assert(0 < slot_count);
+    
+    if (0 == slot_count) {
+        return AMP_ERROR;
+    }
+    
+    if ((AMP_SIZE_MAX - 2 * AMP_CACHE_LINE_SIZE) / sizeof(struct amp_raw_atomic_pointer_s) < slot_count) {
+        return AMP_NOMEM;
+    }
+    
+    tmp_domain = (struct amp_hazard_domain_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                                AMP_CACHE_LINE_SIZE,
+                                                                AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_domain)));
+    if (NULL == tmp_domain) {
+        return AMP_NOMEM;
+    }
+    
+    retval = amp_thread_local_slot_create(&tmp_domain->record_key,
+                                          allocator);
+    if (AMP_SUCCESS != retval) {
+        int const rc = AMP_ALIGNED_DEALLOC(allocator, tmp_domain);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    amp_atomic_pointer_store_explicit(&tmp_domain->records,
+                                      NULL,
+                                      AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int64_store_explicit(&tmp_domain->record_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    tmp_domain->allocator = allocator;
+    tmp_domain->slot_count = slot_count;
+    
+    *domain = tmp_domain;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_hazard_domain_destroy(amp_hazard_domain_t* domain,
+                              amp_allocator_t allocator)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != domain);
+    assert(NULL != *domain);
+    assert(allocator == (*domain)->allocator);
+    
+    retval = amp_thread_local_slot_destroy(&(*domain)->record_key,
+                                           allocator);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    record = (struct amp_internal_hazard_record_s*)amp_atomic_pointer_load_explicit(&(*domain)->records,
+                                                                                    AMP_MEMORY_ORDER_ACQUIRE);
+    while (NULL != record) {
+        struct amp_internal_hazard_record_s* const next = record->next;
+        
+        amp_internal_hazard_free_record(*domain, record);
+        
+        record = next;
+    }
+    
+    retval = AMP_ALIGNED_DEALLOC(allocator, *domain);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    *domain = AMP_HAZARD_DOMAIN_UNINITIALIZED;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_hazard_domain_protect(amp_hazard_domain_t domain,
+                              size_t slot_index,
+                              amp_atomic_pointer_t source,
+                              void** node)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    struct amp_raw_atomic_pointer_s* slot = NULL;
+    void* protected_node = NULL;
+    
+    assert(NULL != domain);
+    assert(slot_index < domain->slot_count);
+    assert(NULL != source);
+    assert(NULL != node);
+    
+    record = amp_internal_hazard_record(domain);
+    if (NULL == record) {
+        return AMP_NOMEM;
+    }
+    
+    slot = &record->slots[slot_index];
+    protected_node = amp_atomic_pointer_load_explicit(source,
+                                                      AMP_MEMORY_ORDER_RELAXED);
+    for (;;) {
+        void* reloaded_node = NULL;
+        
+        amp_atomic_pointer_store_explicit(slot, 
+                                          protected_node,
+                                          AMP_MEMORY_ORDER_RELAXED);
+        
+        /* Makes the slot visible before source is checked again. */
+        amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+        
+        reloaded_node = amp_atomic_pointer_load_explicit(source,
+                                                         AMP_MEMORY_ORDER_ACQUIRE);
+        if (reloaded_node == protected_node) {
+            break;
+        }
+        
+        protected_node = reloaded_node;
+    }
+    
+    *node = protected_node;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_hazard_domain_clear(amp_hazard_domain_t domain,
+                             size_t slot_index)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    
+    assert(NULL != domain);
+    assert(slot_index < domain->slot_count);
+    
+    record = (struct amp_internal_hazard_record_s*)amp_thread_local_slot_value(domain->record_key);
+    if (NULL != record) {
+        /* All reads of the node happen before the slot is cleared. */
+        amp_atomic_pointer_store_explicit(&record->slots[slot_index],
+                                          NULL,
+                                          AMP_MEMORY_ORDER_RELEASE);
+    }
+}
+
+
+
+int amp_hazard_domain_retire(amp_hazard_domain_t domain,
+                             void* node)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    size_t scan_threshold = 0;
+    
+    assert(NULL != domain);
+    assert(NULL != node);
+    
+    record = amp_internal_hazard_record(domain);
+    if (NULL == record) {
+        return AMP_NOMEM;
+    }
+    
+    scan_threshold = 2 * domain->slot_count 
+        * (size_t)amp_atomic_int64_load_explicit(&domain->record_count, 
+                                                 AMP_MEMORY_ORDER_RELAXED)
+        + AMP_INTERNAL_HAZARD_SCAN_SLACK;
+    
+    if (record->retired_count == record->retired_capacity) {
+        size_t const capacity = (0 == record->retired_capacity) 
+            ? scan_threshold 
+            : 2 * record->retired_capacity;
+        int const retval = amp_internal_hazard_reserve(domain,
+                                                       record,
+                                                       capacity);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    record->retired_nodes[record->retired_count++] = node;
+    
+    if (scan_threshold <= record->retired_count) {
+        /* On failure the node stays retired and the next retire scans 
+         * again.
+         */
+        (void)amp_internal_hazard_scan(domain, record);
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_hazard_domain_collect(amp_hazard_domain_t domain)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    
+    assert(NULL != domain);
+    
+    record = (struct amp_internal_hazard_record_s*)amp_thread_local_slot_value(domain->record_key);
+    if (NULL == record) {
+        return AMP_SUCCESS;
+    }
+    
+    return amp_internal_hazard_scan(domain, record);
+}
+
+
+
+int amp_hazard_domain_release(amp_hazard_domain_t domain)
+{
+    struct amp_internal_hazard_record_s* record = NULL;
+    size_t i = 0;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != domain);
+    
+    record = (struct amp_internal_hazard_record_s*)amp_thread_local_slot_value(domain->record_key);
+    if (NULL == record) {
+        return AMP_SUCCESS;
+    }
+    
+    for (i = 0; i < domain->slot_count; ++i) {
+        amp_atomic_pointer_store_explicit(&record->slots[i],
+                                          NULL,
+                                          AMP_MEMORY_ORDER_RELEASE);
+    }
+    
+    /* On failure the nodes stay retired for the next owner or scan. */
+    (void)amp_internal_hazard_scan(domain, record);
+    
+    retval = amp_thread_local_slot_set_value(domain->record_key, NULL);
+    if (AMP_SUCCESS != retval) {
+        return AMP_ERROR;
+    }
+    
+    /* Hands the retire list over to the thread claiming the record next. */
+    amp_atomic_int32_store_explicit(&record->active,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELEASE);
+    
+    return AMP_SUCCESS;
+}
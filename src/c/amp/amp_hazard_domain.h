@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Hazard pointer domain to free the nodes of lock-free data structures with
+ * a bounded memory footprint, even if threads stall while accessing them.
+ *
+ * Each thread owns slot_count hazard slots. Before dereferencing a shared 
+ * node a thread publishes it in one of its slots via 
+ * amp_hazard_domain_protect, and clears the slot once it's done with the 
+ * node. A node unlinked from a data structure is retired with 
+ * amp_hazard_domain_retire instead of being freed immediately. When a 
+ * thread retired twice as many nodes as there are hazard slots in total it
+ * scans all slots and frees the nodes not protected by any of them with the
+ * allocator of the domain.
+ *
+ * A scan can only keep as many nodes as there are hazard slots, therefore 
+ * no thread ever holds more retired nodes than a small multiple of the 
+ * number of threads times slot_count - in contrast to amp_epoch where a 
+ * single stalled thread blocks all reclamation. The price is a full fence 
+ * for each protected node on the read path.
+ *
+ * Each thread registers a record with its slots with the domain on first 
+ * use and finds it via a thread-local slot. Thread-local slots can't detect
+ * the end of a thread, therefore a thread calls amp_hazard_domain_release
+ * before it ends to hand its record back. Released records are reused by
+ * threads registering later, and the nodes retired but not freed yet by
+ * the previous owner are adopted by the next owner or by scanning threads.
+ * Records themselves are only freed when the domain is destroyed.
+ *
+ * Never pass an invalid, e.g. non-created domain to any of the functions 
+ * other than the create function.
+ */
+
+#ifndef AMP_amp_hazard_domain_H
+#define AMP_amp_hazard_domain_H
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+    
+
+#define AMP_HAZARD_DOMAIN_UNINITIALIZED NULL
+    
+    
+    typedef struct amp_hazard_domain_s *amp_hazard_domain_t;
+    
+    
+    /**
+     * Creates a hazard pointer domain with slot_count hazard slots per 
+     * thread that frees retired nodes with allocator, which is used to
+     * allocate the domain and the per-thread records, too. allocator must be 
+     * thread-safe.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if not enough memory is available.
+     *         AMP_ERROR might be returned if slot_count is 0 or if no 
+     *         thread-local slot is available for the domain.
+     */
+    int amp_hazard_domain_create(amp_hazard_domain_t* domain,
+                                 amp_allocator_t allocator,
+                                 size_t slot_count);
+    
+    /**
+     * Frees all retired nodes, all per-thread records, and the domain with
+     * allocator which must be the allocator passed to 
+     * amp_hazard_domain_create.
+     *
+     * Only call after all threads stopped using the domain.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_hazard_domain_destroy(amp_hazard_domain_t* domain,
+                                  amp_allocator_t allocator);
+    
+    /**
+     * Loads the node pointer stored in source and publishes it in the 
+     * hazard slot slot_index of the calling thread, repeating until source
+     * still holds the published node afterwards. The node returned in node 
+     * (which might be NULL) isn't freed until the slot is cleared or 
+     * reused, as long as it has been retired only after being unlinked 
+     * from source.
+     *
+     * source must hold untagged pointers to retirable nodes or NULL.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_NOMEM if the record of the calling thread can't be 
+     *         allocated on its first use of the domain, node isn't changed.
+     */
+    int amp_hazard_domain_protect(amp_hazard_domain_t domain,
+                                  size_t slot_index,
+                                  amp_atomic_pointer_t source,
+                                  void** node);
+    
+    /**
+     * Clears the hazard slot slot_index of the calling thread, the node
+     * previously protected by it mustn't be accessed afterwards.
+     */
+    void amp_hazard_domain_clear(amp_hazard_domain_t domain,
+                                 size_t slot_index);
+    
+    /**
+     * Hands node, allocated with the allocator of the domain and already 
+     * unlinked from all shared data structures, to the domain to free it 
+     * once no hazard slot protects it.
+     *
+     * Scans all hazard slots when the calling thread retired enough nodes.
+     *
+     * @return AMP_SUCCESS if node has been retired.
+     *         AMP_NOMEM if the retire list or the record of the calling 
+     *         thread can't grow, node hasn't been retired.
+     */
+    int amp_hazard_domain_retire(amp_hazard_domain_t domain,
+                                 void* node);
+    
+    /**
+     * Scans all hazard slots and frees the nodes retired by the calling 
+     * thread that aren't protected, e.g. before it goes idle.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_NOMEM if no memory for the scan is available, no nodes 
+     *         have been freed.
+     */
+    int amp_hazard_domain_collect(amp_hazard_domain_t domain);
+
+    /**
+     * Clears all hazard slots of the calling thread, frees the nodes it
+     * retired that aren't protected, and hands its record back to the
+     * domain for reuse by other threads. Retired nodes still protected are
+     * adopted by the next owner of the record or by a scanning thread.
+     *
+     * Call before a thread that used the domain ends. The thread may use
+     * the domain again afterwards and then acquires a record anew.
+     *
+     * @return AMP_SUCCESS on success or if the calling thread has no record.
+     *         AMP_ERROR might be returned if the thread-local slot can't be
+     *         reset, the record stays owned by the calling thread.
+     */
+    int amp_hazard_domain_release(amp_hazard_domain_t domain);
+
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_hazard_domain_H */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the internal Linux futex wrapper.
+ */
+
+/* syscall isn't declared by unistd.h in strict C99 mode. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "amp_internal_futex_linux.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "amp_return_code.h"
+#include "amp_stdint.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_FUTEX_MUTEXES) && !defined(AMP_USE_FUTEX_SEMAPHORES)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+int amp_internal_futex_wait(int32_t* address,
+                            int32_t expected_value)
+{
+    assert(NULL != address);
+    
+    long const retval = syscall(SYS_futex, 
+                                address, 
+                                FUTEX_WAIT_PRIVATE, 
+                                expected_value, 
+                                NULL, 
+                                NULL, 
+                                0);
+    if (0 != retval) {
+        switch (errno) {
+            case EAGAIN: /* Value at address changed before sleeping */
+                /* Fallthrough */
+            case EINTR: /* Interrupted by a signal */
+                break;
+            default: /* EFAULT, EINVAL - programming error */
+                assert(0);
+                return AMP_ERROR;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_futex_timedwait(int32_t* address,
+                                 int32_t expected_value,
+                                 uint64_t deadline_ns)
+{
+    return amp_internal_futex_timedwait_bitset(address,
+                                               expected_value,
+                                               FUTEX_BITSET_MATCH_ANY,
+                                               deadline_ns);
+}
+
+
+
+int amp_internal_futex_wake(int32_t* address,
+                            int32_t wake_count)
+{
+    assert(NULL != address);
+    assert(0 < wake_count);
+    
+    long const retval = syscall(SYS_futex, 
+                                address, 
+                                FUTEX_WAKE_PRIVATE, 
+                                wake_count, 
+                                NULL, 
+                                NULL, 
+                                0);
+    if (0 > retval) {
+        assert(0); /* EFAULT, EINVAL - programming error */
+        return AMP_ERROR;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_futex_wait_bitset(int32_t* address,
+                                   int32_t expected_value,
+                                   uint32_t bitset)
+{
+    assert(NULL != address);
+    assert(0 != bitset);
+    
+    long const retval = syscall(SYS_futex, 
+                                address, 
+                                FUTEX_WAIT_BITSET_PRIVATE, 
+                                expected_value, 
+                                NULL, 
+                                NULL, 
+                                bitset);
+    if (0 != retval) {
+        switch (errno) {
+            case EAGAIN: /* Value at address changed before sleeping */
+                /* Fallthrough */
+            case EINTR: /* Interrupted by a signal */
+                break;
+            default: /* EFAULT, EINVAL - programming error */
+                assert(0);
+                return AMP_ERROR;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_futex_timedwait_bitset(int32_t* address,
+                                        int32_t expected_value,
+                                        uint32_t bitset,
+                                        uint64_t deadline_ns)
+{
+    assert(NULL != address);
+    assert(0 != bitset);
+    
+    if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+        return amp_internal_futex_wait_bitset(address, expected_value, bitset);
+    }
+    
+    /* Unlike FUTEX_WAIT, FUTEX_WAIT_BITSET takes an absolute timeout which
+     * is measured against CLOCK_MONOTONIC.
+     */
+    struct timespec deadline;
+    amp_internal_time_to_timespec(deadline_ns, &deadline);
+    
+    long const retval = syscall(SYS_futex, 
+                                address, 
+                                FUTEX_WAIT_BITSET_PRIVATE, 
+                                expected_value, 
+                                &deadline, 
+                                NULL, 
+                                bitset);
+    if (0 != retval) {
+        switch (errno) {
+            case ETIMEDOUT:
+                return AMP_TIMEOUT;
+            case EAGAIN: /* Value at address changed before sleeping */
+                /* Fallthrough */
+            case EINTR: /* Interrupted by a signal */
+                break;
+            default: /* EFAULT, EINVAL - programming error */
+                assert(0);
+                return AMP_ERROR;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_futex_wake_bitset(int32_t* address,
+                                   int32_t wake_count,
+                                   uint32_t bitset)
+{
+    assert(NULL != address);
+    assert(0 < wake_count);
+    assert(0 != bitset);
+    
+    long const retval = syscall(SYS_futex, 
+                                address, 
+                                FUTEX_WAKE_BITSET_PRIVATE, 
+                                wake_count, 
+                                NULL, 
+                                NULL, 
+                                bitset);
+    if (0 > retval) {
+        assert(0); /* EFAULT, EINVAL - programming error */
+        return AMP_ERROR;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Internal wrapper around the Linux futex system call used by the futex
+ * backends. Only private (process local) futexes are used.
+ *
+ * Everything contained in this file can change without any notice.
+ */
+
+#ifndef AMP_amp_internal_futex_linux_H
+#define AMP_amp_internal_futex_linux_H
+
+#include <amp/amp_stdint.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Blocks the calling thread if the 32bit word at address contains
+     * expected_value until it is woken up via amp_internal_futex_wake.
+     *
+     * Returns immediately if the value at address differs from
+     * expected_value. Wakeups can be spurious, therefore re-check the
+     * condition that lead to waiting after the call returns.
+     *
+     * @return AMP_SUCCESS after waking up, on spurious wakeups, on signal
+     *         interruption, or if the value at address differs from
+     *         expected_value.
+     *         AMP_ERROR if address is invalid which is a programming error.
+     */
+    int amp_internal_futex_wait(int32_t* address,
+                                int32_t expected_value);
+
+
+    /**
+     * Like amp_internal_futex_wait but gives up when the monotonic clock
+     * reaches deadline_ns as returned by amp_internal_time_deadline_ns.
+     *
+     * @return AMP_SUCCESS like amp_internal_futex_wait.
+     *         AMP_TIMEOUT if the deadline passed.
+     *         AMP_ERROR if address is invalid which is a programming error.
+     */
+    int amp_internal_futex_timedwait(int32_t* address,
+                                     int32_t expected_value,
+                                     uint64_t deadline_ns);
+    
+    
+    /**
+     * Wakes up to wake_count threads blocking on address.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_ERROR if address is invalid which is a programming error.
+     */
+    int amp_internal_futex_wake(int32_t* address,
+                                int32_t wake_count);
+
+
+    /**
+     * Like amp_internal_futex_wait but the waiting thread is only woken by
+     * amp_internal_futex_wake_bitset calls whose bitset shares a set bit with
+     * bitset (or by amp_internal_futex_wake).
+     *
+     * bitset must not be 0.
+     */
+    int amp_internal_futex_wait_bitset(int32_t* address,
+                                       int32_t expected_value,
+                                       uint32_t bitset);
+
+
+    /**
+     * Combination of amp_internal_futex_wait_bitset and 
+     * amp_internal_futex_timedwait.
+     */
+    int amp_internal_futex_timedwait_bitset(int32_t* address,
+                                            int32_t expected_value,
+                                            uint32_t bitset,
+                                            uint64_t deadline_ns);
+
+
+    /**
+     * Wakes up to wake_count threads blocking on address whose wait bitset
+     * shares a set bit with bitset.
+     *
+     * bitset must not be 0.
+     */
+    int amp_internal_futex_wake_bitset(int32_t* address,
+                                       int32_t wake_count,
+                                       uint32_t bitset);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_internal_futex_linux_H */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Internal interface to fill the topology table of a platform description.
+ * Implemented by amp_internal_platform_topology_sysfs.c on Linux and by
+ * amp_internal_platform_topology_unsupported.c on all other platforms.
+ *
+ * Everything contained in this file can change without any notice.
+ */
+
+
+#ifndef AMP_amp_internal_platform_topology_H
+#define AMP_amp_internal_platform_topology_H
+
+
+#include <amp/amp_memory.h>
+#include <amp/amp_raw_platform.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Allocates the topology table of descr with allocator and fills it and
+     * the derived core, package, and NUMA node counts.
+     *
+     * descr must have been initialized by amp_raw_platform_init with its
+     * topology fields set to zero.
+     *
+     * @return AMP_SUCCESS if the topology has been queried.
+     *         AMP_UNSUPPORTED if the topology can't be queried, descr is
+     *         left unchanged.
+     *         AMP_NOMEM if the table can't be allocated, descr is left
+     *         unchanged.
+     */
+    int amp_internal_platform_topology_init(amp_platform_t descr,
+                                            amp_allocator_t allocator);
+
+
+    /**
+     * Frees the topology table of descr (if any) with allocator and resets
+     * its topology fields to zero.
+     *
+     * @return AMP_SUCCESS or an allocator specific error code.
+     */
+    int amp_internal_platform_topology_finalize(amp_platform_t descr,
+                                                amp_allocator_t allocator);
+
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_internal_platform_topology_H */
@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Topology queries for Linux reading the sysfs cpu and node directories.
+ *
+ * For every online hardware thread /sys/devices/system/cpu/cpuN/topology
+ * provides the package and core id and the SMT siblings,
+ * /sys/devices/system/cpu/cpuN/cache/indexK describes the caches and a
+ * nodeM entry in /sys/devices/system/cpu/cpuN links to its NUMA node.
+ * Instruction caches are ignored.
+ *
+ * See http://www.kernel.org/doc/Documentation/cputopology.txt
+ */
+
+#include "amp_internal_platform_topology.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "amp_stddef.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_raw_platform.h"
+
+
+
+#define AMP_INTERNAL_SYSFS_CPU_PATH "/sys/devices/system/cpu"
+#define AMP_INTERNAL_SYSFS_PATH_CAPACITY 256
+
+
+
+/**
+ * Parses a sysfs list like "0-3,8,10-11" from the file at path. Stores up
+ * to capacity of the listed ids into ids and sets count to the number of
+ * listed ids.
+ *
+ * Returns AMP_SUCCESS or AMP_UNSUPPORTED if the file can't be read or
+ * parsed.
+ */
+static int amp_internal_sysfs_read_list(char const* path,
+                                        size_t* ids,
+                                        size_t capacity,
+                                        size_t* count);
+
+/**
+ * Reads a signed number from the file at path, negative values (unknown
+ * ids) are stored as 0.
+ *
+ * Returns AMP_SUCCESS or AMP_UNSUPPORTED if the file can't be read or
+ * parsed.
+ */
+static int amp_internal_sysfs_read_id(char const* path,
+                                      size_t* result);
+
+/**
+ * Reads a size with an optional K, M, or G suffix from the file at path.
+ *
+ * Returns AMP_SUCCESS or AMP_UNSUPPORTED if the file can't be read or
+ * parsed.
+ */
+static int amp_internal_sysfs_read_size(char const* path,
+                                        size_t* result);
+
+/**
+ * Fills the caches of info from the cache directory of the hardware thread
+ * os_id. Cache levels that can't be read are left zeroed.
+ */
+static void amp_internal_sysfs_read_caches(size_t os_id,
+                                           struct amp_platform_hwthread_info_s* info);
+
+/**
+ * Sets the NUMA node of info from the nodeM entry of the cpu directory of
+ * the hardware thread os_id, leaves it untouched if there is no entry.
+ */
+static void amp_internal_sysfs_read_numa_node(size_t os_id,
+                                              struct amp_platform_hwthread_info_s* info);
+
+/**
+ * Counts the distinct package, core, and NUMA node ids of the topology
+ * table of descr.
+ */
+static void amp_internal_platform_topology_count(amp_platform_t descr);
+
+
+
+static int amp_internal_sysfs_read_list(char const* path,
+                                        size_t* ids,
+                                        size_t capacity,
+                                        size_t* count)
+{
+    assert(NULL != path);
+    assert((NULL != ids) || (0 == capacity));
+    assert(NULL != count);
+
+    FILE* file = fopen(path, "r");
+    if (NULL == file) {
+        return AMP_UNSUPPORTED;
+    }
+
+    int retval = AMP_SUCCESS;
+    size_t listed_count = 0;
+
+    for (;;) {
+        unsigned long first = 0;
+        unsigned long last = 0;
+
+        /* An empty list only contains a newline. */
+        if (1 != fscanf(file, "%lu", &first)) {
+            break;
+        }
+        last = first;
+
+        int separator = fgetc(file);
+        if ('-' == separator) {
+            if ((1 != fscanf(file, "%lu", &last)) || (last < first)) {
+                retval = AMP_UNSUPPORTED;
+                break;
+            }
+            separator = fgetc(file);
+        }
+
+        for (unsigned long id = first; id <= last; ++id) {
+            if (listed_count < capacity) {
+                ids[listed_count] = (size_t)id;
+            }
+            ++listed_count;
+        }
+
+        if (',' != separator) {
+            break;
+        }
+    }
+
+    int const rc = fclose(file);
+    assert(0 == rc);
+    (void)rc;
+
+    if (AMP_SUCCESS == retval) {
+        *count = listed_count;
+    }
+
+    return retval;
+}
+
+
+
+static int amp_internal_sysfs_read_id(char const* path,
+                                      size_t* result)
+{
+    assert(NULL != path);
+    assert(NULL != result);
+
+    FILE* file = fopen(path, "r");
+    if (NULL == file) {
+        return AMP_UNSUPPORTED;
+    }
+
+    long id = 0;
+    int const scanned = fscanf(file, "%ld", &id);
+
+    int const rc = fclose(file);
+    assert(0 == rc);
+    (void)rc;
+
+    if (1 != scanned) {
+        return AMP_UNSUPPORTED;
+    }
+
+    *result = (0 > id) ? 0 : (size_t)id;
+
+    return AMP_SUCCESS;
+}
+
+
+
+static int amp_internal_sysfs_read_size(char const* path,
+                                        size_t* result)
+{
+    assert(NULL != path);
+    assert(NULL != result);
+
+    FILE* file = fopen(path, "r");
+    if (NULL == file) {
+        return AMP_UNSUPPORTED;
+    }
+
+    unsigned long size = 0;
+    char suffix = '\0';
+    int const scanned = fscanf(file, "%lu%c", &size, &suffix);
+
+    int const rc = fclose(file);
+    assert(0 == rc);
+    (void)rc;
+
+    if (1 > scanned) {
+        return AMP_UNSUPPORTED;
+    }
+
+    switch (suffix) {
+        case 'G':
+            size *= 1024ul;
+            /* Fallthrough */
+        case 'M':
+            size *= 1024ul;
+            /* Fallthrough */
+        case 'K':
+            size *= 1024ul;
+            break;
+        default:
+            break;
+    }
+
+    *result = (size_t)size;
+
+    return AMP_SUCCESS;
+}
+
+
+
+static void amp_internal_sysfs_read_caches(size_t os_id,
+                                           struct amp_platform_hwthread_info_s* info)
+{
+    assert(NULL != info);
+
+    char path[AMP_INTERNAL_SYSFS_PATH_CAPACITY];
+
+    for (unsigned int index = 0; ; ++index) {
+
+        size_t level = 0;
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/cache/index%u/level",
+                       (unsigned long)os_id, index);
+        if (AMP_SUCCESS != amp_internal_sysfs_read_id(path, &level)) {
+            /* No more caches. */
+            break;
+        }
+
+        if ((1 > level) || (AMP_PLATFORM_CACHE_LEVEL_COUNT < level)) {
+            continue;
+        }
+
+        char type[32] = {'\0'};
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/cache/index%u/type",
+                       (unsigned long)os_id, index);
+        FILE* file = fopen(path, "r");
+        if (NULL != file) {
+            char const* const line = fgets(type, (int)sizeof(type), file);
+            (void)line;
+            int const rc = fclose(file);
+            assert(0 == rc);
+            (void)rc;
+        }
+        if (0 == strncmp(type, "Instruction", strlen("Instruction"))) {
+            continue;
+        }
+
+        struct amp_platform_cache_info_s cache = {0, os_id, 1};
+
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/cache/index%u/size",
+                       (unsigned long)os_id, index);
+        if (AMP_SUCCESS != amp_internal_sysfs_read_size(path, &cache.size_in_bytes)) {
+            continue;
+        }
+
+        size_t lowest_sharing_id = os_id;
+        size_t sharing_count = 0;
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/cache/index%u/shared_cpu_list",
+                       (unsigned long)os_id, index);
+        if ((AMP_SUCCESS == amp_internal_sysfs_read_list(path, &lowest_sharing_id, 1, &sharing_count))
+            && (0 < sharing_count)) {
+
+            cache.sharing_id = lowest_sharing_id;
+            cache.sharing_hwthread_count = sharing_count;
+        }
+
+        info->caches[level - 1] = cache;
+    }
+}
+
+
+
+static void amp_internal_sysfs_read_numa_node(size_t os_id,
+                                              struct amp_platform_hwthread_info_s* info)
+{
+    assert(NULL != info);
+
+    char path[AMP_INTERNAL_SYSFS_PATH_CAPACITY];
+    (void)snprintf(path, sizeof(path),
+                   AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu",
+                   (unsigned long)os_id);
+
+    DIR* directory = opendir(path);
+    if (NULL == directory) {
+        return;
+    }
+
+    struct dirent* entry = NULL;
+    while (NULL != (entry = readdir(directory))) {
+        unsigned long node_id = 0;
+        char trailing = '\0';
+        if ((0 == strncmp(entry->d_name, "node", strlen("node")))
+            && (1 == sscanf(entry->d_name + strlen("node"), "%lu%c", &node_id, &trailing))) {
+
+            info->numa_node_id = (size_t)node_id;
+            break;
+        }
+    }
+
+    int const rc = closedir(directory);
+    assert(0 == rc);
+    (void)rc;
+}
+
+
+
+static void amp_internal_platform_topology_count(amp_platform_t descr)
+{
+    assert(NULL != descr);
+
+    struct amp_platform_hwthread_info_s const* hwthreads = descr->hwthreads;
+    size_t const hwthread_count = descr->hwthread_count;
+
+    descr->core_count = 0;
+    descr->package_count = 0;
+    descr->numa_node_count = 0;
+
+    for (size_t i = 0; i < hwthread_count; ++i) {
+
+        amp_bool_t is_new_core = AMP_TRUE;
+        amp_bool_t is_new_package = AMP_TRUE;
+        amp_bool_t is_new_numa_node = AMP_TRUE;
+
+        for (size_t k = 0; k < i; ++k) {
+            if (hwthreads[k].package_id == hwthreads[i].package_id) {
+                is_new_package = AMP_FALSE;
+
+                if (hwthreads[k].core_id == hwthreads[i].core_id) {
+                    is_new_core = AMP_FALSE;
+                }
+            }
+
+            if (hwthreads[k].numa_node_id == hwthreads[i].numa_node_id) {
+                is_new_numa_node = AMP_FALSE;
+            }
+        }
+
+        descr->core_count += (AMP_TRUE == is_new_core) ? 1 : 0;
+        descr->package_count += (AMP_TRUE == is_new_package) ? 1 : 0;
+        descr->numa_node_count += (AMP_TRUE == is_new_numa_node) ? 1 : 0;
+    }
+}
+
+
+
+int amp_internal_platform_topology_init(amp_platform_t descr,
+                                        amp_allocator_t allocator)
+{
+    assert(NULL != descr);
+    assert(NULL == descr->hwthreads);
+    assert(NULL != allocator);
+
+    size_t hwthread_count = 0;
+    int retval = amp_internal_sysfs_read_list(AMP_INTERNAL_SYSFS_CPU_PATH "/online",
+                                              NULL,
+                                              0,
+                                              &hwthread_count);
+    if ((AMP_SUCCESS != retval) || (0 == hwthread_count)) {
+        return AMP_UNSUPPORTED;
+    }
+
+    size_t* os_ids = (size_t*)AMP_ALLOC(allocator,
+                                        hwthread_count * sizeof(*os_ids));
+    if (NULL == os_ids) {
+        return AMP_NOMEM;
+    }
+
+    struct amp_platform_hwthread_info_s* hwthreads = (struct amp_platform_hwthread_info_s*)AMP_CALLOC(allocator,
+                                                                                                       hwthread_count,
+                                                                                                       sizeof(*hwthreads));
+    if (NULL == hwthreads) {
+        int const rc = AMP_DEALLOC(allocator, os_ids);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+
+        return AMP_NOMEM;
+    }
+
+    /* CPUs might go on- or offline between the reads. */
+    size_t listed_count = 0;
+    retval = amp_internal_sysfs_read_list(AMP_INTERNAL_SYSFS_CPU_PATH "/online",
+                                          os_ids,
+                                          hwthread_count,
+                                          &listed_count);
+    if (listed_count < hwthread_count) {
+        hwthread_count = listed_count;
+    }
+
+    char path[AMP_INTERNAL_SYSFS_PATH_CAPACITY];
+
+    for (size_t i = 0; (i < hwthread_count) && (AMP_SUCCESS == retval); ++i) {
+
+        struct amp_platform_hwthread_info_s* info = &hwthreads[i];
+        size_t const os_id = os_ids[i];
+
+        info->os_id = os_id;
+
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/topology/physical_package_id",
+                       (unsigned long)os_id);
+        retval = amp_internal_sysfs_read_id(path, &info->package_id);
+        if (AMP_SUCCESS != retval) {
+            break;
+        }
+
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/topology/core_id",
+                       (unsigned long)os_id);
+        retval = amp_internal_sysfs_read_id(path, &info->core_id);
+        if (AMP_SUCCESS != retval) {
+            break;
+        }
+
+        (void)snprintf(path, sizeof(path),
+                       AMP_INTERNAL_SYSFS_CPU_PATH "/cpu%lu/topology/thread_siblings_list",
+                       (unsigned long)os_id);
+        retval = amp_internal_sysfs_read_list(path, NULL, 0, &info->smt_sibling_count);
+        if ((AMP_SUCCESS != retval) || (0 == info->smt_sibling_count)) {
+            info->smt_sibling_count = 1;
+            retval = AMP_SUCCESS;
+        }
+
+        amp_internal_sysfs_read_caches(os_id, info);
+        amp_internal_sysfs_read_numa_node(os_id, info);
+    }
+
+    int const rc = AMP_DEALLOC(allocator, os_ids);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+
+    if ((AMP_SUCCESS != retval) || (0 == hwthread_count)) {
+
+        int const retv = AMP_DEALLOC(allocator, hwthreads);
+        assert(AMP_SUCCESS == retv);
+        (void)retv;
+
+        return AMP_UNSUPPORTED;
+    }
+
+    descr->hwthreads = hwthreads;
+    descr->hwthread_count = hwthread_count;
+    amp_internal_platform_topology_count(descr);
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_platform_topology_finalize(amp_platform_t descr,
+                                            amp_allocator_t allocator)
+{
+    assert(NULL != descr);
+    assert(NULL != allocator);
+
+    int retval = AMP_SUCCESS;
+
+    if (NULL != descr->hwthreads) {
+        retval = AMP_DEALLOC(allocator, descr->hwthreads);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    descr->hwthreads = NULL;
+    descr->hwthread_count = 0;
+    descr->core_count = 0;
+    descr->package_count = 0;
+    descr->numa_node_count = 0;
+
+    return retval;
+}
+
+
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Internal functions each rwlock backend implements. The shared code in
+ * amp_rwlock_common.c implements the public API and the reader-biased mode on
+ * top of them.
+ *
+ * Everything contained in this file can change without any notice.
+ */
+
+#ifndef AMP_amp_internal_rwlock_H
+#define AMP_amp_internal_rwlock_H
+
+#include <amp/amp_rwlock.h>
+#include <amp/amp_raw_rwlock.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Initializes or finalizes the backend specific fields of rwlock.
+     */
+    int amp_internal_rwlock_backend_init(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_finalize(amp_rwlock_t rwlock);
+
+    /**
+     * Backend lock operations with the return codes documented for the
+     * public rwlock functions.
+     */
+    int amp_internal_rwlock_backend_read_lock(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_read_trylock(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_read_unlock(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_write_lock(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_write_trylock(amp_rwlock_t rwlock);
+    int amp_internal_rwlock_backend_write_unlock(amp_rwlock_t rwlock);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_internal_rwlock_H */
@@ -178,6 +178,49 @@ extern "C" {
     int amp_internal_thread_launch_configured(amp_thread_t thread);
     
     
+    /**
+     * Checks if the backend is able to pin threads to the hardware threads
+     * of affinity.
+     *
+     * @return AMP_SUCCESS if pinning is supported or AMP_UNSUPPORTED.
+     */
+    int amp_internal_thread_check_affinity(struct amp_thread_affinity_s const* affinity);
+    
+    
+    /**
+     * Pins the launched thread to the hardware threads of thread->affinity.
+     *
+     * @attention Only call for launched and not yet joined threads with a 
+     *            supported affinity.
+     */
+    int amp_internal_thread_apply_affinity(amp_thread_t thread);
+    
+    
+    /**
+     * Checks if the backend supports attributes and if they are valid.
+     *
+     * @return AMP_SUCCESS if attributes are supported, AMP_UNSUPPORTED if the
+     *         backend doesn't support an attribute, or AMP_ERROR if an 
+     *         attribute is invalid, e.g. the priority is out of range.
+     */
+    int amp_internal_thread_check_attributes(struct amp_thread_attributes_s const* attributes);
+    
+    
+    /**
+     * Sets the attributes to launch the thread with, attributes might be NULL
+     * to launch with the platform defaults.
+     *
+     * A race condition can occur if calling from different threads for the same
+     * thread object.
+     *
+     * @return AMP_SUCCESS, AMP_BUSY if thread is launched and not yet joined,
+     *         or an error code of amp_internal_thread_check_attributes in which
+     *         case thread isn't changed.
+     */
+    int amp_internal_thread_configure_attributes(amp_thread_t thread,
+                                                 struct amp_thread_attributes_s const* attributes);
+    
+    
     
     /**
      * Returns the thread id of the thread calling the function.
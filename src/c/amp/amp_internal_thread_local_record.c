@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the shared per-thread record registration. The link of
+ * a record is written with memcpy as its type is only known to the caller,
+ * this relies on all object pointers sharing one representation.
+ */
+
+#include "amp_internal_thread_local_record.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "amp_return_code.h"
+#include "amp_atomic.h"
+#include "amp_thread_local_slot.h"
+
+
+
+int amp_internal_thread_local_record_register(amp_thread_local_slot_key_t key,
+                                               amp_atomic_pointer_t head,
+                                               void* record,
+                                               size_t next_offset)
+{
+    void* expected_head = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != head);
+    assert(NULL != record);
+    
+    retval = amp_thread_local_slot_set_value(key, record);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    expected_head = amp_atomic_pointer_load_explicit(head,
+                                                     AMP_MEMORY_ORDER_RELAXED);
+    do {
+        memcpy((char*)record + next_offset, &expected_head, sizeof(expected_head));
+    } while (!amp_atomic_pointer_compare_exchange_explicit(head,
+                                                           &expected_head,
+                                                           record,
+                                                           AMP_MEMORY_ORDER_RELEASE,
+                                                           AMP_MEMORY_ORDER_RELAXED));
+    
+    return AMP_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Registration of per-thread records, e.g. the caches of 
+ * amp_pool_allocator. A module finds the record of the calling thread via
+ * a thread-local slot and keeps all records in a lock-free list that only
+ * grows at its head so they can be visited by other threads and freed on
+ * destruction.
+ *
+ * Everything contained in this file can change without any notice.
+ */
+
+#ifndef AMP_amp_internal_thread_local_record_H
+#define AMP_amp_internal_thread_local_record_H
+
+#include <stddef.h>
+
+#include <amp/amp_atomic.h>
+#include <amp/amp_thread_local_slot.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Stores record in key for the calling thread and pushes it onto the 
+     * list starting at head. The records are linked by a pointer to the
+     * record type next_offset bytes into each record, e.g. 
+     * offsetof(struct record_s, next).
+     *
+     * The push has release semantics, threads loading head with acquire 
+     * semantics see the initialized record.
+     *
+     * @return AMP_SUCCESS if record has been registered.
+     *         Otherwise the error of amp_thread_local_slot_set_value is 
+     *         returned and record isn't pushed onto the list, the caller
+     *         still owns it.
+     */
+    int amp_internal_thread_local_record_register(amp_thread_local_slot_key_t key,
+                                                  amp_atomic_pointer_t head,
+                                                  void* record,
+                                                  size_t next_offset);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_internal_thread_local_record_H */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Internal monotonic clock helpers used to implement the timed wait
+ * functions. Timeouts are passed to amp as relative durations in
+ * nanoseconds and converted into absolute deadlines on the monotonic clock
+ * once, so spurious wakeups or repeated waits don't extend the timeout.
+ *
+ * Everything contained in this file can change without any notice.
+ */
+
+#ifndef AMP_amp_internal_time_H
+#define AMP_amp_internal_time_H
+
+#include <amp/amp_stdint.h>
+
+#if defined(AMP_USE_PTHREADS)
+#   include <pthread.h>
+#   include <time.h>
+#elif defined(AMP_USE_WINTHREADS)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   error Unsupported platform.
+#endif
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Deadline that is never reached.
+     */
+#define AMP_INTERNAL_TIME_INFINITE_DEADLINE (~(uint64_t)0)
+
+    /**
+     * First and longest sleep of amp_internal_time_backoff.
+     */
+#define AMP_INTERNAL_TIME_MIN_BACKOFF_NS ((uint64_t)1000)
+#define AMP_INTERNAL_TIME_MAX_BACKOFF_NS ((uint64_t)1000000)
+
+
+    /**
+     * Returns the current time of a monotonic clock in nanoseconds. Only
+     * differences between returned values are meaningful.
+     */
+    uint64_t amp_internal_time_monotonic_ns(void);
+
+
+    /**
+     * Returns the monotonic time timeout_ns nanoseconds from now, or
+     * AMP_INTERNAL_TIME_INFINITE_DEADLINE if that overflows.
+     */
+    uint64_t amp_internal_time_deadline_ns(uint64_t timeout_ns);
+
+
+    /**
+     * Returns the nanoseconds left until deadline_ns or 0 if it has passed.
+     */
+    uint64_t amp_internal_time_remaining_ns(uint64_t deadline_ns);
+
+
+    /**
+     * Suspends the calling thread for about duration_ns nanoseconds. Used to
+     * back off while polling for a resource that can't be waited on with a
+     * timeout.
+     */
+    void amp_internal_time_sleep_ns(uint64_t duration_ns);
+
+
+    /**
+     * Sleeps for backoff_ns nanoseconds but not beyond deadline_ns and
+     * returns the back-off duration for the next polling round - backoff_ns
+     * doubled up to AMP_INTERNAL_TIME_MAX_BACKOFF_NS.
+     */
+    uint64_t amp_internal_time_backoff(uint64_t deadline_ns,
+                                       uint64_t backoff_ns);
+
+
+#if defined(AMP_USE_PTHREADS)
+
+    /**
+     * Initializes cond so that amp_internal_time_cond_timedwait measures
+     * deadlines on the monotonic clock.
+     *
+     * @return 0 or the error code of pthread_cond_init.
+     */
+    int amp_internal_time_cond_init(pthread_cond_t* cond);
+
+
+    /**
+     * Like pthread_cond_wait but returns ETIMEDOUT when deadline_ns, as
+     * returned by amp_internal_time_deadline_ns, has passed. cond must have
+     * been initialized via amp_internal_time_cond_init.
+     *
+     * @return 0, ETIMEDOUT, or the error code of pthread_cond_timedwait.
+     */
+    int amp_internal_time_cond_timedwait(pthread_cond_t* cond,
+                                         pthread_mutex_t* mutex,
+                                         uint64_t deadline_ns);
+
+
+    /**
+     * Converts a monotonic time in nanoseconds into a timespec.
+     */
+    void amp_internal_time_to_timespec(uint64_t time_ns,
+                                       struct timespec* time);
+
+#elif defined(AMP_USE_WINTHREADS)
+
+    /**
+     * Returns the milliseconds left until deadline_ns rounded up, capped
+     * below INFINITE, for passing to Windows wait functions. Returns 
+     * INFINITE for AMP_INTERNAL_TIME_INFINITE_DEADLINE.
+     */
+    DWORD amp_internal_time_remaining_ms(uint64_t deadline_ns);
+
+#endif
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_internal_time_H */
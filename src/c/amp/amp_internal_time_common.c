@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Platform independent monotonic clock helpers.
+ */
+
+#include "amp_internal_time.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stdint.h"
+
+
+
+uint64_t amp_internal_time_deadline_ns(uint64_t timeout_ns)
+{
+    uint64_t const now = amp_internal_time_monotonic_ns();
+    
+    if (timeout_ns >= AMP_INTERNAL_TIME_INFINITE_DEADLINE - now) {
+        return AMP_INTERNAL_TIME_INFINITE_DEADLINE;
+    }
+    
+    return now + timeout_ns;
+}
+
+
+
+uint64_t amp_internal_time_remaining_ns(uint64_t deadline_ns)
+{
+    uint64_t const now = amp_internal_time_monotonic_ns();
+    
+    return (deadline_ns > now) ? (deadline_ns - now) : 0;
+}
+
+
+
+uint64_t amp_internal_time_backoff(uint64_t deadline_ns,
+                                   uint64_t backoff_ns)
+{
+    uint64_t const remaining_ns = amp_internal_time_remaining_ns(deadline_ns);
+    
+    amp_internal_time_sleep_ns((backoff_ns < remaining_ns) ? backoff_ns : remaining_ns);
+    
+    backoff_ns *= 2;
+    if (backoff_ns > AMP_INTERNAL_TIME_MAX_BACKOFF_NS) {
+        backoff_ns = AMP_INTERNAL_TIME_MAX_BACKOFF_NS;
+    }
+    
+    return backoff_ns;
+}
+
+
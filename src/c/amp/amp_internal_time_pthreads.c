@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Monotonic clock helpers for Pthreads platforms based on
+ * clock_gettime(CLOCK_MONOTONIC).
+ *
+ * Mac OS X doesn't support monotonic condition variable clocks, therefore
+ * timed condition variable waits use the relative
+ * pthread_cond_timedwait_relative_np there.
+ */
+
+/* clock_gettime and nanosleep aren't declared in strict C99 mode. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "amp_internal_time.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "amp_stdint.h"
+
+
+
+#if !defined(AMP_USE_PTHREADS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+#define AMP_INTERNAL_TIME_NS_PER_S ((uint64_t)1000000000)
+
+
+
+uint64_t amp_internal_time_monotonic_ns(void)
+{
+    struct timespec now;
+    
+    int const retval = clock_gettime(CLOCK_MONOTONIC, &now);
+    assert(0 == retval);
+    (void)retval;
+    
+    return (uint64_t)now.tv_sec * AMP_INTERNAL_TIME_NS_PER_S + (uint64_t)now.tv_nsec;
+}
+
+
+
+void amp_internal_time_sleep_ns(uint64_t duration_ns)
+{
+    struct timespec duration;
+    amp_internal_time_to_timespec(duration_ns, &duration);
+    
+    /* Waking up early on a signal is fine for backing off. */
+    (void)nanosleep(&duration, NULL);
+}
+
+
+
+int amp_internal_time_cond_init(pthread_cond_t* cond)
+{
+    assert(NULL != cond);
+    
+#if defined(__APPLE__)
+    return pthread_cond_init(cond, NULL);
+#else
+    pthread_condattr_t cond_attributes;
+    int retval = pthread_condattr_init(&cond_attributes);
+    if (0 != retval) {
+        return retval;
+    }
+    
+    retval = pthread_condattr_setclock(&cond_attributes, CLOCK_MONOTONIC);
+    assert(0 == retval);
+    
+    retval = pthread_cond_init(cond, &cond_attributes);
+    
+    int const cattr_destroy_retval = pthread_condattr_destroy(&cond_attributes);
+    assert(0 == cattr_destroy_retval);
+    (void)cattr_destroy_retval;
+    
+    return retval;
+#endif
+}
+
+
+
+int amp_internal_time_cond_timedwait(pthread_cond_t* cond,
+                                     pthread_mutex_t* mutex,
+                                     uint64_t deadline_ns)
+{
+    assert(NULL != cond);
+    assert(NULL != mutex);
+    
+    if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+        return pthread_cond_wait(cond, mutex);
+    }
+    
+#if defined(__APPLE__)
+    struct timespec relative_time;
+    amp_internal_time_to_timespec(amp_internal_time_remaining_ns(deadline_ns),
+                                  &relative_time);
+    
+    return pthread_cond_timedwait_relative_np(cond, mutex, &relative_time);
+#else
+    struct timespec deadline;
+    amp_internal_time_to_timespec(deadline_ns, &deadline);
+    
+    return pthread_cond_timedwait(cond, mutex, &deadline);
+#endif
+}
+
+
+
+void amp_internal_time_to_timespec(uint64_t time_ns,
+                                   struct timespec* time)
+{
+    assert(NULL != time);
+    
+    time->tv_sec = (time_t)(time_ns / AMP_INTERNAL_TIME_NS_PER_S);
+    time->tv_nsec = (long)(time_ns % AMP_INTERNAL_TIME_NS_PER_S);
+}
+
+
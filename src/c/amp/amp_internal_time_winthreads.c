@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Monotonic clock helpers for Windows based on the performance counter.
+ */
+
+#include "amp_internal_time.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stdint.h"
+
+
+
+#if !defined(AMP_USE_WINTHREADS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+#define AMP_INTERNAL_TIME_NS_PER_S ((uint64_t)1000000000)
+#define AMP_INTERNAL_TIME_NS_PER_MS ((uint64_t)1000000)
+
+
+
+uint64_t amp_internal_time_monotonic_ns(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    uint64_t ticks = 0;
+    uint64_t ticks_per_s = 0;
+    BOOL retval = QueryPerformanceFrequency(&frequency);
+    assert(FALSE != retval);
+    
+    retval = QueryPerformanceCounter(&counter);
+    assert(FALSE != retval);
+    (void)retval;
+    
+    ticks = (uint64_t)counter.QuadPart;
+    ticks_per_s = (uint64_t)frequency.QuadPart;
+    
+    /* Split the conversion to not overflow for large tick counts. */
+    return (ticks / ticks_per_s) * AMP_INTERNAL_TIME_NS_PER_S
+        + ((ticks % ticks_per_s) * AMP_INTERNAL_TIME_NS_PER_S) / ticks_per_s;
+}
+
+
+
+void amp_internal_time_sleep_ns(uint64_t duration_ns)
+{
+    DWORD const duration_ms = (DWORD)((duration_ns + AMP_INTERNAL_TIME_NS_PER_MS - 1) / AMP_INTERNAL_TIME_NS_PER_MS);
+    
+    Sleep(duration_ms);
+}
+
+
+
+DWORD amp_internal_time_remaining_ms(uint64_t deadline_ns)
+{
+    uint64_t remaining_ms = 0;
+    
+    if (AMP_INTERNAL_TIME_INFINITE_DEADLINE == deadline_ns) {
+        return INFINITE;
+    }
+    
+    remaining_ms = (amp_internal_time_remaining_ns(deadline_ns) + AMP_INTERNAL_TIME_NS_PER_MS - 1) / AMP_INTERNAL_TIME_NS_PER_MS;
+    
+    return (remaining_ms < (uint64_t)INFINITE) ? (DWORD)remaining_ms : (INFINITE - 1);
+}
+
+
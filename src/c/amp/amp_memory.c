@@ -36,11 +36,22 @@
  * Implementation of amp memory.
  */ 
 
+/* posix_memalign is a POSIX 2001 function. */
+#if !defined(AMP_USE_WINTHREADS) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "amp_memory.h"
 
 #include <assert.h>
 #include <stdlib.h>
 
+#if defined(AMP_USE_WINTHREADS)
+#   include <malloc.h>
+#endif
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
 #include "amp_return_code.h"
 
 
@@ -52,7 +63,10 @@ static struct amp_raw_allocator_s amp_internal_allocator_default = {
     amp_default_alloc,
     amp_default_calloc,
     amp_default_dealloc,
-    NULL /* amp_default_allocator_context */
+    amp_default_aligned_alloc,
+    amp_default_aligned_dealloc,
+    NULL, /* amp_default_allocator_context */
+    NULL /* amp_default_allocator_context for aligned allocations */
 };
 
 
@@ -106,6 +120,144 @@ int amp_default_dealloc(void *dummy_allocator_context,
 
 
 
+void* amp_default_aligned_alloc(void* dummy_allocator_context,
+                                size_t alignment,
+                                size_t bytes_to_allocate,
+                                char const* filename,
+                                int line)
+{
+    void* pointer = NULL;
+    
+    (void)dummy_allocator_context;
+    (void)filename;
+    (void)line;
+    
+    assert(0 != alignment);
+    assert(0 == (alignment & (alignment - 1)));
+    
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    
+#if defined(AMP_USE_WINTHREADS)
+    pointer = _aligned_malloc(bytes_to_allocate, alignment);
+#else
+    if (0 != posix_memalign(&pointer, alignment, bytes_to_allocate)) {
+        pointer = NULL;
+    }
+#endif
+    
+    return pointer;
+}
+
+
+
+int amp_default_aligned_dealloc(void* dummy_allocator_context,
+                                void* pointer,
+                                char const* filename,
+                                int line)
+{
+    (void)dummy_allocator_context;
+    (void)filename;
+    (void)line;
+    
+#if defined(AMP_USE_WINTHREADS)
+    _aligned_free(pointer);
+#else
+    free(pointer);
+#endif
+    
+    return AMP_SUCCESS;
+}
+
+
+
+/**
+ * Aligned alloc function of allocators created via amp_allocator_create.
+ * allocator_context is the allocator itself. Allocates enough memory via
+ * its alloc function to align the returned pointer and to store the 
+ * allocated pointer in front of it.
+ */
+static void* amp_internal_allocator_aligned_alloc(void* allocator_context,
+                                                  size_t alignment,
+                                                  size_t bytes_to_allocate,
+                                                  char const* filename,
+                                                  int line);
+
+/**
+ * Aligned dealloc function of allocators created via amp_allocator_create.
+ * Passes the pointer stored by amp_internal_allocator_aligned_alloc to the
+ * dealloc function of the allocator.
+ */
+static int amp_internal_allocator_aligned_dealloc(void* allocator_context,
+                                                  void* pointer,
+                                                  char const* filename,
+                                                  int line);
+
+
+
+static void* amp_internal_allocator_aligned_alloc(void* allocator_context,
+                                                  size_t alignment,
+                                                  size_t bytes_to_allocate,
+                                                  char const* filename,
+                                                  int line)
+{
+    amp_allocator_t allocator = (amp_allocator_t)allocator_context;
+    size_t overhead = 0;
+    char* memory = NULL;
+    uintptr_t aligned_address = 0;
+    
+    assert(NULL != allocator);
+    assert(0 != alignment);
+    assert(0 == (alignment & (alignment - 1)));
+    
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    
+    overhead = sizeof(void*) + alignment - 1;
+    if (bytes_to_allocate > AMP_SIZE_MAX - overhead) {
+        return NULL;
+    }
+    
+    memory = (char*)allocator->alloc_func(allocator->allocator_context,
+                                          bytes_to_allocate + overhead,
+                                          filename,
+                                          line);
+    if (NULL == memory) {
+        return NULL;
+    }
+    
+    aligned_address = (uintptr_t)(memory + sizeof(void*));
+    aligned_address = (aligned_address + (alignment - 1)) & ~((uintptr_t)(alignment - 1));
+    ((void**)aligned_address)[-1] = memory;
+    
+    return (void*)aligned_address;
+}
+
+
+
+static int amp_internal_allocator_aligned_dealloc(void* allocator_context,
+                                                  void* pointer,
+                                                  char const* filename,
+                                                  int line)
+{
+    amp_allocator_t allocator = (amp_allocator_t)allocator_context;
+    
+    assert(NULL != allocator);
+    
+    if (NULL == pointer) {
+        return AMP_SUCCESS;
+    }
+    
+    return allocator->dealloc_func(allocator->allocator_context,
+                                   ((void**)pointer)[-1],
+                                   filename,
+                                   line);
+}
+
+
+
 int amp_allocator_create(amp_allocator_t* target_allocator,
                          amp_allocator_t source_allocator,
                          void* target_allocator_context,
@@ -129,7 +281,10 @@ int amp_allocator_create(amp_allocator_t* target_allocator,
     tmp_allocator->alloc_func = target_alloc_func;
     tmp_allocator->calloc_func = target_calloc_func;
     tmp_allocator->dealloc_func = target_dealloc_func;
+    tmp_allocator->aligned_alloc_func = &amp_internal_allocator_aligned_alloc;
+    tmp_allocator->aligned_dealloc_func = &amp_internal_allocator_aligned_dealloc;
     tmp_allocator->allocator_context = target_allocator_context;
+    tmp_allocator->aligned_allocator_context = tmp_allocator;
     
     *target_allocator = tmp_allocator;
     
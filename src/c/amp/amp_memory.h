@@ -35,10 +35,17 @@
  *
  * An allocator used by create and destroy functions which can be 
  * configured by users to include their own allocation, array allocation, 
- * and deallocation functions using a user supplied context.
+ * aligned allocation, and deallocation functions using a user supplied 
+ * context.
  *
  * The default allocator uses shallow wrappers around C's malloc, calloc, and
- * free.
+ * free, and around posix_memalign or _aligned_malloc and _aligned_free on
+ * Windows.
+ *
+ * The create functions of mutexes, condition variables, semaphores, and 
+ * barriers allocate via the aligned allocation function so that their 
+ * memory starts on a cache line and doesn't share cache lines with other
+ * allocations.
  *
  * TODO: @todo Add a test, especially to check the amp_calloc_func_t contract.
  */
@@ -97,6 +104,26 @@ extern "C" {
                                       void *pointer,
                                       char const* filename,
                                       int line);
+    
+    /**
+     * Function type defining an allocation function that allocates memory
+     * of size bytes_to_allocate starting at an address that is a multiple of
+     * alignment using the allocator_context and returns a pointer to it or 
+     * NULL if an error occured.
+     *
+     * alignment must be a power of two. bytes_to_allocate should be a 
+     * multiple of alignment so the last aligned unit of memory isn't shared
+     * with other allocations.
+     *
+     * Memory allocated via an aligned allocation function must be freed via
+     * the associated aligned deallocation function of type 
+     * amp_dealloc_func_t.
+     */
+    typedef void* (*amp_aligned_alloc_func_t)(void* allocator_context,
+                                              size_t alignment,
+                                              size_t bytes_to_allocate,
+                                              char const* filename,
+                                              int line);
 
     
     
@@ -151,6 +178,33 @@ extern "C" {
                             int line);
     
     
+    /**
+     * Shallow wrapper around posix_memalign, or _aligned_malloc on Windows, 
+     * which ignores allocator context, filename, and line. Alignments 
+     * smaller than a pointer are raised to the size of a pointer.
+     *
+     * Only thread-safe if the wrapped function is thread-safe.
+     */
+    void* amp_default_aligned_alloc(void* dummy_allocator_context,
+                                    size_t alignment,
+                                    size_t bytes_to_allocate,
+                                    char const* filename,
+                                    int line);
+    
+    
+    /**
+     * Shallow wrapper around C std free, or _aligned_free on Windows, to free
+     * memory allocated via amp_default_aligned_alloc. Ignores allocator 
+     * context, filename, and line.
+     *
+     * Always returns AMP_SUCCESS.
+     */
+    int amp_default_aligned_dealloc(void* dummy_allocator_context,
+                                    void* pointer,
+                                    char const* filename,
+                                    int line);
+    
+    
     /**
      * Allocator type used by amp's create and destroy functions.
      * Treat as opaque as its implementation can and will change with each 
@@ -158,14 +212,17 @@ extern "C" {
      *
      * Create via amp_allocator_create and destroy via amp_allocator_destroy.
      * To allocate or deallocate memory via an allocator use the functions
-     * (which might be preprocessor macros) AMP_ALLOC, AMP_CALLOC, and 
-     * AMP_DEALLOC.
+     * (which might be preprocessor macros) AMP_ALLOC, AMP_CALLOC, 
+     * AMP_DEALLOC, AMP_ALIGNED_ALLOC, and AMP_ALIGNED_DEALLOC.
      */
     struct amp_raw_allocator_s {
         amp_alloc_func_t alloc_func;
         amp_calloc_func_t calloc_func;
         amp_dealloc_func_t dealloc_func;
+        amp_aligned_alloc_func_t aligned_alloc_func;
+        amp_dealloc_func_t aligned_dealloc_func;
         void* allocator_context;
+        void* aligned_allocator_context;
     };
     typedef struct amp_raw_allocator_s* amp_allocator_t;
     
@@ -181,7 +238,10 @@ extern "C" {
      * allocator context.
      *
      * alloc_func, calloc_func, and dealloc_func and allocator_context must
-     * work/fit together.
+     * work/fit together. Aligned allocations via the target allocator 
+     * over-allocate with alloc_func and are freed with dealloc_func, 
+     * therefore all memory of the target allocator comes from the passed
+     * functions.
      *
      * @return AMP_SUCCESS on successful creation.
      *         AMP_NOMEM if not enough memory is available to allocate the
@@ -216,8 +276,9 @@ extern "C" {
     
     /**
      * Default allocator using amp_default_alloc, amp_default_calloc,
-     * amp_default_dealloc, and AMP_DEFAULT_ALLOCATOR_CONTEXT. Use it to 
-     * bootstrap new allocators.
+     * amp_default_dealloc, amp_default_aligned_alloc, 
+     * amp_default_aligned_dealloc, and AMP_DEFAULT_ALLOCATOR_CONTEXT. Use it
+     * to bootstrap new allocators.
      *
      * @attention Do not change it.
      */
@@ -259,6 +320,26 @@ extern "C" {
      */
 #define AMP_DEALLOC(allocator, pointer) (allocator)->dealloc_func((allocator)->allocator_context, (pointer), __FILE__, __LINE__)
     
+    /**
+     * Calls the aligned alloc function of allocator to allocate size bytes of
+     * memory aligned to alignment bytes.
+     * See amp_aligned_alloc_func_t for a behavior specification.
+     *
+     * The allocator expression must not have side-effects as it is used twice
+     * in the macro.
+     */
+#define AMP_ALIGNED_ALLOC(allocator, alignment, size) (allocator)->aligned_alloc_func((allocator)->aligned_allocator_context, (alignment), (size), __FILE__, __LINE__)
+    
+    /**
+     * Calls the aligned dealloc function of allocator to deallocate the 
+     * memory pointer points to which must have been allocated via 
+     * AMP_ALIGNED_ALLOC.
+     *
+     * The allocator expression must not have side-effects as it is used twice
+     * in the macro.
+     */
+#define AMP_ALIGNED_DEALLOC(allocator, pointer) (allocator)->aligned_dealloc_func((allocator)->aligned_allocator_context, (pointer), __FILE__, __LINE__)
+    
     
     
 #if defined(__cplusplus)   
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the bounded multi-producer/multi-consumer queue after 
+ * Dmitry Vyukov's bounded MPMC queue. The queue, its slots, and the 
+ * semaphores are allocated from the allocator passed to 
+ * amp_mpmc_queue_create.
+ *
+ * Slot i holds sequence number i for the first round - free for the 
+ * producer claiming position i. A producer storing an element at position 
+ * pos sets the sequence to pos + 1 - ready for the consumer claiming 
+ * position pos. The consumer sets it to pos + capacity - free for the 
+ * producer of the next round.
+ *
+ * Threads register in a waiting count before parking on a semaphore and 
+ * check the queue again afterwards. Pushes and pops read the waiting counts
+ * after a full fence, claim one registration, and signal the semaphore. A
+ * parked thread that finds the queue usable after registering withdraws its
+ * registration if it hasn't been claimed yet, otherwise the surplus 
+ * semaphore signal causes one spurious wake-up which is handled by 
+ * checking the queue again.
+ */
+
+#include "amp_mpmc_queue.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_semaphore.h"
+
+
+
+struct amp_internal_mpmc_queue_cell_s {
+    struct amp_raw_atomic_int64_s sequence;
+    void* element;
+};
+
+
+/**
+ * Producers claim positions at the tail, consumers at the head, both live
+ * on their own cache line. The rest is read-mostly.
+ */
+struct amp_mpmc_queue_s {
+    struct amp_raw_atomic_int64_s tail;
+    char tail_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    struct amp_raw_atomic_int64_s head;
+    char head_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    
+    struct amp_raw_atomic_int32_s waiting_pusher_count;
+    struct amp_raw_atomic_int32_s waiting_popper_count;
+    
+    struct amp_internal_mpmc_queue_cell_s* cells;
+    int64_t mask;
+    
+    amp_semaphore_t not_full;
+    amp_semaphore_t not_empty;
+};
+
+
+
+/**
+ * Claims one registration from waiting_count and signals semaphore if a
+ * thread is registered.
+ */
+static void amp_internal_mpmc_queue_wake(struct amp_raw_atomic_int32_s* waiting_count,
+                                         amp_semaphore_t semaphore);
+
+/**
+ * Registers the calling thread in waiting_count before checking the queue
+ * for the last time ahead of parking.
+ */
+static void amp_internal_mpmc_queue_register(struct amp_raw_atomic_int32_s* waiting_count);
+
+/**
+ * Withdraws a registration from waiting_count unless it has been claimed.
+ */
+static void amp_internal_mpmc_queue_withdraw(struct amp_raw_atomic_int32_s* waiting_count);
+
+/**
+ * Frees the semaphores (if created) and the memory of queue.
+ */
+static int amp_internal_mpmc_queue_free(struct amp_mpmc_queue_s* queue,
+                                        amp_allocator_t allocator);
+
+
+
+static void amp_internal_mpmc_queue_wake(struct amp_raw_atomic_int32_s* waiting_count,
+                                         amp_semaphore_t semaphore)
+{
+    int32_t count = 0;
+    
+    /* Pairs with the fence in amp_internal_mpmc_queue_register - either the
+     * waiting thread sees the published slot or the count is seen here.
+     */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    
+    count = amp_atomic_int32_load_explicit(waiting_count,
+                                           AMP_MEMORY_ORDER_RELAXED);
+    while (0 < count) {
+        if (amp_atomic_int32_compare_exchange_explicit(waiting_count,
+                                                       &count,
+                                                       count - 1,
+                                                       AMP_MEMORY_ORDER_RELAXED,
+                                                       AMP_MEMORY_ORDER_RELAXED)) {
+            int const rc = amp_semaphore_signal(semaphore);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+            
+            break;
+        }
+    }
+}
+
+
+
+static void amp_internal_mpmc_queue_register(struct amp_raw_atomic_int32_s* waiting_count)
+{
+    (void)amp_atomic_int32_fetch_add_explicit(waiting_count,
+                                              1,
+                                              AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+}
+
+
+
+static void amp_internal_mpmc_queue_withdraw(struct amp_raw_atomic_int32_s* waiting_count)
+{
+    int32_t count = amp_atomic_int32_load_explicit(waiting_count,
+                                                   AMP_MEMORY_ORDER_RELAXED);
+    while (0 < count) {
+        if (amp_atomic_int32_compare_exchange_explicit(waiting_count,
+                                                       &count,
+                                                       count - 1,
+                                                       AMP_MEMORY_ORDER_RELAXED,
+                                                       AMP_MEMORY_ORDER_RELAXED)) {
+            break;
+        }
+    }
+}
+
+
+
+static int amp_internal_mpmc_queue_free(struct amp_mpmc_queue_s* queue,
+                                        amp_allocator_t allocator)
+{
+    int retval = AMP_SUCCESS;
+    
+    if (AMP_SEMAPHORE_UNINITIALIZED != queue->not_empty) {
+        retval = amp_semaphore_destroy(&queue->not_empty, allocator);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    if (AMP_SEMAPHORE_UNINITIALIZED != queue->not_full) {
+        retval = amp_semaphore_destroy(&queue->not_full, allocator);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    retval = AMP_ALIGNED_DEALLOC(allocator, queue);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_mpmc_queue_create(amp_mpmc_queue_t* queue,
+                          amp_allocator_t allocator,
+                          size_t capacity)
+{
+    struct amp_mpmc_queue_s* tmp_queue = NULL;
+    size_t const header_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_queue));
+    size_t cell_count = 2;
+    size_t i = 0;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != queue);
+    assert(NULL != allocator);
+    assert(0 < capacity);
+    
+    if (0 == capacity) {
+        return AMP_ERROR;
+    }
+    
+    /* Slots are indexed with a mask, therefore round up to a power of two. */
+    while (cell_count < capacity) {
+        if ((AMP_SIZE_MAX / 2) < cell_count) {
+            return AMP_NOMEM;
+        }
+        cell_count *= 2;
+    }
+    
+    if ((AMP_SIZE_MAX - header_size - AMP_CACHE_LINE_SIZE) / sizeof(struct amp_internal_mpmc_queue_cell_s) < cell_count) {
+        return AMP_NOMEM;
+    }
+    
+    tmp_queue = (struct amp_mpmc_queue_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                           AMP_CACHE_LINE_SIZE,
+                                                           AMP_CACHE_LINE_ROUND_UP(header_size + cell_count * sizeof(struct amp_internal_mpmc_queue_cell_s)));
+    if (NULL == tmp_queue) {
+        return AMP_NOMEM;
+    }
+    
+    amp_atomic_int64_store_explicit(&tmp_queue->tail, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int64_store_explicit(&tmp_queue->head, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&tmp_queue->waiting_pusher_count, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&tmp_queue->waiting_popper_count, 0, AMP_MEMORY_ORDER_RELAXED);
+    tmp_queue->cells = (struct amp_internal_mpmc_queue_cell_s*)((char*)tmp_queue + header_size);
+    tmp_queue->mask = (int64_t)(cell_count - 1);
+    tmp_queue->not_full = AMP_SEMAPHORE_UNINITIALIZED;
+    tmp_queue->not_empty = AMP_SEMAPHORE_UNINITIALIZED;
+    
+    for (i = 0; i < cell_count; ++i) {
+        amp_atomic_int64_store_explicit(&tmp_queue->cells[i].sequence,
+                                        (int64_t)i,
+                                        AMP_MEMORY_ORDER_RELAXED);
+        tmp_queue->cells[i].element = NULL;
+    }
+    
+    retval = amp_semaphore_create(&tmp_queue->not_full, allocator, 0);
+    if (AMP_SUCCESS == retval) {
+        retval = amp_semaphore_create(&tmp_queue->not_empty, allocator, 0);
+    }
+    if (AMP_SUCCESS != retval) {
+        int const rc = amp_internal_mpmc_queue_free(tmp_queue, allocator);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    *queue = tmp_queue;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mpmc_queue_destroy(amp_mpmc_queue_t* queue,
+                           amp_allocator_t allocator)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != queue);
+    assert(NULL != *queue);
+    assert(NULL != allocator);
+    
+    retval = amp_internal_mpmc_queue_free(*queue, allocator);
+    if (AMP_SUCCESS == retval) {
+        *queue = AMP_MPMC_QUEUE_UNINITIALIZED;
+    }
+    
+    return retval;
+}
+
+
+
+void amp_mpmc_queue_get_capacity(amp_mpmc_queue_t queue,
+                                 size_t* capacity)
+{
+    assert(NULL != queue);
+    assert(NULL != capacity);
+    
+    *capacity = (size_t)queue->mask + 1;
+}
+
+
+
+int amp_mpmc_queue_try_push(amp_mpmc_queue_t queue,
+                            void* element)
+{
+    struct amp_internal_mpmc_queue_cell_s* cell = NULL;
+    int64_t position = 0;
+    int64_t sequence = 0;
+    
+    assert(NULL != queue);
+    
+    position = amp_atomic_int64_load_explicit(&queue->tail,
+                                              AMP_MEMORY_ORDER_RELAXED);
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        sequence = amp_atomic_int64_load_explicit(&cell->sequence,
+                                                  AMP_MEMORY_ORDER_ACQUIRE);
+        
+        if (sequence == position) {
+            if (amp_atomic_int64_compare_exchange_explicit(&queue->tail,
+                                                           &position,
+                                                           position + 1,
+                                                           AMP_MEMORY_ORDER_RELAXED,
+                                                           AMP_MEMORY_ORDER_RELAXED)) {
+                break;
+            }
+        } else if (sequence < position) {
+            /* The slot still holds the element of the previous round. */
+            return AMP_BUSY;
+        } else {
+            position = amp_atomic_int64_load_explicit(&queue->tail,
+                                                      AMP_MEMORY_ORDER_RELAXED);
+        }
+    }
+    
+    cell->element = element;
+    amp_atomic_int64_store_explicit(&cell->sequence,
+                                    position + 1,
+                                    AMP_MEMORY_ORDER_RELEASE);
+    
+    amp_internal_mpmc_queue_wake(&queue->waiting_popper_count,
+                                 queue->not_empty);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mpmc_queue_try_pop(amp_mpmc_queue_t queue,
+                           void** element)
+{
+    struct amp_internal_mpmc_queue_cell_s* cell = NULL;
+    int64_t position = 0;
+    int64_t sequence = 0;
+    
+    assert(NULL != queue);
+    assert(NULL != element);
+    
+    position = amp_atomic_int64_load_explicit(&queue->head,
+                                              AMP_MEMORY_ORDER_RELAXED);
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        sequence = amp_atomic_int64_load_explicit(&cell->sequence,
+                                                  AMP_MEMORY_ORDER_ACQUIRE);
+        
+        if (sequence == position + 1) {
+            if (amp_atomic_int64_compare_exchange_explicit(&queue->head,
+                                                           &position,
+                                                           position + 1,
+                                                           AMP_MEMORY_ORDER_RELAXED,
+                                                           AMP_MEMORY_ORDER_RELAXED)) {
+                break;
+            }
+        } else if (sequence < position + 1) {
+            /* No element has been stored in the slot for this round. */
+            return AMP_BUSY;
+        } else {
+            position = amp_atomic_int64_load_explicit(&queue->head,
+                                                      AMP_MEMORY_ORDER_RELAXED);
+        }
+    }
+    
+    *element = cell->element;
+    amp_atomic_int64_store_explicit(&cell->sequence,
+                                    position + queue->mask + 1,
+                                    AMP_MEMORY_ORDER_RELEASE);
+    
+    amp_internal_mpmc_queue_wake(&queue->waiting_pusher_count,
+                                 queue->not_full);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mpmc_queue_push(amp_mpmc_queue_t queue,
+                        void* element)
+{
+    int retval = AMP_ERROR;
+    
+    for (;;) {
+        retval = amp_mpmc_queue_try_push(queue, element);
+        if (AMP_BUSY != retval) {
+            return retval;
+        }
+        
+        amp_internal_mpmc_queue_register(&queue->waiting_pusher_count);
+        
+        retval = amp_mpmc_queue_try_push(queue, element);
+        if (AMP_BUSY != retval) {
+            amp_internal_mpmc_queue_withdraw(&queue->waiting_pusher_count);
+            
+            return retval;
+        }
+        
+        retval = amp_semaphore_wait(queue->not_full);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+}
+
+
+
+int amp_mpmc_queue_pop(amp_mpmc_queue_t queue,
+                       void** element)
+{
+    int retval = AMP_ERROR;
+    
+    for (;;) {
+        retval = amp_mpmc_queue_try_pop(queue, element);
+        if (AMP_BUSY != retval) {
+            return retval;
+        }
+        
+        amp_internal_mpmc_queue_register(&queue->waiting_popper_count);
+        
+        retval = amp_mpmc_queue_try_pop(queue, element);
+        if (AMP_BUSY != retval) {
+            amp_internal_mpmc_queue_withdraw(&queue->waiting_popper_count);
+            
+            return retval;
+        }
+        
+        retval = amp_semaphore_wait(queue->not_empty);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+}
+
+
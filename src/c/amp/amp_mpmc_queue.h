@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Bounded lock-free multi-producer/multi-consumer queue of pointers to hand
+ * elements over between threads. The queue is an array of slots, each with
+ * a sequence number telling producers and consumers whether the slot is
+ * free for the current round or holds an element. Producers and consumers 
+ * claim slots by incrementing the tail or head position with a 
+ * compare-and-exchange, the positions live on separate cache lines.
+ *
+ * The try functions never block and return AMP_BUSY if the queue is full or
+ * empty. The blocking push and pop functions park the calling thread on a
+ * semaphore only while the queue is full or empty. Successful pushes and 
+ * pops wake parked threads, so blocking and non-blocking calls can be mixed.
+ *
+ * Elements are handed over in FIFO order per producer. Pushing an element
+ * happens-before popping it.
+ *
+ * Never pass an invalid, e.g. non-created queue to any of the functions 
+ * other than the create function.
+ */
+
+#ifndef AMP_amp_mpmc_queue_H
+#define AMP_amp_mpmc_queue_H
+
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+#define AMP_MPMC_QUEUE_UNINITIALIZED NULL
+
+
+    /**
+     * Opaque queue type.
+     */
+    typedef struct amp_mpmc_queue_s *amp_mpmc_queue_t;
+
+
+    /**
+     * Creates a queue able to hold capacity elements, capacity is rounded up
+     * to the next power of two and to at least 2.
+     *
+     * If the creation fails the allocator is called to free the already
+     * allocated memory which must not result in an error or otherwise
+     * behavior is undefined.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     *         AMP_ERROR if capacity is 0 or other system resources are
+     *         insufficient.
+     */
+    int amp_mpmc_queue_create(amp_mpmc_queue_t* queue,
+                              amp_allocator_t allocator,
+                              size_t capacity);
+
+    /**
+     * Frees the queue with allocator. Elements still in the queue are
+     * dropped, no thread may use the queue anymore.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_BUSY might be returned if threads are parked in the queue.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_mpmc_queue_destroy(amp_mpmc_queue_t* queue,
+                               amp_allocator_t allocator);
+
+    /**
+     * Returns the capacity of the queue in capacity.
+     */
+    void amp_mpmc_queue_get_capacity(amp_mpmc_queue_t queue,
+                                     size_t* capacity);
+
+    /**
+     * Appends element to the queue if it isn't full.
+     *
+     * @return AMP_SUCCESS if element has been pushed.
+     *         AMP_BUSY if the queue is full.
+     */
+    int amp_mpmc_queue_try_push(amp_mpmc_queue_t queue,
+                                void* element);
+
+    /**
+     * Removes the oldest element from the queue and returns it in element if
+     * the queue isn't empty.
+     *
+     * @return AMP_SUCCESS if an element has been popped.
+     *         AMP_BUSY if the queue is empty, element isn't changed.
+     */
+    int amp_mpmc_queue_try_pop(amp_mpmc_queue_t queue,
+                               void** element);
+
+    /**
+     * Appends element to the queue, blocks while the queue is full.
+     *
+     * @return AMP_SUCCESS if element has been pushed.
+     *         Error codes of amp_semaphore_wait.
+     */
+    int amp_mpmc_queue_push(amp_mpmc_queue_t queue,
+                            void* element);
+
+    /**
+     * Removes the oldest element from the queue and returns it in element,
+     * blocks while the queue is empty.
+     *
+     * @return AMP_SUCCESS if an element has been popped.
+     *         Error codes of amp_semaphore_wait.
+     */
+    int amp_mpmc_queue_pop(amp_mpmc_queue_t queue,
+                           void** element);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_mpmc_queue_H */
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the intrusive multi-producer/single-consumer queue 
+ * after Dmitry Vyukov's non-intrusive MPSC node-based queue. Producers 
+ * exchange the tail and then link the previous tail to their node, the 
+ * consumer follows the links from the head. A stub node keeps the queue 
+ * non-empty so the consumer never needs to touch the tail to pop a node 
+ * that has a successor, only the last node is swapped against the stub.
+ *
+ * A sleeping consumer is marked by the lowest bit of the tail which only 
+ * holds the stub then. The producer exchanging the marked tail sees the 
+ * mark in the previous tail it obtains anyway and calls the wake-up 
+ * function - the transition doesn't cost the producers an additional 
+ * atomic operation or fence.
+ */
+
+#include "amp_mpsc_queue.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_semaphore.h"
+#include "amp_raw_mpsc_queue.h"
+
+
+
+#define AMP_INTERNAL_MPSC_QUEUE_SLEEPING_MARK ((uintptr_t)1)
+
+
+
+/**
+ * Exchanges the tail of queue with node and links the previous tail to 
+ * node. Returns non-zero if the previous tail marked the consumer as 
+ * sleeping.
+ */
+static int amp_internal_mpsc_queue_link(amp_mpsc_queue_t queue,
+                                        amp_mpsc_queue_node_t node);
+
+
+
+static int amp_internal_mpsc_queue_link(amp_mpsc_queue_t queue,
+                                        amp_mpsc_queue_node_t node)
+{
+    uintptr_t prev_bits = 0;
+    amp_mpsc_queue_node_t prev = NULL;
+    
+    amp_atomic_pointer_store_explicit(&node->next, NULL, AMP_MEMORY_ORDER_RELAXED);
+    
+    prev_bits = (uintptr_t)amp_atomic_pointer_exchange_explicit(&queue->tail,
+                                                                node,
+                                                                AMP_MEMORY_ORDER_ACQ_REL);
+    prev = (amp_mpsc_queue_node_t)(prev_bits & ~AMP_INTERNAL_MPSC_QUEUE_SLEEPING_MARK);
+    
+    /* Until this store the consumer can't reach node or any node pushed 
+     * after it.
+     */
+    amp_atomic_pointer_store_explicit(&prev->next, node, AMP_MEMORY_ORDER_RELEASE);
+    
+    return (0 != (prev_bits & AMP_INTERNAL_MPSC_QUEUE_SLEEPING_MARK));
+}
+
+
+
+void amp_mpsc_queue_semaphore_wakeup(void* wakeup_context)
+{
+    int const rc = amp_semaphore_signal((amp_semaphore_t)wakeup_context);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+}
+
+
+
+void amp_raw_mpsc_queue_init(amp_mpsc_queue_t queue,
+                             amp_mpsc_queue_wakeup_func_t wakeup_func,
+                             void* wakeup_context)
+{
+    assert(NULL != queue);
+    
+    amp_atomic_pointer_store_explicit(&queue->stub.next, NULL, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_pointer_store_explicit(&queue->tail, &queue->stub, AMP_MEMORY_ORDER_RELAXED);
+    queue->wakeup_func = wakeup_func;
+    queue->wakeup_context = wakeup_context;
+    queue->head = &queue->stub;
+}
+
+
+
+void amp_raw_mpsc_queue_finalize(amp_mpsc_queue_t queue)
+{
+    assert(NULL != queue);
+    
+    queue->wakeup_func = NULL;
+    queue->wakeup_context = NULL;
+    queue->head = NULL;
+}
+
+
+
+int amp_mpsc_queue_create(amp_mpsc_queue_t* queue,
+                          amp_allocator_t allocator,
+                          amp_mpsc_queue_wakeup_func_t wakeup_func,
+                          void* wakeup_context)
+{
+    struct amp_raw_mpsc_queue_s* tmp_queue = NULL;
+    
+    assert(NULL != queue);
+    assert(NULL != allocator);
+    
+    tmp_queue = (struct amp_raw_mpsc_queue_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                               AMP_CACHE_LINE_SIZE,
+                                                               AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_queue)));
+    if (NULL == tmp_queue) {
+        return AMP_NOMEM;
+    }
+    
+    amp_raw_mpsc_queue_init(tmp_queue, wakeup_func, wakeup_context);
+    
+    *queue = tmp_queue;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mpsc_queue_destroy(amp_mpsc_queue_t* queue,
+                           amp_allocator_t allocator)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != queue);
+    assert(NULL != *queue);
+    assert(NULL != allocator);
+    
+    amp_raw_mpsc_queue_finalize(*queue);
+    
+    retval = AMP_ALIGNED_DEALLOC(allocator, *queue);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    *queue = AMP_MPSC_QUEUE_UNINITIALIZED;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_mpsc_queue_push(amp_mpsc_queue_t queue,
+                         amp_mpsc_queue_node_t node)
+{
+    assert(NULL != queue);
+    assert(NULL != node);
+    assert(&queue->stub != node);
+    
+    if (0 != amp_internal_mpsc_queue_link(queue, node)) {
+        
+        assert(NULL != queue->wakeup_func);
+        
+        queue->wakeup_func(queue->wakeup_context);
+    }
+}
+
+
+
+int amp_mpsc_queue_try_pop(amp_mpsc_queue_t queue,
+                           amp_mpsc_queue_node_t* node)
+{
+    amp_mpsc_queue_node_t head = NULL;
+    amp_mpsc_queue_node_t next = NULL;
+    
+    assert(NULL != queue);
+    assert(NULL != node);
+    
+    head = queue->head;
+    next = (amp_mpsc_queue_node_t)amp_atomic_pointer_load_explicit(&head->next, 
+                                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    
+    if (&queue->stub == head) {
+        if (NULL == next) {
+            return AMP_BUSY;
+        }
+        
+        /* Skip the stub. */
+        queue->head = next;
+        head = next;
+        next = (amp_mpsc_queue_node_t)amp_atomic_pointer_load_explicit(&head->next, 
+                                                                       AMP_MEMORY_ORDER_ACQUIRE);
+    }
+    
+    if (NULL == next) {
+        
+        /* head looks like the last node. If it isn't the tail a producer 
+         * has exchanged the tail but not linked its node yet.
+         */
+        if (head != amp_atomic_pointer_load_explicit(&queue->tail, 
+                                                     AMP_MEMORY_ORDER_ACQUIRE)) {
+            return AMP_BUSY;
+        }
+        
+        /* Push the stub behind head to be able to pop head without leaving
+         * the queue without a node. The consumer is awake, therefore the 
+         * sleeping mark can't be set.
+         */
+        {
+            int const sleeping = amp_internal_mpsc_queue_link(queue, &queue->stub);
+            assert(0 == sleeping);
+            (void)sleeping;
+        }
+        
+        next = (amp_mpsc_queue_node_t)amp_atomic_pointer_load_explicit(&head->next, 
+                                                                       AMP_MEMORY_ORDER_ACQUIRE);
+        if (NULL == next) {
+            /* A producer exchanged the tail in between and hasn't linked 
+             * its node yet.
+             */
+            return AMP_BUSY;
+        }
+    }
+    
+    queue->head = next;
+    *node = head;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mpsc_queue_try_sleep(amp_mpsc_queue_t queue)
+{
+    void* expected = NULL;
+    
+    assert(NULL != queue);
+    
+    /* The queue is empty if only the stub is left. */
+    if ((&queue->stub != queue->head)
+        || (NULL != amp_atomic_pointer_load_explicit(&queue->stub.next, 
+                                                     AMP_MEMORY_ORDER_RELAXED))) {
+        return AMP_BUSY;
+    }
+    
+    /* Fails if a producer has exchanged the tail in the meantime. */
+    expected = &queue->stub;
+    if (amp_atomic_pointer_compare_exchange_explicit(&queue->tail,
+                                                     &expected,
+                                                     (void*)((uintptr_t)&queue->stub | AMP_INTERNAL_MPSC_QUEUE_SLEEPING_MARK),
+                                                     AMP_MEMORY_ORDER_ACQ_REL,
+                                                     AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_SUCCESS;
+    }
+    
+    return AMP_BUSY;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unbounded intrusive multi-producer/single-consumer queue, e.g. for the
+ * mailboxes of actors. Elements embed an amp_raw_mpsc_queue_node_s header
+ * of one pointer (see amp_raw_mpsc_queue.h) so the queue never allocates
+ * memory for pushes. A push is a single atomic exchange, the consumer pops
+ * without locks.
+ *
+ * A consumer finding the queue empty can go to sleep via 
+ * amp_mpsc_queue_try_sleep. The next push then calls the wake-up function 
+ * of the queue, e.g. amp_mpsc_queue_semaphore_wakeup to signal the 
+ * semaphore the consumer waits on. Pushes onto a queue whose consumer is 
+ * awake never call the wake-up function.
+ *
+ * Elements are popped in the order their pushes exchanged the queue tail,
+ * in FIFO order per producer. Pushing a node happens-before popping it.
+ *
+ * Never pass an invalid, e.g. non-created queue to any of the functions 
+ * other than the create function. Never push a node that is still queued.
+ * Only one thread at a time may act as the consumer.
+ */
+
+#ifndef AMP_amp_mpsc_queue_H
+#define AMP_amp_mpsc_queue_H
+
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+#define AMP_MPSC_QUEUE_UNINITIALIZED NULL
+
+
+    /**
+     * Opaque queue type. See amp_raw_mpsc_queue.h for its definition.
+     */
+    typedef struct amp_raw_mpsc_queue_s *amp_mpsc_queue_t;
+    
+    /**
+     * Node header to embed into queued elements, place it as the first 
+     * member to convert between node and element pointers. See 
+     * amp_raw_mpsc_queue.h for its definition.
+     */
+    typedef struct amp_raw_mpsc_queue_node_s *amp_mpsc_queue_node_t;
+    
+    /**
+     * Function called by the push that wakes up a sleeping consumer.
+     */
+    typedef void (*amp_mpsc_queue_wakeup_func_t)(void* wakeup_context);
+    
+    
+    /**
+     * Wake-up function signaling the amp_semaphore_t passed as 
+     * wakeup_context.
+     */
+    void amp_mpsc_queue_semaphore_wakeup(void* wakeup_context);
+    
+    
+    /**
+     * Creates an empty queue that calls wakeup_func with wakeup_context to 
+     * wake up its sleeping consumer. wakeup_func can be NULL if the consumer
+     * never sleeps.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     */
+    int amp_mpsc_queue_create(amp_mpsc_queue_t* queue,
+                              amp_allocator_t allocator,
+                              amp_mpsc_queue_wakeup_func_t wakeup_func,
+                              void* wakeup_context);
+    
+    /**
+     * Frees the queue with allocator. Nodes still in the queue are dropped
+     * (but not freed), no thread may use the queue anymore.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_mpsc_queue_destroy(amp_mpsc_queue_t* queue,
+                               amp_allocator_t allocator);
+    
+    /**
+     * Appends node to the queue and calls the wake-up function if the 
+     * consumer sleeps. Can be called by any number of threads concurrently.
+     */
+    void amp_mpsc_queue_push(amp_mpsc_queue_t queue,
+                             amp_mpsc_queue_node_t node);
+    
+    /**
+     * Removes the oldest node from the queue and returns it in node. Only 
+     * call from the consumer.
+     *
+     * The queue can appear empty for a moment while a producer is in the 
+     * middle of a push, check with amp_mpsc_queue_try_sleep before 
+     * sleeping.
+     *
+     * @return AMP_SUCCESS if a node has been popped.
+     *         AMP_BUSY if no node can be popped right now, node isn't 
+     *         changed.
+     */
+    int amp_mpsc_queue_try_pop(amp_mpsc_queue_t queue,
+                               amp_mpsc_queue_node_t* node);
+    
+    /**
+     * Marks the consumer as sleeping if the queue is empty so the next push
+     * calls the wake-up function. Only call from the consumer.
+     *
+     * After a successful call the consumer must wait for the wake-up, e.g. 
+     * on the semaphore signaled by the wake-up function, before popping 
+     * again.
+     *
+     * @return AMP_SUCCESS if the consumer has been marked as sleeping.
+     *         AMP_BUSY if the queue isn't empty or a push is in progress, 
+     *         try to pop again.
+     */
+    int amp_mpsc_queue_try_sleep(amp_mpsc_queue_t queue);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_mpsc_queue_H */
@@ -91,6 +91,7 @@
 
 #include <stddef.h>
 
+#include <amp/amp_stdint.h>
 #include <amp/amp_memory.h>
 
 
@@ -140,6 +141,29 @@ extern "C" {
     int amp_mutex_create(amp_mutex_t* mutex,
                          amp_allocator_t allocator);
     
+    
+    /**
+     * Like amp_mutex_create but creates a mutex that spins up to spin_count
+     * times with a processor pause hint (see amp_atomic_spin_pause) trying to
+     * grab a contended lock before the locking thread is put to sleep.
+     *
+     * Spinning prevents the context switch costs of parking and waking a
+     * thread if the mutex only protects short critical sections. Don't spin
+     * if the critical sections are long or if more threads than hardware
+     * threads contend for the mutex.
+     *
+     * A spin_count of 0 disables spinning on all backends but the Windows
+     * backend, which always uses CRITICAL_SECTION spinning and passes 
+     * spin_count to InitializeCriticalSectionAndSpinCount. amp_mutex_create
+     * uses a spin count of 0 for Pthreads and futex mutexes and
+     * AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_DEFAULT_SPIN_COUNT on Windows.
+     *
+     * @return Same return codes as amp_mutex_create.
+     */
+    int amp_mutex_create_with_spin(amp_mutex_t* mutex,
+                                   amp_allocator_t allocator,
+                                   unsigned int spin_count);
+    
     /**
      * Finalizes the mutex and frees its memory and platform resources.
      *
@@ -209,6 +233,32 @@ extern "C" {
      */
     int amp_mutex_trylock(amp_mutex_t mutex);
     
+    /**
+     * Locks the mutex like amp_mutex_lock but gives up and returns 
+     * AMP_TIMEOUT if the lock couldn't be taken within timeout_ns 
+     * nanoseconds, measured on a monotonic clock. A timeout of 0 behaves
+     * like amp_mutex_trylock but returns AMP_TIMEOUT instead of AMP_BUSY.
+     *
+     * Backends without a native timed lock poll with trylock and a growing
+     * back-off sleep, therefore the lock might be taken a bit later than
+     * with amp_mutex_lock when it is released.
+     *
+     * @return AMP_SUCCESS if the lock has been taken.
+     *         AMP_TIMEOUT if the lock hasn't been taken before the timeout
+     *         expired.
+     *         Error codes might be returned to signal errors while
+     *         locking, too. These are programming errors and mustn't 
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     *         AMP_ERROR if the mutex isn't valid, e.g. not initialized or if 
+     *         trying to lock recursively.
+     *
+     * @attention Trying to recursively lock a mutex from the same thread
+     *            results in undefined behavior. Never lock recursively.
+     */
+    int amp_mutex_timedlock(amp_mutex_t mutex,
+                            uint64_t timeout_ns);
+    
     /**
      * Unlocks the mutex, other threads trying to lock it or which are blocked
      * waiting on the lock will get it in non-deterministic order one after the
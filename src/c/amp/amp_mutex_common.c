@@ -41,13 +41,43 @@
 #include <assert.h>
 #include <stddef.h>
 
+#include "amp_stddef.h"
 #include "amp_return_code.h"
 #include "amp_raw_mutex.h"
 
+#if defined(AMP_USE_WINTHREADS)
+#   include "amp_internal_winthreads_critical_section_config.h"
+#endif
 
 
-int amp_mutex_create(amp_mutex_t* mutex,
-                     amp_allocator_t allocator)
+
+/**
+ * Spin count amp_mutex_create passes to the backend, see 
+ * amp_mutex_create_with_spin.
+ */
+#if defined(AMP_USE_FUTEX_MUTEXES) || defined(AMP_USE_PTHREADS)
+#   define AMP_INTERNAL_MUTEX_DEFAULT_SPIN_COUNT 0
+#elif defined(AMP_USE_WINTHREADS)
+#   define AMP_INTERNAL_MUTEX_DEFAULT_SPIN_COUNT AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_DEFAULT_SPIN_COUNT
+#else
+#   error Unsupported platform.
+#endif
+
+
+
+/**
+ * Allocates a cache line aligned mutex with allocator and initializes it 
+ * with spin_count.
+ */
+static int amp_internal_mutex_create(amp_mutex_t* mutex,
+                                     amp_allocator_t allocator,
+                                     unsigned int spin_count);
+
+
+
+static int amp_internal_mutex_create(amp_mutex_t* mutex,
+                                     amp_allocator_t allocator,
+                                     unsigned int spin_count)
 {
     amp_mutex_t tmp_mutex = AMP_MUTEX_UNINITIALIZED;
     int retval = AMP_UNSUPPORTED;
@@ -55,18 +85,20 @@ int amp_mutex_create(amp_mutex_t* mutex,
     assert(NULL != mutex);
     assert(NULL != allocator);
     
-    tmp_mutex = (amp_mutex_t)AMP_ALLOC(allocator,
-                                       sizeof(*tmp_mutex));
+    tmp_mutex = (amp_mutex_t)AMP_ALIGNED_ALLOC(allocator,
+                                               AMP_CACHE_LINE_SIZE,
+                                               AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_mutex)));
     if (NULL == tmp_mutex) {
         return AMP_NOMEM;
     }
  
-    retval = amp_raw_mutex_init(tmp_mutex);
+    retval = amp_raw_mutex_init_with_spin(tmp_mutex,
+                                          spin_count);
     if (AMP_SUCCESS == retval) {
         *mutex = tmp_mutex;
     } else {
-        int const rc = AMP_DEALLOC(allocator,
-                                   tmp_mutex);
+        int const rc = AMP_ALIGNED_DEALLOC(allocator,
+                                           tmp_mutex);
         assert(AMP_SUCCESS == rc);
         (void)rc;
     }
@@ -76,6 +108,27 @@ int amp_mutex_create(amp_mutex_t* mutex,
 
 
 
+int amp_mutex_create(amp_mutex_t* mutex,
+                     amp_allocator_t allocator)
+{
+    return amp_internal_mutex_create(mutex,
+                                     allocator,
+                                     AMP_INTERNAL_MUTEX_DEFAULT_SPIN_COUNT);
+}
+
+
+
+int amp_mutex_create_with_spin(amp_mutex_t* mutex,
+                               amp_allocator_t allocator,
+                               unsigned int spin_count)
+{
+    return amp_internal_mutex_create(mutex,
+                                     allocator,
+                                     spin_count);
+}
+
+
+
 int amp_mutex_destroy(amp_mutex_t* mutex,
                       amp_allocator_t allocator)
 {
@@ -87,8 +140,8 @@ int amp_mutex_destroy(amp_mutex_t* mutex,
     
     retval = amp_raw_mutex_finalize(*mutex);
     if (AMP_SUCCESS == retval) {
-        retval = AMP_DEALLOC(allocator,
-                             *mutex);
+        retval = AMP_ALIGNED_DEALLOC(allocator,
+                                     *mutex);
         assert(AMP_SUCCESS == retval);
         if (AMP_SUCCESS == retval) {
             *mutex = AMP_MUTEX_UNINITIALIZED;
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Linux futex based mutex backend. Uncontended locking and unlocking only
+ * cost one atomic operation each, the kernel is only entered if threads
+ * contend for the mutex.
+ *
+ * The mutex state word holds one of three values (see Ulrich Drepper,
+ * Futexes Are Tricky, 2011):
+ * 0 - unlocked,
+ * 1 - locked and no other thread waits,
+ * 2 - locked and other threads might wait in the kernel.
+ *
+ * Mutexes created with a spin count spin before marking the mutex as
+ * contended and sleeping in the kernel.
+ *
+ * Unlike the Pthreads backend in debug mode the futex mutex doesn't detect 
+ * recursive locking or unlocking by a non-owning thread - this is a 
+ * programming error and behavior is undefined.
+ */
+
+#include "amp_mutex.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_return_code.h"
+#include "amp_stdint.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_raw_mutex.h"
+#include "amp_internal_futex_linux.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_FUTEX_MUTEXES)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+enum amp_internal_futex_mutex_state {
+    amp_internal_unlocked_futex_mutex_state = 0,
+    amp_internal_locked_futex_mutex_state = 1,
+    amp_internal_contended_futex_mutex_state = 2
+};
+
+
+
+int amp_raw_mutex_init(amp_mutex_t mutex)
+{
+    return amp_raw_mutex_init_with_spin(mutex, 0);
+}
+
+
+
+int amp_raw_mutex_init_with_spin(amp_mutex_t mutex,
+                                 unsigned int spin_count)
+{
+    assert(NULL != mutex);
+    
+    mutex->spin_count = spin_count;
+    amp_atomic_int32_store_explicit(&mutex->state,
+                                    amp_internal_unlocked_futex_mutex_state,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_mutex_finalize(amp_mutex_t mutex)
+{
+    assert(NULL != mutex);
+    
+    if (amp_internal_unlocked_futex_mutex_state != amp_atomic_int32_load(&mutex->state)) {
+        return AMP_BUSY;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mutex_lock(amp_mutex_t mutex)
+{
+    assert(NULL != mutex);
+    
+    int32_t state = amp_internal_unlocked_futex_mutex_state;
+    if (AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&mutex->state,
+                                                               &state,
+                                                               amp_internal_locked_futex_mutex_state,
+                                                               AMP_MEMORY_ORDER_ACQUIRE,
+                                                               AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_SUCCESS;
+    }
+    
+    /* Spin reading the state and only try to grab the mutex when it looks
+     * unlocked to not bounce its cache line between contending threads.
+     */
+    for (unsigned int i = 0; i < mutex->spin_count; ++i) {
+        
+        amp_atomic_spin_pause();
+        
+        state = amp_atomic_int32_load_explicit(&mutex->state,
+                                               AMP_MEMORY_ORDER_RELAXED);
+        if ((amp_internal_unlocked_futex_mutex_state == state)
+            && (AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&mutex->state,
+                                                                       &state,
+                                                                       amp_internal_locked_futex_mutex_state,
+                                                                       AMP_MEMORY_ORDER_ACQUIRE,
+                                                                       AMP_MEMORY_ORDER_RELAXED))) {
+            return AMP_SUCCESS;
+        }
+    }
+    
+    /* Contended - mark the mutex as contended so the owner wakes up a
+     * waiting thread on unlock, and sleep until the mutex was grabbed while
+     * unlocked.
+     */
+    if (amp_internal_contended_futex_mutex_state != state) {
+        state = amp_atomic_int32_exchange_explicit(&mutex->state,
+                                                   amp_internal_contended_futex_mutex_state,
+                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    }
+    
+    while (amp_internal_unlocked_futex_mutex_state != state) {
+        
+        int const retval = amp_internal_futex_wait(&mutex->state.value,
+                                                   amp_internal_contended_futex_mutex_state);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+        
+        state = amp_atomic_int32_exchange_explicit(&mutex->state,
+                                                   amp_internal_contended_futex_mutex_state,
+                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mutex_trylock(amp_mutex_t mutex)
+{
+    assert(NULL != mutex);
+    
+    int32_t state = amp_internal_unlocked_futex_mutex_state;
+    if (AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&mutex->state,
+                                                               &state,
+                                                               amp_internal_locked_futex_mutex_state,
+                                                               AMP_MEMORY_ORDER_ACQUIRE,
+                                                               AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_SUCCESS;
+    }
+    
+    return AMP_BUSY;
+}
+
+
+
+int amp_mutex_timedlock(amp_mutex_t mutex,
+                        uint64_t timeout_ns)
+{
+    assert(NULL != mutex);
+    
+    int32_t state = amp_internal_unlocked_futex_mutex_state;
+    if (AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&mutex->state,
+                                                               &state,
+                                                               amp_internal_locked_futex_mutex_state,
+                                                               AMP_MEMORY_ORDER_ACQUIRE,
+                                                               AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_SUCCESS;
+    }
+    
+    uint64_t const deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+    /* Same protocol as amp_mutex_lock without spinning. Giving up leaves the
+     * mutex marked as contended which only costs the owner a superfluous
+     * wake call on unlock.
+     */
+    state = amp_atomic_int32_exchange_explicit(&mutex->state,
+                                               amp_internal_contended_futex_mutex_state,
+                                               AMP_MEMORY_ORDER_ACQUIRE);
+    
+    while (amp_internal_unlocked_futex_mutex_state != state) {
+        
+        int const retval = amp_internal_futex_timedwait(&mutex->state.value,
+                                                        amp_internal_contended_futex_mutex_state,
+                                                        deadline_ns);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+        
+        state = amp_atomic_int32_exchange_explicit(&mutex->state,
+                                                   amp_internal_contended_futex_mutex_state,
+                                                   AMP_MEMORY_ORDER_ACQUIRE);
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_mutex_unlock(amp_mutex_t mutex)
+{
+    assert(NULL != mutex);
+    
+    int32_t const previous_state = amp_atomic_int32_exchange_explicit(&mutex->state,
+                                                                      amp_internal_unlocked_futex_mutex_state,
+                                                                      AMP_MEMORY_ORDER_RELEASE);
+    assert(amp_internal_unlocked_futex_mutex_state != previous_state);
+    
+    if (amp_internal_contended_futex_mutex_state == previous_state) {
+        return amp_internal_futex_wake(&mutex->state.value, 1);
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
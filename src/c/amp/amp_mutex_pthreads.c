@@ -34,9 +34,17 @@
  * @file
  *
  * Shallow raw wrapper around the Pthread mutex primitive.
+ *
+ * Mutexes created with a spin count try to grab the lock via trylock spin_count
+ * times before blocking in pthread_mutex_lock.
  */
 
 
+/* pthread_mutex_clocklock is a GNU extension. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
 #include "amp_mutex.h"
 
 #include <assert.h>
@@ -44,14 +52,29 @@
 #include <stddef.h>
 
 #include "amp_return_code.h"
+#include "amp_atomic.h"
 #include "amp_raw_mutex.h"
+#include "amp_internal_time.h"
 
 
 
 int amp_raw_mutex_init(amp_mutex_t mutex)
+{
+    return amp_raw_mutex_init_with_spin(mutex, 0);
+}
+
+
+
+int amp_raw_mutex_init_with_spin(amp_mutex_t mutex,
+                                 unsigned int spin_count)
 {
     assert(NULL != mutex);
     
+    mutex->spin_count = spin_count;
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
     pthread_mutexattr_t mutex_attributes;
     int retval = pthread_mutexattr_init(&mutex_attributes);
     if (0 != retval) {
@@ -119,13 +142,38 @@ int amp_mutex_lock(amp_mutex_t mutex)
 {
     assert(NULL != mutex);
     
+    /* Bounded spinning before blocking. PTHREAD_MUTEX_ADAPTIVE_NP isn't
+     * portable and its spin count can't be tuned, therefore spin on a plain
+     * read of the locked hint and only try to acquire the mutex when it 
+     * looks free to not hammer its cache line with atomic writes.
+     */
+    for (unsigned int i = 0; i < mutex->spin_count; ++i) {
+        if (0 == amp_atomic_int32_load_explicit(&mutex->is_locked, 
+                                                AMP_MEMORY_ORDER_RELAXED)) {
+            int const trylock_retval = pthread_mutex_trylock(&mutex->mutex);
+            if (0 == trylock_retval) {
+                amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                                1, 
+                                                AMP_MEMORY_ORDER_RELAXED);
+                return AMP_SUCCESS;
+            }
+            assert(EBUSY == trylock_retval);
+        }
+        
+        amp_atomic_spin_pause();
+    }
+    
     int retval = pthread_mutex_lock(&mutex->mutex);
     if (0 != retval) {
         assert(0); /* Programming error */
-        retval = AMP_ERROR;
+        return AMP_ERROR;
     }
     
-    return retval;
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    1, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    return AMP_SUCCESS;
 }
 
 
@@ -138,6 +186,9 @@ int amp_mutex_trylock(amp_mutex_t mutex)
     switch (retval) {
         case 0:
             /* retval is already equal to AMP_SUCCESS */
+            amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                            1, 
+                                            AMP_MEMORY_ORDER_RELAXED);
             break;
         case EBUSY:
             /* retval is already equal to AMP_BUSY */
@@ -152,10 +203,73 @@ int amp_mutex_trylock(amp_mutex_t mutex)
 
 
 
+int amp_mutex_timedlock(amp_mutex_t mutex,
+                        uint64_t timeout_ns)
+{
+    assert(NULL != mutex);
+    
+    uint64_t const deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+    
+    int retval = pthread_mutex_trylock(&mutex->mutex);
+    if (EBUSY == retval) {
+        struct timespec deadline;
+        amp_internal_time_to_timespec(deadline_ns, &deadline);
+        
+        retval = pthread_mutex_clocklock(&mutex->mutex, 
+                                         CLOCK_MONOTONIC, 
+                                         &deadline);
+    }
+    
+#else
+    
+    /* pthread_mutex_timedlock only measures against the realtime clock which
+     * jumps when the system time is adjusted - poll with exponential back-off
+     * instead.
+     */
+    uint64_t backoff_ns = AMP_INTERNAL_TIME_MIN_BACKOFF_NS;
+    int retval = pthread_mutex_trylock(&mutex->mutex);
+    while (EBUSY == retval) {
+        if (0 == amp_internal_time_remaining_ns(deadline_ns)) {
+            retval = ETIMEDOUT;
+            break;
+        }
+        
+        backoff_ns = amp_internal_time_backoff(deadline_ns, backoff_ns);
+        retval = pthread_mutex_trylock(&mutex->mutex);
+    }
+    
+#endif
+    
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                            1, 
+                                            AMP_MEMORY_ORDER_RELAXED);
+            break;
+        case ETIMEDOUT:
+            retval = AMP_TIMEOUT;
+            break;
+        default: /* EINVAL, EDEADLK, EAGAIN - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
 int amp_mutex_unlock(amp_mutex_t mutex)
 {
     assert(NULL != mutex);
     
+    amp_atomic_int32_store_explicit(&mutex->is_locked, 
+                                    0, 
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
     int retval = pthread_mutex_unlock(&(mutex->mutex));
     if (0 != retval) {
         assert(0); /* Programming error */
@@ -53,17 +53,28 @@
 #include "amp_return_code.h"
 #include "amp_raw_mutex.h"
 #include "amp_internal_winthreads_critical_section_config.h"
+#include "amp_internal_time.h"
 
 
 
 int amp_raw_mutex_init(amp_mutex_t mutex)
+{
+    return amp_raw_mutex_init_with_spin(mutex,
+                                        AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_DEFAULT_SPIN_COUNT);
+}
+
+
+
+int amp_raw_mutex_init_with_spin(amp_mutex_t mutex,
+                                 unsigned int spin_count)
 {    
     BOOL retval = FALSE;
 
     assert(NULL != mutex);
+    assert(0 == (spin_count & AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_CREATE_IMMEDIATELY_ON_WIN2000));
     
     retval = InitializeCriticalSectionAndSpinCount(&mutex->critical_section,
-        AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_DEFAULT_SPIN_COUNT | AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_CREATE_IMMEDIATELY_ON_WIN2000);
+        (DWORD)spin_count | AMP_RAW_MUTEX_WINTHREADS_CRITICAL_SECTION_CREATE_IMMEDIATELY_ON_WIN2000);
     
     if (FALSE == retval) {
         DWORD const last_error = GetLastError();
@@ -189,6 +200,35 @@ int amp_mutex_trylock(amp_mutex_t mutex)
 
 
 
+int amp_mutex_timedlock(amp_mutex_t mutex,
+                        uint64_t timeout_ns)
+{
+    uint64_t deadline_ns = 0;
+    uint64_t backoff_ns = AMP_INTERNAL_TIME_MIN_BACKOFF_NS;
+    int retval = AMP_BUSY;
+    
+    assert(NULL != mutex);
+    
+    /* Critical sections can't be waited on with a timeout - poll with 
+     * exponential back-off instead.
+     */
+    deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+    retval = amp_mutex_trylock(mutex);
+    while (AMP_BUSY == retval) {
+        if (0 == amp_internal_time_remaining_ns(deadline_ns)) {
+            return AMP_TIMEOUT;
+        }
+        
+        backoff_ns = amp_internal_time_backoff(deadline_ns, backoff_ns);
+        retval = amp_mutex_trylock(mutex);
+    }
+    
+    return retval;
+}
+
+
+
 int amp_mutex_unlock(amp_mutex_t mutex)
 {
     assert(NULL != mutex);
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of amp parallel for.
+ *
+ * All participating threads, including the calling thread, run the same
+ * participate function on a shared loop description and claim work until
+ * none is left. Even the static schedule claims its blocks via a counter so
+ * participants that couldn't be launched don't leave blocks unprocessed.
+ */
+
+#include "amp_parallel_for.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_platform.h"
+#include "amp_thread_array.h"
+#include "amp_thread_pool.h"
+
+
+
+/**
+ * Largest range length supported - offsets are kept in an int64_t and the
+ * dynamic schedule may overshoot by one grain per participant.
+ */
+#define AMP_INTERNAL_PARALLEL_FOR_MAX_RANGE_LENGTH ((uint64_t)1 << 62)
+
+
+
+struct amp_internal_parallel_for_s {
+    size_t range_begin;
+    size_t range_length;
+    size_t grain;
+    size_t participant_count;
+    amp_parallel_for_func_t func;
+    void* context;
+    amp_parallel_for_schedule_t schedule;
+
+    struct amp_raw_atomic_int64_s next_offset; /* Dynamic and guided */
+    struct amp_raw_atomic_int64_s next_block; /* Static */
+};
+
+
+
+/**
+ * Initializes loop and returns AMP_SUCCESS or AMP_ERROR for invalid
+ * arguments. The participant count is limited to the number of chunks of
+ * grain iterations.
+ */
+static int amp_internal_parallel_for_init(struct amp_internal_parallel_for_s* loop,
+                                          size_t range_begin,
+                                          size_t range_end,
+                                          size_t grain,
+                                          amp_parallel_for_func_t func,
+                                          void* context,
+                                          amp_parallel_for_schedule_t schedule,
+                                          size_t max_participant_count);
+
+/**
+ * Processes chunks of the loop until all are claimed.
+ */
+static void amp_internal_parallel_for_participate(void* loop_context);
+
+/**
+ * Returns the concurrency level of the platform, querying it with an
+ * amp_platform allocated from allocator, or 1 if it can't be determined.
+ */
+static size_t amp_internal_parallel_for_concurrency_level(amp_allocator_t allocator);
+
+
+
+static int amp_internal_parallel_for_init(struct amp_internal_parallel_for_s* loop,
+                                          size_t range_begin,
+                                          size_t range_end,
+                                          size_t grain,
+                                          amp_parallel_for_func_t func,
+                                          void* context,
+                                          amp_parallel_for_schedule_t schedule,
+                                          size_t max_participant_count)
+{
+    size_t chunk_count = 0;
+
+    assert(NULL != func);
+    assert(range_begin <= range_end);
+    assert(0 < max_participant_count);
+
+    if ((range_begin > range_end)
+        || ((uint64_t)(range_end - range_begin) > AMP_INTERNAL_PARALLEL_FOR_MAX_RANGE_LENGTH)) {
+        return AMP_ERROR;
+    }
+
+    switch (schedule) {
+        case amp_static_parallel_for_schedule:
+        case amp_dynamic_parallel_for_schedule:
+        case amp_guided_parallel_for_schedule:
+            break;
+        default:
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+    }
+
+    if (0 == grain) {
+        grain = 1;
+    }
+    if ((uint64_t)grain > AMP_INTERNAL_PARALLEL_FOR_MAX_RANGE_LENGTH) {
+        grain = (size_t)AMP_INTERNAL_PARALLEL_FOR_MAX_RANGE_LENGTH;
+    }
+
+    loop->range_begin = range_begin;
+    loop->range_length = range_end - range_begin;
+    loop->grain = grain;
+    loop->func = func;
+    loop->context = context;
+    loop->schedule = schedule;
+
+    chunk_count = (loop->range_length / grain) + ((0 != loop->range_length % grain) ? 1 : 0);
+    loop->participant_count = (chunk_count < max_participant_count) ? chunk_count : max_participant_count;
+
+    amp_atomic_int64_store_explicit(&loop->next_offset, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int64_store_explicit(&loop->next_block, 0, AMP_MEMORY_ORDER_RELAXED);
+
+    return AMP_SUCCESS;
+}
+
+
+
+static void amp_internal_parallel_for_participate(void* loop_context)
+{
+    struct amp_internal_parallel_for_s* loop =
+        (struct amp_internal_parallel_for_s*)loop_context;
+    int64_t const range_length = (int64_t)loop->range_length;
+    int64_t const grain = (int64_t)loop->grain;
+
+    switch (loop->schedule) {
+        case amp_static_parallel_for_schedule:
+        {
+            /* Balanced blocks - the first remainder blocks get one more
+             * iteration.
+             */
+            size_t const block_count = loop->participant_count;
+            size_t const block_length = loop->range_length / block_count;
+            size_t const remainder = loop->range_length % block_count;
+
+            for (;;) {
+                size_t const block = (size_t)amp_atomic_int64_fetch_add_explicit(&loop->next_block,
+                                                                                 1,
+                                                                                 AMP_MEMORY_ORDER_RELAXED);
+                size_t begin = 0;
+                size_t length = 0;
+
+                if (block >= block_count) {
+                    break;
+                }
+
+                begin = block * block_length + ((block < remainder) ? block : remainder);
+                length = block_length + ((block < remainder) ? 1 : 0);
+
+                loop->func(loop->context,
+                           loop->range_begin + begin,
+                           loop->range_begin + begin + length);
+            }
+            break;
+        }
+        case amp_dynamic_parallel_for_schedule:
+        {
+            for (;;) {
+                int64_t const offset = amp_atomic_int64_fetch_add_explicit(&loop->next_offset,
+                                                                           grain,
+                                                                           AMP_MEMORY_ORDER_RELAXED);
+                int64_t end = 0;
+
+                if (offset >= range_length) {
+                    break;
+                }
+
+                end = (range_length - offset < grain) ? range_length : offset + grain;
+
+                loop->func(loop->context,
+                           loop->range_begin + (size_t)offset,
+                           loop->range_begin + (size_t)end);
+            }
+            break;
+        }
+        case amp_guided_parallel_for_schedule:
+        {
+            int64_t const divisor = 2 * (int64_t)loop->participant_count;
+            int64_t offset = amp_atomic_int64_load_explicit(&loop->next_offset,
+                                                            AMP_MEMORY_ORDER_RELAXED);
+
+            for (;;) {
+                int64_t remaining = 0;
+                int64_t chunk = 0;
+
+                if (offset >= range_length) {
+                    break;
+                }
+
+                remaining = range_length - offset;
+                chunk = remaining / divisor;
+                if (chunk < grain) {
+                    chunk = grain;
+                }
+                if (chunk > remaining) {
+                    chunk = remaining;
+                }
+
+                if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&loop->next_offset,
+                                                                            &offset,
+                                                                            offset + chunk,
+                                                                            AMP_MEMORY_ORDER_RELAXED,
+                                                                            AMP_MEMORY_ORDER_RELAXED)) {
+                    loop->func(loop->context,
+                               loop->range_begin + (size_t)offset,
+                               loop->range_begin + (size_t)(offset + chunk));
+
+                    offset = amp_atomic_int64_load_explicit(&loop->next_offset,
+                                                            AMP_MEMORY_ORDER_RELAXED);
+                }
+            }
+            break;
+        }
+        default:
+            assert(0); /* Checked by init */
+    }
+}
+
+
+
+static size_t amp_internal_parallel_for_concurrency_level(amp_allocator_t allocator)
+{
+    amp_platform_t platform = AMP_PLATFORM_UNINITIALIZED;
+    size_t concurrency_level = 0;
+    int retval = amp_platform_create(&platform, allocator);
+
+    if (AMP_SUCCESS != retval) {
+        return 1;
+    }
+
+    retval = amp_platform_get_concurrency_level(platform, &concurrency_level);
+    if ((AMP_SUCCESS != retval) || (0 == concurrency_level)) {
+        concurrency_level = 1;
+    }
+
+    retval = amp_platform_destroy(&platform, allocator);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+
+    return concurrency_level;
+}
+
+
+
+int amp_parallel_for(amp_allocator_t allocator,
+                     size_t concurrency_level,
+                     size_t range_begin,
+                     size_t range_end,
+                     size_t grain,
+                     amp_parallel_for_func_t func,
+                     void* context,
+                     amp_parallel_for_schedule_t schedule)
+{
+    struct amp_internal_parallel_for_s loop;
+    amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+    size_t joinable_count = 0;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != allocator);
+    
+    if (0 == concurrency_level) {
+        concurrency_level = amp_internal_parallel_for_concurrency_level(allocator);
+    }
+    
+    retval = amp_internal_parallel_for_init(&loop,
+                                            range_begin,
+                                            range_end,
+                                            grain,
+                                            func,
+                                            context,
+                                            schedule,
+                                            concurrency_level);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    if (0 == loop.participant_count) {
+        return AMP_SUCCESS; /* Empty range */
+    }
+
+    if (1 < loop.participant_count) {
+        retval = amp_thread_array_create(&threads,
+                                         allocator,
+                                         loop.participant_count - 1);
+        if (AMP_SUCCESS == retval) {
+            retval = amp_thread_array_configure(threads,
+                                                0,
+                                                loop.participant_count - 1,
+                                                &loop,
+                                                &amp_internal_parallel_for_participate);
+            assert(AMP_SUCCESS == retval);
+
+            /* If not all threads could be launched the calling thread
+             * processes the remaining chunks.
+             */
+            (void)amp_thread_array_launch_all(threads, &joinable_count);
+        }
+    }
+
+    amp_internal_parallel_for_participate(&loop);
+
+    if (AMP_THREAD_ARRAY_UNINITIALIZED != threads) {
+        retval = amp_thread_array_join_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+
+        retval = amp_thread_array_destroy(&threads, allocator);
+        assert(AMP_SUCCESS == retval);
+        (void)retval;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_parallel_for_in_pool(amp_thread_pool_t pool,
+                             amp_allocator_t allocator,
+                             size_t range_begin,
+                             size_t range_end,
+                             size_t grain,
+                             amp_parallel_for_func_t func,
+                             void* context,
+                             amp_parallel_for_schedule_t schedule)
+{
+    struct amp_internal_parallel_for_s loop;
+    amp_thread_pool_wait_group_t group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+    size_t worker_count = 0;
+    size_t i = 0;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != pool);
+    assert(NULL != allocator);
+
+    retval = amp_thread_pool_get_worker_count(pool, &worker_count);
+    assert(AMP_SUCCESS == retval);
+
+    retval = amp_internal_parallel_for_init(&loop,
+                                            range_begin,
+                                            range_end,
+                                            grain,
+                                            func,
+                                            context,
+                                            schedule,
+                                            worker_count + 1);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    if (0 == loop.participant_count) {
+        return AMP_SUCCESS; /* Empty range */
+    }
+
+    if (1 < loop.participant_count) {
+        retval = amp_thread_pool_wait_group_create(&group, allocator);
+        if (AMP_SUCCESS == retval) {
+            for (i = 1; i < loop.participant_count; ++i) {
+                retval = amp_thread_pool_submit(pool,
+                                                group,
+                                                &amp_internal_parallel_for_participate,
+                                                &loop);
+                assert(AMP_SUCCESS == retval);
+            }
+        }
+    }
+
+    amp_internal_parallel_for_participate(&loop);
+
+    if (AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED != group) {
+        retval = amp_thread_pool_wait(pool, group);
+        assert(AMP_SUCCESS == retval);
+
+        retval = amp_thread_pool_wait_group_destroy(&group, allocator);
+        assert(AMP_SUCCESS == retval);
+        (void)retval;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
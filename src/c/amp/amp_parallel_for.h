@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Parallel loop over an index range. The range is split into chunks which
+ * are passed to a user function by the calling thread and by helper
+ * threads - either workers of an amp thread pool or temporary threads of an
+ * amp thread array.
+ *
+ * Chunks are scheduled in one of three ways:
+ * <ul>
+ *    <li> Static: the range is split into one contiguous block per
+ *         participating thread. Cheapest, but load imbalance on irregular
+ *         iterations can't be compensated.
+ *    </li>
+ *    <li> Dynamic: participants grab chunks of grain iterations from a
+ *         shared atomic counter. Balances irregular loops at the cost of one
+ *         atomic operation per chunk.
+ *    </li>
+ *    <li> Guided: like dynamic but chunks start large and shrink to grain
+ *         proportionally to the remaining iterations, so few atomic
+ *         operations are needed while the end of the loop is still balanced.
+ *    </li>
+ * </ul>
+ *
+ * The function is never called with an empty chunk. Chunks don't overlap
+ * and cover the range exactly once.
+ */
+
+#ifndef AMP_amp_parallel_for_H
+#define AMP_amp_parallel_for_H
+
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+#include <amp/amp_thread_pool.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Chunk schedule of a parallel for.
+     */
+    enum amp_parallel_for_schedule {
+        amp_static_parallel_for_schedule = 0, /**< One contiguous block per thread */
+        amp_dynamic_parallel_for_schedule, /**< Chunks of grain iterations from a shared counter */
+        amp_guided_parallel_for_schedule /**< Shrinking chunks, at least grain iterations */
+    };
+
+    typedef enum amp_parallel_for_schedule amp_parallel_for_schedule_t;
+
+#define AMP_PARALLEL_FOR_SCHEDULE_STATIC (amp_static_parallel_for_schedule)
+#define AMP_PARALLEL_FOR_SCHEDULE_DYNAMIC (amp_dynamic_parallel_for_schedule)
+#define AMP_PARALLEL_FOR_SCHEDULE_GUIDED (amp_guided_parallel_for_schedule)
+
+
+    /**
+     * Function called for each chunk [chunk_begin, chunk_end) of the range.
+     * Called concurrently by multiple threads.
+     */
+    typedef void (*amp_parallel_for_func_t)(void* context,
+                                            size_t chunk_begin,
+                                            size_t chunk_end);
+
+
+    /**
+     * Calls func with context for chunks covering [range_begin, range_end)
+     * using the calling thread and concurrency_level minus one temporary 
+     * helper threads allocated with allocator. No more threads than chunks 
+     * of grain iterations are used. If concurrency_level is 0 the level
+     * returned by amp_platform_get_concurrency_level for a platform created
+     * with allocator is used, or 1 if it can't be queried. Creating the
+     * platform is expensive - query the level once and pass it in for
+     * frequent loops.
+     *
+     * grain is the minimal number of iterations per chunk, 0 is treated like
+     * 1. For the dynamic schedule it is the exact chunk size (except for the
+     * last chunk).
+     *
+     * If the helper threads can't be created or launched the remaining 
+     * chunks are processed by the calling thread.
+     *
+     * Creating threads is expensive - prefer amp_parallel_for_in_pool for
+     * frequent or short loops.
+     *
+     * @return AMP_SUCCESS after func has been called for all chunks.
+     *         AMP_ERROR if range_end is smaller than range_begin, the range is
+     *         too large (more than 2^62 iterations), or the schedule is
+     *         unknown.
+     */
+    int amp_parallel_for(amp_allocator_t allocator,
+                         size_t concurrency_level,
+                         size_t range_begin,
+                         size_t range_end,
+                         size_t grain,
+                         amp_parallel_for_func_t func,
+                         void* context,
+                         amp_parallel_for_schedule_t schedule);
+
+
+    /**
+     * Like amp_parallel_for but uses the workers of pool and the calling
+     * thread to process the chunks. allocator is used for the wait group of
+     * the loop. Can be called from inside a task of the pool.
+     *
+     * @return Same as amp_parallel_for.
+     */
+    int amp_parallel_for_in_pool(amp_thread_pool_t pool,
+                                 amp_allocator_t allocator,
+                                 size_t range_begin,
+                                 size_t range_end,
+                                 size_t grain,
+                                 amp_parallel_for_func_t func,
+                                 void* context,
+                                 amp_parallel_for_schedule_t schedule);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_parallel_for_H */
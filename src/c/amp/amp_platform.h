@@ -38,12 +38,15 @@
  * is homogeneous and only queries the architecture the software runs on, i.e.
  * doesn't detect the GPU when run on CPU.
  *
- * TODO: @todo Add detection for the number of packages (CPU dies), cores per
- *             package, hw-threads per core. Take non-homoheneous platforms into
- *             account. Also detect memory and cache sizes and cache / local
- *             storage grouping of hw-threads and cores and detect if the 
- *             platform is an UMA or NUMA architecture. Add ways to detect if
- *             specific infos can be determined or not on the platform in use.
+ * The topology of the active hardware threads - their package, core, NUMA
+ * node, and data caches - is read once when the platform is created and 
+ * can be queried via amp_platform_get_hwthread_info. Currently only Linux
+ * (via sysfs) supports topology queries.
+ *
+ * TODO: @todo Take non-homoheneous platforms into account. Detect memory 
+ *             sizes.
+ * TODO: @todo Query the topology via GetLogicalProcessorInformation on
+ *             Windows and via sysctl on Mac OS X.
  * TODO: @todo Decide if to implement the following functions:
  *             size_t amp_platform_get_package_type_count(void);
  *             size_t amp_platform_get_package_count_for_type(size_t package_type_id);
@@ -229,6 +232,103 @@ extern "C" {
     
     
     
+    /**
+     * Number of cache levels described per hardware thread, level 1 is 
+     * stored at index 0.
+     */
+#define AMP_PLATFORM_CACHE_LEVEL_COUNT 3
+    
+    /**
+     * Description of a data (or unified) cache as seen by a hardware thread.
+     *
+     * Hardware threads with the same sharing_id for a cache level share the
+     * cache. The sharing_id is the os_id of the lowest hardware thread 
+     * sharing the cache.
+     */
+    struct amp_platform_cache_info_s {
+        size_t size_in_bytes; /**< 0 if the cache level doesn't exist or is unknown */
+        size_t sharing_id; /**< Identifies the hwthreads sharing the cache */
+        size_t sharing_hwthread_count; /**< Number of hwthreads sharing the cache */
+    };
+    
+    /**
+     * Topology of an active hardware thread (logical CPU).
+     *
+     * Ids are the ones the operating system uses and needn't be contiguous.
+     * Core ids are only unique per package.
+     */
+    struct amp_platform_hwthread_info_s {
+        size_t os_id; /**< Id used by the OS, e.g. for affinity masks */
+        size_t package_id; /**< Physical package (socket) */
+        size_t core_id; /**< Physical core inside the package */
+        size_t numa_node_id; /**< NUMA node, 0 on UMA platforms */
+        size_t smt_sibling_count; /**< Hardware threads of the core, including this one */
+        struct amp_platform_cache_info_s caches[AMP_PLATFORM_CACHE_LEVEL_COUNT];
+    };
+    
+    
+    /**
+     * Queries the number of hardware threads described by the topology of 
+     * descr, which equals the number of active hardware threads when
+     * the platform was created.
+     *
+     * If the topology can't be queried AMP_UNSUPPORTED is returned and 
+     * result is unchanged and untouched. If result is NULL the function call
+     * can be used to determine if the topology is supported.
+     *
+     * @return AMP_SUCCESS if the topology has been queried.
+     *         AMP_UNSUPPORTED if the platform does not support this query.
+     */
+    int amp_platform_get_topology_hwthread_count(amp_platform_t descr,
+                                                 size_t* result);
+    
+    /**
+     * Copies the topology of the hardware thread at index into result.
+     * Hardware threads are sorted by ascending os_id.
+     *
+     * index must be smaller than the count returned by 
+     * amp_platform_get_topology_hwthread_count.
+     *
+     * @return AMP_SUCCESS if result has been set.
+     *         AMP_UNSUPPORTED if the platform does not support this query.
+     *         AMP_ERROR if index is out of range.
+     */
+    int amp_platform_get_hwthread_info(amp_platform_t descr,
+                                       size_t index,
+                                       struct amp_platform_hwthread_info_s* result);
+    
+    /**
+     * Queries the number of distinct physical cores of the hardware threads
+     * described by the topology.
+     *
+     * @return AMP_SUCCESS if the topology has been queried.
+     *         AMP_UNSUPPORTED if the platform does not support this query.
+     */
+    int amp_platform_get_topology_core_count(amp_platform_t descr,
+                                             size_t* result);
+    
+    /**
+     * Queries the number of distinct packages of the hardware threads 
+     * described by the topology.
+     *
+     * @return AMP_SUCCESS if the topology has been queried.
+     *         AMP_UNSUPPORTED if the platform does not support this query.
+     */
+    int amp_platform_get_package_count(amp_platform_t descr,
+                                       size_t* result);
+    
+    /**
+     * Queries the number of distinct NUMA nodes of the hardware threads
+     * described by the topology. 1 on UMA platforms.
+     *
+     * @return AMP_SUCCESS if the topology has been queried.
+     *         AMP_UNSUPPORTED if the platform does not support this query.
+     */
+    int amp_platform_get_numa_node_count(amp_platform_t descr,
+                                         size_t* result);
+    
+    
+    
     
 #if defined(__cplusplus)
 } /* extern "C" */
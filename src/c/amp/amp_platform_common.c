@@ -44,6 +44,7 @@
 
 #include "amp_return_code.h"
 #include "amp_raw_platform.h"
+#include "amp_internal_platform_topology.h"
 
 
 /**
@@ -66,6 +67,8 @@ size_t amp_internal_max(size_t a, size_t b)
 int amp_raw_platform_init(amp_platform_t descr,
                           amp_allocator_t allocator)
 {
+    int retval = AMP_UNSUPPORTED;
+    
     assert(NULL != descr);
     assert(NULL != allocator);
     
@@ -73,18 +76,35 @@ int amp_raw_platform_init(amp_platform_t descr,
     descr->alloc_func = allocator->alloc_func;
     descr->dealloc_func = allocator->dealloc_func;
     
-    return AMP_SUCCESS;
+    descr->hwthreads = NULL;
+    descr->hwthread_count = 0;
+    descr->core_count = 0;
+    descr->package_count = 0;
+    descr->numa_node_count = 0;
+    
+    /* An unsupported topology query leaves the topology table empty. */
+    retval = amp_internal_platform_topology_init(descr, allocator);
+    if (AMP_UNSUPPORTED == retval) {
+        retval = AMP_SUCCESS;
+    }
+    
+    return retval;
 }
 
 
 int amp_raw_platform_finalize(amp_platform_t descr,
                               amp_allocator_t allocator)
 {
-    (void)allocator;
+    int retval = AMP_UNSUPPORTED;
     
     assert(NULL != descr);
     assert(NULL != allocator);
     
+    retval = amp_internal_platform_topology_finalize(descr, allocator);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
     descr->allocator_context = NULL;
     descr->alloc_func = NULL;
     descr->dealloc_func = NULL;
@@ -202,3 +222,98 @@ int amp_platform_get_concurrency_level(amp_platform_t descr,
 }
 
 
+
+int amp_platform_get_topology_hwthread_count(amp_platform_t descr,
+                                             size_t* result)
+{
+    assert(NULL != descr);
+    
+    if (NULL == descr->hwthreads) {
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (NULL != result) {
+        *result = descr->hwthread_count;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_platform_get_hwthread_info(amp_platform_t descr,
+                                   size_t index,
+                                   struct amp_platform_hwthread_info_s* result)
+{
+    assert(NULL != descr);
+    assert(NULL != result);
+    
+    if (NULL == descr->hwthreads) {
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (index >= descr->hwthread_count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    *result = descr->hwthreads[index];
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_platform_get_topology_core_count(amp_platform_t descr,
+                                         size_t* result)
+{
+    assert(NULL != descr);
+    
+    if (NULL == descr->hwthreads) {
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (NULL != result) {
+        *result = descr->core_count;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_platform_get_package_count(amp_platform_t descr,
+                                   size_t* result)
+{
+    assert(NULL != descr);
+    
+    if (NULL == descr->hwthreads) {
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (NULL != result) {
+        *result = descr->package_count;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_platform_get_numa_node_count(amp_platform_t descr,
+                                     size_t* result)
+{
+    assert(NULL != descr);
+    
+    if (NULL == descr->hwthreads) {
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (NULL != result) {
+        *result = descr->numa_node_count;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
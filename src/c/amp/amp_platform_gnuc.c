@@ -34,7 +34,10 @@
  * @file
  *
  * Platform hardware detection via get_nprocs_conf and get_nprocs from the 
- * GNU C library.
+ * GNU C library. Both count hardware threads. Cores are counted via the
+ * topology table if it is available - the topology only describes active
+ * hardware threads, therefore the installed core count is only taken from
+ * it if all hardware threads are active.
  *
  * amp_platform_create and amp_platform_destroy are implemented in 
  * amp_platform_common.c.
@@ -50,6 +53,7 @@
 #include <sys/sysinfo.h>
 
 #include "amp_return_code.h"
+#include "amp_raw_platform.h"
 
 
 
@@ -84,13 +88,19 @@ static size_t amp_internal_platform_get_core_count(void)
 int amp_platform_get_installed_core_count(amp_platform_t descr, 
                                           size_t* result)
 {
-    (void)descr;
-    
     assert(NULL != descr);
     
     if (NULL != result ) {
         
-        *result = amp_internal_platform_get_core_count();
+        size_t const installed_hwthread_count = amp_internal_platform_get_core_count();
+        
+        if ((NULL != descr->hwthreads)
+            && (installed_hwthread_count == descr->hwthread_count)) {
+            
+            *result = descr->core_count;
+        } else {
+            *result = installed_hwthread_count;
+        }
     }
     
     return AMP_SUCCESS;
@@ -101,13 +111,15 @@ int amp_platform_get_installed_core_count(amp_platform_t descr,
 int amp_platform_get_active_core_count(amp_platform_t descr, 
                                        size_t* result)
 {
-    (void)descr;
-    
     assert(NULL != descr);
     
     if (NULL != result ) {
         
-        *result = amp_internal_platform_get_active_core_count();
+        if (NULL != descr->hwthreads) {
+            *result = descr->core_count;
+        } else {
+            *result = amp_internal_platform_get_active_core_count();
+        }
     }
     
     return AMP_SUCCESS;
@@ -116,31 +128,35 @@ int amp_platform_get_active_core_count(amp_platform_t descr,
 
 
 int amp_platform_get_installed_hwthread_count(amp_platform_t descr, 
-                                        size_t* result)
+                                              size_t* result)
 {
     (void)descr;
     
     assert(NULL != descr); 
     
-    /* Functionality not supported, no value returned. */
-    (void)result;
+    if (NULL != result ) {
+        
+        *result = amp_internal_platform_get_core_count();
+    }
     
-    return AMP_UNSUPPORTED;
+    return AMP_SUCCESS;
 }
 
 
 
 int amp_platform_get_active_hwthread_count(amp_platform_t descr, 
-                                               size_t* result)
+                                           size_t* result)
 {
     (void)descr;
     
     assert(NULL != descr); 
     
-    /* Functionality not supported, no value returned. */
-    (void)result;
+    if (NULL != result ) {
+        
+        *result = amp_internal_platform_get_active_core_count();
+    }
     
-    return AMP_UNSUPPORTED;
+    return AMP_SUCCESS;
 }
 
 
@@ -0,0 +1,709 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the thread-caching pool allocator. The allocator, the
+ * pool state, the span class table, and the spans are allocated in one 
+ * block. The per-thread caches are allocated individually with the source
+ * allocator and registered with the pool to free them on destruction.
+ *
+ * The shared free lists are only pushed to via compare-and-exchange and 
+ * always taken as a whole via exchange, so they don't suffer from ABA.
+ */
+
+#include "amp_pool_allocator.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_thread_local_slot.h"
+#include "amp_internal_thread_local_record.h"
+
+
+
+/**
+ * Size of the smallest size class, large enough for a free list link and
+ * for the alignment of all fundamental types. Size class c holds blocks of
+ * AMP_INTERNAL_POOL_MIN_BLOCK_SIZE << c bytes.
+ */
+#define AMP_INTERNAL_POOL_MIN_BLOCK_SIZE ((size_t)16)
+
+#define AMP_INTERNAL_POOL_CLASS_COUNT 6
+
+/**
+ * Spans are cache line aligned and a multiple of all block sizes, blocks of
+ * AMP_CACHE_LINE_SIZE bytes and more therefore don't share cache lines.
+ */
+#define AMP_INTERNAL_POOL_SPAN_SIZE ((size_t)4096)
+
+/**
+ * A thread moves AMP_INTERNAL_POOL_FLUSH_COUNT blocks of a size class to the
+ * shared free list when it caches twice as many.
+ */
+#define AMP_INTERNAL_POOL_FLUSH_COUNT ((size_t)32)
+
+
+
+struct amp_internal_pool_block_s {
+    struct amp_internal_pool_block_s* next;
+};
+
+
+/**
+ * Per-thread cache with a free list and the unused rest of the current span
+ * of each size class.
+ */
+struct amp_internal_pool_cache_s {
+    struct amp_internal_pool_block_s* free_blocks[AMP_INTERNAL_POOL_CLASS_COUNT];
+    size_t free_block_counts[AMP_INTERNAL_POOL_CLASS_COUNT];
+    unsigned char* span_positions[AMP_INTERNAL_POOL_CLASS_COUNT];
+    unsigned char* span_ends[AMP_INTERNAL_POOL_CLASS_COUNT];
+    struct amp_internal_pool_cache_s* next;
+};
+
+
+/**
+ * Shared free list of a size class on its own cache line.
+ */
+union amp_internal_pool_shared_list_u {
+    struct amp_raw_atomic_pointer_s head;
+    char padding[AMP_CACHE_LINE_SIZE];
+};
+
+
+/**
+ * Block layout: the pool (starting with its allocator), the span class 
+ * table, padding to align the spans to the cache line size, and the spans.
+ */
+struct amp_internal_pool_s {
+    struct amp_raw_allocator_s allocator;
+    amp_allocator_t source_allocator;
+    amp_thread_local_slot_key_t cache_key;
+    
+    unsigned char* spans;
+    unsigned char* span_classes;
+    size_t span_count;
+    struct amp_raw_atomic_int64_s claimed_span_count;
+    
+    struct amp_raw_atomic_pointer_s caches;
+    
+    union amp_internal_pool_shared_list_u shared_lists[AMP_INTERNAL_POOL_CLASS_COUNT];
+};
+
+
+
+/**
+ * Hands out a block of the size class fitting bytes_to_allocate from the
+ * cache of the calling thread, or forwards the request to the source 
+ * allocator.
+ */
+static void* amp_internal_pool_alloc(void* allocator_context, 
+                                     size_t bytes_to_allocate,
+                                     char const* filename,
+                                     int line);
+
+/**
+ * Like amp_internal_pool_alloc but zeroes the memory.
+ */
+static void* amp_internal_pool_calloc(void* allocator_context,
+                                      size_t elem_count,
+                                      size_t bytes_per_elem,
+                                      char const* filename,
+                                      int line);
+
+/**
+ * Returns a pool block to the cache of the calling thread, or forwards 
+ * memory not belonging to the pool to the source allocator.
+ */
+static int amp_internal_pool_dealloc(void* allocator_context, 
+                                     void *pointer,
+                                     char const* filename,
+                                     int line);
+
+/**
+ * Like amp_internal_pool_alloc but the block is aligned to alignment. 
+ * Requests with alignments above the cache line size are forwarded to the
+ * source allocator.
+ */
+static void* amp_internal_pool_aligned_alloc(void* allocator_context,
+                                             size_t alignment,
+                                             size_t bytes_to_allocate,
+                                             char const* filename,
+                                             int line);
+
+/**
+ * Like amp_internal_pool_dealloc but forwards memory not belonging to the
+ * pool to the aligned dealloc function of the source allocator.
+ */
+static int amp_internal_pool_aligned_dealloc(void* allocator_context, 
+                                             void *pointer,
+                                             char const* filename,
+                                             int line);
+
+/**
+ * Returns AMP_TRUE if pointer points into the spans of pool.
+ */
+static amp_bool_t amp_internal_pool_contains(struct amp_internal_pool_s* pool,
+                                             void* pointer);
+
+/**
+ * Returns the pool block pointer points to to the cache of the calling 
+ * thread and moves surplus blocks to the shared free list.
+ */
+static void amp_internal_pool_push(struct amp_internal_pool_s* pool,
+                                   void* pointer);
+
+/**
+ * Returns the size class for blocks of bytes_to_allocate bytes.
+ */
+static size_t amp_internal_pool_class_index(size_t bytes_to_allocate);
+
+/**
+ * Returns the cache of the calling thread, creates and registers it on 
+ * first use. Returns NULL if the cache can't be created.
+ */
+static struct amp_internal_pool_cache_s* amp_internal_pool_cache(struct amp_internal_pool_s* pool);
+
+/**
+ * Takes a block of size class class_index from cache, refills it from the
+ * shared free list or a newly claimed span if empty. Returns NULL if the
+ * pool is exhausted.
+ */
+static void* amp_internal_pool_cache_pop(struct amp_internal_pool_s* pool,
+                                         struct amp_internal_pool_cache_s* cache,
+                                         size_t class_index);
+
+/**
+ * Pushes the chain of blocks from first to last onto the shared free list
+ * of size class class_index.
+ */
+static void amp_internal_pool_shared_push(struct amp_internal_pool_s* pool,
+                                          size_t class_index,
+                                          struct amp_internal_pool_block_s* first,
+                                          struct amp_internal_pool_block_s* last);
+
+
+
+static void* amp_internal_pool_alloc(void* allocator_context, 
+                                     size_t bytes_to_allocate,
+                                     char const* filename,
+                                     int line)
+{
+    struct amp_internal_pool_s* pool = (struct amp_internal_pool_s*)allocator_context;
+    struct amp_internal_pool_cache_s* cache = NULL;
+    void* block = NULL;
+    
+    assert(NULL != pool);
+    
+    if (bytes_to_allocate <= AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE) {
+        
+        cache = amp_internal_pool_cache(pool);
+        
+        if (NULL != cache) {
+            block = amp_internal_pool_cache_pop(pool, 
+                                                cache,
+                                                amp_internal_pool_class_index(bytes_to_allocate));
+        }
+    }
+    
+    if (NULL == block) {
+        block = pool->source_allocator->alloc_func(pool->source_allocator->allocator_context,
+                                                   bytes_to_allocate,
+                                                   filename,
+                                                   line);
+    }
+    
+    return block;
+}
+
+
+
+static void* amp_internal_pool_calloc(void* allocator_context,
+                                      size_t elem_count,
+                                      size_t bytes_per_elem,
+                                      char const* filename,
+                                      int line)
+{
+    size_t bytes_to_allocate = 0;
+    void* memory = NULL;
+    
+    if ((0 != bytes_per_elem)
+        && (elem_count > AMP_SIZE_MAX / bytes_per_elem)) {
+        return NULL;
+    }
+    
+    bytes_to_allocate = elem_count * bytes_per_elem;
+    
+    memory = amp_internal_pool_alloc(allocator_context,
+                                     bytes_to_allocate,
+                                     filename,
+                                     line);
+    if (NULL != memory) {
+        memset(memory, 0, bytes_to_allocate);
+    }
+    
+    return memory;
+}
+
+
+
+static void* amp_internal_pool_aligned_alloc(void* allocator_context,
+                                             size_t alignment,
+                                             size_t bytes_to_allocate,
+                                             char const* filename,
+                                             int line)
+{
+    struct amp_internal_pool_s* pool = (struct amp_internal_pool_s*)allocator_context;
+    struct amp_internal_pool_cache_s* cache = NULL;
+    size_t const block_bytes = (bytes_to_allocate < alignment) ? alignment : bytes_to_allocate;
+    void* block = NULL;
+    
+    assert(NULL != pool);
+    assert(0 != alignment);
+    assert(0 == (alignment & (alignment - 1)));
+    
+    /* Blocks are aligned to their size up to the cache line size. */
+    if ((alignment <= AMP_CACHE_LINE_SIZE)
+        && (block_bytes <= AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE)) {
+        
+        cache = amp_internal_pool_cache(pool);
+        
+        if (NULL != cache) {
+            block = amp_internal_pool_cache_pop(pool, 
+                                                cache,
+                                                amp_internal_pool_class_index(block_bytes));
+        }
+    }
+    
+    if (NULL == block) {
+        block = pool->source_allocator->aligned_alloc_func(pool->source_allocator->aligned_allocator_context,
+                                                           alignment,
+                                                           bytes_to_allocate,
+                                                           filename,
+                                                           line);
+    }
+    
+    return block;
+}
+
+
+
+static int amp_internal_pool_dealloc(void* allocator_context, 
+                                     void *pointer,
+                                     char const* filename,
+                                     int line)
+{
+    struct amp_internal_pool_s* pool = (struct amp_internal_pool_s*)allocator_context;
+    
+    assert(NULL != pool);
+    
+    if (NULL == pointer) {
+        return AMP_SUCCESS;
+    }
+    
+    if (AMP_FALSE == amp_internal_pool_contains(pool, pointer)) {
+        return pool->source_allocator->dealloc_func(pool->source_allocator->allocator_context,
+                                                    pointer,
+                                                    filename,
+                                                    line);
+    }
+    
+    amp_internal_pool_push(pool, pointer);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static int amp_internal_pool_aligned_dealloc(void* allocator_context, 
+                                             void *pointer,
+                                             char const* filename,
+                                             int line)
+{
+    struct amp_internal_pool_s* pool = (struct amp_internal_pool_s*)allocator_context;
+    
+    assert(NULL != pool);
+    
+    if (NULL == pointer) {
+        return AMP_SUCCESS;
+    }
+    
+    if (AMP_FALSE == amp_internal_pool_contains(pool, pointer)) {
+        return pool->source_allocator->aligned_dealloc_func(pool->source_allocator->aligned_allocator_context,
+                                                            pointer,
+                                                            filename,
+                                                            line);
+    }
+    
+    amp_internal_pool_push(pool, pointer);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static amp_bool_t amp_internal_pool_contains(struct amp_internal_pool_s* pool,
+                                             void* pointer)
+{
+    uintptr_t const spans_address = (uintptr_t)pool->spans;
+    uintptr_t const address = (uintptr_t)pointer;
+    
+    if ((address < spans_address)
+        || (address - spans_address >= pool->span_count * AMP_INTERNAL_POOL_SPAN_SIZE)) {
+        return AMP_FALSE;
+    }
+    
+    return AMP_TRUE;
+}
+
+
+
+static void amp_internal_pool_push(struct amp_internal_pool_s* pool,
+                                   void* pointer)
+{
+    struct amp_internal_pool_cache_s* cache = NULL;
+    struct amp_internal_pool_block_s* block = (struct amp_internal_pool_block_s*)pointer;
+    struct amp_internal_pool_block_s* last = NULL;
+    size_t const offset = (size_t)((uintptr_t)pointer - (uintptr_t)pool->spans);
+    size_t class_index = pool->span_classes[offset / AMP_INTERNAL_POOL_SPAN_SIZE];
+    size_t i = 0;
+    
+    assert(class_index < AMP_INTERNAL_POOL_CLASS_COUNT);
+    assert(0 == (offset % (AMP_INTERNAL_POOL_MIN_BLOCK_SIZE << class_index)));
+    
+    cache = amp_internal_pool_cache(pool);
+    
+    if (NULL == cache) {
+        amp_internal_pool_shared_push(pool, class_index, block, block);
+        
+        return;
+    }
+    
+    block->next = cache->free_blocks[class_index];
+    cache->free_blocks[class_index] = block;
+    ++(cache->free_block_counts[class_index]);
+    
+    if (cache->free_block_counts[class_index] >= 2 * AMP_INTERNAL_POOL_FLUSH_COUNT) {
+        
+        last = block;
+        for (i = 1; i < AMP_INTERNAL_POOL_FLUSH_COUNT; ++i) {
+            last = last->next;
+        }
+        
+        cache->free_blocks[class_index] = last->next;
+        cache->free_block_counts[class_index] -= AMP_INTERNAL_POOL_FLUSH_COUNT;
+        
+        amp_internal_pool_shared_push(pool, class_index, block, last);
+    }
+}
+
+
+
+static size_t amp_internal_pool_class_index(size_t bytes_to_allocate)
+{
+    size_t class_index = 0;
+    
+    assert(bytes_to_allocate <= AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE);
+    
+    while ((AMP_INTERNAL_POOL_MIN_BLOCK_SIZE << class_index) < bytes_to_allocate) {
+        ++class_index;
+    }
+    
+    return class_index;
+}
+
+
+
+static struct amp_internal_pool_cache_s* amp_internal_pool_cache(struct amp_internal_pool_s* pool)
+{
+    struct amp_internal_pool_cache_s* cache = (struct amp_internal_pool_cache_s*)amp_thread_local_slot_value(pool->cache_key);
+    size_t i = 0;
+    
+    if (NULL != cache) {
+        return cache;
+    }
+    
+    cache = (struct amp_internal_pool_cache_s*)AMP_ALLOC(pool->source_allocator, 
+                                                         sizeof(*cache));
+    if (NULL == cache) {
+        return NULL;
+    }
+    
+    for (i = 0; i < AMP_INTERNAL_POOL_CLASS_COUNT; ++i) {
+        cache->free_blocks[i] = NULL;
+        cache->free_block_counts[i] = 0;
+        cache->span_positions[i] = NULL;
+        cache->span_ends[i] = NULL;
+    }
+    
+    if (AMP_SUCCESS != amp_internal_thread_local_record_register(pool->cache_key,
+                                                                 &pool->caches,
+                                                                 cache,
+                                                                 offsetof(struct amp_internal_pool_cache_s, next))) {
+        int const rc = AMP_DEALLOC(pool->source_allocator, cache);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return NULL;
+    }
+    
+    return cache;
+}
+
+
+
+static void* amp_internal_pool_cache_pop(struct amp_internal_pool_s* pool,
+                                         struct amp_internal_pool_cache_s* cache,
+                                         size_t class_index)
+{
+    size_t const block_size = AMP_INTERNAL_POOL_MIN_BLOCK_SIZE << class_index;
+    struct amp_internal_pool_block_s* block = cache->free_blocks[class_index];
+    unsigned char* position = NULL;
+    int64_t span_index = 0;
+    
+    if (NULL == block) {
+        
+        /* Cut the next block from the current span. */
+        position = cache->span_positions[class_index];
+        if (position != cache->span_ends[class_index]) {
+            cache->span_positions[class_index] = position + block_size;
+            
+            return position;
+        }
+        
+        /* Take over all blocks other threads moved to the shared list. */
+        block = (struct amp_internal_pool_block_s*)amp_atomic_pointer_exchange_explicit(&pool->shared_lists[class_index].head,
+                                                                                        NULL,
+                                                                                        AMP_MEMORY_ORDER_ACQUIRE);
+        if (NULL != block) {
+            struct amp_internal_pool_block_s* counted = block;
+            size_t count = 0;
+            
+            while (NULL != counted) {
+                ++count;
+                counted = counted->next;
+            }
+            
+            cache->free_block_counts[class_index] = count;
+            
+        } else {
+            
+            /* Claim a new span, don't count past the end once exhausted. */
+            if (amp_atomic_int64_load_explicit(&pool->claimed_span_count,
+                                               AMP_MEMORY_ORDER_RELAXED) >= (int64_t)pool->span_count) {
+                return NULL;
+            }
+            
+            span_index = amp_atomic_int64_fetch_add_explicit(&pool->claimed_span_count,
+                                                             1,
+                                                             AMP_MEMORY_ORDER_RELAXED);
+            if (span_index >= (int64_t)pool->span_count) {
+                return NULL;
+            }
+            
+            pool->span_classes[span_index] = (unsigned char)class_index;
+            
+            position = pool->spans + (size_t)span_index * AMP_INTERNAL_POOL_SPAN_SIZE;
+            cache->span_positions[class_index] = position + block_size;
+            cache->span_ends[class_index] = position + AMP_INTERNAL_POOL_SPAN_SIZE;
+            
+            return position;
+        }
+    }
+    
+    cache->free_blocks[class_index] = block->next;
+    --(cache->free_block_counts[class_index]);
+    
+    return block;
+}
+
+
+
+static void amp_internal_pool_shared_push(struct amp_internal_pool_s* pool,
+                                          size_t class_index,
+                                          struct amp_internal_pool_block_s* first,
+                                          struct amp_internal_pool_block_s* last)
+{
+    void* expected_head = amp_atomic_pointer_load_explicit(&pool->shared_lists[class_index].head,
+                                                           AMP_MEMORY_ORDER_RELAXED);
+    
+    do {
+        last->next = (struct amp_internal_pool_block_s*)expected_head;
+    } while (!amp_atomic_pointer_compare_exchange_explicit(&pool->shared_lists[class_index].head,
+                                                           &expected_head,
+                                                           first,
+                                                           AMP_MEMORY_ORDER_RELEASE,
+                                                           AMP_MEMORY_ORDER_RELAXED));
+}
+
+
+
+int amp_pool_allocator_create(amp_allocator_t* pool,
+                              amp_allocator_t source_allocator,
+                              size_t capacity)
+{
+    struct amp_internal_pool_s* internal_pool = NULL;
+    size_t span_count = 0;
+    size_t const pool_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*internal_pool));
+    size_t span_classes_size = 0;
+    size_t block_size = 0;
+    size_t i = 0;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != pool);
+    assert(NULL != source_allocator);
+    assert(0 < capacity);
+    
+    if (0 == capacity) {
+        return AMP_ERROR;
+    }
+    
+    span_count = capacity / AMP_INTERNAL_POOL_SPAN_SIZE 
+        + ((0 == capacity % AMP_INTERNAL_POOL_SPAN_SIZE) ? 0 : 1);
+    
+    if (span_count > (AMP_SIZE_MAX - pool_size - AMP_CACHE_LINE_SIZE) / (AMP_INTERNAL_POOL_SPAN_SIZE + 1)) {
+        return AMP_NOMEM;
+    }
+    
+    /* The span classes follow the pool, the cache line aligned spans follow
+     * the span classes.
+     */
+    span_classes_size = AMP_CACHE_LINE_ROUND_UP(span_count);
+    block_size = pool_size + span_classes_size 
+        + span_count * AMP_INTERNAL_POOL_SPAN_SIZE;
+    
+    internal_pool = (struct amp_internal_pool_s*)AMP_ALIGNED_ALLOC(source_allocator,
+                                                                   AMP_CACHE_LINE_SIZE,
+                                                                   block_size);
+    if (NULL == internal_pool) {
+        return AMP_NOMEM;
+    }
+    
+    retval = amp_thread_local_slot_create(&internal_pool->cache_key,
+                                          source_allocator);
+    if (AMP_SUCCESS != retval) {
+        int const rc = AMP_ALIGNED_DEALLOC(source_allocator, internal_pool);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    internal_pool->span_classes = (unsigned char*)internal_pool + pool_size;
+    internal_pool->spans = internal_pool->span_classes + span_classes_size;
+    internal_pool->span_count = span_count;
+    amp_atomic_int64_store_explicit(&internal_pool->claimed_span_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    amp_atomic_pointer_store_explicit(&internal_pool->caches,
+                                      NULL,
+                                      AMP_MEMORY_ORDER_RELAXED);
+    
+    for (i = 0; i < AMP_INTERNAL_POOL_CLASS_COUNT; ++i) {
+        amp_atomic_pointer_store_explicit(&internal_pool->shared_lists[i].head,
+                                          NULL,
+                                          AMP_MEMORY_ORDER_RELAXED);
+    }
+    
+    internal_pool->source_allocator = source_allocator;
+    
+    internal_pool->allocator.alloc_func = &amp_internal_pool_alloc;
+    internal_pool->allocator.calloc_func = &amp_internal_pool_calloc;
+    internal_pool->allocator.dealloc_func = &amp_internal_pool_dealloc;
+    internal_pool->allocator.aligned_alloc_func = &amp_internal_pool_aligned_alloc;
+    internal_pool->allocator.aligned_dealloc_func = &amp_internal_pool_aligned_dealloc;
+    internal_pool->allocator.allocator_context = internal_pool;
+    internal_pool->allocator.aligned_allocator_context = internal_pool;
+    
+    *pool = &internal_pool->allocator;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_pool_allocator_destroy(amp_allocator_t* pool,
+                               amp_allocator_t source_allocator)
+{
+    struct amp_internal_pool_s* internal_pool = NULL;
+    struct amp_internal_pool_cache_s* cache = NULL;
+    int retval = AMP_ERROR;
+    
+    assert(NULL != pool);
+    assert(NULL != source_allocator);
+    assert(&amp_internal_pool_alloc == (*pool)->alloc_func);
+    
+    internal_pool = (struct amp_internal_pool_s*)(*pool)->allocator_context;
+    
+    assert(source_allocator == internal_pool->source_allocator);
+    
+    retval = amp_thread_local_slot_destroy(&internal_pool->cache_key,
+                                           source_allocator);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    cache = (struct amp_internal_pool_cache_s*)amp_atomic_pointer_load_explicit(&internal_pool->caches,
+                                                                                AMP_MEMORY_ORDER_ACQUIRE);
+    while (NULL != cache) {
+        struct amp_internal_pool_cache_s* const next = cache->next;
+        
+        retval = AMP_DEALLOC(source_allocator, cache);
+        assert(AMP_SUCCESS == retval);
+        
+        cache = next;
+    }
+    
+    /* The allocator is the first member of the pool. */
+    retval = AMP_ALIGNED_DEALLOC(source_allocator, internal_pool);
+    if (AMP_SUCCESS == retval) {
+        *pool = AMP_ALLOCATOR_UNINITIALIZED;
+    } else {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
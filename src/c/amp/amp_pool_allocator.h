@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Thread-caching pool allocator that hands out fixed-size blocks via the
+ * amp_allocator_t interface. Requests are rounded up to one of a few 
+ * power-of-two size classes up to AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE bytes.
+ *
+ * The pool memory is one contiguous block taken from a source allocator and
+ * cut into spans, each span serving one size class. Every thread keeps its
+ * own free list per size class in a thread-local slot and allocates and
+ * deallocates without synchronization as long as its free lists and its 
+ * current spans have blocks left. Threads refill from a lock-free shared 
+ * free list per size class that receives the surplus blocks of threads which
+ * deallocate more than they allocate, or claim a new span with an atomic 
+ * increment.
+ *
+ * Use a pool to create and destroy many small primitives like mutexes,
+ * condition variables, semaphores, or barriers at a high rate from many 
+ * threads without contending for the locks of the C std malloc.
+ *
+ * Larger requests and requests the exhausted pool can't serve are forwarded
+ * to the source allocator which therefore has to be thread-safe, too.
+ *
+ * Blocks can be deallocated by any thread, not only by the allocating one.
+ * The free blocks and partially used spans cached by a thread aren't 
+ * returned to the pool when the thread ends - size the pool for this.
+ *
+ * Never pass an allocator not created by amp_pool_allocator_create to the
+ * other pool functions.
+ */
+
+#ifndef AMP_amp_pool_allocator_H
+#define AMP_amp_pool_allocator_H
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+    
+    
+    /**
+     * Size of the largest size class. Larger requests are served by the
+     * source allocator of the pool.
+     */
+#define AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE ((size_t)512)
+    
+    
+    /**
+     * Creates a pool allocator with at least capacity bytes of pool memory
+     * using source_allocator to allocate the pool and its memory and to serve
+     * the requests the pool can't handle.
+     *
+     * The pool is thread-safe if source_allocator is thread-safe.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if not enough memory is available.
+     *         AMP_ERROR might be returned if capacity is 0 or if no 
+     *         thread-local slot is available for the pool.
+     */
+    int amp_pool_allocator_create(amp_allocator_t* pool,
+                                  amp_allocator_t source_allocator,
+                                  size_t capacity);
+    
+    /**
+     * Destroys the pool and frees its memory and the per-thread caches with
+     * source_allocator which must be the allocator passed to 
+     * amp_pool_allocator_create.
+     *
+     * Only call after all threads stopped using the pool. All blocks handed
+     * out by the pool are invalid afterwards.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_pool_allocator_destroy(amp_allocator_t* pool,
+                                   amp_allocator_t source_allocator);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_pool_allocator_H */
@@ -45,6 +45,7 @@
 
 #include <amp/amp.h>
 
+#include <amp/amp_raw_atomic.h>
 #include <amp/amp_raw_platform.h>
 #include <amp/amp_raw_thread.h>
 #include <amp/amp_raw_thread_local_slot.h>
@@ -52,6 +53,7 @@
 #include <amp/amp_raw_mutex.h>
 #include <amp/amp_raw_condition_variable.h>
 #include <amp/amp_raw_barrier.h>
+#include <amp/amp_raw_rwlock.h>
 
 
 #endif /* AMP_amp_raw_H */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Definition of the raw atomic types so they can be embedded into other data
+ * structures. The value fields are only accessed via the amp_atomic functions.
+ *
+ * AMP_USE_GNUC_ATOMICS uses the gcc/clang __atomic builtins,
+ * AMP_USE_C11_ATOMICS uses the C1x stdatomic.h header (the backend source file
+ * must be compiled as C1x) while AMP_USE_WINTHREADS uses the Windows
+ * Interlocked functions.
+ *
+ * @attention Don't copy or move raw atomics that are shared between threads.
+ */
+
+#ifndef AMP_amp_raw_atomic_H
+#define AMP_amp_raw_atomic_H
+
+#include <amp/amp_stdint.h>
+#include <amp/amp_atomic.h>
+
+
+#if !defined(AMP_USE_GNUC_ATOMICS) && !defined(AMP_USE_C11_ATOMICS) && !defined(AMP_USE_WINTHREADS)
+#   error Unsupported platform.
+#endif
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+/**
+ * @def AMP_RAW_ATOMIC_INT64_ALIGNMENT
+ *
+ * 64bit integers are only four byte aligned inside structs on some 32bit
+ * platforms which breaks atomicity of double-word instructions.
+ */
+#if defined(_MSC_VER)
+#   define AMP_RAW_ATOMIC_INT64_ALIGNMENT __declspec(align(8))
+#elif defined(__GNUC__) || defined(__clang__)
+#   define AMP_RAW_ATOMIC_INT64_ALIGNMENT __attribute__((aligned(8)))
+#else
+#   error Unsupported platform.
+#endif
+
+
+    struct amp_raw_atomic_int32_s {
+        int32_t value;
+    };
+
+    struct amp_raw_atomic_int64_s {
+        AMP_RAW_ATOMIC_INT64_ALIGNMENT int64_t value;
+    };
+
+    struct amp_raw_atomic_pointer_s {
+        void* value;
+    };
+
+
+/**
+ * Static initializers for raw atomics, e.g.
+ * struct amp_raw_atomic_int32_s counter = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+ */
+#define AMP_RAW_ATOMIC_INT32_INITIALIZER(value) {(value)}
+#define AMP_RAW_ATOMIC_INT64_INITIALIZER(value) {(value)}
+#define AMP_RAW_ATOMIC_POINTER_INITIALIZER(value) {(value)}
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_raw_atomic_H */
@@ -41,12 +41,17 @@
 #define AMP_amp_raw_barrier_H
 
 #include <amp/amp_barrier.h>
+#include <amp/amp_stddef.h>
 
 
 
 #if defined(AMP_USE_GENERIC_BROADCAST_BARRIERS) || defined(AMP_USE_GENERIC_SIGNAL_BARRIERS)
 #   include <amp/amp_raw_mutex.h>
 #   include <amp/amp_raw_condition_variable.h>
+#elif defined(AMP_USE_SPIN_BARRIERS) || defined(AMP_USE_TREE_BARRIERS)
+#   include <amp/amp_raw_atomic.h>
+#   include <amp/amp_raw_mutex.h>
+#   include <amp/amp_raw_condition_variable.h>
 #else
 #   error Unsupported backend.
 #endif
@@ -57,6 +62,12 @@
 extern "C" {
 #endif
 
+#if defined(AMP_USE_TREE_BARRIERS)
+    /* Defined in amp_barrier_tree.c */
+    struct amp_internal_barrier_slot_s;
+    struct amp_internal_barrier_tree_node_s;
+#endif
+
 
     
     /**
@@ -81,15 +92,76 @@ extern "C" {
         amp_barrier_count_t init_count;
         int state;
         int valid;
+#elif defined(AMP_USE_SPIN_BARRIERS)
+        /* Generation of the current phase in the upper 32 bits and the
+         * threads still to arrive in it in the lower 32 bits, so timed out
+         * threads can withdraw their arrival only while the phase is still
+         * running. Written by arriving threads, therefore kept apart from 
+         * generation which waiting threads spin on.
+         */
+        struct amp_raw_atomic_int64_s state;
+        char state_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+        
+        /* Advanced by the last arriving thread to release the phase. */
+        struct amp_raw_atomic_int32_s generation;
+        char generation_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int32_s)];
+        
+        /* Threads that stopped spinning and park on waking_condition. */
+        struct amp_raw_atomic_int32_s parked_count;
+        struct amp_raw_mutex_s park_mutex;
+        struct amp_raw_condition_variable_s waking_condition;
+        
+        amp_barrier_count_t init_count;
+        int valid;
+#elif defined(AMP_USE_TREE_BARRIERS)
+        /* Number of completed phases. Only written once per phase by the 
+         * serial thread, read by arriving threads.
+         */
+        struct amp_raw_atomic_int64_s phase;
+        char phase_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+        
+        /* Cache line aligned arrays inside of the memory passed to init - 
+         * one arrival slot per thread and the combining tree nodes, leaves 
+         * first, root last.
+         */
+        struct amp_internal_barrier_slot_s* slots;
+        struct amp_internal_barrier_tree_node_s* nodes;
+        size_t node_count;
+        
+        /* Threads that stopped spinning and park on waking_condition. */
+        struct amp_raw_atomic_int32_s parked_count;
+        struct amp_raw_mutex_s park_mutex;
+        struct amp_raw_condition_variable_s waking_condition;
+        
+        amp_barrier_count_t init_count;
+        int valid;
 #else
 #   error Unsupported backend.
 #endif
     };
 
+    /**
+     * Returns the number of bytes of cache line aligned memory 
+     * amp_raw_barrier_init needs for a barrier of init_count threads, 0 if 
+     * the backend doesn't need memory, or AMP_SIZE_MAX if the memory can't 
+     * be addressed.
+     */
+    size_t amp_raw_barrier_memory_size(amp_barrier_count_t init_count);
     
+    /**
+     * Like amp_barrier_create but does not allocate memory. memory must 
+     * point to cache line aligned memory of at least 
+     * amp_raw_barrier_memory_size(init_count) bytes which lives until the 
+     * barrier is finalized, or it can be NULL if that size is 0.
+     */
     int amp_raw_barrier_init(amp_barrier_t barrier,
-                             amp_barrier_count_t init_count);
+                             amp_barrier_count_t init_count,
+                             void* memory);
     
+    /**
+     * Like amp_barrier_destroy but does not free memory, the memory passed
+     * to amp_raw_barrier_init can be freed afterwards.
+     */
     int amp_raw_barrier_finalize(amp_barrier_t barrier);
 
     
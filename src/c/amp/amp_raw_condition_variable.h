@@ -48,7 +48,11 @@
 
 
 
-#if defined(AMP_USE_PTHREADS)
+#if defined(AMP_USE_FUTEX_MUTEXES)
+#   include <amp/amp_stdint.h>
+#   include <amp/amp_raw_atomic.h>
+#   include <amp/amp_raw_mutex.h>
+#elif defined(AMP_USE_PTHREADS)
 #   include <pthread.h>
 #elif defined(AMP_USE_WINVISTA_CONDITION_VARIABLES)
 #   define WIN32_LEAN_AND_MEAN /* Only include streamlined windows header. */
@@ -72,6 +76,10 @@
 extern "C" {
 #endif
 
+#if defined(AMP_USE_FUTEX_MUTEXES)
+    /* Defined in amp_condition_variable_futex_linux.c */
+    struct amp_internal_condition_variable_waiter_s;
+#endif
     
     /**
      * Don't copy and don't move, pointer can be copied and moved but ownership
@@ -79,7 +87,20 @@ extern "C" {
      */
     struct amp_raw_condition_variable_s
     {
-#if defined(AMP_USE_PTHREADS)
+#if defined(AMP_USE_FUTEX_MUTEXES)
+        /* Waiters enqueue a node living on their stack into a FIFO list
+         * and may leave once signal or broadcast dequeued and granted it.
+         * The list and counters are protected by lock. Sleeping happens on
+         * the futex word sequence which is incremented by each signal and
+         * broadcast that grants wakeups.
+         */
+        struct amp_raw_mutex_s lock;
+        struct amp_internal_condition_variable_waiter_s* first_waiter;
+        struct amp_internal_condition_variable_waiter_s* last_waiter;
+        unsigned int next_bitset_index;
+        unsigned int waiter_count;
+        struct amp_raw_atomic_int32_s sequence;
+#elif defined(AMP_USE_PTHREADS)
         pthread_cond_t cond;
 #elif defined(AMP_USE_WINVISTA_CONDITION_VARIABLES)
         CONDITION_VARIABLE cond;
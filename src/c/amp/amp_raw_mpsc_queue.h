@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Definition of the intrusive multi-producer/single-consumer queue node and
+ * queue types to embed them into other data structures, e.g. a queue per
+ * actor, without allocating each separately.
+ *
+ * @attention Don't copy or move raw queues or queued nodes.
+ */
+
+#ifndef AMP_amp_raw_mpsc_queue_H
+#define AMP_amp_raw_mpsc_queue_H
+
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_mpsc_queue.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Node header embedded into queued elements.
+     */
+    struct amp_raw_mpsc_queue_node_s {
+        struct amp_raw_atomic_pointer_s next;
+    };
+    
+    
+    /**
+     * Producers exchange the tail and read the wake-up function on one cache
+     * line, the consumer owns the head and the stub node on another.
+     *
+     * Treat definition and size as opaque as these can change without a 
+     * warning in future versions of amp.
+     */
+    struct amp_raw_mpsc_queue_s {
+        struct amp_raw_atomic_pointer_s tail;
+        amp_mpsc_queue_wakeup_func_t wakeup_func;
+        void* wakeup_context;
+        char tail_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_pointer_s) - sizeof(amp_mpsc_queue_wakeup_func_t) - sizeof(void*)];
+        
+        struct amp_raw_mpsc_queue_node_s* head;
+        struct amp_raw_mpsc_queue_node_s stub;
+    };
+    
+    
+    /**
+     * Like amp_mpsc_queue_create but does not allocate memory for the queue.
+     */
+    void amp_raw_mpsc_queue_init(amp_mpsc_queue_t queue,
+                                 amp_mpsc_queue_wakeup_func_t wakeup_func,
+                                 void* wakeup_context);
+    
+    /**
+     * Like amp_mpsc_queue_destroy but does not free memory for the queue.
+     */
+    void amp_raw_mpsc_queue_finalize(amp_mpsc_queue_t queue);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_raw_mpsc_queue_H */
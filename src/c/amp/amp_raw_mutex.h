@@ -50,8 +50,11 @@
 
 
 
-#if defined(AMP_USE_PTHREADS)
+#if defined(AMP_USE_FUTEX_MUTEXES)
+#   include <amp/amp_raw_atomic.h>
+#elif defined(AMP_USE_PTHREADS)
 #   include <pthread.h>
+#   include <amp/amp_raw_atomic.h>
 #elif defined(AMP_USE_WINTHREADS)
 #   define WIN32_LEAN_AND_MEAN /* Only include streamlined windows header. */
 #   include <windows.h>
@@ -80,9 +83,20 @@ extern "C" {
      *            undefined - use pointers to an amp_raw_mutex instead.
      */
     struct amp_raw_mutex_s {
-#if defined(AMP_USE_PTHREADS)
+#if defined(AMP_USE_FUTEX_MUTEXES)
+        /* Unlocked, locked, or locked and contended - see 
+         * amp_mutex_futex_linux.c for details.
+         */
+        struct amp_raw_atomic_int32_s state;
+        unsigned int spin_count;
+#elif defined(AMP_USE_PTHREADS)
         /* Don't copy or move - therefore don't copy or move amp_mutex_s. */
         pthread_mutex_t mutex;
+        /* Hint if the mutex is held, read while spinning to only call
+         * pthread_mutex_trylock when the mutex looks free.
+         */
+        struct amp_raw_atomic_int32_s is_locked;
+        unsigned int spin_count;
 #elif defined(AMP_USE_WINTHREADS)
         /* Don't copy or move - therefore don't copy or move amp_mutex_s. */
         CRITICAL_SECTION critical_section;
@@ -105,6 +119,14 @@ extern "C" {
      */
     int amp_raw_mutex_init(amp_mutex_t mutex);
     
+    /**
+     * Like amp_mutex_create_with_spin but does not allocate memory for the
+     * amp mutex other than indirectly via the platform API to create a 
+     * platform mutex.
+     */
+    int amp_raw_mutex_init_with_spin(amp_mutex_t mutex,
+                                     unsigned int spin_count);
+    
     /**
      * Like amp_mutex_destroy but does not free memory for the amp mutex
      * other than indirectly via the platform API to destroy a platform mutex.
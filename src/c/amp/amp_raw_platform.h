@@ -60,6 +60,13 @@ extern "C" {
         void* allocator_context;
         amp_alloc_func_t alloc_func;
         amp_dealloc_func_t dealloc_func;
+        
+        /* Topology table, NULL if the topology can't be queried. */
+        struct amp_platform_hwthread_info_s* hwthreads;
+        size_t hwthread_count;
+        size_t core_count;
+        size_t package_count;
+        size_t numa_node_count;
     };
     
     
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Backend specific definition of amp rwlock to allow placing an rwlock on the
+ * stack or inside other data structures. Platform specific headers will be
+ * included.
+ *
+ * AMP_USE_GENERIC_RWLOCKS builds the rwlock from amp mutexes and condition
+ * variables, otherwise AMP_USE_PTHREADS uses pthread_rwlock_t. The Pthreads
+ * rwlock type is only declared by pthread.h if the POSIX 2001 (or X/Open 600)
+ * feature macros are enabled - define _XOPEN_SOURCE 600 or _GNU_SOURCE before
+ * including any system header when compiling strict C99 code that includes
+ * this header.
+ *
+ * @attention Don't copy a variable of type amp_raw_rwlock_s - copying a
+ *            pointer to this type is ok though.
+ */
+
+#ifndef AMP_amp_raw_rwlock_H
+#define AMP_amp_raw_rwlock_H
+
+#include <stddef.h>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_rwlock.h>
+#include <amp/amp_raw_atomic.h>
+
+#if defined(AMP_USE_GENERIC_RWLOCKS)
+#   include <amp/amp_raw_mutex.h>
+#   include <amp/amp_raw_condition_variable.h>
+#elif defined(AMP_USE_PTHREADS)
+#   include <pthread.h>
+#else
+#   error Unsupported platform.
+#endif
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+    /**
+     * Counter of readers that passed a reader-biased rwlock via the fast
+     * path. Padded to fill a whole cache line.
+     */
+    struct amp_raw_rwlock_reader_slot_s {
+        struct amp_raw_atomic_int32_s reader_count;
+        char padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int32_s)];
+    };
+
+
+    /**
+     * Treat definition and size as opaque as these can change without a
+     * warning in future versions of amp.
+     *
+     * @attention Don't copy or move an amp_raw_rwlock instance or behavior is
+     *            undefined - use pointers to an amp_raw_rwlock instead.
+     */
+    struct amp_raw_rwlock_s {
+#if defined(AMP_USE_GENERIC_RWLOCKS)
+        struct amp_raw_mutex_s mutex;
+        struct amp_raw_condition_variable_s readers_can_pass;
+        struct amp_raw_condition_variable_s writer_can_pass;
+        unsigned int active_reader_count;
+        unsigned int waiting_writer_count;
+        amp_bool_t writer_active;
+#elif defined(AMP_USE_PTHREADS)
+        pthread_rwlock_t rwlock;
+#else
+#   error Unsupported platform.
+#endif
+
+        /* Reader-biased mode - NULL reader_slots if not reader-biased. */
+        struct amp_raw_rwlock_reader_slot_s* reader_slots;
+        size_t reader_slot_count;
+        struct amp_raw_atomic_int32_s writer_pending;
+    };
+
+
+
+    /**
+     * Like amp_rwlock_create but does not allocate memory for the amp rwlock
+     * other than indirectly via the platform API to create a platform rwlock.
+     */
+    int amp_raw_rwlock_init(amp_rwlock_t rwlock);
+
+
+    /**
+     * Like amp_rwlock_create_reader_biased but uses the reader_slot_count
+     * reader slots reader_slots points to instead of allocating them.
+     *
+     * The reader slots must stay valid until the rwlock is finalized and
+     * should be aligned to AMP_CACHE_LINE_SIZE.
+     */
+    int amp_raw_rwlock_init_reader_biased(amp_rwlock_t rwlock,
+                                          struct amp_raw_rwlock_reader_slot_s* reader_slots,
+                                          size_t reader_slot_count);
+
+
+    /**
+     * Like amp_rwlock_destroy but does not free memory for the amp rwlock or
+     * the reader slots.
+     */
+    int amp_raw_rwlock_finalize(amp_rwlock_t rwlock);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_raw_rwlock_H */
@@ -63,7 +63,10 @@
 
 #include <amp/amp_semaphore.h>
 
-#if defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
+#if defined(AMP_USE_FUTEX_SEMAPHORES)
+#   include <amp/amp_raw_atomic.h>
+#   include <limits.h>
+#elif defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
 #   include <semaphore.h>
 #elif defined(AMP_USE_LIBDISPATCH_SEMAPHORES)
 #   include <dispatch/dispatch.h>
@@ -93,7 +96,9 @@ extern "C" {
      * When changing the type also adapt AMP_RAW_SEMAPHORE_COUNT_MAX
      * and check if limits.h must be included or not.
      */
-#if defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
+#if defined(AMP_USE_FUTEX_SEMAPHORES)
+    typedef unsigned int amp_raw_semaphore_counter_t;
+#elif defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
     typedef unsigned int amp_raw_semaphore_counter_t;
 #elif defined(AMP_USE_LIBDISPATCH_SEMAPHORES)
     typedef long amp_raw_semaphore_counter_t;
@@ -114,7 +119,9 @@ extern "C" {
      * TODO: @todo Try to find a Windows platform constant for the max number
      *             of semaphores allowed (not found yet).
      */
-#if defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
+#if defined(AMP_USE_FUTEX_SEMAPHORES)
+#   define AMP_RAW_SEMAPHORE_COUNT_MAX ((amp_raw_semaphore_counter_t)(INT_MAX))
+#elif defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
 #   define AMP_RAW_SEMAPHORE_COUNT_MAX ((amp_raw_semaphore_counter_t)(SEM_VALUE_MAX))
 #elif defined(AMP_USE_LIBDISPATCH_SEMAPHORES)
 #   define AMP_RAW_SEMAPHORE_COUNT_MAX ((amp_raw_semaphore_counter_t)(LONG_MAX))
@@ -134,16 +141,43 @@ extern "C" {
      * @attention Don't copy or move, otherwise behavior is undefined.
      */
     struct amp_raw_semaphore_s {
-#if defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
+#if defined(AMP_USE_FUTEX_SEMAPHORES)
+        /* Count in the lower and number of waiting threads in the upper 
+         * 32bit - see amp_semaphore_futex_linux.c for details.
+         */
+        struct amp_raw_atomic_int64_s state;
+        /* Threads waiting for a whole batch sleep on the sequence which is
+         * incremented by signals while there are any.
+         */
+        struct amp_raw_atomic_int32_s batch_waiter_count;
+        struct amp_raw_atomic_int32_s batch_wake_sequence;
+#elif defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
         sem_t semaphore;
+        /* Binary semaphore letting one batch waiter at a time collect its
+         * units.
+         */
+        sem_t batch_gate;
 #elif defined(AMP_USE_LIBDISPATCH_SEMAPHORES)
         dispatch_semaphore_t semaphore;
+        /* Binary semaphore letting one batch waiter at a time collect its
+         * units.
+         */
+        dispatch_semaphore_t batch_gate;
 #elif defined(AMP_USE_PTHREADS)
         pthread_mutex_t mutex;
         pthread_cond_t a_thread_can_pass;
         amp_semaphore_counter_t count;
+        /* Threads waiting in amp_semaphore_wait_n for a whole batch - 
+         * while there are any every wake up is a broadcast, otherwise a
+         * single wake up could hit a batch waiter that can't pass yet.
+         */
+        int batch_waiter_count;
 #elif defined(AMP_USE_WINTHREADS)
         HANDLE semaphore_handle;
+        /* Binary semaphore letting one batch waiter at a time collect its
+         * units.
+         */
+        HANDLE batch_gate_handle;
 #else
 #   error Unsupported platform.
 #endif
@@ -100,6 +100,18 @@ extern "C" {
         
         struct amp_native_thread_s native_thread_description;
         
+        /* Hardware threads to pin the thread to when launched, only valid
+         * if has_affinity is AMP_TRUE.
+         */
+        struct amp_thread_affinity_s affinity;
+        amp_bool_t has_affinity;
+        
+        /* Attributes to launch the thread with, only valid if 
+         * has_attributes is AMP_TRUE.
+         */
+        struct amp_thread_attributes_s attributes;
+        amp_bool_t has_attributes;
+        
         /**
          * TODO: @todo The moment the amp atomic operations are ready make it
          *             an atomically changed flag that is queryable. Currently
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Reader-writer lock that lets multiple reader threads hold the lock
+ * concurrently while a writer thread holds it exclusively. Writers are
+ * preferred - while a writer waits for the lock no new readers pass if the
+ * backend supports it (the generic backend does, the Pthreads backend does on
+ * glibc and otherwise relies on the platform default).
+ *
+ * A reader-biased rwlock (see amp_rwlock_create_reader_biased) lets
+ * uncontended readers only touch a per-thread counter slot instead of a
+ * shared lock word so reading threads don't bounce a cache line between
+ * processors. In exchange writers get more expensive as they have to wait
+ * for all reader slots to drain.
+ *
+ * The rwlock is neither recursive nor upgradeable. Don't read-lock or
+ * write-lock an rwlock already locked by the calling thread and don't unlock
+ * an rwlock locked by another thread, otherwise behavior is undefined.
+ *
+ * Never pass an invalid, e.g. non-created rwlock to any of the rwlock
+ * functions other than the create functions.
+ */
+
+#ifndef AMP_amp_rwlock_H
+#define AMP_amp_rwlock_H
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+#define AMP_RWLOCK_UNINITIALIZED NULL
+
+
+    /**
+     * Opaque reader-writer lock type. See amp_raw_rwlock_s.
+     */
+    typedef struct amp_raw_rwlock_s *amp_rwlock_t;
+
+
+    /**
+     * Allocates and initializes an rwlock.
+     *
+     * If the initialization fails the allocator is called to free the
+     * already allocated memory which must not result in an error or otherwise
+     * behavior is undefined.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     *         AMP_ERROR if other system resources are insufficient.
+     *         Other error codes might be returned to signal errors while
+     *         initializing, too. These are programming errors and mustn't
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     */
+    int amp_rwlock_create(amp_rwlock_t* rwlock,
+                          amp_allocator_t allocator);
+
+
+    /**
+     * Like amp_rwlock_create but creates a reader-biased rwlock with
+     * reader_slot_count cache line sized reader counters. Reading threads
+     * pick a slot based on their thread id, therefore the number of slots
+     * should be greater than or equal to the number of hardware threads
+     * to minimize the chance of two readers sharing a slot.
+     *
+     * reader_slot_count must be greater than 0.
+     *
+     * @return Same as amp_rwlock_create.
+     */
+    int amp_rwlock_create_reader_biased(amp_rwlock_t* rwlock,
+                                        amp_allocator_t allocator,
+                                        size_t reader_slot_count);
+
+
+    /**
+     * Finalizes the rwlock and frees its memory with the allocator.
+     *
+     * allocator must be capable of freeing the memory allocated via the
+     * create function otherwise behavior is undefined and resources might be
+     * leaked.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_BUSY if the rwlock is locked.
+     *         AMP_ERROR if the rwlock is invalid.
+     *
+     * @attention Only call for unlocked rwlocks on which no threads wait.
+     */
+    int amp_rwlock_destroy(amp_rwlock_t* rwlock,
+                           amp_allocator_t allocator);
+
+
+    /**
+     * Acquires the rwlock for reading and blocks while a writer holds or waits
+     * for the lock.
+     *
+     * @return AMP_SUCCESS after acquiring the lock.
+     *         AMP_ERROR on programming errors, e.g. if a deadlock is detected.
+     */
+    int amp_rwlock_read_lock(amp_rwlock_t rwlock);
+
+
+    /**
+     * Acquires the rwlock for reading if possible without blocking.
+     *
+     * @return AMP_SUCCESS after acquiring the lock.
+     *         AMP_BUSY if a writer holds or waits for the lock.
+     *         AMP_ERROR on programming errors.
+     */
+    int amp_rwlock_read_trylock(amp_rwlock_t rwlock);
+
+
+    /**
+     * Releases a read lock held by the calling thread.
+     *
+     * @return AMP_SUCCESS after releasing the lock.
+     *         AMP_ERROR on programming errors, e.g. if the calling thread
+     *         doesn't hold a read lock.
+     */
+    int amp_rwlock_read_unlock(amp_rwlock_t rwlock);
+
+
+    /**
+     * Acquires the rwlock exclusively for writing and blocks while other
+     * threads hold it.
+     *
+     * @return AMP_SUCCESS after acquiring the lock.
+     *         AMP_ERROR on programming errors, e.g. if a deadlock is detected.
+     */
+    int amp_rwlock_write_lock(amp_rwlock_t rwlock);
+
+
+    /**
+     * Acquires the rwlock exclusively for writing if possible without
+     * blocking.
+     *
+     * @return AMP_SUCCESS after acquiring the lock.
+     *         AMP_BUSY if other threads hold the lock.
+     *         AMP_ERROR on programming errors.
+     */
+    int amp_rwlock_write_trylock(amp_rwlock_t rwlock);
+
+
+    /**
+     * Releases the write lock held by the calling thread.
+     *
+     * @return AMP_SUCCESS after releasing the lock.
+     *         AMP_ERROR on programming errors, e.g. if the calling thread
+     *         doesn't hold the write lock.
+     */
+    int amp_rwlock_write_unlock(amp_rwlock_t rwlock);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_rwlock_H */
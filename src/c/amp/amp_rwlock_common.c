@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation shared by all amp rwlock backends: creation, destruction,
+ * and the reader-biased mode.
+ *
+ * Reader-biased mode: a reader increments the counter of its reader slot and
+ * then checks the writer_pending flag. A writer acquires the backend write
+ * lock, raises writer_pending, and then waits until all reader slots are
+ * zero. Both sides use sequentially consistent operations so at least one of
+ * them sees the other (Dekker style). A reader that sees a pending writer
+ * backs out and takes the slow path: it acquires the backend read lock (and
+ * therefore waits for the writer), registers in its slot, and releases the
+ * backend read lock again. Unlocking a read lock always only decrements the
+ * reader slot.
+ */
+
+/* pthread_rwlock_t is only declared if POSIX 2001 features are enabled. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "amp_rwlock.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_thread.h"
+#include "amp_internal_thread.h"
+#include "amp_raw_rwlock.h"
+#include "amp_internal_rwlock.h"
+
+
+
+/**
+ * Number of spins with a pause hint a writer performs while waiting for
+ * readers to leave before it starts yielding its time slice.
+ */
+#define AMP_INTERNAL_RWLOCK_DRAIN_SPIN_COUNT 1000
+
+
+
+/**
+ * Returns the reader slot the calling thread uses.
+ */
+static struct amp_raw_rwlock_reader_slot_s* amp_internal_rwlock_reader_slot(amp_rwlock_t rwlock);
+
+/**
+ * Returns AMP_TRUE if no reader is registered in any reader slot.
+ */
+static amp_bool_t amp_internal_rwlock_reader_slots_empty(amp_rwlock_t rwlock);
+
+/**
+ * Blocks until all readers have left their reader slots.
+ */
+static void amp_internal_rwlock_wait_for_reader_slots_to_drain(amp_rwlock_t rwlock);
+
+/**
+ * Shared allocation and initialization for the create functions.
+ * reader_slot_count of 0 creates a rwlock that isn't reader-biased.
+ */
+static int amp_internal_rwlock_create(amp_rwlock_t* rwlock,
+                                      amp_allocator_t allocator,
+                                      size_t reader_slot_count);
+
+
+
+static struct amp_raw_rwlock_reader_slot_s* amp_internal_rwlock_reader_slot(amp_rwlock_t rwlock)
+{
+    /* Thread ids are often aligned addresses - mix their bits before picking
+     * a slot.
+     */
+    uintptr_t hash = (uintptr_t)amp_internal_thread_current_id();
+    hash ^= hash >> 16;
+    hash *= (uintptr_t)0x45d9f3b;
+    hash ^= hash >> 16;
+
+    return &rwlock->reader_slots[hash % rwlock->reader_slot_count];
+}
+
+
+
+static amp_bool_t amp_internal_rwlock_reader_slots_empty(amp_rwlock_t rwlock)
+{
+    size_t i = 0;
+
+    for (i = 0; i < rwlock->reader_slot_count; ++i) {
+        if (0 != amp_atomic_int32_load(&rwlock->reader_slots[i].reader_count)) {
+            return AMP_FALSE;
+        }
+    }
+
+    return AMP_TRUE;
+}
+
+
+
+static void amp_internal_rwlock_wait_for_reader_slots_to_drain(amp_rwlock_t rwlock)
+{
+    size_t i = 0;
+    unsigned int spin_count = 0;
+
+    for (i = 0; i < rwlock->reader_slot_count; ++i) {
+        while (0 != amp_atomic_int32_load(&rwlock->reader_slots[i].reader_count)) {
+            if (spin_count < AMP_INTERNAL_RWLOCK_DRAIN_SPIN_COUNT) {
+                ++spin_count;
+                amp_atomic_spin_pause();
+            } else {
+                (void)amp_thread_yield();
+            }
+        }
+    }
+}
+
+
+
+static int amp_internal_rwlock_create(amp_rwlock_t* rwlock,
+                                      amp_allocator_t allocator,
+                                      size_t reader_slot_count)
+{
+    amp_rwlock_t tmp_rwlock = AMP_RWLOCK_UNINITIALIZED;
+    size_t const rwlock_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_rwlock));
+    size_t block_size = rwlock_size;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+    assert(NULL != allocator);
+
+    if (0 < reader_slot_count) {
+        /* Slots follow the rwlock in the same block and are aligned to the
+         * cache line size.
+         */
+        size_t const slot_size = sizeof(struct amp_raw_rwlock_reader_slot_s);
+        size_t const max_slot_count = (AMP_SIZE_MAX - block_size) / slot_size;
+        if (reader_slot_count > max_slot_count) {
+            return AMP_NOMEM;
+        }
+        block_size += reader_slot_count * slot_size;
+    }
+
+    tmp_rwlock = (amp_rwlock_t)AMP_ALIGNED_ALLOC(allocator,
+                                                 AMP_CACHE_LINE_SIZE,
+                                                 block_size);
+    if (NULL == tmp_rwlock) {
+        return AMP_NOMEM;
+    }
+
+    if (0 < reader_slot_count) {
+        retval = amp_raw_rwlock_init_reader_biased(tmp_rwlock,
+                                                   (struct amp_raw_rwlock_reader_slot_s*)((char*)tmp_rwlock + rwlock_size),
+                                                   reader_slot_count);
+    } else {
+        retval = amp_raw_rwlock_init(tmp_rwlock);
+    }
+
+    if (AMP_SUCCESS == retval) {
+        *rwlock = tmp_rwlock;
+    } else {
+        int const rc = AMP_ALIGNED_DEALLOC(allocator, tmp_rwlock);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+    }
+
+    return retval;
+}
+
+
+
+int amp_raw_rwlock_init(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+
+    rwlock->reader_slots = NULL;
+    rwlock->reader_slot_count = 0;
+    amp_atomic_int32_store_explicit(&rwlock->writer_pending,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+
+    return amp_internal_rwlock_backend_init(rwlock);
+}
+
+
+
+int amp_raw_rwlock_init_reader_biased(amp_rwlock_t rwlock,
+                                      struct amp_raw_rwlock_reader_slot_s* reader_slots,
+                                      size_t reader_slot_count)
+{
+    size_t i = 0;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+    assert(NULL != reader_slots);
+    assert(0 < reader_slot_count);
+
+    retval = amp_raw_rwlock_init(rwlock);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    for (i = 0; i < reader_slot_count; ++i) {
+        amp_atomic_int32_store_explicit(&reader_slots[i].reader_count,
+                                        0,
+                                        AMP_MEMORY_ORDER_RELAXED);
+    }
+
+    rwlock->reader_slots = reader_slots;
+    rwlock->reader_slot_count = reader_slot_count;
+
+    /* Publish the initialized slots before the rwlock is shared. */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_RELEASE);
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_rwlock_finalize(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+
+    if ((NULL != rwlock->reader_slots)
+        && (AMP_FALSE == amp_internal_rwlock_reader_slots_empty(rwlock))) {
+
+        return AMP_BUSY;
+    }
+
+    return amp_internal_rwlock_backend_finalize(rwlock);
+}
+
+
+
+int amp_rwlock_create(amp_rwlock_t* rwlock,
+                      amp_allocator_t allocator)
+{
+    return amp_internal_rwlock_create(rwlock, allocator, 0);
+}
+
+
+
+int amp_rwlock_create_reader_biased(amp_rwlock_t* rwlock,
+                                    amp_allocator_t allocator,
+                                    size_t reader_slot_count)
+{
+    assert(0 < reader_slot_count);
+
+    if (0 == reader_slot_count) {
+        return AMP_ERROR;
+    }
+
+    return amp_internal_rwlock_create(rwlock, allocator, reader_slot_count);
+}
+
+
+
+int amp_rwlock_destroy(amp_rwlock_t* rwlock,
+                       amp_allocator_t allocator)
+{
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+    assert(NULL != *rwlock);
+    assert(NULL != allocator);
+
+    retval = amp_raw_rwlock_finalize(*rwlock);
+    if (AMP_SUCCESS == retval) {
+        retval = AMP_ALIGNED_DEALLOC(allocator, *rwlock);
+        assert(AMP_SUCCESS == retval);
+        if (AMP_SUCCESS == retval) {
+            *rwlock = AMP_RWLOCK_UNINITIALIZED;
+        }
+    }
+
+    return retval;
+}
+
+
+
+int amp_rwlock_read_lock(amp_rwlock_t rwlock)
+{
+    struct amp_raw_rwlock_reader_slot_s* slot = NULL;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+
+    if (NULL == rwlock->reader_slots) {
+        return amp_internal_rwlock_backend_read_lock(rwlock);
+    }
+
+    slot = amp_internal_rwlock_reader_slot(rwlock);
+
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, 1);
+    if (0 == amp_atomic_int32_load(&rwlock->writer_pending)) {
+        return AMP_SUCCESS;
+    }
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, -1);
+
+    /* Slow path - wait for the writer via the backend lock. */
+    retval = amp_internal_rwlock_backend_read_lock(rwlock);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, 1);
+
+    return amp_internal_rwlock_backend_read_unlock(rwlock);
+}
+
+
+
+int amp_rwlock_read_trylock(amp_rwlock_t rwlock)
+{
+    struct amp_raw_rwlock_reader_slot_s* slot = NULL;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+
+    if (NULL == rwlock->reader_slots) {
+        return amp_internal_rwlock_backend_read_trylock(rwlock);
+    }
+
+    slot = amp_internal_rwlock_reader_slot(rwlock);
+
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, 1);
+    if (0 == amp_atomic_int32_load(&rwlock->writer_pending)) {
+        return AMP_SUCCESS;
+    }
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, -1);
+
+    retval = amp_internal_rwlock_backend_read_trylock(rwlock);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    (void)amp_atomic_int32_fetch_add(&slot->reader_count, 1);
+
+    return amp_internal_rwlock_backend_read_unlock(rwlock);
+}
+
+
+
+int amp_rwlock_read_unlock(amp_rwlock_t rwlock)
+{
+    struct amp_raw_rwlock_reader_slot_s* slot = NULL;
+    int32_t previous_count = 0;
+
+    assert(NULL != rwlock);
+
+    if (NULL == rwlock->reader_slots) {
+        return amp_internal_rwlock_backend_read_unlock(rwlock);
+    }
+
+    slot = amp_internal_rwlock_reader_slot(rwlock);
+    previous_count = amp_atomic_int32_fetch_add_explicit(&slot->reader_count,
+                                                         -1,
+                                                         AMP_MEMORY_ORDER_RELEASE);
+    if (0 >= previous_count) {
+        assert(0); /* Programming error - not read locked by this thread. */
+        (void)amp_atomic_int32_fetch_add(&slot->reader_count, 1);
+        return AMP_ERROR;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_rwlock_write_lock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+
+    retval = amp_internal_rwlock_backend_write_lock(rwlock);
+    if ((AMP_SUCCESS != retval) || (NULL == rwlock->reader_slots)) {
+        return retval;
+    }
+
+    amp_atomic_int32_store(&rwlock->writer_pending, 1);
+    amp_internal_rwlock_wait_for_reader_slots_to_drain(rwlock);
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_rwlock_write_trylock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != rwlock);
+
+    retval = amp_internal_rwlock_backend_write_trylock(rwlock);
+    if ((AMP_SUCCESS != retval) || (NULL == rwlock->reader_slots)) {
+        return retval;
+    }
+
+    amp_atomic_int32_store(&rwlock->writer_pending, 1);
+    if (AMP_FALSE == amp_internal_rwlock_reader_slots_empty(rwlock)) {
+
+        amp_atomic_int32_store(&rwlock->writer_pending, 0);
+        retval = amp_internal_rwlock_backend_write_unlock(rwlock);
+        assert(AMP_SUCCESS == retval);
+
+        return AMP_BUSY;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_rwlock_write_unlock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+
+    if (NULL != rwlock->reader_slots) {
+        amp_atomic_int32_store_explicit(&rwlock->writer_pending,
+                                        0,
+                                        AMP_MEMORY_ORDER_RELEASE);
+    }
+
+    return amp_internal_rwlock_backend_write_unlock(rwlock);
+}
+
+
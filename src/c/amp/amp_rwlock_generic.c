@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Backend of amp rwlock built from an amp mutex and two amp condition
+ * variables. Writers are preferred: readers don't pass while a writer holds
+ * the lock or waits for it.
+ *
+ * Used on Windows and when building with USE_GENERIC_RWLOCKS.
+ */
+
+#include "amp_rwlock.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_return_code.h"
+#include "amp_mutex.h"
+#include "amp_raw_mutex.h"
+#include "amp_condition_variable.h"
+#include "amp_raw_condition_variable.h"
+#include "amp_raw_rwlock.h"
+#include "amp_internal_rwlock.h"
+
+
+
+#if !defined(AMP_USE_GENERIC_RWLOCKS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+int amp_internal_rwlock_backend_init(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    int rc = AMP_UNSUPPORTED;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_raw_mutex_init(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    retval = amp_raw_condition_variable_init(&rwlock->readers_can_pass);
+    if (AMP_SUCCESS != retval) {
+        rc = amp_raw_mutex_finalize(&rwlock->mutex);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    retval = amp_raw_condition_variable_init(&rwlock->writer_can_pass);
+    if (AMP_SUCCESS != retval) {
+        rc = amp_raw_condition_variable_finalize(&rwlock->readers_can_pass);
+        assert(AMP_SUCCESS == rc);
+        rc = amp_raw_mutex_finalize(&rwlock->mutex);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    rwlock->active_reader_count = 0;
+    rwlock->waiting_writer_count = 0;
+    rwlock->writer_active = AMP_FALSE;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_rwlock_backend_finalize(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    int retval2 = AMP_UNSUPPORTED;
+    int retval3 = AMP_UNSUPPORTED;
+    amp_bool_t busy = AMP_FALSE;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    assert(AMP_SUCCESS == retval);
+    {
+        busy = (0 != rwlock->active_reader_count)
+            || (0 != rwlock->waiting_writer_count)
+            || (AMP_FALSE != rwlock->writer_active);
+    }
+    retval = amp_mutex_unlock(&rwlock->mutex);
+    assert(AMP_SUCCESS == retval);
+    
+    if (busy) {
+        return AMP_BUSY;
+    }
+    
+    retval = amp_raw_condition_variable_finalize(&rwlock->writer_can_pass);
+    assert(AMP_SUCCESS == retval);
+    
+    retval2 = amp_raw_condition_variable_finalize(&rwlock->readers_can_pass);
+    assert(AMP_SUCCESS == retval2);
+    
+    retval3 = amp_raw_mutex_finalize(&rwlock->mutex);
+    assert(AMP_SUCCESS == retval3);
+    
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    } else if (AMP_SUCCESS != retval2) {
+        return retval2;
+    }
+    
+    return retval3;
+}
+
+
+
+int amp_internal_rwlock_backend_read_lock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        while ((AMP_FALSE != rwlock->writer_active) 
+               || (0 != rwlock->waiting_writer_count)) {
+            
+            retval = amp_condition_variable_wait(&rwlock->readers_can_pass,
+                                                 &rwlock->mutex);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        ++(rwlock->active_reader_count);
+    }
+    return amp_mutex_unlock(&rwlock->mutex);
+}
+
+
+
+int amp_internal_rwlock_backend_read_trylock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    amp_bool_t acquired = AMP_FALSE;
+    
+    assert(NULL != rwlock);
+    
+    /* The mutex only guards the short bookkeeping sections, therefore block
+     * on it and only report AMP_BUSY if the lock state forbids reading.
+     */
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        if ((AMP_FALSE == rwlock->writer_active) 
+            && (0 == rwlock->waiting_writer_count)) {
+            
+            ++(rwlock->active_reader_count);
+            acquired = AMP_TRUE;
+        }
+    }
+    retval = amp_mutex_unlock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    return acquired ? AMP_SUCCESS : AMP_BUSY;
+}
+
+
+
+int amp_internal_rwlock_backend_read_unlock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    amp_bool_t was_read_locked = AMP_FALSE;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        if (0 < rwlock->active_reader_count) {
+            was_read_locked = AMP_TRUE;
+            
+            --(rwlock->active_reader_count);
+            if ((0 == rwlock->active_reader_count) 
+                && (0 != rwlock->waiting_writer_count)) {
+                
+                retval = amp_condition_variable_signal(&rwlock->writer_can_pass);
+                assert(AMP_SUCCESS == retval);
+            }
+        }
+    }
+    retval = amp_mutex_unlock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    assert(was_read_locked); /* Programming error - not read locked. */
+    
+    return was_read_locked ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
+
+int amp_internal_rwlock_backend_write_lock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        ++(rwlock->waiting_writer_count);
+        
+        while ((AMP_FALSE != rwlock->writer_active) 
+               || (0 != rwlock->active_reader_count)) {
+            
+            retval = amp_condition_variable_wait(&rwlock->writer_can_pass,
+                                                 &rwlock->mutex);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        --(rwlock->waiting_writer_count);
+        rwlock->writer_active = AMP_TRUE;
+    }
+    return amp_mutex_unlock(&rwlock->mutex);
+}
+
+
+
+int amp_internal_rwlock_backend_write_trylock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    amp_bool_t acquired = AMP_FALSE;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        if ((AMP_FALSE == rwlock->writer_active) 
+            && (0 == rwlock->active_reader_count)) {
+            
+            rwlock->writer_active = AMP_TRUE;
+            acquired = AMP_TRUE;
+        }
+    }
+    retval = amp_mutex_unlock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    return acquired ? AMP_SUCCESS : AMP_BUSY;
+}
+
+
+
+int amp_internal_rwlock_backend_write_unlock(amp_rwlock_t rwlock)
+{
+    int retval = AMP_UNSUPPORTED;
+    amp_bool_t was_write_locked = AMP_FALSE;
+    
+    assert(NULL != rwlock);
+    
+    retval = amp_mutex_lock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    {
+        was_write_locked = rwlock->writer_active;
+        rwlock->writer_active = AMP_FALSE;
+        
+        /* Hand the lock to a waiting writer first, readers only pass if no
+         * writer is waiting.
+         */
+        if (0 != rwlock->waiting_writer_count) {
+            retval = amp_condition_variable_signal(&rwlock->writer_can_pass);
+        } else {
+            retval = amp_condition_variable_broadcast(&rwlock->readers_can_pass);
+        }
+        assert(AMP_SUCCESS == retval);
+    }
+    retval = amp_mutex_unlock(&rwlock->mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    assert(AMP_FALSE != was_write_locked); /* Programming error. */
+    
+    return (AMP_FALSE != was_write_locked) ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
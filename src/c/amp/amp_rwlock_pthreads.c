@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Backend of amp rwlock using POSIX threads rwlocks. On glibc the rwlock is
+ * configured to prefer writers, other platforms use their default policy.
+ */
+
+/* Needed for pthread_rwlock_t and pthread_rwlockattr_setkind_np. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
+#include "amp_rwlock.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "amp_return_code.h"
+#include "amp_raw_rwlock.h"
+#include "amp_internal_rwlock.h"
+
+
+
+#if !defined(AMP_USE_PTHREADS) || defined(AMP_USE_GENERIC_RWLOCKS)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+
+
+int amp_internal_rwlock_backend_init(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    pthread_rwlockattr_t attr;
+    int retval = pthread_rwlockattr_init(&attr);
+    if (0 != retval) {
+        return (ENOMEM == retval) ? AMP_NOMEM : AMP_ERROR;
+    }
+    
+#if defined(__GLIBC__)
+    /* glibc prefers readers by default which can starve writers. */
+    retval = pthread_rwlockattr_setkind_np(&attr,
+                                           PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    assert(0 == retval);
+#endif
+    
+    retval = pthread_rwlock_init(&rwlock->rwlock, &attr);
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            /* Fallthrough */
+        case ENOMEM:
+            /* retval is already equal to AMP_NOMEM */
+            break;
+        case EAGAIN: /* Platform resources not available */
+            retval = AMP_ERROR;
+            break;
+        default: /* EINVAL, EBUSY - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
+    int const rc = pthread_rwlockattr_destroy(&attr);
+    assert(0 == rc);
+    (void)rc;
+    
+    return retval;
+}
+
+
+
+int amp_internal_rwlock_backend_finalize(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int retval = pthread_rwlock_destroy(&rwlock->rwlock);
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            /* Fallthrough */
+        case EBUSY:
+            /* retval is already equal to AMP_BUSY */
+            break;
+        default: /* EINVAL - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_internal_rwlock_backend_read_lock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int const retval = pthread_rwlock_rdlock(&rwlock->rwlock);
+    assert(0 == retval); /* EDEADLK, EINVAL, EAGAIN - programming error */
+    
+    return (0 == retval) ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
+
+int amp_internal_rwlock_backend_read_trylock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int retval = pthread_rwlock_tryrdlock(&rwlock->rwlock);
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            /* Fallthrough */
+        case EBUSY:
+            /* retval is already equal to AMP_BUSY */
+            break;
+        default: /* EINVAL, EAGAIN - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_internal_rwlock_backend_read_unlock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int const retval = pthread_rwlock_unlock(&rwlock->rwlock);
+    assert(0 == retval); /* EINVAL, EPERM - programming error */
+    
+    return (0 == retval) ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
+
+int amp_internal_rwlock_backend_write_lock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int const retval = pthread_rwlock_wrlock(&rwlock->rwlock);
+    assert(0 == retval); /* EDEADLK, EINVAL - programming error */
+    
+    return (0 == retval) ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
+
+int amp_internal_rwlock_backend_write_trylock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int retval = pthread_rwlock_trywrlock(&rwlock->rwlock);
+    switch (retval) {
+        case 0:
+            /* retval is already equal to AMP_SUCCESS */
+            /* Fallthrough */
+        case EBUSY:
+            /* retval is already equal to AMP_BUSY */
+            break;
+        default: /* EINVAL - programming error */
+            assert(0);
+            retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_internal_rwlock_backend_write_unlock(amp_rwlock_t rwlock)
+{
+    assert(NULL != rwlock);
+    
+    int const retval = pthread_rwlock_unlock(&rwlock->rwlock);
+    assert(0 == retval); /* EINVAL, EPERM - programming error */
+    
+    return (0 == retval) ? AMP_SUCCESS : AMP_ERROR;
+}
+
+
@@ -41,7 +41,6 @@
  *            to amp_raw_semaphore_init. Don't pass initialized semaphores
  *            to amp_raw_semaphore_init.
  * 
- * TODO: @todo Add amp_semaphore_trywait.
  * TODO: @todo Decide if to add amp_semaphore_max_count.
  */
 
@@ -208,35 +207,93 @@ extern "C" {
     
     
     /**
-     * If the semaphore counter is not zero decrements the counter and returns.
-     * If the counter is zero, this function will not alter the semaphore counter
-     * and will return immediately.
+     * Like amp_semaphore_wait but gives up and returns AMP_TIMEOUT without
+     * decrementing the counter if it stays zero for timeout_ns nanoseconds,
+     * measured on a monotonic clock.
      *
-     * @note This is a proposed function, and the implementation has not yet been 
-     *       approved by the project author for inclusion in the library.
+     * Backends without a native timed wait poll with a growing back-off
+     * sleep.
      *
-     * @return AMP_SUCCESS if semphore was locked successfuly.
-	 *         AMP_BUSY if semaphore counter was 0 when attempted.
-     *         AMP_ERROR if the semaphore was interrupted by a signal when using
-     *         a backend that supports signal interruption.
+     * @return AMP_SUCCESS after the counter has been decremented.
+     *         AMP_TIMEOUT if the timeout expired.
      *         AMP_UNSUPPORTED if the backend doesn't support semaphores.
      *         Error codes might be returned to signal errors while
      *         waiting, too. These are programming errors and mustn't 
      *         occur in release code. When @em amp is compiled without NDEBUG
      *         set it might assert that these programming errors don't happen.
-     *         AMP_ERROR if a deadlock condition was detected, or if the 
-     *         semaphore isn't valid, e.g. not initialized, or if the process 
-     *         lacks privileges to wait on the semaphore.
+     *         AMP_ERROR if the semaphore isn't valid, e.g. not initialized.
      *
-     * @attention sem mustn't be NULL.
+     * @attention semaphore mustn't be NULL.
+     */
+    int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                                uint64_t timeout_ns);
+    
+    
+    /**
+     * If the semaphore counter is not zero decrements the counter and returns.
+     * If the counter is zero, this function will not alter the semaphore 
+     * counter and will return immediately.
      *
-     * @attention Based on the backend amp_raw_semaphores might or might not 
-     *            react to / are or are not usable with signals. Set the threads
-     *            signal mask to not let any signals through.
+     * @return AMP_SUCCESS if the counter has been decremented.
+     *         AMP_BUSY if the semaphore counter was 0.
+     *         AMP_UNSUPPORTED if the backend doesn't support semaphores.
+     *         Error codes might be returned to signal errors while
+     *         waiting, too. These are programming errors and mustn't 
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     *         AMP_ERROR if the semaphore isn't valid, e.g. not initialized.
      *
-     * TODO: @todo Decide if OS signals should be able to interrupt the waiting.
+     * @attention semaphore mustn't be NULL.
+     */
+    int amp_semaphore_trywait(amp_semaphore_t semaphore);
+    
+    
+    /**
+     * Deprecated name of amp_semaphore_trywait kept for source compatibility.
      */
     int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore);
+    
+    
+    /**
+     * Increments the semaphore counter by count and wakes up to count 
+     * threads blocked on the semaphore. Backends with a native batch 
+     * release (Pthreads, Windows) only enter the kernel once, the others
+     * signal count times.
+     *
+     * A count of 0 doesn't change the semaphore.
+     *
+     * @return AMP_SUCCESS after succesful signaling the semaphore.
+     *         AMP_UNSUPPORTED if the backend doesn't support semaphores.
+     *         AMP_ERROR if the semaphore counter value would exceed 
+     *           AMP_RAW_SEMAPHORE_COUNT_MAX, the counter isn't changed in 
+     *           this case by backends with a native batch release.
+     *         Error codes might be returned to signal errors while
+     *         signaling, too. These are programming errors and mustn't 
+     *         occur in release code. When @em amp is compiled without NDEBUG
+     *         set it might assert that these programming errors don't happen.
+     *         AMP_ERROR if count is negative or the semaphore isn't valid.
+     *
+     * @attention semaphore mustn't be NULL.
+     */
+    int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                               amp_semaphore_counter_t count);
+    
+    
+    /**
+     * Decrements the semaphore counter by count, blocking until count units
+     * are available. Waiting threads don't hold parts of their batches while
+     * waiting for the rest.
+     *
+     * A count of 0 returns immediately.
+     *
+     * @return AMP_SUCCESS after the counter has been decremented by count.
+     *         Other return codes like amp_semaphore_wait.
+     *         AMP_ERROR if count is negative.
+     *
+     * @attention semaphore mustn't be NULL.
+     */
+    int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                             amp_semaphore_counter_t count);
 	
 	
     
@@ -67,8 +67,9 @@ int amp_semaphore_create(amp_semaphore_t* semaphore,
         return AMP_ERROR;
     }
 
-    tmp_sema = (amp_semaphore_t)AMP_ALLOC(allocator,
-                                           sizeof(*tmp_sema));
+    tmp_sema = (amp_semaphore_t)AMP_ALIGNED_ALLOC(allocator,
+                                                   AMP_CACHE_LINE_SIZE,
+                                                   AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_sema)));
     if (NULL == tmp_sema) {
         return AMP_NOMEM;
     }
@@ -78,7 +79,7 @@ int amp_semaphore_create(amp_semaphore_t* semaphore,
     if (AMP_SUCCESS == retval) {
         *semaphore = tmp_sema;
     } else {
-        int const rc = AMP_DEALLOC(allocator, tmp_sema);
+        int const rc = AMP_ALIGNED_DEALLOC(allocator, tmp_sema);
         assert(AMP_SUCCESS == rc);
         (void)rc;
     }
@@ -99,8 +100,8 @@ int amp_semaphore_destroy(amp_semaphore_t* semaphore,
     
     retval = amp_raw_semaphore_finalize(*semaphore);
     if (AMP_SUCCESS == retval) {
-        retval = AMP_DEALLOC(allocator,
-                             *semaphore);
+        retval = AMP_ALIGNED_DEALLOC(allocator,
+                                     *semaphore);
         assert(AMP_SUCCESS == retval);
         if (AMP_SUCCESS == retval) {
             *semaphore = AMP_SEMAPHORE_UNINITIALIZED;
@@ -111,3 +112,10 @@ int amp_semaphore_destroy(amp_semaphore_t* semaphore,
 }
 
 
+
+int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
+{
+    return amp_semaphore_trywait(semaphore);
+}
+
+
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Linux futex based semaphore backend. Signaling and waiting on a semaphore
+ * with a non-zero count only cost one atomic operation each, the kernel is
+ * only entered to sleep on an empty semaphore or to wake sleeping threads.
+ *
+ * The semaphore state is one 64bit word, its lower 32bit hold the count,
+ * its upper 32bit the number of threads registered as waiting. Updating
+ * both in one compare-and-swap lets signalers see if a wake is needed at
+ * all. Threads sleep on the 32bit half containing the count with an
+ * expected value of 0 - if a signal increments the count between
+ * registering and sleeping the futex wait returns immediately.
+ *
+ * A woken thread might find the count already taken by a thread that
+ * didn't need to sleep and goes back to sleep - the count never stays
+ * positive while registered threads sleep.
+ *
+ * Threads waiting for a batch of units can't pass on a positive count and
+ * would swallow wakes meant for single unit waiters, therefore they don't
+ * register in the state but sleep on a separate wake sequence. Signals 
+ * increment it and wake all batch waiters while there are any.
+ */
+
+#include "amp_semaphore.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_return_code.h"
+#include "amp_stdint.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_raw_semaphore.h"
+#include "amp_internal_futex_linux.h"
+#include "amp_internal_time.h"
+
+
+
+#if !defined(AMP_USE_FUTEX_SEMAPHORES)
+#   error Build configuration problem - this source file shouldn't be compiled.
+#endif
+
+#if !defined(__BYTE_ORDER__) || ((__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) && (__BYTE_ORDER__ != __ORDER_BIG_ENDIAN__))
+#   error Unsupported byte order.
+#endif
+
+
+
+#define AMP_INTERNAL_SEMAPHORE_COUNT_MASK ((int64_t)0xffffffff)
+#define AMP_INTERNAL_SEMAPHORE_WAITER_ONE ((int64_t)1 << 32)
+
+#define AMP_INTERNAL_SEMAPHORE_COUNT(state) ((amp_semaphore_counter_t)((state) & AMP_INTERNAL_SEMAPHORE_COUNT_MASK))
+#define AMP_INTERNAL_SEMAPHORE_WAITERS(state) ((int64_t)((uint64_t)(state) >> 32))
+
+
+
+/**
+ * Returns the address of the 32bit half of the state holding the count.
+ */
+static int32_t* amp_internal_semaphore_count_address(amp_semaphore_t semaphore);
+
+/**
+ * Takes one unit from the semaphore, sleeping while it is empty.
+ *
+ * Returns AMP_TIMEOUT if deadline_ns passed while sleeping.
+ */
+static int amp_internal_semaphore_wait_until(amp_semaphore_t semaphore,
+                                             uint64_t deadline_ns);
+
+/**
+ * Takes count units from the semaphore at once, sleeping until that many
+ * are available.
+ */
+static int amp_internal_semaphore_wait_batch(amp_semaphore_t semaphore,
+                                             amp_semaphore_counter_t count);
+
+
+
+static int32_t* amp_internal_semaphore_count_address(amp_semaphore_t semaphore)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return (int32_t*)&semaphore->state.value;
+#else
+    return ((int32_t*)&semaphore->state.value) + 1;
+#endif
+}
+
+
+
+static int amp_internal_semaphore_wait_until(amp_semaphore_t semaphore,
+                                             uint64_t deadline_ns)
+{
+    int64_t state = amp_atomic_int64_load_explicit(&semaphore->state,
+                                                   AMP_MEMORY_ORDER_RELAXED);
+    int64_t waiter_registration = 0;
+    int wait_retval = AMP_SUCCESS;
+
+    for (;;) {
+
+        amp_semaphore_counter_t const available = AMP_INTERNAL_SEMAPHORE_COUNT(state);
+
+        if (0 < available) {
+
+            /* Take a unit and drop the waiter registration in one step. */
+            if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                                       &state,
+                                                                       state - 1 - waiter_registration,
+                                                                       AMP_MEMORY_ORDER_ACQUIRE,
+                                                                       AMP_MEMORY_ORDER_RELAXED)) {
+                return AMP_SUCCESS;
+            }
+
+        } else if (0 == waiter_registration) {
+
+            if (AMP_TIMEOUT == wait_retval) {
+                return AMP_TIMEOUT;
+            }
+
+            if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                                       &state,
+                                                                       state + AMP_INTERNAL_SEMAPHORE_WAITER_ONE,
+                                                                       AMP_MEMORY_ORDER_RELAXED,
+                                                                       AMP_MEMORY_ORDER_RELAXED)) {
+                state += AMP_INTERNAL_SEMAPHORE_WAITER_ONE;
+                waiter_registration = AMP_INTERNAL_SEMAPHORE_WAITER_ONE;
+            }
+
+        } else if (AMP_SUCCESS == wait_retval) {
+
+            wait_retval = amp_internal_futex_timedwait(amp_internal_semaphore_count_address(semaphore),
+                                                       0,
+                                                       deadline_ns);
+            if (AMP_ERROR == wait_retval) {
+                assert(0); /* Programming error */
+                return AMP_ERROR;
+            }
+
+            state = amp_atomic_int64_load_explicit(&semaphore->state,
+                                                   AMP_MEMORY_ORDER_RELAXED);
+
+        } else {
+
+            /* Timed out - withdraw the registration unless a count arrived
+             * in the meantime.
+             */
+            if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                                       &state,
+                                                                       state - AMP_INTERNAL_SEMAPHORE_WAITER_ONE,
+                                                                       AMP_MEMORY_ORDER_RELAXED,
+                                                                       AMP_MEMORY_ORDER_RELAXED)) {
+                return AMP_TIMEOUT;
+            }
+        }
+    }
+}
+
+
+
+static int amp_internal_semaphore_wait_batch(amp_semaphore_t semaphore,
+                                             amp_semaphore_counter_t count)
+{
+    assert(0 < count);
+
+    int retval = AMP_SUCCESS;
+
+    /* Sequentially consistent with the signalers' update of the state and
+     * read of the batch waiter count - either the signaler sees this 
+     * waiter or the waiter sees the signaled units.
+     */
+    (void)amp_atomic_int32_fetch_add_explicit(&semaphore->batch_waiter_count,
+                                              1,
+                                              AMP_MEMORY_ORDER_SEQ_CST);
+
+    for (;;) {
+
+        int32_t const sequence = amp_atomic_int32_load_explicit(&semaphore->batch_wake_sequence,
+                                                                AMP_MEMORY_ORDER_SEQ_CST);
+        int64_t state = amp_atomic_int64_load_explicit(&semaphore->state,
+                                                       AMP_MEMORY_ORDER_SEQ_CST);
+        amp_bool_t taken = AMP_FALSE;
+
+        while ((AMP_FALSE == taken) && (count <= AMP_INTERNAL_SEMAPHORE_COUNT(state))) {
+            taken = amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                               &state,
+                                                               state - (int64_t)count,
+                                                               AMP_MEMORY_ORDER_ACQUIRE,
+                                                               AMP_MEMORY_ORDER_RELAXED);
+        }
+
+        if (AMP_TRUE == taken) {
+            break;
+        }
+
+        retval = amp_internal_futex_wait(&semaphore->batch_wake_sequence.value,
+                                         sequence);
+        if (AMP_SUCCESS != retval) {
+            assert(0); /* Programming error */
+            break;
+        }
+    }
+
+    (void)amp_atomic_int32_fetch_add_explicit(&semaphore->batch_waiter_count,
+                                              -1,
+                                              AMP_MEMORY_ORDER_RELAXED);
+
+    return retval;
+}
+
+
+
+int amp_raw_semaphore_init(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t init_count)
+{
+    assert(NULL != semaphore);
+    assert((amp_semaphore_counter_t)0 <= init_count);
+    assert(AMP_RAW_SEMAPHORE_COUNT_MAX >= (amp_raw_semaphore_counter_t)init_count);
+
+    if ((amp_semaphore_counter_t)0 > init_count
+        || AMP_RAW_SEMAPHORE_COUNT_MAX < (amp_raw_semaphore_counter_t)init_count) {
+
+        amp_atomic_int64_store_explicit(&semaphore->state,
+                                        0,
+                                        AMP_MEMORY_ORDER_RELAXED);
+
+        return AMP_ERROR;
+    }
+
+    amp_atomic_int64_store_explicit(&semaphore->state,
+                                    (int64_t)init_count,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&semaphore->batch_waiter_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&semaphore->batch_wake_sequence,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_raw_semaphore_finalize(amp_semaphore_t semaphore)
+{
+    assert(NULL != semaphore);
+
+    int64_t const state = amp_atomic_int64_load(&semaphore->state);
+    if ((0 != AMP_INTERNAL_SEMAPHORE_WAITERS(state))
+        || (0 != amp_atomic_int32_load(&semaphore->batch_waiter_count))) {
+        assert(0); /* Programming error */
+        return AMP_BUSY;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_semaphore_wait(amp_semaphore_t semaphore)
+{
+    assert(NULL != semaphore);
+
+    return amp_internal_semaphore_wait_until(semaphore,
+                                             AMP_INTERNAL_TIME_INFINITE_DEADLINE);
+}
+
+
+
+int amp_semaphore_signal(amp_semaphore_t semaphore)
+{
+    return amp_semaphore_signal_n(semaphore, 1);
+}
+
+
+
+int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                            uint64_t timeout_ns)
+{
+    assert(NULL != semaphore);
+
+    return amp_internal_semaphore_wait_until(semaphore,
+                                             amp_internal_time_deadline_ns(timeout_ns));
+}
+
+
+
+int amp_semaphore_trywait(amp_semaphore_t semaphore)
+{
+    assert(NULL != semaphore);
+
+    int64_t state = amp_atomic_int64_load_explicit(&semaphore->state,
+                                                   AMP_MEMORY_ORDER_RELAXED);
+    while (0 < AMP_INTERNAL_SEMAPHORE_COUNT(state)) {
+        if (AMP_TRUE == amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                                   &state,
+                                                                   state - 1,
+                                                                   AMP_MEMORY_ORDER_ACQUIRE,
+                                                                   AMP_MEMORY_ORDER_RELAXED)) {
+            return AMP_SUCCESS;
+        }
+    }
+
+    return AMP_BUSY;
+}
+
+
+
+int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+
+    if (0 >= count) {
+        assert(0 == count); /* Programming error */
+        return (0 == count) ? AMP_SUCCESS : AMP_ERROR;
+    }
+
+    int64_t state = amp_atomic_int64_load_explicit(&semaphore->state,
+                                                   AMP_MEMORY_ORDER_RELAXED);
+    do {
+        if (count > ((amp_semaphore_counter_t)AMP_RAW_SEMAPHORE_COUNT_MAX - AMP_INTERNAL_SEMAPHORE_COUNT(state))) {
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+        }
+    } while (AMP_TRUE != amp_atomic_int64_compare_exchange_explicit(&semaphore->state,
+                                                                    &state,
+                                                                    state + (int64_t)count,
+                                                                    AMP_MEMORY_ORDER_SEQ_CST,
+                                                                    AMP_MEMORY_ORDER_RELAXED));
+
+    int retval = AMP_SUCCESS;
+
+    if (0 != amp_atomic_int32_load_explicit(&semaphore->batch_waiter_count,
+                                            AMP_MEMORY_ORDER_SEQ_CST)) {
+        (void)amp_atomic_int32_fetch_add_explicit(&semaphore->batch_wake_sequence,
+                                                  1,
+                                                  AMP_MEMORY_ORDER_SEQ_CST);
+        retval = amp_internal_futex_wake(&semaphore->batch_wake_sequence.value,
+                                         INT32_MAX);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+
+    /* Only enter the kernel if threads registered to wait. */
+    int64_t const waiters = AMP_INTERNAL_SEMAPHORE_WAITERS(state);
+    if (0 == waiters) {
+        return retval;
+    }
+
+    int64_t const wake_count = (waiters < (int64_t)count) ? waiters : (int64_t)count;
+
+    return amp_internal_futex_wake(amp_internal_semaphore_count_address(semaphore),
+                                   (wake_count < (int64_t)INT32_MAX) ? (int32_t)wake_count : INT32_MAX);
+}
+
+
+
+int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                         amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+
+    if (0 >= count) {
+        assert(0 == count); /* Programming error */
+        return (0 == count) ? AMP_SUCCESS : AMP_ERROR;
+    }
+
+    if ((amp_raw_semaphore_counter_t)count > AMP_RAW_SEMAPHORE_COUNT_MAX) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+
+    return amp_internal_semaphore_wait_batch(semaphore,
+                                             count);
+}
+
+
@@ -87,6 +87,15 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
         (void)signal_retval;
     }
     
+    /* Opened by a signal for the same reason as above. */
+    semaphore->batch_gate = dispatch_semaphore_create(0l);
+    if (NULL == semaphore->batch_gate) {
+        dispatch_release(semaphore->semaphore);
+        
+        return AMP_NOMEM;
+    }
+    (void)dispatch_semaphore_signal(semaphore->batch_gate);
+    
     return AMP_SUCCESS;
 }
 
@@ -97,6 +106,7 @@ int amp_raw_semaphore_finalize(amp_semaphore_t semaphore)
     assert(NULL != semaphore);
     assert(NULL != semaphore->semaphore);
 
+    dispatch_release(semaphore->batch_gate);
     dispatch_release(semaphore->semaphore);
     
     return AMP_SUCCESS;
@@ -129,7 +139,29 @@ int amp_semaphore_signal(amp_semaphore_t semaphore)
     return AMP_SUCCESS;
 }
 
-int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
+int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                            uint64_t timeout_ns)
+{
+    assert(NULL != semaphore);
+    assert(NULL != semaphore->semaphore);
+    
+    /* dispatch_time measures on the monotonic mach absolute time clock.
+     * Timeouts beyond the int64_t range are as good as waiting forever.
+     */
+    dispatch_time_t const timeout = (timeout_ns > (uint64_t)INT64_MAX) ? DISPATCH_TIME_FOREVER : dispatch_time(DISPATCH_TIME_NOW, (int64_t)timeout_ns);
+    
+    long const retval = dispatch_semaphore_wait(semaphore->semaphore, timeout);
+    
+    if (0 != retval) {
+        return AMP_TIMEOUT;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_semaphore_trywait(amp_semaphore_t semaphore)
 {
     assert(NULL != semaphore);
     assert(NULL != semaphore->semaphore);
@@ -144,3 +176,57 @@ int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
     return return_code;
 }
 
+
+
+int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+    
+    if (0 > count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* dispatch semaphores have no batch signal. */
+    int return_code = AMP_SUCCESS;
+    while ((0 < count) && (AMP_SUCCESS == return_code)) {
+        return_code = amp_semaphore_signal(semaphore);
+        --count;
+    }
+    
+    return return_code;
+}
+
+
+
+int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                         amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+    
+    if (0 > count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* Dispatch semaphores are decremented one by one - only one batch 
+     * waiter at a time collects units so waiters never block each other 
+     * holding parts of their batches.
+     */
+    long retval = dispatch_semaphore_wait(semaphore->batch_gate, DISPATCH_TIME_FOREVER);
+    assert(0 == retval && "Timeout should not occur when waiting for DISPATCH_TIME_FOREVER.");
+    
+    int return_code = AMP_SUCCESS;
+    while ((0 < count) && (AMP_SUCCESS == return_code)) {
+        return_code = amp_semaphore_wait(semaphore);
+        --count;
+    }
+    
+    (void)dispatch_semaphore_signal(semaphore->batch_gate);
+    (void)retval;
+    
+    return return_code;
+}
+
+
@@ -39,6 +39,11 @@
  *             semaphores. Until then: take care.
  */
 
+/* sem_clockwait is a GNU extension. */
+#if !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
 #include "amp_semaphore.h"
 
 #include <assert.h>
@@ -50,6 +55,7 @@
 #include "amp_stddef.h"
 #include "amp_return_code.h"
 #include "amp_raw_semaphore.h"
+#include "amp_internal_time.h"
 
 
 
@@ -64,6 +70,65 @@
 
 
 
+/**
+ * Waits on sem and maps the error codes to amp return codes.
+ */
+static int amp_internal_sem_wait(sem_t* sem);
+
+/**
+ * Posts to sem and maps the error codes to amp return codes.
+ */
+static int amp_internal_sem_post(sem_t* sem);
+
+
+
+static int amp_internal_sem_wait(sem_t* sem)
+{
+    errno = 0;
+    int retval = sem_wait(sem);
+    int return_code = AMP_SUCCESS;
+    if(0 != retval) {        
+        switch (errno) {
+            case ENOSYS:
+                assert(0); /* Use another amp semaphore backend */
+                return_code = AMP_UNSUPPORTED;
+                break;
+            case EINTR: /* sem_wait interrupted by a signal */
+                return_code = AMP_ERROR;
+                break;
+            default: /* EINVAL, EDEADLK - programming error */
+                assert(0);
+                return_code = AMP_ERROR;
+        }
+    }
+    
+    return return_code;
+}
+
+
+
+static int amp_internal_sem_post(sem_t* sem)
+{
+    errno = 0;
+    int retval = sem_post(sem);    
+    int return_code = AMP_SUCCESS;
+    if(0 != retval) {        
+        switch (errno) {
+            case ENOSYS:
+                assert(0); /* Use another amp semaphore backend */
+                return_code = AMP_UNSUPPORTED;
+                break;
+            default:
+                assert(0); /* Programming error */
+                return_code = AMP_ERROR;
+        }
+    }
+    
+    return return_code;    
+}
+
+
+
 int amp_raw_semaphore_init(amp_semaphore_t semaphore,
                            amp_semaphore_counter_t init_count)
 {
@@ -78,7 +143,7 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
     }
     
     errno = 0;
-    int const retval = sem_init(&semaphore->semaphore, 
+    int retval = sem_init(&semaphore->semaphore, 
                                 0, /* Don't share semaphore between processes */
                                 (unsigned int)init_count);
     int return_code = AMP_SUCCESS;
@@ -97,6 +162,16 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
                 assert(0);
                 return_code = AMP_ERROR;
         }
+        
+        return return_code;
+    }
+    
+    if (0 != sem_init(&semaphore->batch_gate, 0, 1)) {
+        retval = sem_destroy(&semaphore->semaphore);
+        assert(0 == retval);
+        (void)retval;
+        
+        return AMP_ERROR;
     }
     
     return return_code;
@@ -121,6 +196,14 @@ int amp_raw_semaphore_finalize(amp_semaphore_t semaphore)
                 assert(0);
                 return_code = AMP_ERROR;
         }
+        
+        return return_code;
+    }
+    
+    retval = sem_destroy(&semaphore->batch_gate);
+    if (0 != retval) {
+        assert(0); /* Programming error */
+        return_code = AMP_ERROR;
     }
 
     return return_code;
@@ -132,18 +215,70 @@ int amp_semaphore_wait(amp_semaphore_t semaphore)
 {
     assert(NULL != semaphore);
     
+    return amp_internal_sem_wait(&semaphore->semaphore);
+}
+
+
+
+int amp_semaphore_signal(amp_semaphore_t semaphore)
+{
+    assert(NULL != semaphore);
+    
+    return amp_internal_sem_post(&semaphore->semaphore);
+}
+
+int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                            uint64_t timeout_ns)
+{
+    assert(NULL != semaphore);
+    
+    uint64_t const deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+    
+    struct timespec deadline;
+    amp_internal_time_to_timespec(deadline_ns, &deadline);
+    
+    int retval = 0;
+    do {
+        errno = 0;
+        retval = sem_clockwait(&semaphore->semaphore, 
+                               CLOCK_MONOTONIC, 
+                               &deadline);
+    } while ((0 != retval) && (EINTR == errno));
+    
+#else
+    
+    /* sem_timedwait only measures against the realtime clock which jumps 
+     * when the system time is adjusted - poll with exponential back-off 
+     * instead.
+     */
+    uint64_t backoff_ns = AMP_INTERNAL_TIME_MIN_BACKOFF_NS;
     errno = 0;
-    int retval = sem_wait(&semaphore->semaphore);
+    int retval = sem_trywait(&semaphore->semaphore);
+    while ((0 != retval) && ((EAGAIN == errno) || (EINTR == errno))) {
+        if (0 == amp_internal_time_remaining_ns(deadline_ns)) {
+            errno = ETIMEDOUT;
+            break;
+        }
+        
+        backoff_ns = amp_internal_time_backoff(deadline_ns, backoff_ns);
+        errno = 0;
+        retval = sem_trywait(&semaphore->semaphore);
+    }
+    
+#endif
+    
     int return_code = AMP_SUCCESS;
-    if(0 != retval) {        
+    if (0 != retval) {        
         switch (errno) {
+            case ETIMEDOUT:
+                return_code = AMP_TIMEOUT;
+                break;
             case ENOSYS:
                 assert(0); /* Use another amp semaphore backend */
                 return_code = AMP_UNSUPPORTED;
                 break;
-            case EINTR: /* sem_wait interrupted by a signal */
-                return_code = AMP_ERROR;
-                break;
             default: /* EINVAL, EDEADLK - programming error */
                 assert(0);
                 return_code = AMP_ERROR;
@@ -155,18 +290,17 @@ int amp_semaphore_wait(amp_semaphore_t semaphore)
 
 
 
-int amp_semaphore_signal(amp_semaphore_t semaphore)
+int amp_semaphore_trywait(amp_semaphore_t semaphore)
 {
     assert(NULL != semaphore);
-    
+	
     errno = 0;
-    int retval = sem_post(&semaphore->semaphore);    
+    int retval = sem_trywait(&semaphore->semaphore);    
     int return_code = AMP_SUCCESS;
     if(0 != retval) {        
         switch (errno) {
-            case ENOSYS:
-                assert(0); /* Use another amp semaphore backend */
-                return_code = AMP_UNSUPPORTED;
+            case EAGAIN: /* Semaphore was already locked */
+                return_code = AMP_BUSY;
                 break;
             default:
                 assert(0); /* Programming error */
@@ -177,24 +311,72 @@ int amp_semaphore_signal(amp_semaphore_t semaphore)
     return return_code;    
 }
 
-int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
+
+
+int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t count)
 {
     assert(NULL != semaphore);
-	
-    errno = 0;
-    int retval = sem_trywait(&semaphore->semaphore);    
+    
+    if (0 > count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* POSIX semaphores have no batch post. */
     int return_code = AMP_SUCCESS;
-    if(0 != retval) {        
-        switch (errno) {
-            case EAGAIN: /* Semaphore was already locked */
-                return_code = AMP_BUSY;
-                break;
-            default:
-                assert(0); /* Programming error */
-                return_code = AMP_ERROR;
+    while ((0 < count) && (AMP_SUCCESS == return_code)) {
+        return_code = amp_semaphore_signal(semaphore);
+        --count;
+    }
+    
+    return return_code;
+}
+
+
+
+int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                         amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+    
+    if (0 > count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* POSIX semaphores are decremented one by one - only one batch waiter
+     * at a time collects units so waiters never block each other holding
+     * parts of their batches.
+     */
+    int return_code = amp_internal_sem_wait(&semaphore->batch_gate);
+    if (AMP_SUCCESS != return_code) {
+        return return_code;
+    }
+    
+    amp_semaphore_counter_t taken = 0;
+    while ((taken < count) && (AMP_SUCCESS == return_code)) {
+        return_code = amp_internal_sem_wait(&semaphore->semaphore);
+        if (AMP_SUCCESS == return_code) {
+            ++taken;
         }
     }
     
-    return return_code;    
+    if (AMP_SUCCESS != return_code) {
+        /* Return the units of the incomplete batch. */
+        while (0 < taken) {
+            int const rc = amp_internal_sem_post(&semaphore->semaphore);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+            --taken;
+        }
+    }
+    
+    int const rc = amp_internal_sem_post(&semaphore->batch_gate);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    return return_code;
 }
 
+
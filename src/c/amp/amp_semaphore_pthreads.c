@@ -46,10 +46,11 @@
 #include "amp_stddef.h"
 #include "amp_return_code.h"
 #include "amp_raw_semaphore.h"
+#include "amp_internal_time.h"
 
 
 
-#if !defined(AMP_USE_PTHREADS) || defined(AMP_USE_POSIX_1003_1B_SEMAPHORES)
+#if !defined(AMP_USE_PTHREADS) || defined(AMP_USE_POSIX_1003_1B_SEMAPHORES) || defined(AMP_USE_FUTEX_SEMAPHORES)
 #   error Build configuration problem - this source file shouldn't be compiled.
 #endif
 
@@ -70,11 +71,13 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
          * doesn't check and react to the return code.
          */
         semaphore->count = 0;
+        semaphore->batch_waiter_count = 0;
         
         return AMP_ERROR;
     }
     
     semaphore->count = init_count;
+    semaphore->batch_waiter_count = 0;
     
     pthread_mutexattr_t mutex_attributes;
     int retval = pthread_mutexattr_init(&mutex_attributes);
@@ -125,7 +128,8 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
         return retval;
     }
     
-    retval = pthread_cond_init(&semaphore->a_thread_can_pass, NULL);
+    /* Measure timed waits against the monotonic clock. */
+    retval = amp_internal_time_cond_init(&semaphore->a_thread_can_pass);
     if (0 != retval) {
         switch (retval) {
             case ENOMEM:
@@ -212,7 +216,11 @@ int amp_semaphore_signal(amp_semaphore_t semaphore)
             ++(semaphore->count); 
             
             /* Could also signal after unlocking the mutex. Needs experimentation.*/
-            retval = pthread_cond_signal(&semaphore->a_thread_can_pass);
+            if (0 == semaphore->batch_waiter_count) {
+                retval = pthread_cond_signal(&semaphore->a_thread_can_pass);
+            } else {
+                retval = pthread_cond_broadcast(&semaphore->a_thread_can_pass);
+            }
             if (0 != retval) {
                 assert(0); /* Programming error */
                 retval = AMP_ERROR;
@@ -231,7 +239,46 @@ int amp_semaphore_signal(amp_semaphore_t semaphore)
 }
 
 
-int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
+int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                            uint64_t timeout_ns)
+{    
+    assert(NULL != semaphore);
+    
+    uint64_t const deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+    int retval = AMP_SUCCESS;
+    int const mlock_retval = pthread_mutex_lock(&semaphore->mutex);
+    if (0 != mlock_retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    {
+        while ((0 >= semaphore->count) && (0 == retval)) {
+            retval = amp_internal_time_cond_timedwait(&semaphore->a_thread_can_pass,
+                                                      &semaphore->mutex,
+                                                      deadline_ns);
+            assert((0 == retval) || (ETIMEDOUT == retval)); /* Programming error */
+        }
+        
+        if (0 < semaphore->count) {
+            /* A count that became available while timing out is taken. */
+            --(semaphore->count);
+            retval = AMP_SUCCESS;
+        } else if (ETIMEDOUT == retval) {
+            retval = AMP_TIMEOUT;
+        } else {
+            retval = AMP_ERROR;
+        }
+    }
+    int const munlock_retval = pthread_mutex_unlock(&semaphore->mutex);
+    assert(0 == munlock_retval);
+    (void)munlock_retval;
+    
+    return retval;
+}
+
+
+int amp_semaphore_trywait(amp_semaphore_t semaphore)
 {    
     assert(NULL != semaphore);
     
@@ -260,3 +307,102 @@ int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
     return retval;
 }
 
+
+
+int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+    
+    if (0 >= count) {
+        assert(0 == count); /* Programming error */
+        return (0 == count) ? AMP_SUCCESS : AMP_ERROR;
+    }
+    
+    int retval = AMP_SUCCESS;
+    
+    int const mlock_retval = pthread_mutex_lock(&semaphore->mutex);
+    if (0 != mlock_retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    {
+        if (count <= ((amp_semaphore_counter_t)AMP_RAW_SEMAPHORE_COUNT_MAX - semaphore->count)) {
+            semaphore->count += count;
+            
+            /* One broadcast instead of count signals - woken threads that 
+             * don't find a count left go back to sleep.
+             */
+            if ((1 == count) && (0 == semaphore->batch_waiter_count)) {
+                retval = pthread_cond_signal(&semaphore->a_thread_can_pass);
+            } else {
+                retval = pthread_cond_broadcast(&semaphore->a_thread_can_pass);
+            }
+            if (0 != retval) {
+                assert(0); /* Programming error */
+                retval = AMP_ERROR;
+            }
+            
+        } else {
+            assert(0); /* Programming error */
+            retval = AMP_ERROR;
+        }
+    }
+    int const munlock_retval = pthread_mutex_unlock(&semaphore->mutex);
+    assert(0 == munlock_retval);
+    (void)munlock_retval;
+    
+    return retval;
+}
+
+
+
+int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                         amp_semaphore_counter_t count)
+{
+    assert(NULL != semaphore);
+    
+    if (0 >= count) {
+        assert(0 == count); /* Programming error */
+        return (0 == count) ? AMP_SUCCESS : AMP_ERROR;
+    }
+    
+    if ((amp_raw_semaphore_counter_t)count > AMP_RAW_SEMAPHORE_COUNT_MAX) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    int retval = AMP_SUCCESS;
+    int const mlock_retval = pthread_mutex_lock(&semaphore->mutex);
+    if (0 != mlock_retval) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    {
+        /* Take the whole batch at once so waiting threads never hold parts
+         * of their batches and block each other.
+         */
+        ++(semaphore->batch_waiter_count);
+        
+        while ((semaphore->count < count) && (AMP_SUCCESS == retval)) {
+            retval = pthread_cond_wait(&semaphore->a_thread_can_pass, 
+                                       &semaphore->mutex);
+            assert(0 == retval); /* Programming error */
+        }
+        
+        --(semaphore->batch_waiter_count);
+        
+        if (AMP_SUCCESS == retval) {
+            semaphore->count -= count;
+        } else {
+            retval = AMP_ERROR;
+        }
+    }
+    int const munlock_retval = pthread_mutex_unlock(&semaphore->mutex);
+    assert(0 == munlock_retval);
+    (void)munlock_retval;
+    
+    return retval;
+}
+
+
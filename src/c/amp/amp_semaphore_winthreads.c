@@ -55,6 +55,7 @@
 #include "amp_stddef.h"
 #include "amp_return_code.h"
 #include "amp_raw_semaphore.h"
+#include "amp_internal_time.h"
 
 
 
@@ -98,6 +99,17 @@ int amp_raw_semaphore_init(amp_semaphore_t semaphore,
         }
     }
     
+    if (AMP_SUCCESS == retval) {
+        semaphore->batch_gate_handle = CreateSemaphore(NULL, 1, 1, NULL);
+        if (NULL == semaphore->batch_gate_handle) {
+            BOOL const close_retval = CloseHandle(semaphore->semaphore_handle);
+            assert(close_retval);
+            (void)close_retval;
+            
+            retval = AMP_ERROR;
+        }
+    }
+    
     return retval;
 }
 
@@ -119,6 +131,11 @@ int amp_raw_semaphore_finalize(amp_semaphore_t semaphore)
         retval = AMP_ERROR;
     }
     
+    if ( !CloseHandle(semaphore->batch_gate_handle)) {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
     return retval;
 }
 
@@ -167,14 +184,46 @@ int amp_semaphore_signal(amp_semaphore_t semaphore)
 }
 
 
-int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
+int amp_semaphore_timedwait(amp_semaphore_t semaphore,
+                            uint64_t timeout_ns)
 {
     int retval = AMP_SUCCESS;
+    uint64_t deadline_ns = 0;
+    DWORD wait_retval = 0;
+    
+    assert(NULL != semaphore);
+    
+    deadline_ns = amp_internal_time_deadline_ns(timeout_ns);
+    
+    /* Waits longer than INFINITE - 1 milliseconds are split up. */
+    do {
+        wait_retval = WaitForSingleObject(semaphore->semaphore_handle,
+                                          amp_internal_time_remaining_ms(deadline_ns));
+    } while ((WAIT_TIMEOUT == wait_retval) && (0 != amp_internal_time_remaining_ns(deadline_ns)));
+    
+    if (WAIT_TIMEOUT == wait_retval) {
+        retval = AMP_TIMEOUT;
+    } else if (WAIT_OBJECT_0 != wait_retval) {
+        
+        DWORD const last_error = GetLastError();
+        assert(0); /* Programming error */
+        
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+int amp_semaphore_trywait(amp_semaphore_t semaphore)
+{
+    int retval = AMP_SUCCESS;
+    DWORD return_code = 0;
+    
+    assert(NULL != semaphore);
+    
+    return_code = WaitForSingleObject(semaphore->semaphore_handle, 0);
     
-    //assert(NULL != semaphore); // TODO: Why is this line causing a compile error?
-	
-    DWORD return_code = WaitForSingleObject(semaphore->semaphore_handle, 0);
-	
     if (WAIT_TIMEOUT == return_code) {
         retval = AMP_BUSY; /* Semaphore was already locked */
     }
@@ -189,3 +238,73 @@ int amp_semaphore_trywait_PROPOSED(amp_semaphore_t semaphore)
     return retval;
 }
 
+
+
+int amp_semaphore_signal_n(amp_semaphore_t semaphore,
+                           amp_semaphore_counter_t count)
+{
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != semaphore);
+    
+    if (0 >= count) {
+        assert(0 == count); /* Programming error */
+        return (0 == count) ? AMP_SUCCESS : AMP_ERROR;
+    }
+    
+    if ((amp_semaphore_counter_t)AMP_RAW_SEMAPHORE_COUNT_MAX < count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* ReleaseSemaphore fails without changing the count if it would 
+     * exceed the maximum count.
+     */
+    if ( !ReleaseSemaphore(semaphore->semaphore_handle, (LONG)count, NULL)) {
+        
+        DWORD const last_error = GetLastError();
+        
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+int amp_semaphore_wait_n(amp_semaphore_t semaphore,
+                         amp_semaphore_counter_t count)
+{
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != semaphore);
+    
+    if (0 > count) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    /* Windows semaphores can only be decremented by one per wait - only one
+     * batch waiter at a time collects units so waiters never block each 
+     * other holding parts of their batches.
+     */
+    if (WAIT_OBJECT_0 != WaitForSingleObject(semaphore->batch_gate_handle,
+                                             INFINITE)) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    while ((0 < count) && (AMP_SUCCESS == retval)) {
+        retval = amp_semaphore_wait(semaphore);
+        --count;
+    }
+    
+    if ( !ReleaseSemaphore(semaphore->batch_gate_handle, 1, NULL)) {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of the single-producer/single-consumer ring buffer. The 
+ * ring and its slots are allocated in one cache line aligned block, the 
+ * semaphores of blocking mode rings separately.
+ *
+ * Positions grow monotonically and are masked to index the slots, the ring
+ * holds tail - head elements.
+ *
+ * A blocking side marks itself parked, fences, and checks the ring again
+ * before waiting on its semaphore. After a transfer the other side fences 
+ * and clears the parked mark via exchange, only the side clearing a set 
+ * mark signals. A parked side that finds the ring usable after marking 
+ * itself clears its own mark - if it has already been cleared the surplus
+ * semaphore signal causes one spurious wake-up which is handled by checking
+ * the ring again.
+ */
+
+#include "amp_spsc_ring.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_semaphore.h"
+
+
+
+/**
+ * The producer side and the consumer side each live on their own cache 
+ * line. The cached positions are only accessed by the owning side.
+ */
+struct amp_spsc_ring_s {
+    struct amp_raw_atomic_int64_s tail;
+    int64_t cached_head;
+    char producer_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s) - sizeof(int64_t)];
+    
+    struct amp_raw_atomic_int64_s head;
+    int64_t cached_tail;
+    char consumer_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s) - sizeof(int64_t)];
+    
+    struct amp_raw_atomic_int32_s producer_parked;
+    struct amp_raw_atomic_int32_s consumer_parked;
+    
+    void** slots;
+    int64_t mask;
+    amp_spsc_ring_mode_t mode;
+    
+    amp_semaphore_t not_full;
+    amp_semaphore_t not_empty;
+};
+
+
+
+/**
+ * Clears the parked mark of the other side and signals its semaphore if it
+ * has been set.
+ */
+static void amp_internal_spsc_ring_wake(struct amp_raw_atomic_int32_s* parked,
+                                        amp_semaphore_t semaphore);
+
+/**
+ * Marks the calling side as parked before checking the ring for the last
+ * time ahead of waiting.
+ */
+static void amp_internal_spsc_ring_park(struct amp_raw_atomic_int32_s* parked);
+
+/**
+ * Frees the semaphores (if created) and the memory of ring.
+ */
+static int amp_internal_spsc_ring_free(struct amp_spsc_ring_s* ring,
+                                       amp_allocator_t allocator);
+
+
+
+static void amp_internal_spsc_ring_wake(struct amp_raw_atomic_int32_s* parked,
+                                        amp_semaphore_t semaphore)
+{
+    /* Pairs with the fence in amp_internal_spsc_ring_park - either the 
+     * parking side sees the transfer or the mark is seen here.
+     */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    
+    if ((0 != amp_atomic_int32_load_explicit(parked, AMP_MEMORY_ORDER_RELAXED))
+        && (0 != amp_atomic_int32_exchange_explicit(parked, 0, AMP_MEMORY_ORDER_RELAXED))) {
+        
+        int const rc = amp_semaphore_signal(semaphore);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+    }
+}
+
+
+
+static void amp_internal_spsc_ring_park(struct amp_raw_atomic_int32_s* parked)
+{
+    amp_atomic_int32_store_explicit(parked, 1, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+}
+
+
+
+static int amp_internal_spsc_ring_free(struct amp_spsc_ring_s* ring,
+                                       amp_allocator_t allocator)
+{
+    int retval = AMP_SUCCESS;
+    
+    if (AMP_SEMAPHORE_UNINITIALIZED != ring->not_empty) {
+        retval = amp_semaphore_destroy(&ring->not_empty, allocator);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    if (AMP_SEMAPHORE_UNINITIALIZED != ring->not_full) {
+        retval = amp_semaphore_destroy(&ring->not_full, allocator);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    retval = AMP_ALIGNED_DEALLOC(allocator, ring);
+    if (AMP_SUCCESS != retval) {
+        assert(0); /* Programming error */
+        retval = AMP_ERROR;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_spsc_ring_create(amp_spsc_ring_t* ring,
+                         amp_allocator_t allocator,
+                         size_t capacity,
+                         amp_spsc_ring_mode_t mode)
+{
+    struct amp_spsc_ring_s* tmp_ring = NULL;
+    size_t const header_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*tmp_ring));
+    size_t slot_count = 1;
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != ring);
+    assert(NULL != allocator);
+    assert(0 < capacity);
+    assert((AMP_SPSC_RING_MODE_NONBLOCKING == mode) 
+           || (AMP_SPSC_RING_MODE_BLOCKING == mode));
+    
+    if ((0 == capacity)
+        || ((AMP_SPSC_RING_MODE_NONBLOCKING != mode) 
+            && (AMP_SPSC_RING_MODE_BLOCKING != mode))) {
+        return AMP_ERROR;
+    }
+    
+    /* Slots are indexed with a mask, therefore round up to a power of two. */
+    while (slot_count < capacity) {
+        if ((AMP_SIZE_MAX / 2) < slot_count) {
+            return AMP_NOMEM;
+        }
+        slot_count *= 2;
+    }
+    
+    if ((AMP_SIZE_MAX - header_size - AMP_CACHE_LINE_SIZE) / sizeof(void*) < slot_count) {
+        return AMP_NOMEM;
+    }
+    
+    tmp_ring = (struct amp_spsc_ring_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                         AMP_CACHE_LINE_SIZE,
+                                                         AMP_CACHE_LINE_ROUND_UP(header_size + slot_count * sizeof(void*)));
+    if (NULL == tmp_ring) {
+        return AMP_NOMEM;
+    }
+    
+    amp_atomic_int64_store_explicit(&tmp_ring->tail, 0, AMP_MEMORY_ORDER_RELAXED);
+    tmp_ring->cached_head = 0;
+    amp_atomic_int64_store_explicit(&tmp_ring->head, 0, AMP_MEMORY_ORDER_RELAXED);
+    tmp_ring->cached_tail = 0;
+    amp_atomic_int32_store_explicit(&tmp_ring->producer_parked, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&tmp_ring->consumer_parked, 0, AMP_MEMORY_ORDER_RELAXED);
+    tmp_ring->slots = (void**)((char*)tmp_ring + header_size);
+    tmp_ring->mask = (int64_t)(slot_count - 1);
+    tmp_ring->mode = mode;
+    tmp_ring->not_full = AMP_SEMAPHORE_UNINITIALIZED;
+    tmp_ring->not_empty = AMP_SEMAPHORE_UNINITIALIZED;
+    
+    if (AMP_SPSC_RING_MODE_BLOCKING == mode) {
+        retval = amp_semaphore_create(&tmp_ring->not_full, allocator, 0);
+        if (AMP_SUCCESS == retval) {
+            retval = amp_semaphore_create(&tmp_ring->not_empty, allocator, 0);
+        }
+        if (AMP_SUCCESS != retval) {
+            int const rc = amp_internal_spsc_ring_free(tmp_ring, allocator);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+            
+            return retval;
+        }
+    }
+    
+    *ring = tmp_ring;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_spsc_ring_destroy(amp_spsc_ring_t* ring,
+                          amp_allocator_t allocator)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != ring);
+    assert(NULL != *ring);
+    assert(NULL != allocator);
+    
+    retval = amp_internal_spsc_ring_free(*ring, allocator);
+    if (AMP_SUCCESS == retval) {
+        *ring = AMP_SPSC_RING_UNINITIALIZED;
+    }
+    
+    return retval;
+}
+
+
+
+void amp_spsc_ring_get_capacity(amp_spsc_ring_t ring,
+                                size_t* capacity)
+{
+    assert(NULL != ring);
+    assert(NULL != capacity);
+    
+    *capacity = (size_t)ring->mask + 1;
+}
+
+
+
+int amp_spsc_ring_try_push(amp_spsc_ring_t ring,
+                           void* element)
+{
+    size_t pushed_count = 0;
+    
+    return amp_spsc_ring_push_n(ring, &element, 1, &pushed_count);
+}
+
+
+
+int amp_spsc_ring_try_pop(amp_spsc_ring_t ring,
+                          void** element)
+{
+    size_t popped_count = 0;
+    
+    return amp_spsc_ring_pop_n(ring, element, 1, &popped_count);
+}
+
+
+
+int amp_spsc_ring_push_n(amp_spsc_ring_t ring,
+                         void* const* elements,
+                         size_t count,
+                         size_t* pushed_count)
+{
+    int64_t tail = 0;
+    int64_t free_count = 0;
+    int64_t i = 0;
+    
+    assert(NULL != ring);
+    assert((NULL != elements) || (0 == count));
+    assert(NULL != pushed_count);
+    
+    *pushed_count = 0;
+    
+    if (0 == count) {
+        return AMP_SUCCESS;
+    }
+    
+    tail = amp_atomic_int64_load_explicit(&ring->tail,
+                                          AMP_MEMORY_ORDER_RELAXED);
+    free_count = ring->mask + 1 - (tail - ring->cached_head);
+    
+    if ((uint64_t)free_count < (uint64_t)count) {
+        ring->cached_head = amp_atomic_int64_load_explicit(&ring->head,
+                                                           AMP_MEMORY_ORDER_ACQUIRE);
+        free_count = ring->mask + 1 - (tail - ring->cached_head);
+        
+        if (0 == free_count) {
+            return AMP_BUSY;
+        }
+    }
+    
+    if ((uint64_t)count < (uint64_t)free_count) {
+        free_count = (int64_t)count;
+    }
+    
+    for (i = 0; i < free_count; ++i) {
+        ring->slots[(tail + i) & ring->mask] = elements[i];
+    }
+    
+    amp_atomic_int64_store_explicit(&ring->tail,
+                                    tail + free_count,
+                                    AMP_MEMORY_ORDER_RELEASE);
+    
+    if (AMP_SPSC_RING_MODE_BLOCKING == ring->mode) {
+        amp_internal_spsc_ring_wake(&ring->consumer_parked,
+                                    ring->not_empty);
+    }
+    
+    *pushed_count = (size_t)free_count;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_spsc_ring_pop_n(amp_spsc_ring_t ring,
+                        void** elements,
+                        size_t max_count,
+                        size_t* popped_count)
+{
+    int64_t head = 0;
+    int64_t available_count = 0;
+    int64_t i = 0;
+    
+    assert(NULL != ring);
+    assert((NULL != elements) || (0 == max_count));
+    assert(NULL != popped_count);
+    
+    *popped_count = 0;
+    
+    if (0 == max_count) {
+        return AMP_SUCCESS;
+    }
+    
+    head = amp_atomic_int64_load_explicit(&ring->head,
+                                          AMP_MEMORY_ORDER_RELAXED);
+    available_count = ring->cached_tail - head;
+    
+    if ((uint64_t)available_count < (uint64_t)max_count) {
+        ring->cached_tail = amp_atomic_int64_load_explicit(&ring->tail,
+                                                           AMP_MEMORY_ORDER_ACQUIRE);
+        available_count = ring->cached_tail - head;
+        
+        if (0 == available_count) {
+            return AMP_BUSY;
+        }
+    }
+    
+    if ((uint64_t)max_count < (uint64_t)available_count) {
+        available_count = (int64_t)max_count;
+    }
+    
+    for (i = 0; i < available_count; ++i) {
+        elements[i] = ring->slots[(head + i) & ring->mask];
+    }
+    
+    amp_atomic_int64_store_explicit(&ring->head,
+                                    head + available_count,
+                                    AMP_MEMORY_ORDER_RELEASE);
+    
+    if (AMP_SPSC_RING_MODE_BLOCKING == ring->mode) {
+        amp_internal_spsc_ring_wake(&ring->producer_parked,
+                                    ring->not_full);
+    }
+    
+    *popped_count = (size_t)available_count;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_spsc_ring_push(amp_spsc_ring_t ring,
+                       void* element)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != ring);
+    assert(AMP_SPSC_RING_MODE_BLOCKING == ring->mode);
+    
+    if (AMP_SPSC_RING_MODE_BLOCKING != ring->mode) {
+        return AMP_ERROR;
+    }
+    
+    for (;;) {
+        retval = amp_spsc_ring_try_push(ring, element);
+        if (AMP_BUSY != retval) {
+            return retval;
+        }
+        
+        amp_internal_spsc_ring_park(&ring->producer_parked);
+        
+        retval = amp_spsc_ring_try_push(ring, element);
+        if (AMP_BUSY != retval) {
+            amp_atomic_int32_store_explicit(&ring->producer_parked,
+                                            0,
+                                            AMP_MEMORY_ORDER_RELAXED);
+            return retval;
+        }
+        
+        retval = amp_semaphore_wait(ring->not_full);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+}
+
+
+
+int amp_spsc_ring_pop(amp_spsc_ring_t ring,
+                      void** element)
+{
+    int retval = AMP_ERROR;
+    
+    assert(NULL != ring);
+    assert(AMP_SPSC_RING_MODE_BLOCKING == ring->mode);
+    
+    if (AMP_SPSC_RING_MODE_BLOCKING != ring->mode) {
+        return AMP_ERROR;
+    }
+    
+    for (;;) {
+        retval = amp_spsc_ring_try_pop(ring, element);
+        if (AMP_BUSY != retval) {
+            return retval;
+        }
+        
+        amp_internal_spsc_ring_park(&ring->consumer_parked);
+        
+        retval = amp_spsc_ring_try_pop(ring, element);
+        if (AMP_BUSY != retval) {
+            amp_atomic_int32_store_explicit(&ring->consumer_parked,
+                                            0,
+                                            AMP_MEMORY_ORDER_RELAXED);
+            return retval;
+        }
+        
+        retval = amp_semaphore_wait(ring->not_empty);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+}
+
+
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Wait-free single-producer/single-consumer ring buffer of pointers to hand
+ * elements over between exactly one producer and one consumer thread.
+ *
+ * The producer owns the tail position and the consumer the head position,
+ * both on their own cache line next to a cached copy of the other side's
+ * position. Only when the cached copy indicates a full or empty ring is the
+ * other side's position reloaded. push_n and pop_n transfer a batch of
+ * elements and publish it with a single release store.
+ *
+ * Rings created in blocking mode additionally offer blocking push and pop
+ * functions that park the calling thread on a semaphore while the ring is
+ * full or empty. Every transfer of a blocking mode ring checks if the other
+ * side is parked which costs a full memory fence, therefore rings are 
+ * created in non-blocking mode unless requested.
+ *
+ * Pushing an element happens-before popping it.
+ *
+ * Never pass an invalid, e.g. non-created ring to any of the functions 
+ * other than the create function. Never call the push functions from more 
+ * than one thread or the pop functions from more than one thread at a time.
+ */
+
+#ifndef AMP_amp_spsc_ring_H
+#define AMP_amp_spsc_ring_H
+
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+#define AMP_SPSC_RING_UNINITIALIZED NULL
+
+
+    /**
+     * Opaque ring type.
+     */
+    typedef struct amp_spsc_ring_s *amp_spsc_ring_t;
+    
+    
+    /**
+     * amp_nonblocking_spsc_ring_mode rings only offer the try, push_n, and
+     * pop_n functions.
+     *
+     * amp_blocking_spsc_ring_mode rings additionally offer amp_spsc_ring_push
+     * and amp_spsc_ring_pop.
+     */
+    enum amp_spsc_ring_mode {
+        amp_nonblocking_spsc_ring_mode = 0,
+        amp_blocking_spsc_ring_mode
+    };
+    
+    typedef enum amp_spsc_ring_mode amp_spsc_ring_mode_t;
+    
+#define AMP_SPSC_RING_MODE_NONBLOCKING (amp_nonblocking_spsc_ring_mode)
+#define AMP_SPSC_RING_MODE_BLOCKING (amp_blocking_spsc_ring_mode)
+    
+    
+    /**
+     * Creates a ring able to hold capacity elements, capacity is rounded up
+     * to the next power of two.
+     *
+     * If the creation fails the allocator is called to free the already
+     * allocated memory which must not result in an error or otherwise
+     * behavior is undefined.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     *         AMP_ERROR if capacity is 0, mode is invalid, or other system 
+     *         resources are insufficient.
+     */
+    int amp_spsc_ring_create(amp_spsc_ring_t* ring,
+                             amp_allocator_t allocator,
+                             size_t capacity,
+                             amp_spsc_ring_mode_t mode);
+    
+    /**
+     * Frees the ring with allocator. Elements still in the ring are 
+     * dropped, neither thread may use the ring anymore.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_BUSY might be returned if a thread is parked in the ring.
+     *         AMP_ERROR might be returned if the memory can't be freed.
+     */
+    int amp_spsc_ring_destroy(amp_spsc_ring_t* ring,
+                              amp_allocator_t allocator);
+    
+    /**
+     * Returns the capacity of the ring in capacity.
+     */
+    void amp_spsc_ring_get_capacity(amp_spsc_ring_t ring,
+                                    size_t* capacity);
+    
+    /**
+     * Appends element to the ring if it isn't full. Only call from the
+     * producer thread.
+     *
+     * @return AMP_SUCCESS if element has been pushed.
+     *         AMP_BUSY if the ring is full.
+     */
+    int amp_spsc_ring_try_push(amp_spsc_ring_t ring,
+                               void* element);
+    
+    /**
+     * Removes the oldest element from the ring and returns it in element if 
+     * the ring isn't empty. Only call from the consumer thread.
+     *
+     * @return AMP_SUCCESS if an element has been popped.
+     *         AMP_BUSY if the ring is empty, element isn't changed.
+     */
+    int amp_spsc_ring_try_pop(amp_spsc_ring_t ring,
+                              void** element);
+    
+    /**
+     * Appends as many of the count elements as fit into the ring in order
+     * and returns their number in pushed_count. Only call from the producer
+     * thread.
+     *
+     * @return AMP_SUCCESS if at least one element or if no element has been
+     *         requested to be pushed.
+     *         AMP_BUSY if the ring is full.
+     */
+    int amp_spsc_ring_push_n(amp_spsc_ring_t ring,
+                             void* const* elements,
+                             size_t count,
+                             size_t* pushed_count);
+    
+    /**
+     * Removes up to max_count of the oldest elements from the ring, stores 
+     * them in order in elements, and returns their number in popped_count.
+     * Only call from the consumer thread.
+     *
+     * @return AMP_SUCCESS if at least one element or if no element has been
+     *         requested to be popped.
+     *         AMP_BUSY if the ring is empty.
+     */
+    int amp_spsc_ring_pop_n(amp_spsc_ring_t ring,
+                            void** elements,
+                            size_t max_count,
+                            size_t* popped_count);
+    
+    /**
+     * Appends element to the ring, blocks while the ring is full. Only call
+     * from the producer thread of a blocking mode ring.
+     *
+     * @return AMP_SUCCESS if element has been pushed.
+     *         AMP_ERROR if the ring hasn't been created in blocking mode.
+     *         Error codes of amp_semaphore_wait.
+     */
+    int amp_spsc_ring_push(amp_spsc_ring_t ring,
+                           void* element);
+    
+    /**
+     * Removes the oldest element from the ring and returns it in element, 
+     * blocks while the ring is empty. Only call from the consumer thread of
+     * a blocking mode ring. Follow it with amp_spsc_ring_pop_n to drain the
+     * ring in batches.
+     *
+     * @return AMP_SUCCESS if an element has been popped.
+     *         AMP_ERROR if the ring hasn't been created in blocking mode.
+     *         Error codes of amp_semaphore_wait.
+     */
+    int amp_spsc_ring_pop(amp_spsc_ring_t ring,
+                          void** element);
+    
+    
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_spsc_ring_H */
@@ -77,6 +77,25 @@ extern "C" {
 #endif
 
 
+#if !defined(AMP_CACHE_LINE_SIZE)
+/**
+ * Assumed size in bytes of a cache line. Used to pad data that is written 
+ * by different threads to separate cache lines to prevent false sharing.
+ *
+ * Define AMP_CACHE_LINE_SIZE when building amp if the target platform uses
+ * another cache line size. Must be a power of two.
+ */
+#   define AMP_CACHE_LINE_SIZE 64
+#endif
+
+
+/**
+ * Rounds size up to a multiple of AMP_CACHE_LINE_SIZE, e.g. to allocate 
+ * data cache line aligned without sharing its last cache line.
+ */
+#define AMP_CACHE_LINE_ROUND_UP(size) ((((size) + (AMP_CACHE_LINE_SIZE - 1)) / AMP_CACHE_LINE_SIZE) * AMP_CACHE_LINE_SIZE)
+
+
 typedef AMP_BOOL amp_bool_t;
 typedef AMP_BYTE amp_byte_t;
     
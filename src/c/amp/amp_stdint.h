@@ -38,7 +38,8 @@
  * Assumes a C99 compatible C compiler, or MSVC, or a compiler whose c lib
  * contains the stdint header.
  *
- * Makes intptr_t,  and uintptr_t accessible to amp.
+ * Makes intptr_t, uintptr_t, int32_t, uint32_t, int64_t, and uint64_t 
+ * accessible to amp. The fixed width types are needed by amp_atomic.
  *
  * If C89 needs to be supported or a platform needs a better platform detection
  * and handling then poc ( http://github.com/bjoernknafla/poc ) can be used to 
@@ -57,6 +58,14 @@
 
 #if defined(_MSC_VER)
 #   include <stddef.h> /* MSVC defines intptr_t, uintptr_t in stddef.h */
+#   if (_MSC_VER >= 1600)
+#       include <stdint.h> /* Shipped with Visual Studio 2010 and later */
+#   else
+        typedef __int32 int32_t;
+        typedef unsigned __int32 uint32_t;
+        typedef __int64 int64_t;
+        typedef unsigned __int64 uint64_t;
+#   endif
 #elif defined(__GNUC__)
 #   include <stdint.h> /* C99 header with intptr_t, uintptr_t */
 #elif defined(__llvm__) && defined(__clang__)
@@ -53,6 +53,7 @@
 #include <stddef.h>
 
 #include <amp/amp_stdint.h>
+#include <amp/amp_stddef.h>
 #include <amp/amp_memory.h>
 
 
@@ -154,6 +155,165 @@ extern "C" {
      */
     int amp_thread_join_and_destroy(amp_thread_t* thread,
                                     amp_allocator_t allocator);
+    
+    
+    /**
+     * Maximal number of hardware threads (and exclusive upper bound of the 
+     * hardware thread os ids) a thread affinity can contain.
+     */
+#define AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY 1024
+    
+    /**
+     * Set of hardware threads a thread is allowed to run on. Hardware threads
+     * are identified by the os_id of struct amp_platform_hwthread_info_s.
+     *
+     * Treat the content as opaque and use the amp_thread_affinity functions.
+     */
+    struct amp_thread_affinity_s {
+        unsigned long hwthread_mask[AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY / (8 * sizeof(unsigned long))];
+    };
+    
+    /**
+     * Removes all hardware threads from affinity.
+     */
+    void amp_thread_affinity_clear(struct amp_thread_affinity_s* affinity);
+    
+    /**
+     * Adds the hardware thread hwthread_os_id to affinity.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_ERROR if hwthread_os_id isn't smaller than 
+     *         AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY.
+     */
+    int amp_thread_affinity_add(struct amp_thread_affinity_s* affinity,
+                                size_t hwthread_os_id);
+    
+    /**
+     * Returns AMP_TRUE if hwthread_os_id is contained in affinity.
+     */
+    amp_bool_t amp_thread_affinity_contains(struct amp_thread_affinity_s const* affinity,
+                                            size_t hwthread_os_id);
+    
+    /**
+     * Returns the number of hardware threads contained in affinity.
+     */
+    size_t amp_thread_affinity_count(struct amp_thread_affinity_s const* affinity);
+    
+    
+    /**
+     * Pins thread to the hardware threads contained in affinity - the
+     * operating system only schedules the thread on these hardware threads.
+     *
+     * Pinned threads don't migrate between cores and keep their caches warm
+     * but can't evade to idle cores if their hardware threads are busy.
+     *
+     * Launched threads are pinned immediately. Threads of a thread array
+     * that aren't launched yet store the affinity and are pinned when 
+     * launched - for them affinity might be NULL to not pin them.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_UNSUPPORTED if the backend can't pin threads or can't pin
+     *         to the hardware threads in affinity, e.g. Windows only supports
+     *         os ids smaller than 64, Pthreads only supports pinning on 
+     *         Linux. The thread isn't changed in this case.
+     *         AMP_ERROR if affinity is empty or NULL for a launched thread.
+     */
+    int amp_thread_configure_affinity(amp_thread_t thread,
+                                      struct amp_thread_affinity_s const* affinity);
+    
+    
+    /**
+     * Scheduling policies for threads created with attributes.
+     *
+     * amp_default_thread_scheduling_policy uses the time-sharing policy of
+     * the operating system. amp_fifo_thread_scheduling_policy and
+     * amp_round_robin_thread_scheduling_policy are the real-time policies
+     * SCHED_FIFO and SCHED_RR which preempt all time-sharing threads and 
+     * typically need special privileges.
+     */
+    enum amp_thread_scheduling_policy {
+        amp_default_thread_scheduling_policy = 0,
+        amp_fifo_thread_scheduling_policy,
+        amp_round_robin_thread_scheduling_policy
+    };
+    typedef enum amp_thread_scheduling_policy amp_thread_scheduling_policy_t;
+    
+#define AMP_THREAD_SCHEDULING_POLICY_DEFAULT (amp_default_thread_scheduling_policy)
+#define AMP_THREAD_SCHEDULING_POLICY_FIFO (amp_fifo_thread_scheduling_policy)
+#define AMP_THREAD_SCHEDULING_POLICY_ROUND_ROBIN (amp_round_robin_thread_scheduling_policy)
+    
+    /**
+     * Guard size value to use the platform default guard size.
+     */
+#define AMP_THREAD_DEFAULT_GUARD_SIZE (~(size_t)0)
+    
+    /**
+     * Capacity of a thread name including the terminating '\0'. Linux
+     * doesn't support longer names.
+     */
+#define AMP_THREAD_NAME_CAPACITY 16
+    
+    /**
+     * Attributes to create threads with. Initialize with 
+     * amp_thread_attributes_init and only change the fields of interest.
+     *
+     * stack_size of 0 uses the platform default stack size (e.g. 8 MB on 
+     * Linux). Other sizes are rounded up to the page size and the platform
+     * minimum. Small stacks allow to run many more threads as each thread
+     * reserves its whole stack in the address space.
+     *
+     * guard_size is the size of the inaccessible region guarding against
+     * stack overflows, AMP_THREAD_DEFAULT_GUARD_SIZE uses the platform
+     * default and 0 disables the guard region.
+     *
+     * priority is only used for real-time scheduling policies and must be
+     * in the range the platform supports for the policy (1 to 99 on Linux).
+     *
+     * name is a '\0' terminated name shown by debuggers and tools like top,
+     * an empty name keeps the platform default.
+     */
+    struct amp_thread_attributes_s {
+        size_t stack_size;
+        size_t guard_size;
+        amp_thread_scheduling_policy_t scheduling_policy;
+        int priority;
+        char name[AMP_THREAD_NAME_CAPACITY];
+    };
+    
+    /**
+     * Sets all attributes to the platform defaults.
+     */
+    void amp_thread_attributes_init(struct amp_thread_attributes_s* attributes);
+    
+    /**
+     * Copies name into the name of attributes.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_ERROR if name doesn't fit into AMP_THREAD_NAME_CAPACITY 
+     *         including its terminating '\0', attributes isn't changed in
+     *         this case.
+     */
+    int amp_thread_attributes_set_name(struct amp_thread_attributes_s* attributes,
+                                       char const* name);
+    
+    /**
+     * Like amp_thread_create_and_launch but creates the thread with 
+     * attributes. attributes might be NULL to use the platform defaults.
+     *
+     * @return AMP_SUCCESS on successful thread launch.
+     *         AMP_UNSUPPORTED if the backend doesn't support an attribute,
+     *         e.g. Windows doesn't support guard sizes and real-time 
+     *         scheduling policies and ignores thread names.
+     *         AMP_ERROR if the priority is out of range for the scheduling
+     *         policy, if the process lacks the privileges for the scheduling
+     *         policy, or if the system is lacking resources.
+     *         AMP_NOMEM if the system is lacking memory to create the thread.
+     */
+    int amp_thread_create_and_launch_with_attributes(amp_thread_t* thread,
+                                                     amp_allocator_t allocator,
+                                                     struct amp_thread_attributes_s const* attributes,
+                                                     void* func_context,
+                                                     amp_thread_func_t func);
 
     
     /**
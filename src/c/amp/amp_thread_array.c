@@ -40,36 +40,866 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "amp_stddef.h"
+#include "amp_stdint.h"
 #include "amp_return_code.h"
+#include "amp_platform.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_mutex.h"
+#include "amp_raw_mutex.h"
+#include "amp_condition_variable.h"
+#include "amp_raw_condition_variable.h"
 #include "amp_thread.h"
 #include "amp_raw_thread.h"
 #include "amp_internal_thread.h"
 
 
+
+/**
+ * Number of checks with a pause hint for a dispatched function before a
+ * parked thread blocks, or for finished threads before a waiting thread
+ * blocks.
+ */
+#define AMP_INTERNAL_THREAD_ARRAY_PARK_SPIN_COUNT 1024
+
+
+/**
+ * Per-thread record of a thread array. The user data comes first so it 
+ * starts on a cache line.
+ */
+struct amp_internal_thread_array_record_s {
+    union {
+        unsigned char bytes[AMP_THREAD_ARRAY_USER_DATA_SIZE];
+        void* pointer; /* Forces pointer alignment */
+        double real; /* Forces floating point alignment */
+    } user_data;
+    struct amp_raw_thread_s thread;
+    
+    /* Only used in the tree launch mode while the tree function replaces the
+     * thread function and context.
+     */
+    struct amp_thread_array_s* thread_array;
+    amp_thread_func_t func;
+    void* func_context;
+    int launch_retval; /* Result of the launch by the parent thread */
+    
+    /* Configured thread function and context while parked. */
+    amp_thread_func_t parked_func;
+    void* parked_func_context;
+};
+
+#define AMP_INTERNAL_THREAD_ARRAY_SLOT_SIZE (((sizeof(struct amp_internal_thread_array_record_s) + AMP_CACHE_LINE_SIZE - 1) / AMP_CACHE_LINE_SIZE) * AMP_CACHE_LINE_SIZE)
+
+/**
+ * Record padded to a multiple of the cache line size so threads working on
+ * their own record and user data don't false share with their neighbors.
+ */
+union amp_internal_thread_array_slot_u {
+    struct amp_internal_thread_array_record_s record;
+    char padding[AMP_INTERNAL_THREAD_ARRAY_SLOT_SIZE];
+};
+
+
 /** 
- * Internal opaque thread array data structure 
+ * Internal opaque thread array data structure, allocated cache line aligned.
+ * The cache line aligned slots follow the thread array in the same memory 
+ * block.
+ *
+ * Parked threads poll dispatch_generation and all of them decrement 
+ * pending_count after each dispatch - both get cache lines of their own so
+ * the polling isn't disturbed by the decrements and neither by accesses to
+ * the other fields.
  */
 struct amp_thread_array_s {
-    struct amp_raw_thread_s *threads;
+    /* Dispatching to parked threads. Only initialized while parked. 
+     * dispatch_func, dispatch_context, and shutdown_requested are written 
+     * before and read after dispatch_generation changes. ready_count is
+     * protected by dispatch_mutex.
+     */
+    struct amp_raw_atomic_int64_s dispatch_generation;
+    char dispatch_generation_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    struct amp_raw_atomic_int64_s pending_count;
+    char pending_count_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    
+    union amp_internal_thread_array_slot_u *slots;
     size_t thread_count;
     size_t joinable_count;
+    amp_thread_array_launch_mode_t launch_mode;
     /* struct amp_thread_array_context_s *context;*/
+    
+    struct amp_raw_mutex_s dispatch_mutex;
+    struct amp_raw_condition_variable_s dispatch_start;
+    struct amp_raw_condition_variable_s dispatch_done;
+    amp_thread_array_dispatch_func_t dispatch_func;
+    void* dispatch_context;
+    size_t ready_count;
+    amp_bool_t shutdown_requested;
+    amp_bool_t parked;
+    
+    /* Launch reports of the threads in the tree launch mode. Only 
+     * initialized while launch_all waits for them. resolved_count counts 
+     * the launched threads and the threads that won't be launched, 
+     * launched_count only the former, launch_retval keeps the first error.
+     * All three are protected by launch_mutex.
+     */
+    struct amp_raw_mutex_s launch_mutex;
+    struct amp_raw_condition_variable_s launch_done;
+    size_t resolved_count;
+    size_t launched_count;
+    int launch_retval;
+};
+
+
+/**
+ * Number of children each thread launches and joins in the tree launch 
+ * mode. Thread i is the parent of threads i * fan out + 1 to 
+ * i * fan out + fan out.
+ */
+#define AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT 2
+
+
+
+/**
+ * A hardware thread threads can be pinned to and its position in the 
+ * topology.
+ */
+struct amp_internal_thread_array_place_s {
+    size_t os_id;
+    size_t package_id;
+    size_t core_id;
+    size_t core_rank; /* Rank of the core inside its package */
+    size_t smt_rank; /* Rank of the hardware thread inside its core */
 };
 
 
 
+/**
+ * qsort comparison function ordering places by package, core, and os id.
+ */
+static int amp_internal_compare_places_compact(void const* lhs, 
+                                               void const* rhs);
+
+/**
+ * qsort comparison function ordering places by SMT rank, core rank, 
+ * package, and os id so consecutive places are on different packages and
+ * cores while possible.
+ */
+static int amp_internal_compare_places_scatter(void const* lhs, 
+                                               void const* rhs);
+
+/**
+ * Pins thread i of thread_array to the hardware thread of 
+ * places[i % place_count]. Checks all places before changing any thread.
+ */
+static int amp_internal_thread_array_pin(amp_thread_array_t thread_array,
+                                         struct amp_internal_thread_array_place_s const* places,
+                                         size_t place_count);
+
+/**
+ * Thread function of all threads in the tree launch mode. Launches the
+ * children of the thread, runs the user function, and joins with the 
+ * launched children. context is the slot of the thread.
+ */
+static void amp_internal_thread_array_tree_func(void* context);
+
+/**
+ * Number of threads in the subtree rooted at the thread with index in the
+ * tree launch mode, i.e. the thread and all its descendants.
+ */
+static size_t amp_internal_thread_array_subtree_size(size_t index,
+                                                     size_t thread_count);
+
+/**
+ * Records the result retval of launching the thread with index in the 
+ * tree launch mode and wakes the thread waiting in launch_all. A failed
+ * launch resolves the whole subtree of the thread as it never runs.
+ */
+static void amp_internal_thread_array_report_launch(amp_thread_array_t thread_array,
+                                                    size_t index,
+                                                    int retval);
+
+/**
+ * Launches the first thread in the tree launch mode and waits till the 
+ * launch of all threads has been reported.
+ */
+static int amp_internal_thread_array_launch_tree(amp_thread_array_t thread_array,
+                                                 size_t* joinable_thread_count);
+
+/**
+ * Joins with the first thread in the tree launch mode.
+ */
+static int amp_internal_thread_array_join_tree(amp_thread_array_t thread_array,
+                                               size_t* joinable_thread_count);
+
+/**
+ * Thread function of parked threads. Waits for dispatched functions and
+ * runs them until shutdown is requested. context is the slot of the thread.
+ */
+static void amp_internal_thread_array_park_func(void* context);
+
+/**
+ * Blocks till the dispatch generation differs from seen_generation and 
+ * returns the new generation.
+ */
+static int64_t amp_internal_thread_array_wait_for_dispatch(amp_thread_array_t thread_array,
+                                                           int64_t seen_generation);
+
+/**
+ * Wakes all threads waiting on dispatch_done, i.e. the thread launching
+ * or waiting on the parked threads. If is_launch_report is AMP_TRUE
+ * the ready count is incremented before waking.
+ */
+static void amp_internal_thread_array_signal_done(amp_thread_array_t thread_array,
+                                                  amp_bool_t is_launch_report);
+
+/**
+ * Requests all parked threads to leave the park, joins them, and finalizes
+ * the dispatch state.
+ */
+static int amp_internal_thread_array_join_parked(amp_thread_array_t thread_array,
+                                                 size_t* joinable_thread_count);
+
+/**
+ * Joins with the launched threads according to the launch mode.
+ */
+static int amp_internal_thread_array_join(amp_thread_array_t thread_array,
+                                          size_t* joinable_thread_count);
+
+/**
+ * Fills places with the hardware threads of the topology of platform in
+ * compact order and sets their core and SMT ranks.
+ */
+static int amp_internal_thread_array_collect_places(amp_platform_t platform,
+                                                    struct amp_internal_thread_array_place_s* places,
+                                                    size_t place_count);
+
+
+
+static int amp_internal_compare_places_compact(void const* lhs, 
+                                               void const* rhs)
+{
+    struct amp_internal_thread_array_place_s const* l = (struct amp_internal_thread_array_place_s const*)lhs;
+    struct amp_internal_thread_array_place_s const* r = (struct amp_internal_thread_array_place_s const*)rhs;
+    
+    if (l->package_id != r->package_id) {
+        return (l->package_id < r->package_id) ? -1 : 1;
+    }
+    if (l->core_id != r->core_id) {
+        return (l->core_id < r->core_id) ? -1 : 1;
+    }
+    if (l->os_id != r->os_id) {
+        return (l->os_id < r->os_id) ? -1 : 1;
+    }
+    
+    return 0;
+}
+
+
+
+static int amp_internal_compare_places_scatter(void const* lhs, 
+                                               void const* rhs)
+{
+    struct amp_internal_thread_array_place_s const* l = (struct amp_internal_thread_array_place_s const*)lhs;
+    struct amp_internal_thread_array_place_s const* r = (struct amp_internal_thread_array_place_s const*)rhs;
+    
+    if (l->smt_rank != r->smt_rank) {
+        return (l->smt_rank < r->smt_rank) ? -1 : 1;
+    }
+    if (l->core_rank != r->core_rank) {
+        return (l->core_rank < r->core_rank) ? -1 : 1;
+    }
+    if (l->package_id != r->package_id) {
+        return (l->package_id < r->package_id) ? -1 : 1;
+    }
+    if (l->os_id != r->os_id) {
+        return (l->os_id < r->os_id) ? -1 : 1;
+    }
+    
+    return 0;
+}
+
+
+
+static int amp_internal_thread_array_pin(amp_thread_array_t thread_array,
+                                         struct amp_internal_thread_array_place_s const* places,
+                                         size_t place_count)
+{
+    struct amp_thread_affinity_s affinity;
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(NULL != places);
+    assert(0 < place_count);
+    
+    for (i = 0; (i < place_count) && (AMP_SUCCESS == retval); ++i) {
+        amp_thread_affinity_clear(&affinity);
+        retval = amp_thread_affinity_add(&affinity, places[i].os_id);
+        if (AMP_SUCCESS == retval) {
+            retval = amp_internal_thread_check_affinity(&affinity);
+        }
+    }
+    
+    for (i = 0; (i < thread_array->thread_count) && (AMP_SUCCESS == retval); ++i) {
+        amp_thread_affinity_clear(&affinity);
+        retval = amp_thread_affinity_add(&affinity, places[i % place_count].os_id);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_configure_affinity(&thread_array->slots[i].record.thread,
+                                               &affinity);
+    }
+    
+    return retval;
+}
+
+
+
+static int amp_internal_thread_array_collect_places(amp_platform_t platform,
+                                                    struct amp_internal_thread_array_place_s* places,
+                                                    size_t place_count)
+{
+    struct amp_platform_hwthread_info_s info;
+    size_t i = 0;
+    
+    assert(NULL != platform);
+    assert(NULL != places);
+    
+    for (i = 0; i < place_count; ++i) {
+        int const retval = amp_platform_get_hwthread_info(platform, i, &info);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+        
+        places[i].os_id = info.os_id;
+        places[i].package_id = info.package_id;
+        places[i].core_id = info.core_id;
+        places[i].core_rank = 0;
+        places[i].smt_rank = 0;
+    }
+    
+    qsort(places, place_count, sizeof(*places), &amp_internal_compare_places_compact);
+    
+    for (i = 1; i < place_count; ++i) {
+        if (places[i].package_id != places[i - 1].package_id) {
+            /* First core of a package. */
+        } else if (places[i].core_id != places[i - 1].core_id) {
+            places[i].core_rank = places[i - 1].core_rank + 1;
+        } else {
+            places[i].core_rank = places[i - 1].core_rank;
+            places[i].smt_rank = places[i - 1].smt_rank + 1;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+static void amp_internal_thread_array_tree_func(void* context)
+{
+    union amp_internal_thread_array_slot_u* slot = (union amp_internal_thread_array_slot_u*)context;
+    struct amp_thread_array_s* thread_array = slot->record.thread_array;
+    union amp_internal_thread_array_slot_u* slots = thread_array->slots;
+    size_t const index = (size_t)(slot - slots);
+    size_t child_begin = 0;
+    size_t child_end = 0;
+    size_t i = 0;
+    
+    assert(index < thread_array->thread_count);
+    
+    /* Children of the last levels might not exist. */
+    child_begin = index * AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT + 1;
+    if ((index > (thread_array->thread_count - 1) / AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT)
+        || (child_begin >= thread_array->thread_count)) {
+        child_begin = thread_array->thread_count;
+    }
+    child_end = child_begin + AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT;
+    if (child_end > thread_array->thread_count) {
+        child_end = thread_array->thread_count;
+    }
+    
+    for (i = child_begin; i < child_end; ++i) {
+        slots[i].record.launch_retval = amp_internal_thread_launch_configured(&slots[i].record.thread);
+        
+        amp_internal_thread_array_report_launch(thread_array,
+                                                i,
+                                                slots[i].record.launch_retval);
+    }
+    
+    slot->record.func(slot->record.func_context);
+    
+    for (i = child_begin; i < child_end; ++i) {
+        if (AMP_SUCCESS == slots[i].record.launch_retval) {
+            int const rc = amp_raw_thread_join(&slots[i].record.thread);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+    }
+}
+
+
+
+static size_t amp_internal_thread_array_subtree_size(size_t index,
+                                                     size_t thread_count)
+{
+    size_t level_begin = index;
+    size_t level_end = index + 1;
+    size_t size = 0;
+    
+    while (level_begin < thread_count) {
+        if (level_end > thread_count) {
+            level_end = thread_count;
+        }
+        
+        size += level_end - level_begin;
+        
+        level_begin = level_begin * AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT + 1;
+        level_end = level_end * AMP_INTERNAL_THREAD_ARRAY_TREE_FAN_OUT + 1;
+    }
+    
+    return size;
+}
+
+
+
+static void amp_internal_thread_array_report_launch(amp_thread_array_t thread_array,
+                                                    size_t index,
+                                                    int retval)
+{
+    int rc = amp_mutex_lock(&thread_array->launch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    if (AMP_SUCCESS == retval) {
+        ++(thread_array->resolved_count);
+        ++(thread_array->launched_count);
+    } else {
+        thread_array->resolved_count += amp_internal_thread_array_subtree_size(index,
+                                                                               thread_array->thread_count);
+        
+        /* Parents are launched before their children so the first error 
+         * is the one of a thread that couldn't be launched.
+         */
+        if (AMP_SUCCESS == thread_array->launch_retval) {
+            thread_array->launch_retval = retval;
+        }
+    }
+    
+    if (thread_array->resolved_count == thread_array->thread_count) {
+        rc = amp_condition_variable_broadcast(&thread_array->launch_done);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    rc = amp_mutex_unlock(&thread_array->launch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+}
+
+
+
+static int amp_internal_thread_array_launch_tree(amp_thread_array_t thread_array,
+                                                 size_t* joinable_thread_count)
+{
+    union amp_internal_thread_array_slot_u* slots = NULL;
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    int rc = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(0 == thread_array->joinable_count);
+    
+    if (0 != thread_array->joinable_count) {
+        return AMP_BUSY;
+    }
+    
+    retval = amp_raw_mutex_init(&thread_array->launch_mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    retval = amp_raw_condition_variable_init(&thread_array->launch_done);
+    if (AMP_SUCCESS != retval) {
+        rc = amp_raw_mutex_finalize(&thread_array->launch_mutex);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    thread_array->resolved_count = 0;
+    thread_array->launched_count = 0;
+    thread_array->launch_retval = AMP_SUCCESS;
+    
+    slots = thread_array->slots;
+    
+    /* Threads that aren't launched by their parent keep the error code. */
+    for (i = 0; i < thread_array->thread_count; ++i) {
+        struct amp_internal_thread_array_record_s* record = &slots[i].record;
+        
+        assert(NULL != record->thread.func);
+        
+        record->thread_array = thread_array;
+        record->func = record->thread.func;
+        record->func_context = record->thread.func_context;
+        record->launch_retval = AMP_ERROR;
+        
+        record->thread.func = &amp_internal_thread_array_tree_func;
+        record->thread.func_context = &slots[i];
+    }
+    
+    slots[0].record.launch_retval = amp_internal_thread_launch_configured(&slots[0].record.thread);
+    amp_internal_thread_array_report_launch(thread_array,
+                                            0,
+                                            slots[0].record.launch_retval);
+    
+    /* Wait for the launch reports so the caller learns about failed 
+     * launches before it relies on all threads running.
+     */
+    rc = amp_mutex_lock(&thread_array->launch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    while (thread_array->resolved_count < thread_array->thread_count) {
+        rc = amp_condition_variable_wait(&thread_array->launch_done,
+                                         &thread_array->launch_mutex);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    retval = thread_array->launch_retval;
+    thread_array->joinable_count = thread_array->launched_count;
+    
+    rc = amp_mutex_unlock(&thread_array->launch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    rc = amp_raw_condition_variable_finalize(&thread_array->launch_done);
+    assert(AMP_SUCCESS == rc);
+    rc = amp_raw_mutex_finalize(&thread_array->launch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    if (0 == thread_array->joinable_count) {
+        for (i = 0; i < thread_array->thread_count; ++i) {
+            slots[i].record.thread.func = slots[i].record.func;
+            slots[i].record.thread.func_context = slots[i].record.func_context;
+        }
+    }
+    
+    if (NULL != joinable_thread_count) {
+        *joinable_thread_count = thread_array->joinable_count;
+    }
+    
+    return retval;
+}
+
+
+
+static int amp_internal_thread_array_join_tree(amp_thread_array_t thread_array,
+                                               size_t* joinable_thread_count)
+{
+    union amp_internal_thread_array_slot_u* slots = NULL;
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    
+    slots = thread_array->slots;
+    
+    if (0 != thread_array->joinable_count) {
+        
+        retval = amp_raw_thread_join(&slots[0].record.thread);
+        if (AMP_SUCCESS != retval) {
+            if (NULL != joinable_thread_count) {
+                *joinable_thread_count = thread_array->joinable_count;
+            }
+            return retval;
+        }
+        
+        for (i = 0; i < thread_array->thread_count; ++i) {
+            struct amp_internal_thread_array_record_s* record = &slots[i].record;
+            
+            record->thread.func = record->func;
+            record->thread.func_context = record->func_context;
+        }
+        
+        thread_array->joinable_count = 0;
+    }
+    
+    if (NULL != joinable_thread_count) {
+        *joinable_thread_count = thread_array->joinable_count;
+    }
+    
+    return retval;
+}
+
+
+
+static void amp_internal_thread_array_park_func(void* context)
+{
+    union amp_internal_thread_array_slot_u* slot = (union amp_internal_thread_array_slot_u*)context;
+    struct amp_thread_array_s* thread_array = slot->record.thread_array;
+    size_t const index = (size_t)(slot - thread_array->slots);
+    int64_t generation = 0;
+    
+    amp_internal_thread_array_signal_done(thread_array, AMP_TRUE);
+    
+    for (;;) {
+        generation = amp_internal_thread_array_wait_for_dispatch(thread_array,
+                                                                 generation);
+        
+        if (AMP_TRUE == thread_array->shutdown_requested) {
+            break;
+        }
+        
+        thread_array->dispatch_func(thread_array->dispatch_context,
+                                    index,
+                                    thread_array->thread_count);
+        
+        if (1 == amp_atomic_int64_fetch_add_explicit(&thread_array->pending_count,
+                                                     -1,
+                                                     AMP_MEMORY_ORDER_ACQ_REL)) {
+            amp_internal_thread_array_signal_done(thread_array, AMP_FALSE);
+        }
+    }
+}
+
+
+
+static int64_t amp_internal_thread_array_wait_for_dispatch(amp_thread_array_t thread_array,
+                                                           int64_t seen_generation)
+{
+    int64_t generation = seen_generation;
+    size_t spin_count = 0;
+    int rc = AMP_SUCCESS;
+    
+    for (spin_count = 0; spin_count < AMP_INTERNAL_THREAD_ARRAY_PARK_SPIN_COUNT; ++spin_count) {
+        generation = amp_atomic_int64_load_explicit(&thread_array->dispatch_generation,
+                                                    AMP_MEMORY_ORDER_ACQUIRE);
+        if (generation != seen_generation) {
+            return generation;
+        }
+        amp_atomic_spin_pause();
+    }
+    
+    rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    /* Dispatchers change the generation with the mutex locked. */
+    generation = amp_atomic_int64_load_explicit(&thread_array->dispatch_generation,
+                                                AMP_MEMORY_ORDER_ACQUIRE);
+    while (generation == seen_generation) {
+        rc = amp_condition_variable_wait(&thread_array->dispatch_start,
+                                         &thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        
+        generation = amp_atomic_int64_load_explicit(&thread_array->dispatch_generation,
+                                                    AMP_MEMORY_ORDER_ACQUIRE);
+    }
+    
+    rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    return generation;
+}
+
+
+
+static void amp_internal_thread_array_signal_done(amp_thread_array_t thread_array,
+                                                  amp_bool_t is_launch_report)
+{
+    int rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    if (AMP_TRUE == is_launch_report) {
+        ++(thread_array->ready_count);
+    }
+    
+    rc = amp_condition_variable_broadcast(&thread_array->dispatch_done);
+    assert(AMP_SUCCESS == rc);
+    
+    rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+}
+
+
+
+static int amp_internal_thread_array_join_parked(amp_thread_array_t thread_array,
+                                                 size_t* joinable_thread_count)
+{
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    int rc = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(AMP_TRUE == thread_array->parked);
+    
+    if (0 != thread_array->joinable_count) {
+        
+        rc = amp_thread_array_wait(thread_array);
+        assert(AMP_SUCCESS == rc);
+        
+        rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        
+        thread_array->shutdown_requested = AMP_TRUE;
+        (void)amp_atomic_int64_fetch_add_explicit(&thread_array->dispatch_generation,
+                                                  1,
+                                                  AMP_MEMORY_ORDER_RELEASE);
+        
+        rc = amp_condition_variable_broadcast(&thread_array->dispatch_start);
+        assert(AMP_SUCCESS == rc);
+        
+        rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        
+        retval = amp_internal_thread_array_join(thread_array,
+                                                joinable_thread_count);
+        if (0 != thread_array->joinable_count) {
+            return retval;
+        }
+    }
+    
+    for (i = 0; i < thread_array->thread_count; ++i) {
+        struct amp_internal_thread_array_record_s* record = &thread_array->slots[i].record;
+        
+        record->thread.func = record->parked_func;
+        record->thread.func_context = record->parked_func_context;
+    }
+    
+    rc = amp_raw_condition_variable_finalize(&thread_array->dispatch_done);
+    assert(AMP_SUCCESS == rc);
+    rc = amp_raw_condition_variable_finalize(&thread_array->dispatch_start);
+    assert(AMP_SUCCESS == rc);
+    rc = amp_raw_mutex_finalize(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    thread_array->parked = AMP_FALSE;
+    
+    if (NULL != joinable_thread_count) {
+        *joinable_thread_count = thread_array->joinable_count;
+    }
+    
+    return retval;
+}
+
+
+
+int amp_thread_array_configure_affinity(amp_thread_array_t thread_array,
+                                        amp_allocator_t allocator,
+                                        amp_platform_t platform,
+                                        amp_thread_array_affinity_policy_t policy,
+                                        size_t const* hwthread_os_ids,
+                                        size_t hwthread_os_id_count)
+{
+    struct amp_internal_thread_array_place_s* places = NULL;
+    size_t place_count = 0;
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(NULL != allocator);
+    assert(0 == thread_array->joinable_count);
+    
+    if (0 != thread_array->joinable_count) {
+        return AMP_BUSY;
+    }
+    
+    switch (policy) {
+        case amp_none_thread_array_affinity_policy:
+            for (i = 0; (i < thread_array->thread_count) && (AMP_SUCCESS == retval); ++i) {
+                retval = amp_thread_configure_affinity(&thread_array->slots[i].record.thread,
+                                                       NULL);
+            }
+            return retval;
+            
+        case amp_explicit_thread_array_affinity_policy:
+            if ((NULL == hwthread_os_ids) || (0 == hwthread_os_id_count)) {
+                assert(0); /* Programming error */
+                return AMP_ERROR;
+            }
+            place_count = hwthread_os_id_count;
+            break;
+            
+        case amp_compact_thread_array_affinity_policy:
+            /* Fallthrough */
+        case amp_scatter_thread_array_affinity_policy:
+            /* Fallthrough */
+        case amp_physical_core_thread_array_affinity_policy:
+            assert(NULL != platform);
+            retval = amp_platform_get_topology_hwthread_count(platform,
+                                                              &place_count);
+            if (AMP_SUCCESS != retval) {
+                return retval;
+            }
+            break;
+            
+        default:
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+    }
+    
+    places = (struct amp_internal_thread_array_place_s*)AMP_CALLOC(allocator,
+                                                                   place_count,
+                                                                   sizeof(*places));
+    if (NULL == places) {
+        return AMP_NOMEM;
+    }
+    
+    if (amp_explicit_thread_array_affinity_policy == policy) {
+        for (i = 0; i < place_count; ++i) {
+            places[i].os_id = hwthread_os_ids[i];
+        }
+    } else {
+        retval = amp_internal_thread_array_collect_places(platform,
+                                                          places,
+                                                          place_count);
+    }
+    
+    if (AMP_SUCCESS == retval) {
+        if (amp_scatter_thread_array_affinity_policy == policy) {
+            
+            qsort(places, place_count, sizeof(*places), &amp_internal_compare_places_scatter);
+            
+        } else if (amp_physical_core_thread_array_affinity_policy == policy) {
+            
+            /* Only keep the first hardware thread of each core. */
+            size_t core_count = 0;
+            for (i = 0; i < place_count; ++i) {
+                if (0 == places[i].smt_rank) {
+                    places[core_count] = places[i];
+                    ++core_count;
+                }
+            }
+            place_count = core_count;
+        }
+        
+        retval = amp_internal_thread_array_pin(thread_array,
+                                               places,
+                                               place_count);
+    }
+    
+    {
+        int const rc = AMP_DEALLOC(allocator, places);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+    }
+    
+    return retval;
+}
+
+
+
 int amp_thread_array_create(amp_thread_array_t* thread_array,
                             amp_allocator_t allocator,
                             size_t thread_count)
 {
-    /* TODO: @todo Decide if only to allocate one big area of memory to put
-     *             the group thread structs and the group itself into.
-     */
-    
     struct amp_thread_array_s* group = NULL;
-    struct amp_raw_thread_s* threads = NULL;
+    union amp_internal_thread_array_slot_u* slots = NULL;
+    size_t const group_size = AMP_CACHE_LINE_ROUND_UP(sizeof(*group));
     size_t i = 0;
 
     assert(NULL != thread_array);
@@ -83,35 +913,34 @@ int amp_thread_array_create(amp_thread_array_t* thread_array,
         return AMP_ERROR;
     }
     
-    *thread_array = NULL;
-    
-    group = (struct amp_thread_array_s *)AMP_ALLOC(allocator, sizeof(*group));
-    if (NULL == group) {
+    if (thread_count > (AMP_SIZE_MAX - group_size) / sizeof(*slots)) {
         return AMP_NOMEM;
     }
     
-    /* Allocate memory for the groups threads. */
-    threads = (struct amp_raw_thread_s*)AMP_CALLOC(allocator,
-                                                   thread_count,
-                                                   sizeof(*threads));
-    if (NULL == threads) {
-        int const rv = AMP_DEALLOC(allocator, group);
-        assert(AMP_SUCCESS == rv);
-        (void)rv;
-        
+    /* One block for the group and its cache line aligned slots. */
+    group = (struct amp_thread_array_s *)AMP_ALIGNED_ALLOC(allocator,
+                                                           AMP_CACHE_LINE_SIZE,
+                                                           group_size + thread_count * sizeof(*slots));
+    if (NULL == group) {
         return AMP_NOMEM;
     }
     
+    slots = (union amp_internal_thread_array_slot_u*)((char*)group + group_size);
+    
+    memset(slots, 0, thread_count * sizeof(*slots));
+    
     for (i = 0; i < thread_count; ++i) {
-        int const rv = amp_internal_thread_init_for_configuration(&threads[i]);
+        int const rv = amp_internal_thread_init_for_configuration(&slots[i].record.thread);
         assert(AMP_SUCCESS == rv);
         (void)rv;
     }
     
     
-    group->threads = threads;
+    group->slots = slots;
     group->thread_count = thread_count;
     group->joinable_count = (size_t)0;
+    group->launch_mode = amp_serial_thread_array_launch_mode;
+    group->parked = AMP_FALSE;
     
     *thread_array = group;
     
@@ -135,16 +964,12 @@ int amp_thread_array_destroy(amp_thread_array_t* thread_array,
         return AMP_BUSY;
     }
     
-    retval = AMP_DEALLOC(allocator, (*thread_array)->threads);
+    retval =  AMP_ALIGNED_DEALLOC(allocator, *thread_array);
     if (AMP_SUCCESS == retval) {
-        (*thread_array)->threads = NULL;
-        retval =  AMP_DEALLOC(allocator, *thread_array);
-        if (AMP_SUCCESS == retval) {
-            *thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
-        } else {
-            assert(0); /* Unable to deallocate - posibly bad dealloc_func */
-            retval = AMP_ERROR;
-        }
+        *thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+    } else {
+        assert(0); /* Unable to deallocate - posibly bad dealloc_func */
+        retval = AMP_ERROR;
     }
     
     return retval;
@@ -158,7 +983,7 @@ int amp_thread_array_configure_contexts(amp_thread_array_t thread_array,
                                         void* shared_context)
 {
     size_t thread_count = 0;
-    struct amp_raw_thread_s *threads = NULL;
+    union amp_internal_thread_array_slot_u *slots = NULL;
     size_t range_end = 0;
     size_t i = 0;
 
@@ -182,11 +1007,11 @@ int amp_thread_array_configure_contexts(amp_thread_array_t thread_array,
         return AMP_BUSY;
     }
     
-    threads = thread_array->threads;
+    slots = thread_array->slots;
     range_end = range_begin - 1 + range_length;
     
     for (i = range_begin; i <= range_end; ++i) {
-        int const errc = amp_internal_thread_configure_context(&threads[i],
+        int const errc = amp_internal_thread_configure_context(&slots[i].record.thread,
                                                                shared_context);
         if (AMP_SUCCESS != errc) {
             return errc;
@@ -204,7 +1029,7 @@ int amp_thread_array_configure_functions(amp_thread_array_t thread_array,
                                          amp_thread_func_t shared_function)
 {
     size_t thread_count = 0;
-    struct amp_raw_thread_s *threads = NULL;
+    union amp_internal_thread_array_slot_u *slots = NULL;
     size_t range_end = 0;
     size_t i = 0;
 
@@ -230,10 +1055,10 @@ int amp_thread_array_configure_functions(amp_thread_array_t thread_array,
         return AMP_BUSY;
     }
     
-    threads = thread_array->threads;
+    slots = thread_array->slots;
     range_end = range_begin - 1 + range_length;
     for (i = range_begin; i <= range_end; ++i) {
-        int const errc = amp_internal_thread_configure_function(&threads[i],
+        int const errc = amp_internal_thread_configure_function(&slots[i].record.thread,
                                                                 shared_function);
         if (AMP_SUCCESS != errc) {
             return errc;
@@ -252,7 +1077,7 @@ int amp_thread_array_configure(amp_thread_array_t thread_array,
                                amp_thread_func_t shared_function)
 {
     size_t thread_count = 0;
-    struct amp_raw_thread_s* threads = NULL;
+    union amp_internal_thread_array_slot_u* slots = NULL;
     size_t range_end = 0;
     size_t i = 0;
 
@@ -278,15 +1103,15 @@ int amp_thread_array_configure(amp_thread_array_t thread_array,
         return AMP_BUSY;
     }
     
-    threads = thread_array->threads;
+    slots = thread_array->slots;
     range_end = range_begin - 1 + range_length;
     for (i = range_begin; i <= range_end; ++i) {
         int errc0 = AMP_ERROR;
         int errc1 = AMP_ERROR;
         
-        errc0 = amp_internal_thread_configure_context(&threads[i],
+        errc0 = amp_internal_thread_configure_context(&slots[i].record.thread,
                                                       shared_context);
-        errc1 = amp_internal_thread_configure_function(&threads[i],
+        errc1 = amp_internal_thread_configure_function(&slots[i].record.thread,
                                                        shared_function);
         if (AMP_SUCCESS != errc0
             || AMP_SUCCESS != errc1) {
@@ -299,24 +1124,106 @@ int amp_thread_array_configure(amp_thread_array_t thread_array,
 }
 
 
+int amp_thread_array_configure_attributes(amp_thread_array_t thread_array,
+                                          size_t range_begin,
+                                          size_t range_length,
+                                          struct amp_thread_attributes_s const* shared_attributes)
+{
+    size_t thread_count = 0;
+    union amp_internal_thread_array_slot_u *slots = NULL;
+    size_t range_end = 0;
+    size_t i = 0;
+    
+    assert(NULL != thread_array);
+    assert(range_begin < thread_array->thread_count);
+    assert(range_length > 0);
+    assert(range_length <= thread_array->thread_count);
+    assert(range_begin <= thread_array->thread_count - range_length);
+    assert(0 == thread_array->joinable_count);
+    
+    thread_count = thread_array->thread_count;
+    
+    if (range_begin >= thread_count
+        || range_length <= 0
+        || range_length > thread_count
+        || range_begin > thread_count - range_length) {
+        
+        return AMP_ERROR;
+    }
+    if (0 != thread_array->joinable_count) {
+        return AMP_BUSY;
+    }
+    
+    if (NULL != shared_attributes) {
+        int const errc = amp_internal_thread_check_attributes(shared_attributes);
+        if (AMP_SUCCESS != errc) {
+            return errc;
+        }
+    }
+    
+    slots = thread_array->slots;
+    range_end = range_begin - 1 + range_length;
+    
+    for (i = range_begin; i <= range_end; ++i) {
+        int const errc = amp_internal_thread_configure_attributes(&slots[i].record.thread,
+                                                                  shared_attributes);
+        if (AMP_SUCCESS != errc) {
+            return errc;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_array_configure_launch_mode(amp_thread_array_t thread_array,
+                                           amp_thread_array_launch_mode_t mode)
+{
+    assert(NULL != thread_array);
+    assert(0 == thread_array->joinable_count);
+    
+    if (0 != thread_array->joinable_count) {
+        return AMP_BUSY;
+    }
+    
+    switch (mode) {
+        case amp_serial_thread_array_launch_mode:
+            /* Fallthrough */
+        case amp_tree_thread_array_launch_mode:
+            thread_array->launch_mode = mode;
+            return AMP_SUCCESS;
+        default:
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+    }
+}
+
+
+
 int amp_thread_array_launch_all(struct amp_thread_array_s *thread_array,
                                 size_t* joinable_thread_count)
 {
-    struct amp_raw_thread_s *threads = NULL;
+    union amp_internal_thread_array_slot_u *slots = NULL;
     size_t joinable_count = 0;
     size_t thread_count = 0;
     int retval = AMP_SUCCESS;
     
     assert(NULL != thread_array);
     
-    threads = thread_array->threads;
+    if (amp_tree_thread_array_launch_mode == thread_array->launch_mode) {
+        return amp_internal_thread_array_launch_tree(thread_array,
+                                                     joinable_thread_count);
+    }
+    
+    slots = thread_array->slots;
     joinable_count = thread_array->joinable_count;
     thread_count = thread_array->thread_count;
     
     while (   (joinable_count < thread_count)
            && (AMP_SUCCESS == retval)) {
         
-        retval = amp_internal_thread_launch_configured(&(threads[joinable_count]));
+        retval = amp_internal_thread_launch_configured(&slots[joinable_count].record.thread);
         
         if (AMP_SUCCESS != retval) {
             break;
@@ -335,24 +1242,29 @@ int amp_thread_array_launch_all(struct amp_thread_array_s *thread_array,
 }
 
 
-int amp_thread_array_join_all(struct amp_thread_array_s* thread_array,
-                              size_t* joinable_thread_count)
+static int amp_internal_thread_array_join(amp_thread_array_t thread_array,
+                                          size_t* joinable_thread_count)
 {
-    struct amp_raw_thread_s *threads = NULL;
+    union amp_internal_thread_array_slot_u *slots = NULL;
     size_t joinable_count = 0;
     size_t joined_count = 0;
     int retval = AMP_SUCCESS;
     
     assert(NULL != thread_array);
     
-    threads = thread_array->threads;
+    if (amp_tree_thread_array_launch_mode == thread_array->launch_mode) {
+        return amp_internal_thread_array_join_tree(thread_array,
+                                                   joinable_thread_count);
+    }
+    
+    slots = thread_array->slots;
     joinable_count = thread_array->joinable_count;
     joined_count = 0;
     while (   (joined_count < joinable_count)
            && (AMP_SUCCESS == retval)) {
         
         /* Launching from left to right, joining from right to left. */
-        retval = amp_raw_thread_join(&(threads[joinable_count - 1 - joined_count]));
+        retval = amp_raw_thread_join(&slots[joinable_count - 1 - joined_count].record.thread);
         
         if (AMP_SUCCESS != retval) {
             break;
@@ -373,6 +1285,218 @@ int amp_thread_array_join_all(struct amp_thread_array_s* thread_array,
 
 
 
+int amp_thread_array_join_all(struct amp_thread_array_s* thread_array,
+                              size_t* joinable_thread_count)
+{
+    assert(NULL != thread_array);
+    
+    if (AMP_TRUE == thread_array->parked) {
+        return amp_internal_thread_array_join_parked(thread_array,
+                                                     joinable_thread_count);
+    }
+    
+    return amp_internal_thread_array_join(thread_array,
+                                          joinable_thread_count);
+}
+
+
+
+int amp_thread_array_launch_parked(amp_thread_array_t thread_array)
+{
+    size_t i = 0;
+    int retval = AMP_SUCCESS;
+    int rc = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(0 == thread_array->joinable_count);
+    assert(AMP_FALSE == thread_array->parked);
+    
+    if ((0 != thread_array->joinable_count)
+        || (AMP_TRUE == thread_array->parked)) {
+        return AMP_BUSY;
+    }
+    
+    retval = amp_raw_mutex_init(&thread_array->dispatch_mutex);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    retval = amp_raw_condition_variable_init(&thread_array->dispatch_start);
+    if (AMP_SUCCESS != retval) {
+        rc = amp_raw_mutex_finalize(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    retval = amp_raw_condition_variable_init(&thread_array->dispatch_done);
+    if (AMP_SUCCESS != retval) {
+        rc = amp_raw_condition_variable_finalize(&thread_array->dispatch_start);
+        assert(AMP_SUCCESS == rc);
+        rc = amp_raw_mutex_finalize(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+        
+        return retval;
+    }
+    
+    amp_atomic_int64_store_explicit(&thread_array->dispatch_generation,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int64_store_explicit(&thread_array->pending_count,
+                                    0,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    thread_array->dispatch_func = NULL;
+    thread_array->dispatch_context = NULL;
+    thread_array->ready_count = 0;
+    thread_array->shutdown_requested = AMP_FALSE;
+    thread_array->parked = AMP_TRUE;
+    
+    for (i = 0; i < thread_array->thread_count; ++i) {
+        struct amp_internal_thread_array_record_s* record = &thread_array->slots[i].record;
+        
+        record->thread_array = thread_array;
+        record->parked_func = record->thread.func;
+        record->parked_func_context = record->thread.func_context;
+        record->thread.func = &amp_internal_thread_array_park_func;
+        record->thread.func_context = &thread_array->slots[i];
+    }
+    
+    retval = amp_thread_array_launch_all(thread_array, NULL);
+    
+    if (AMP_SUCCESS == retval) {
+        /* Wait till all threads are parked. */
+        rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+        
+        while (thread_array->ready_count < thread_array->thread_count) {
+            rc = amp_condition_variable_wait(&thread_array->dispatch_done,
+                                             &thread_array->dispatch_mutex);
+            assert(AMP_SUCCESS == rc);
+        }
+        
+        rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    if (AMP_SUCCESS != retval) {
+        /* Join with the launched threads. */
+        rc = amp_internal_thread_array_join_parked(thread_array, NULL);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    return retval;
+}
+
+
+
+int amp_thread_array_dispatch(amp_thread_array_t thread_array,
+                              amp_thread_array_dispatch_func_t func,
+                              void* context)
+{
+    int rc = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(NULL != func);
+    assert(AMP_TRUE == thread_array->parked);
+    
+    if ((NULL == func) || (AMP_TRUE != thread_array->parked)) {
+        return AMP_ERROR;
+    }
+    
+    if (0 != amp_atomic_int64_load_explicit(&thread_array->pending_count,
+                                            AMP_MEMORY_ORDER_ACQUIRE)) {
+        return AMP_BUSY;
+    }
+    
+    /* Parked threads read the function and context after they see the 
+     * generation change.
+     */
+    thread_array->dispatch_func = func;
+    thread_array->dispatch_context = context;
+    amp_atomic_int64_store_explicit(&thread_array->pending_count,
+                                    (int64_t)thread_array->thread_count,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    
+    rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    (void)amp_atomic_int64_fetch_add_explicit(&thread_array->dispatch_generation,
+                                              1,
+                                              AMP_MEMORY_ORDER_RELEASE);
+    
+    rc = amp_condition_variable_broadcast(&thread_array->dispatch_start);
+    assert(AMP_SUCCESS == rc);
+    
+    rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_array_wait(amp_thread_array_t thread_array)
+{
+    size_t spin_count = 0;
+    int rc = AMP_SUCCESS;
+    
+    assert(NULL != thread_array);
+    assert(AMP_TRUE == thread_array->parked);
+    
+    if (AMP_TRUE != thread_array->parked) {
+        return AMP_ERROR;
+    }
+    
+    for (spin_count = 0; spin_count < AMP_INTERNAL_THREAD_ARRAY_PARK_SPIN_COUNT; ++spin_count) {
+        if (0 == amp_atomic_int64_load_explicit(&thread_array->pending_count,
+                                                AMP_MEMORY_ORDER_ACQUIRE)) {
+            return AMP_SUCCESS;
+        }
+        amp_atomic_spin_pause();
+    }
+    
+    rc = amp_mutex_lock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    
+    /* The last finishing thread signals with the mutex locked. */
+    while (0 != amp_atomic_int64_load_explicit(&thread_array->pending_count,
+                                               AMP_MEMORY_ORDER_ACQUIRE)) {
+        rc = amp_condition_variable_wait(&thread_array->dispatch_done,
+                                         &thread_array->dispatch_mutex);
+        assert(AMP_SUCCESS == rc);
+    }
+    
+    rc = amp_mutex_unlock(&thread_array->dispatch_mutex);
+    assert(AMP_SUCCESS == rc);
+    (void)rc;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_array_get_user_data(amp_thread_array_t thread_array,
+                                   size_t thread_index,
+                                   void** user_data)
+{
+    assert(NULL != thread_array);
+    assert(NULL != user_data);
+    assert(thread_index < thread_array->thread_count);
+    
+    if (thread_index >= thread_array->thread_count) {
+        return AMP_ERROR;
+    }
+    
+    *user_data = thread_array->slots[thread_index].record.user_data.bytes;
+    
+    return AMP_SUCCESS;
+}
+
+
+
 int amp_thread_array_get_joinable_thread_count(amp_thread_array_t thread_array,
                                                size_t* joinable_thread_count)
 {
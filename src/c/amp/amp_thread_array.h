@@ -53,7 +53,9 @@
 
 #include <stddef.h>
 
+#include <amp/amp_stddef.h>
 #include <amp/amp_memory.h>
+#include <amp/amp_platform.h>
 #include <amp/amp_thread.h>
 
 
@@ -64,6 +66,11 @@ extern "C" {
     
 #define AMP_THREAD_ARRAY_UNINITIALIZED NULL
     
+    /**
+     * Size in bytes of the user data each thread of a thread array owns.
+     */
+#define AMP_THREAD_ARRAY_USER_DATA_SIZE AMP_CACHE_LINE_SIZE
+    
     /**
      * Opaque type representing an amp thread array.
      */
@@ -74,6 +81,11 @@ extern "C" {
      * Allocates memory and creates a thread array that needs to be configured
      * before launching it.
      *
+     * The thread array and the records of its threads are allocated in one
+     * memory block. Each record is padded to a multiple of 
+     * AMP_CACHE_LINE_SIZE so threads don't false share their records or
+     * their user data.
+     *
      * Behavior is undefined if thread_array represents an already 
      * (non-destroyed) created thread array.
      *
@@ -214,6 +226,124 @@ extern "C" {
                                    void* shared_context,
                                    amp_thread_func_t shared_function);
     
+    /**
+     * Sets the creation attributes of range_length thread array threads 
+     * starting at index range_begin to shared_attributes, e.g. to launch
+     * many worker threads with small stacks. Pass NULL to launch them with
+     * the platform defaults.
+     *
+     * The range rules of amp_thread_array_configure_contexts apply.
+     *
+     * Do not call after launching and before joining with a thread array.
+     *
+     * @return AMP_SUCCESS on successful configuration.
+     *         AMP_UNSUPPORTED if the backend doesn't support an attribute, the
+     *         thread array isn't changed in this case.
+     *         AMP_ERROR might be returned if the arguments or attributes are
+     *         invalid.
+     *         AMP_BUSY might be returned if the thread array is already 
+     *         launched.
+     */
+    int amp_thread_array_configure_attributes(amp_thread_array_t thread_array,
+                                              size_t range_begin,
+                                              size_t range_length,
+                                              struct amp_thread_attributes_s const* shared_attributes);
+    
+    
+    /**
+     * Placement of the threads of a thread array onto hardware threads.
+     */
+    enum amp_thread_array_affinity_policy {
+        amp_none_thread_array_affinity_policy = 0, /**< Threads aren't pinned */
+        amp_compact_thread_array_affinity_policy, /**< Fill the SMT siblings of a core, then the cores of a package, then the next package */
+        amp_scatter_thread_array_affinity_policy, /**< Alternate packages, then spread over the cores of each package, SMT siblings last */
+        amp_physical_core_thread_array_affinity_policy, /**< One thread per physical core, only the first SMT sibling is used */
+        amp_explicit_thread_array_affinity_policy /**< Thread i runs on the i-th hardware thread os id of a list */
+    };
+    
+    typedef enum amp_thread_array_affinity_policy amp_thread_array_affinity_policy_t;
+    
+#define AMP_THREAD_ARRAY_AFFINITY_POLICY_NONE (amp_none_thread_array_affinity_policy)
+#define AMP_THREAD_ARRAY_AFFINITY_POLICY_COMPACT (amp_compact_thread_array_affinity_policy)
+#define AMP_THREAD_ARRAY_AFFINITY_POLICY_SCATTER (amp_scatter_thread_array_affinity_policy)
+#define AMP_THREAD_ARRAY_AFFINITY_POLICY_PHYSICAL_CORE (amp_physical_core_thread_array_affinity_policy)
+#define AMP_THREAD_ARRAY_AFFINITY_POLICY_EXPLICIT (amp_explicit_thread_array_affinity_policy)
+    
+    
+    /**
+     * Pins each thread of thread_array to one hardware thread according to
+     * policy. The threads are pinned when they are launched.
+     *
+     * The compact, scatter, and physical core policies place the threads 
+     * using the package and core ids of the topology of platform. If there 
+     * are more threads than places the placement wraps around and threads
+     * share hardware threads.
+     *
+     * The explicit policy pins thread i to hwthread_os_ids[i % 
+     * hwthread_os_id_count], platform might be NULL. The other policies
+     * ignore hwthread_os_ids and hwthread_os_id_count.
+     *
+     * The none policy removes the pinning of all threads.
+     *
+     * allocator is used for temporary memory.
+     *
+     * Do not call after launching and before joining with a thread array.
+     *
+     * @return AMP_SUCCESS on successful configuration.
+     *         AMP_UNSUPPORTED if the topology of platform can't be queried or
+     *         if the backend can't pin threads. The thread array isn't changed
+     *         in this case.
+     *         AMP_NOMEM if the temporary memory can't be allocated.
+     *         AMP_ERROR might be returned if the arguments are invalid.
+     *         AMP_BUSY might be returned if the thread array is already 
+     *         launched.
+     */
+    int amp_thread_array_configure_affinity(amp_thread_array_t thread_array,
+                                            amp_allocator_t allocator,
+                                            amp_platform_t platform,
+                                            amp_thread_array_affinity_policy_t policy,
+                                            size_t const* hwthread_os_ids,
+                                            size_t hwthread_os_id_count);
+    
+    
+    /**
+     * How launch_all and join_all launch and join the threads of a thread
+     * array.
+     *
+     * amp_serial_thread_array_launch_mode launches all threads one after the
+     * other from the calling thread and joins them one after the other.
+     *
+     * amp_tree_thread_array_launch_mode only launches the first thread from
+     * the calling thread. Each launched thread launches its children in a
+     * tree of thread indices before running its function and joins with its
+     * children after its function returned, so launching and joining take
+     * time logarithmic in the number of threads. join_all only joins with 
+     * the first thread.
+     */
+    enum amp_thread_array_launch_mode {
+        amp_serial_thread_array_launch_mode = 0,
+        amp_tree_thread_array_launch_mode
+    };
+    
+    typedef enum amp_thread_array_launch_mode amp_thread_array_launch_mode_t;
+    
+#define AMP_THREAD_ARRAY_LAUNCH_MODE_SERIAL (amp_serial_thread_array_launch_mode)
+#define AMP_THREAD_ARRAY_LAUNCH_MODE_TREE (amp_tree_thread_array_launch_mode)
+    
+    /**
+     * Sets how launch_all and join_all launch and join the threads of 
+     * thread_array. Thread arrays are created with the serial launch mode.
+     *
+     * Do not call after launching and before joining with a thread array.
+     *
+     * @return AMP_SUCCESS on successful configuration.
+     *         AMP_ERROR might be returned if mode is invalid.
+     *         AMP_BUSY might be returned if the thread array is already 
+     *         launched.
+     */
+    int amp_thread_array_configure_launch_mode(amp_thread_array_t thread_array,
+                                               amp_thread_array_launch_mode_t mode);
+    
     
     /**
      * Launches the contained threads one after the other and stops if
@@ -255,10 +385,20 @@ extern "C" {
      * that the function should proceed or that it should shut down, e.g. if
      * not all necessary threads could have been launched.
      *
+     * In the tree launch mode only the first thread is launched by the
+     * calling thread which then waits till all threads reported their 
+     * launch. Threads that can't be launched by their parent thread don't
+     * run, neither do their children. The error of the first of them is
+     * returned and joinable_thread_count is set to the number of threads 
+     * that have been launched. Relaunching isn't possible in the tree 
+     * launch mode, join_all first.
+     *
      * @return AMP_SUCCESS on successful launch of all launcheable threads of
      *         the thread array.
      *         AMP_ERROR is returned if the system lacks the resources for 
      *         thread creation and launching.
+     *         AMP_BUSY if threads of the thread array are already launched
+     *         in the tree launch mode.
      *         Other error codes might be returned to signal 
      *         errors, too. These are programming errors and mustn't 
      *         occur in release code. When @em amp is compiled without NDEBUG
@@ -278,6 +418,12 @@ extern "C" {
      * joinable_thread_count isn't NULL the number of remaining un-joined
      * threads "left" from the non-joinable thread is returned in it.
      *
+     * In the tree launch mode only the first thread is joined which returns
+     * after all other threads have been joined. 
+     *
+     * Parked threads finish the last dispatched function, leave the park, 
+     * and are joined.
+     *
      * @return AMP_SUCCESS if all joinable threads have been joined with.
      *         Other error codes might be returned to signal 
      *         errors, too. These are programming errors and mustn't 
@@ -290,6 +436,83 @@ extern "C" {
                                   size_t* joinable_thread_count);
     
     
+    /**
+     * Function dispatched to all threads of a parked thread array. Each 
+     * thread calls it with the dispatched context, its index in the thread
+     * array, and the number of threads of the thread array.
+     */
+    typedef void (*amp_thread_array_dispatch_func_t)(void* context,
+                                                     size_t thread_index,
+                                                     size_t thread_count);
+    
+    /**
+     * Launches all threads of thread_array with the configured launch mode 
+     * and parks them so they can run many dispatched functions without 
+     * creating and joining operating system threads for each. The configured
+     * thread contexts and functions aren't used.
+     *
+     * Returns after all threads are parked. Use amp_thread_array_dispatch to
+     * wake them, amp_thread_array_wait to wait till they finished, and
+     * amp_thread_array_join_all to end and join with them.
+     *
+     * If not all threads could be launched the launched threads are joined
+     * before returning.
+     *
+     * @return AMP_SUCCESS if all threads have been launched and are parked.
+     *         AMP_ERROR or AMP_NOMEM if the system lacks the resources for 
+     *         thread creation, no thread is launched in this case.
+     *         AMP_BUSY might be returned if the thread array is already 
+     *         launched.
+     */
+    int amp_thread_array_launch_parked(amp_thread_array_t thread_array);
+    
+    /**
+     * Wakes the parked threads of thread_array to call func with context.
+     *
+     * Parked threads spin a bit before they block so dispatching in quick
+     * succession, e.g. once per frame, avoids the cost of waking blocked 
+     * threads.
+     *
+     * Do not call from the threads of thread_array.
+     *
+     * @return AMP_SUCCESS if func has been dispatched.
+     *         AMP_BUSY if the previously dispatched function hasn't finished
+     *         on all threads.
+     *         AMP_ERROR might be returned if thread_array isn't parked.
+     */
+    int amp_thread_array_dispatch(amp_thread_array_t thread_array,
+                                  amp_thread_array_dispatch_func_t func,
+                                  void* context);
+    
+    /**
+     * Blocks until all threads of the parked thread_array finished the last
+     * dispatched function. Returns immediately if nothing is dispatched.
+     *
+     * Do not call from the threads of thread_array.
+     *
+     * @return AMP_SUCCESS after all threads finished.
+     *         AMP_ERROR might be returned if thread_array isn't parked.
+     */
+    int amp_thread_array_wait(amp_thread_array_t thread_array);
+    
+    
+    /**
+     * Returns the AMP_THREAD_ARRAY_USER_DATA_SIZE bytes of user data of the
+     * thread at thread_index in user_data. The user data starts at a cache
+     * line boundary, doesn't share its cache line with the data of other 
+     * threads, is zeroed on creation, and lives as long as the thread array.
+     *
+     * Use it for thread local data like counters and pass it to the thread
+     * as its context.
+     *
+     * @return AMP_SUCCESS on success.
+     *         AMP_ERROR might be returned if thread_index is out of range.
+     */
+    int amp_thread_array_get_user_data(amp_thread_array_t thread_array,
+                                       size_t thread_index,
+                                       void** user_data);
+    
+    
     /**
      * Returns the number of joinable threads in the variable 
      * joinable_thread_count points to.
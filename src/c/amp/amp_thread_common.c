@@ -44,6 +44,7 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "amp_stddef.h"
 #include "amp_return_code.h"
@@ -61,6 +62,10 @@ int amp_internal_thread_init_for_configuration(amp_thread_t thread)
     thread->func_context = NULL;
     thread->reserved0 = 0;
     thread->reserved1 = 0;
+    amp_thread_affinity_clear(&thread->affinity);
+    thread->has_affinity = AMP_FALSE;
+    amp_thread_attributes_init(&thread->attributes);
+    thread->has_attributes = AMP_FALSE;
     thread->state = 0; /* Signal not initialized */
     
     retval = amp_internal_native_thread_set_invalid(&thread->native_thread_description);
@@ -153,6 +158,196 @@ int amp_internal_thread_function(amp_thread_t thread,
 
 
 
+#define AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD (8 * sizeof(unsigned long))
+#define AMP_INTERNAL_THREAD_AFFINITY_WORD_COUNT (AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY / AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD)
+
+
+
+void amp_thread_affinity_clear(struct amp_thread_affinity_s* affinity)
+{
+    size_t i = 0;
+    
+    assert(NULL != affinity);
+    
+    for (i = 0; i < AMP_INTERNAL_THREAD_AFFINITY_WORD_COUNT; ++i) {
+        affinity->hwthread_mask[i] = 0ul;
+    }
+}
+
+
+
+int amp_thread_affinity_add(struct amp_thread_affinity_s* affinity,
+                            size_t hwthread_os_id)
+{
+    assert(NULL != affinity);
+    
+    if (AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY <= hwthread_os_id) {
+        return AMP_ERROR;
+    }
+    
+    affinity->hwthread_mask[hwthread_os_id / AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD] |= 1ul << (hwthread_os_id % AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+amp_bool_t amp_thread_affinity_contains(struct amp_thread_affinity_s const* affinity,
+                                        size_t hwthread_os_id)
+{
+    assert(NULL != affinity);
+    
+    if (AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY <= hwthread_os_id) {
+        return AMP_FALSE;
+    }
+    
+    if (0ul != (affinity->hwthread_mask[hwthread_os_id / AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD] & (1ul << (hwthread_os_id % AMP_INTERNAL_THREAD_AFFINITY_BITS_PER_WORD)))) {
+        return AMP_TRUE;
+    }
+    
+    return AMP_FALSE;
+}
+
+
+
+size_t amp_thread_affinity_count(struct amp_thread_affinity_s const* affinity)
+{
+    size_t count = 0;
+    size_t i = 0;
+    
+    assert(NULL != affinity);
+    
+    for (i = 0; i < AMP_INTERNAL_THREAD_AFFINITY_WORD_COUNT; ++i) {
+        unsigned long word = affinity->hwthread_mask[i];
+        
+        while (0ul != word) {
+            word &= word - 1ul; /* Clear lowest set bit */
+            ++count;
+        }
+    }
+    
+    return count;
+}
+
+
+
+int amp_thread_configure_affinity(amp_thread_t thread,
+                                  struct amp_thread_affinity_s const* affinity)
+{
+    int retval = AMP_UNSUPPORTED;
+    
+    assert(NULL != thread);
+    
+    if (NULL == affinity) {
+        
+        if (amp_internal_thread_joinable_state == thread->state) {
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+        }
+        
+        thread->has_affinity = AMP_FALSE;
+        
+        return AMP_SUCCESS;
+    }
+    
+    if (0 == amp_thread_affinity_count(affinity)) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    retval = amp_internal_thread_check_affinity(affinity);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+    
+    if (amp_internal_thread_joinable_state == thread->state) {
+        
+        struct amp_thread_affinity_s const previous_affinity = thread->affinity;
+        amp_bool_t const previous_has_affinity = thread->has_affinity;
+        
+        thread->affinity = *affinity;
+        thread->has_affinity = AMP_TRUE;
+        
+        retval = amp_internal_thread_apply_affinity(thread);
+        if (AMP_SUCCESS != retval) {
+            thread->affinity = previous_affinity;
+            thread->has_affinity = previous_has_affinity;
+        }
+        
+        return retval;
+    }
+    
+    thread->affinity = *affinity;
+    thread->has_affinity = AMP_TRUE;
+    
+    return AMP_SUCCESS;
+}
+
+
+
+void amp_thread_attributes_init(struct amp_thread_attributes_s* attributes)
+{
+    assert(NULL != attributes);
+    
+    attributes->stack_size = 0;
+    attributes->guard_size = AMP_THREAD_DEFAULT_GUARD_SIZE;
+    attributes->scheduling_policy = amp_default_thread_scheduling_policy;
+    attributes->priority = 0;
+    memset(attributes->name, 0, sizeof(attributes->name));
+}
+
+
+
+int amp_thread_attributes_set_name(struct amp_thread_attributes_s* attributes,
+                                   char const* name)
+{
+    size_t length = 0;
+    
+    assert(NULL != attributes);
+    assert(NULL != name);
+    
+    length = strlen(name);
+    if (AMP_THREAD_NAME_CAPACITY <= length) {
+        return AMP_ERROR;
+    }
+    
+    memcpy(attributes->name, name, length + 1);
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_thread_configure_attributes(amp_thread_t thread,
+                                             struct amp_thread_attributes_s const* attributes)
+{
+    assert(NULL != thread);
+    assert(amp_internal_thread_joinable_state != thread->state);
+    
+    if (amp_internal_thread_joinable_state == thread->state) {
+        return AMP_BUSY;
+    }
+    
+    if (NULL == attributes) {
+        amp_thread_attributes_init(&thread->attributes);
+        thread->has_attributes = AMP_FALSE;
+        
+        return AMP_SUCCESS;
+    } else {
+        int const retval = amp_internal_thread_check_attributes(attributes);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
+    thread->attributes = *attributes;
+    thread->has_attributes = AMP_TRUE;
+    
+    return AMP_SUCCESS;
+}
+
+
+
 int amp_raw_thread_launch(amp_thread_t thread, 
                           void* func_context, 
                           amp_thread_func_t func)
@@ -187,6 +382,21 @@ int amp_thread_create_and_launch(amp_thread_t* thread,
                                  amp_allocator_t allocator,
                                  void* func_context,
                                  amp_thread_func_t func)
+{
+    return amp_thread_create_and_launch_with_attributes(thread,
+                                                        allocator,
+                                                        NULL,
+                                                        func_context,
+                                                        func);
+}
+
+
+
+int amp_thread_create_and_launch_with_attributes(amp_thread_t* thread,
+                                                 amp_allocator_t allocator,
+                                                 struct amp_thread_attributes_s const* attributes,
+                                                 void* func_context,
+                                                 amp_thread_func_t func)
 {
     int retval = AMP_UNSUPPORTED;
     amp_thread_t local_thread = AMP_THREAD_UNINITIALIZED;
@@ -197,6 +407,13 @@ int amp_thread_create_and_launch(amp_thread_t* thread,
     
     *thread = AMP_THREAD_UNINITIALIZED;
     
+    if (NULL != attributes) {
+        retval = amp_internal_thread_check_attributes(attributes);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+    }
+    
     local_thread = (amp_thread_t)AMP_ALLOC(allocator,
                                             sizeof(*local_thread));
     
@@ -204,9 +421,19 @@ int amp_thread_create_and_launch(amp_thread_t* thread,
         return AMP_NOMEM;
     }
     
-    retval = amp_raw_thread_launch(local_thread,
-                                   func_context,
-                                   func);
+    retval = amp_internal_thread_init_for_configuration(local_thread);
+    if (AMP_SUCCESS == retval) {
+        retval = amp_internal_thread_configure(local_thread,
+                                               func_context,
+                                               func);
+    }
+    if (AMP_SUCCESS == retval) {
+        retval = amp_internal_thread_configure_attributes(local_thread,
+                                                          attributes);
+    }
+    if (AMP_SUCCESS == retval) {
+        retval = amp_internal_thread_launch_configured(local_thread);
+    }
     
     if (AMP_SUCCESS == retval) {
         *thread = local_thread;
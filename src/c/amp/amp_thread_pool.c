@@ -0,0 +1,1034 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Implementation of amp thread pool.
+ *
+ * The worker deques follow the Chase-Lev work-stealing deque with a fixed
+ * capacity ring buffer as described in "Correct and Efficient Work-Stealing
+ * for Weak Memory Models" by Le, Pop, Cohen, and Zappa Nardelli. Thieves
+ * read a task slot before claiming it via compare-exchange on top and
+ * discard the read if the claim fails - the owner never overwrites a slot
+ * that can still be claimed as pushing fails for a full deque.
+ *
+ * Parking: an idle worker registers itself in sleeping_worker_count, then
+ * re-checks all queues and only waits on the wakeup semaphore if it still
+ * finds no work. Submitters push first, then check sleeping_worker_count
+ * and claim one sleeper to signal. Both sides separate their write and read
+ * by sequentially consistent operations so at least one of them sees the
+ * other.
+ */
+
+#include "amp_thread_pool.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "amp_stddef.h"
+#include "amp_stdint.h"
+#include "amp_return_code.h"
+#include "amp_memory.h"
+#include "amp_atomic.h"
+#include "amp_raw_atomic.h"
+#include "amp_thread.h"
+#include "amp_thread_array.h"
+#include "amp_thread_local_slot.h"
+#include "amp_mutex.h"
+#include "amp_condition_variable.h"
+#include "amp_semaphore.h"
+
+
+
+/**
+ * Number of unsuccessful searches for a task with a pause hint before an
+ * idle worker parks or a waiting thread blocks.
+ */
+#define AMP_INTERNAL_THREAD_POOL_IDLE_SPIN_COUNT 64
+
+/**
+ * Upper bound of queued tasks so the injection queue size fits into an
+ * int32_t.
+ */
+#define AMP_INTERNAL_THREAD_POOL_MAX_QUEUE_SIZE ((size_t)0x7fffffff)
+
+
+
+struct amp_internal_thread_pool_task_s {
+    amp_thread_pool_task_func_t func;
+    void* context;
+    amp_thread_pool_wait_group_t group;
+};
+
+
+/**
+ * Worker with its work-stealing deque. The owner end (bottom) and the thief
+ * end (top) live on different cache lines.
+ */
+struct amp_internal_thread_pool_worker_s {
+    struct amp_raw_atomic_int64_s bottom;
+    char bottom_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+    struct amp_raw_atomic_int64_s top;
+    char top_padding[AMP_CACHE_LINE_SIZE - sizeof(struct amp_raw_atomic_int64_s)];
+
+    struct amp_internal_thread_pool_task_s* tasks;
+    struct amp_thread_pool_s* pool;
+    uint32_t random_state;
+};
+
+
+struct amp_thread_pool_s {
+    struct amp_internal_thread_pool_worker_s* workers;
+    size_t worker_count;
+    int64_t deque_capacity;
+
+    /* Memory of all worker deques and of the injection queue. */
+    struct amp_internal_thread_pool_task_s* task_storage;
+
+    amp_thread_array_t threads;
+    amp_thread_local_slot_key_t worker_key;
+
+    amp_semaphore_t wakeup;
+    struct amp_raw_atomic_int32_s sleeping_worker_count;
+    struct amp_raw_atomic_int32_s shutdown_requested;
+    amp_bool_t shut_down;
+
+    /* Injection queue for tasks from outside the pool or from full deques.
+     * injection_size mirrors injection_count for checks without locking.
+     */
+    amp_mutex_t injection_mutex;
+    struct amp_internal_thread_pool_task_s* injection_tasks;
+    size_t injection_capacity;
+    size_t injection_head;
+    size_t injection_count;
+    struct amp_raw_atomic_int32_s injection_size;
+};
+
+
+struct amp_thread_pool_wait_group_s {
+    struct amp_raw_atomic_int32_s pending_count;
+    amp_mutex_t mutex;
+    amp_condition_variable_t all_done;
+};
+
+
+
+/**
+ * Pushes task onto the bottom of the deque of worker. Only call from the
+ * thread owning worker.
+ *
+ * Returns AMP_FALSE if the deque is full.
+ */
+static amp_bool_t amp_internal_thread_pool_deque_push(struct amp_internal_thread_pool_worker_s* worker,
+                                                      struct amp_internal_thread_pool_task_s const* task);
+
+/**
+ * Takes a task from the bottom of the deque of worker. Only call from the
+ * thread owning worker.
+ *
+ * Returns AMP_FALSE if the deque is empty.
+ */
+static amp_bool_t amp_internal_thread_pool_deque_take(struct amp_internal_thread_pool_worker_s* worker,
+                                                      struct amp_internal_thread_pool_task_s* task);
+
+/**
+ * Steals a task from the top of the deque of victim.
+ *
+ * Returns AMP_SUCCESS if a task was stolen, AMP_BUSY if another thread won
+ * the race for the task, and AMP_ERROR if the deque is empty.
+ */
+static int amp_internal_thread_pool_deque_steal(struct amp_internal_thread_pool_worker_s* victim,
+                                                struct amp_internal_thread_pool_task_s* task);
+
+/**
+ * Adds task to the injection queue. Returns AMP_FALSE if the queue is full.
+ */
+static amp_bool_t amp_internal_thread_pool_inject(struct amp_thread_pool_s* pool,
+                                                  struct amp_internal_thread_pool_task_s const* task);
+
+/**
+ * Removes the oldest task from the injection queue. Returns AMP_FALSE if the
+ * queue is empty.
+ */
+static amp_bool_t amp_internal_thread_pool_take_injected(struct amp_thread_pool_s* pool,
+                                                         struct amp_internal_thread_pool_task_s* task);
+
+/**
+ * Searches the own deque of worker (if worker isn't NULL), the injection
+ * queue, and the deques of all workers for a task.
+ *
+ * Returns AMP_FALSE if no task has been found.
+ */
+static amp_bool_t amp_internal_thread_pool_find_task(struct amp_thread_pool_s* pool,
+                                                     struct amp_internal_thread_pool_worker_s* worker,
+                                                     struct amp_internal_thread_pool_task_s* task);
+
+/**
+ * Returns AMP_TRUE if any queue of the pool might contain a task.
+ */
+static amp_bool_t amp_internal_thread_pool_has_queued_tasks(struct amp_thread_pool_s* pool);
+
+/**
+ * Calls the task function and marks the task as done in its wait group.
+ */
+static void amp_internal_thread_pool_execute(struct amp_internal_thread_pool_task_s const* task);
+
+/**
+ * Signals one parked worker if there is one.
+ */
+static void amp_internal_thread_pool_wake_one(struct amp_thread_pool_s* pool);
+
+/**
+ * Parks the calling worker until it is signaled or work is found while
+ * registering as a sleeper.
+ */
+static void amp_internal_thread_pool_park(struct amp_thread_pool_s* pool);
+
+/**
+ * Main loop of the worker threads.
+ */
+static void amp_internal_thread_pool_worker_func(void* context);
+
+/**
+ * Marks one task of group as done and wakes the waiting threads if it was
+ * the last one.
+ */
+static void amp_internal_thread_pool_wait_group_task_done(amp_thread_pool_wait_group_t group);
+
+/**
+ * Frees all resources of a partially or fully created pool that has no
+ * running workers.
+ */
+static void amp_internal_thread_pool_free(struct amp_thread_pool_s* pool,
+                                          amp_allocator_t allocator);
+
+
+
+static amp_bool_t amp_internal_thread_pool_deque_push(struct amp_internal_thread_pool_worker_s* worker,
+                                                      struct amp_internal_thread_pool_task_s const* task)
+{
+    int64_t const capacity = worker->pool->deque_capacity;
+    int64_t const bottom = amp_atomic_int64_load_explicit(&worker->bottom,
+                                                          AMP_MEMORY_ORDER_RELAXED);
+    int64_t const top = amp_atomic_int64_load_explicit(&worker->top,
+                                                       AMP_MEMORY_ORDER_ACQUIRE);
+
+    if (capacity <= (bottom - top)) {
+        return AMP_FALSE;
+    }
+
+    worker->tasks[bottom & (capacity - 1)] = *task;
+    amp_atomic_int64_store_explicit(&worker->bottom,
+                                    bottom + 1,
+                                    AMP_MEMORY_ORDER_RELEASE);
+
+    return AMP_TRUE;
+}
+
+
+
+static amp_bool_t amp_internal_thread_pool_deque_take(struct amp_internal_thread_pool_worker_s* worker,
+                                                      struct amp_internal_thread_pool_task_s* task)
+{
+    int64_t const capacity = worker->pool->deque_capacity;
+    int64_t const bottom = amp_atomic_int64_load_explicit(&worker->bottom,
+                                                          AMP_MEMORY_ORDER_RELAXED) - 1;
+    int64_t top = 0;
+    amp_bool_t found = AMP_FALSE;
+
+    amp_atomic_int64_store_explicit(&worker->bottom,
+                                    bottom,
+                                    AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    top = amp_atomic_int64_load_explicit(&worker->top,
+                                         AMP_MEMORY_ORDER_RELAXED);
+
+    if (top <= bottom) {
+        *task = worker->tasks[bottom & (capacity - 1)];
+        found = AMP_TRUE;
+
+        if (top == bottom) {
+            /* Last task - race thieves for it. */
+            if (AMP_FALSE == amp_atomic_int64_compare_exchange_explicit(&worker->top,
+                                                                         &top,
+                                                                         top + 1,
+                                                                         AMP_MEMORY_ORDER_SEQ_CST,
+                                                                         AMP_MEMORY_ORDER_RELAXED)) {
+                found = AMP_FALSE;
+            }
+            amp_atomic_int64_store_explicit(&worker->bottom,
+                                            bottom + 1,
+                                            AMP_MEMORY_ORDER_RELAXED);
+        }
+    } else {
+        amp_atomic_int64_store_explicit(&worker->bottom,
+                                        bottom + 1,
+                                        AMP_MEMORY_ORDER_RELAXED);
+    }
+
+    return found;
+}
+
+
+
+static int amp_internal_thread_pool_deque_steal(struct amp_internal_thread_pool_worker_s* victim,
+                                                struct amp_internal_thread_pool_task_s* task)
+{
+    int64_t const capacity = victim->pool->deque_capacity;
+    int64_t top = amp_atomic_int64_load_explicit(&victim->top,
+                                                 AMP_MEMORY_ORDER_ACQUIRE);
+    int64_t bottom = 0;
+
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    bottom = amp_atomic_int64_load_explicit(&victim->bottom,
+                                            AMP_MEMORY_ORDER_ACQUIRE);
+
+    if (top >= bottom) {
+        return AMP_ERROR;
+    }
+
+    *task = victim->tasks[top & (capacity - 1)];
+    if (AMP_FALSE == amp_atomic_int64_compare_exchange_explicit(&victim->top,
+                                                                 &top,
+                                                                 top + 1,
+                                                                 AMP_MEMORY_ORDER_SEQ_CST,
+                                                                 AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_BUSY;
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+static amp_bool_t amp_internal_thread_pool_inject(struct amp_thread_pool_s* pool,
+                                                  struct amp_internal_thread_pool_task_s const* task)
+{
+    amp_bool_t injected = AMP_FALSE;
+    int retval = amp_mutex_lock(pool->injection_mutex);
+    assert(AMP_SUCCESS == retval);
+    {
+        if (pool->injection_count < pool->injection_capacity) {
+            size_t const index = (pool->injection_head + pool->injection_count)
+                % pool->injection_capacity;
+            pool->injection_tasks[index] = *task;
+            ++(pool->injection_count);
+            amp_atomic_int32_store(&pool->injection_size,
+                                   (int32_t)pool->injection_count);
+            injected = AMP_TRUE;
+        }
+    }
+    retval = amp_mutex_unlock(pool->injection_mutex);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+
+    return injected;
+}
+
+
+
+static amp_bool_t amp_internal_thread_pool_take_injected(struct amp_thread_pool_s* pool,
+                                                         struct amp_internal_thread_pool_task_s* task)
+{
+    amp_bool_t taken = AMP_FALSE;
+    int retval = AMP_UNSUPPORTED;
+
+    if (0 == amp_atomic_int32_load_explicit(&pool->injection_size,
+                                            AMP_MEMORY_ORDER_RELAXED)) {
+        return AMP_FALSE;
+    }
+
+    retval = amp_mutex_lock(pool->injection_mutex);
+    assert(AMP_SUCCESS == retval);
+    {
+        if (0 < pool->injection_count) {
+            *task = pool->injection_tasks[pool->injection_head];
+            pool->injection_head = (pool->injection_head + 1) % pool->injection_capacity;
+            --(pool->injection_count);
+            amp_atomic_int32_store(&pool->injection_size,
+                                   (int32_t)pool->injection_count);
+            taken = AMP_TRUE;
+        }
+    }
+    retval = amp_mutex_unlock(pool->injection_mutex);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+
+    return taken;
+}
+
+
+
+static amp_bool_t amp_internal_thread_pool_find_task(struct amp_thread_pool_s* pool,
+                                                     struct amp_internal_thread_pool_worker_s* worker,
+                                                     struct amp_internal_thread_pool_task_s* task)
+{
+    size_t first_victim = 0;
+    size_t i = 0;
+    amp_bool_t lost_race = AMP_FALSE;
+
+    if ((NULL != worker)
+        && (AMP_TRUE == amp_internal_thread_pool_deque_take(worker, task))) {
+        return AMP_TRUE;
+    }
+
+    if (AMP_TRUE == amp_internal_thread_pool_take_injected(pool, task)) {
+        return AMP_TRUE;
+    }
+
+    if (NULL != worker) {
+        /* xorshift32 to spread thieves over the victims. */
+        uint32_t random = worker->random_state;
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        worker->random_state = random;
+
+        first_victim = (size_t)random % pool->worker_count;
+    }
+
+    do {
+        lost_race = AMP_FALSE;
+
+        for (i = 0; i < pool->worker_count; ++i) {
+            struct amp_internal_thread_pool_worker_s* victim =
+                &pool->workers[(first_victim + i) % pool->worker_count];
+            int retval = AMP_UNSUPPORTED;
+
+            if (victim == worker) {
+                continue;
+            }
+
+            retval = amp_internal_thread_pool_deque_steal(victim, task);
+            if (AMP_SUCCESS == retval) {
+                return AMP_TRUE;
+            } else if (AMP_BUSY == retval) {
+                lost_race = AMP_TRUE;
+            }
+        }
+    } while (AMP_TRUE == lost_race);
+
+    return AMP_FALSE;
+}
+
+
+
+static amp_bool_t amp_internal_thread_pool_has_queued_tasks(struct amp_thread_pool_s* pool)
+{
+    size_t i = 0;
+
+    if (0 != amp_atomic_int32_load(&pool->injection_size)) {
+        return AMP_TRUE;
+    }
+
+    for (i = 0; i < pool->worker_count; ++i) {
+        int64_t const top = amp_atomic_int64_load(&pool->workers[i].top);
+        int64_t const bottom = amp_atomic_int64_load(&pool->workers[i].bottom);
+
+        if (top < bottom) {
+            return AMP_TRUE;
+        }
+    }
+
+    return AMP_FALSE;
+}
+
+
+
+static void amp_internal_thread_pool_execute(struct amp_internal_thread_pool_task_s const* task)
+{
+    task->func(task->context);
+
+    if (NULL != task->group) {
+        amp_internal_thread_pool_wait_group_task_done(task->group);
+    }
+}
+
+
+
+static void amp_internal_thread_pool_wake_one(struct amp_thread_pool_s* pool)
+{
+    int32_t sleeping_count = 0;
+
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+    sleeping_count = amp_atomic_int32_load(&pool->sleeping_worker_count);
+
+    while (0 < sleeping_count) {
+        if (AMP_TRUE == amp_atomic_int32_compare_exchange(&pool->sleeping_worker_count,
+                                                          &sleeping_count,
+                                                          sleeping_count - 1)) {
+            int const retval = amp_semaphore_signal(pool->wakeup);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+
+            return;
+        }
+    }
+}
+
+
+
+static void amp_internal_thread_pool_park(struct amp_thread_pool_s* pool)
+{
+    int retval = AMP_UNSUPPORTED;
+    int32_t sleeping_count = 0;
+
+    (void)amp_atomic_int32_fetch_add(&pool->sleeping_worker_count, 1);
+
+    if ((AMP_FALSE == amp_internal_thread_pool_has_queued_tasks(pool))
+        && (0 == amp_atomic_int32_load(&pool->shutdown_requested))) {
+
+        retval = amp_semaphore_wait(pool->wakeup);
+        assert(AMP_SUCCESS == retval);
+        (void)retval;
+
+        return;
+    }
+
+    /* Work arrived while registering - unregister. If a submitter already
+     * claimed this worker as a sleeper its signal must be consumed.
+     */
+    sleeping_count = amp_atomic_int32_load(&pool->sleeping_worker_count);
+    while (0 < sleeping_count) {
+        if (AMP_TRUE == amp_atomic_int32_compare_exchange(&pool->sleeping_worker_count,
+                                                          &sleeping_count,
+                                                          sleeping_count - 1)) {
+            return;
+        }
+    }
+
+    retval = amp_semaphore_wait(pool->wakeup);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+}
+
+
+
+static void amp_internal_thread_pool_worker_func(void* context)
+{
+    struct amp_internal_thread_pool_worker_s* worker =
+        (struct amp_internal_thread_pool_worker_s*)context;
+    struct amp_thread_pool_s* pool = worker->pool;
+    struct amp_internal_thread_pool_task_s task;
+    unsigned int idle_count = 0;
+
+    int const retval = amp_thread_local_slot_set_value(pool->worker_key, worker);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+
+    for (;;) {
+        if (AMP_TRUE == amp_internal_thread_pool_find_task(pool, worker, &task)) {
+            amp_internal_thread_pool_execute(&task);
+            idle_count = 0;
+            continue;
+        }
+
+        if (0 != amp_atomic_int32_load(&pool->shutdown_requested)) {
+            break;
+        }
+
+        if (idle_count < AMP_INTERNAL_THREAD_POOL_IDLE_SPIN_COUNT) {
+            ++idle_count;
+            amp_atomic_spin_pause();
+        } else {
+            amp_internal_thread_pool_park(pool);
+            idle_count = 0;
+        }
+    }
+}
+
+
+
+static void amp_internal_thread_pool_wait_group_task_done(amp_thread_pool_wait_group_t group)
+{
+    int retval = AMP_UNSUPPORTED;
+    int32_t pending_count = amp_atomic_int32_load_explicit(&group->pending_count,
+                                                           AMP_MEMORY_ORDER_RELAXED);
+
+    while (1 < pending_count) {
+        if (AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&group->pending_count,
+                                                                   &pending_count,
+                                                                   pending_count - 1,
+                                                                   AMP_MEMORY_ORDER_ACQ_REL,
+                                                                   AMP_MEMORY_ORDER_RELAXED)) {
+            return;
+        }
+    }
+
+    /* Possibly the last task - decrement while holding the mutex so a waiter
+     * can't destroy the group before it is signaled.
+     */
+    retval = amp_mutex_lock(group->mutex);
+    assert(AMP_SUCCESS == retval);
+    {
+        pending_count = amp_atomic_int32_fetch_add_explicit(&group->pending_count,
+                                                            -1,
+                                                            AMP_MEMORY_ORDER_ACQ_REL);
+        assert(0 < pending_count);
+
+        if (1 == pending_count) {
+            retval = amp_condition_variable_broadcast(group->all_done);
+            assert(AMP_SUCCESS == retval);
+        }
+    }
+    retval = amp_mutex_unlock(group->mutex);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+}
+
+
+
+static void amp_internal_thread_pool_free(struct amp_thread_pool_s* pool,
+                                          amp_allocator_t allocator)
+{
+    int retval = AMP_SUCCESS;
+
+    if (AMP_THREAD_ARRAY_UNINITIALIZED != pool->threads) {
+        retval = amp_thread_array_destroy(&pool->threads, allocator);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    if (AMP_SEMAPHORE_UNINITIALIZED != pool->wakeup) {
+        retval = amp_semaphore_destroy(&pool->wakeup, allocator);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    if (AMP_MUTEX_UNINITIALIZED != pool->injection_mutex) {
+        retval = amp_mutex_destroy(&pool->injection_mutex, allocator);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    if (AMP_THREAD_LOCAL_SLOT_UNINITIALIZED != pool->worker_key) {
+        retval = amp_thread_local_slot_destroy(&pool->worker_key, allocator);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    if (NULL != pool->task_storage) {
+        retval = AMP_DEALLOC(allocator, pool->task_storage);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    if (NULL != pool->workers) {
+        retval = AMP_ALIGNED_DEALLOC(allocator, pool->workers);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    retval = AMP_DEALLOC(allocator, pool);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+}
+
+
+
+int amp_thread_pool_create(amp_thread_pool_t* pool,
+                           amp_allocator_t allocator,
+                           size_t worker_count,
+                           size_t queue_capacity)
+{
+    struct amp_thread_pool_s* tmp_pool = NULL;
+    size_t capacity = 2;
+    size_t joinable_count = 0;
+    size_t i = 0;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != pool);
+    assert(NULL != allocator);
+    assert(0 < worker_count);
+
+    if (0 == worker_count) {
+        return AMP_ERROR;
+    }
+
+    if (0 == queue_capacity) {
+        queue_capacity = AMP_THREAD_POOL_DEFAULT_QUEUE_CAPACITY;
+    }
+
+    /* Deques index with a mask, therefore round up to a power of two. */
+    while (capacity < queue_capacity) {
+        if ((AMP_INTERNAL_THREAD_POOL_MAX_QUEUE_SIZE / 2) < capacity) {
+            return AMP_NOMEM;
+        }
+        capacity *= 2;
+    }
+    if ((AMP_INTERNAL_THREAD_POOL_MAX_QUEUE_SIZE / capacity) < worker_count
+        || (AMP_SIZE_MAX / sizeof(struct amp_internal_thread_pool_task_s) / capacity) < (worker_count * 2)) {
+        return AMP_NOMEM;
+    }
+
+    tmp_pool = (struct amp_thread_pool_s*)AMP_ALLOC(allocator, sizeof(*tmp_pool));
+    if (NULL == tmp_pool) {
+        return AMP_NOMEM;
+    }
+
+    tmp_pool->workers = NULL;
+    tmp_pool->worker_count = worker_count;
+    tmp_pool->deque_capacity = (int64_t)capacity;
+    tmp_pool->task_storage = NULL;
+    tmp_pool->threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+    tmp_pool->worker_key = AMP_THREAD_LOCAL_SLOT_UNINITIALIZED;
+    tmp_pool->wakeup = AMP_SEMAPHORE_UNINITIALIZED;
+    amp_atomic_int32_store_explicit(&tmp_pool->sleeping_worker_count, 0, AMP_MEMORY_ORDER_RELAXED);
+    amp_atomic_int32_store_explicit(&tmp_pool->shutdown_requested, 0, AMP_MEMORY_ORDER_RELAXED);
+    tmp_pool->shut_down = AMP_FALSE;
+    tmp_pool->injection_mutex = AMP_MUTEX_UNINITIALIZED;
+    tmp_pool->injection_tasks = NULL;
+    tmp_pool->injection_capacity = capacity * worker_count;
+    tmp_pool->injection_head = 0;
+    tmp_pool->injection_count = 0;
+    amp_atomic_int32_store_explicit(&tmp_pool->injection_size, 0, AMP_MEMORY_ORDER_RELAXED);
+
+    /* Workers are initialized below, the deque ends start cache line aligned. */
+    if (worker_count <= (AMP_SIZE_MAX - AMP_CACHE_LINE_SIZE) / sizeof(*tmp_pool->workers)) {
+        tmp_pool->workers = (struct amp_internal_thread_pool_worker_s*)AMP_ALIGNED_ALLOC(allocator,
+                                                                                         AMP_CACHE_LINE_SIZE,
+                                                                                         AMP_CACHE_LINE_ROUND_UP(worker_count * sizeof(*tmp_pool->workers)));
+    }
+    tmp_pool->task_storage = (struct amp_internal_thread_pool_task_s*)AMP_CALLOC(allocator,
+                                                                                 2 * worker_count * capacity,
+                                                                                 sizeof(*tmp_pool->task_storage));
+    if ((NULL == tmp_pool->workers) || (NULL == tmp_pool->task_storage)) {
+        amp_internal_thread_pool_free(tmp_pool, allocator);
+        return AMP_NOMEM;
+    }
+    tmp_pool->injection_tasks = tmp_pool->task_storage + (worker_count * capacity);
+
+    retval = amp_thread_local_slot_create(&tmp_pool->worker_key, allocator);
+    if (AMP_SUCCESS == retval) {
+        retval = amp_semaphore_create(&tmp_pool->wakeup, allocator, 0);
+    }
+    if (AMP_SUCCESS == retval) {
+        retval = amp_mutex_create(&tmp_pool->injection_mutex, allocator);
+    }
+    if (AMP_SUCCESS == retval) {
+        retval = amp_thread_array_create(&tmp_pool->threads, allocator, worker_count);
+    }
+    if (AMP_SUCCESS != retval) {
+        amp_internal_thread_pool_free(tmp_pool, allocator);
+        return retval;
+    }
+
+    for (i = 0; i < worker_count; ++i) {
+        struct amp_internal_thread_pool_worker_s* worker = &tmp_pool->workers[i];
+
+        amp_atomic_int64_store_explicit(&worker->bottom, 0, AMP_MEMORY_ORDER_RELAXED);
+        amp_atomic_int64_store_explicit(&worker->top, 0, AMP_MEMORY_ORDER_RELAXED);
+        worker->tasks = tmp_pool->task_storage + (i * capacity);
+        worker->pool = tmp_pool;
+        worker->random_state = (uint32_t)((i + 1) * 2654435761u);
+
+        retval = amp_thread_array_configure(tmp_pool->threads,
+                                            i,
+                                            1,
+                                            worker,
+                                            &amp_internal_thread_pool_worker_func);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    /* Publish the initialized pool to the workers. */
+    amp_atomic_thread_fence(AMP_MEMORY_ORDER_RELEASE);
+
+    retval = amp_thread_array_launch_all(tmp_pool->threads, &joinable_count);
+    if (AMP_SUCCESS != retval) {
+        /* Workers that have been launched exit as no task is queued. */
+        amp_atomic_int32_store(&tmp_pool->shutdown_requested, 1);
+        for (i = 0; i < joinable_count; ++i) {
+            int const rc = amp_semaphore_signal(tmp_pool->wakeup);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+
+        if (AMP_SUCCESS != amp_thread_array_join_all(tmp_pool->threads, &joinable_count)) {
+            /* Threads still running - leak the pool instead of freeing it
+             * under their feet.
+             */
+            assert(0);
+            return AMP_ERROR;
+        }
+
+        amp_internal_thread_pool_free(tmp_pool, allocator);
+        return (AMP_NOMEM == retval) ? AMP_NOMEM : AMP_ERROR;
+    }
+
+    *pool = tmp_pool;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_destroy(amp_thread_pool_t* pool,
+                            amp_allocator_t allocator)
+{
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != pool);
+    assert(NULL != *pool);
+    assert(NULL != allocator);
+
+    retval = amp_thread_pool_shutdown(*pool);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    amp_internal_thread_pool_free(*pool, allocator);
+    *pool = AMP_THREAD_POOL_UNINITIALIZED;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_shutdown(amp_thread_pool_t pool)
+{
+    size_t joinable_count = 0;
+    size_t i = 0;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != pool);
+
+    if (AMP_TRUE == pool->shut_down) {
+        return AMP_SUCCESS;
+    }
+
+    amp_atomic_int32_store(&pool->shutdown_requested, 1);
+
+    /* Wake all parked workers - each worker consumes at most one signal
+     * before seeing the shutdown request.
+     */
+    for (i = 0; i < pool->worker_count; ++i) {
+        retval = amp_semaphore_signal(pool->wakeup);
+        assert(AMP_SUCCESS == retval);
+    }
+
+    retval = amp_thread_array_join_all(pool->threads, &joinable_count);
+    assert(AMP_SUCCESS == retval);
+    if (AMP_SUCCESS != retval) {
+        return AMP_ERROR;
+    }
+
+    assert(0 == pool->injection_count);
+    pool->shut_down = AMP_TRUE;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_get_worker_count(amp_thread_pool_t pool,
+                                     size_t* worker_count)
+{
+    assert(NULL != pool);
+    assert(NULL != worker_count);
+
+    *worker_count = pool->worker_count;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_submit(amp_thread_pool_t pool,
+                           amp_thread_pool_wait_group_t group,
+                           amp_thread_pool_task_func_t func,
+                           void* context)
+{
+    struct amp_internal_thread_pool_worker_s* worker = NULL;
+    struct amp_internal_thread_pool_task_s task;
+    amp_bool_t queued = AMP_FALSE;
+
+    assert(NULL != pool);
+    assert(NULL != func);
+
+    worker = (struct amp_internal_thread_pool_worker_s*)amp_thread_local_slot_value(pool->worker_key);
+
+    /* Workers may still submit during a shutdown, other threads mustn't. */
+    assert((NULL != worker) || (AMP_FALSE == pool->shut_down));
+    if ((NULL == worker)
+        && (0 != amp_atomic_int32_load_explicit(&pool->shutdown_requested,
+                                                AMP_MEMORY_ORDER_RELAXED))) {
+        return AMP_ERROR;
+    }
+
+    task.func = func;
+    task.context = context;
+    task.group = group;
+
+    if (NULL != group) {
+        (void)amp_atomic_int32_fetch_add_explicit(&group->pending_count,
+                                                  1,
+                                                  AMP_MEMORY_ORDER_RELAXED);
+    }
+
+    if (NULL != worker) {
+        queued = amp_internal_thread_pool_deque_push(worker, &task);
+    }
+    if (AMP_FALSE == queued) {
+        queued = amp_internal_thread_pool_inject(pool, &task);
+    }
+
+    if (AMP_TRUE == queued) {
+        amp_internal_thread_pool_wake_one(pool);
+    } else {
+        /* All queues full - run the task right away. */
+        amp_internal_thread_pool_execute(&task);
+    }
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_wait(amp_thread_pool_t pool,
+                         amp_thread_pool_wait_group_t group)
+{
+    struct amp_internal_thread_pool_worker_s* worker = NULL;
+    struct amp_internal_thread_pool_task_s task;
+    unsigned int idle_count = 0;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != pool);
+    assert(NULL != group);
+
+    worker = (struct amp_internal_thread_pool_worker_s*)amp_thread_local_slot_value(pool->worker_key);
+
+    while (0 != amp_atomic_int32_load_explicit(&group->pending_count,
+                                               AMP_MEMORY_ORDER_ACQUIRE)) {
+
+        if (AMP_TRUE == amp_internal_thread_pool_find_task(pool, worker, &task)) {
+            amp_internal_thread_pool_execute(&task);
+            idle_count = 0;
+        } else if (idle_count < AMP_INTERNAL_THREAD_POOL_IDLE_SPIN_COUNT) {
+            ++idle_count;
+            amp_atomic_spin_pause();
+        } else {
+            /* Remaining tasks of the group are running on other threads. */
+            break;
+        }
+    }
+
+    /* Always pass the mutex so the last task has finished touching the group
+     * when returning.
+     */
+    retval = amp_mutex_lock(group->mutex);
+    assert(AMP_SUCCESS == retval);
+    {
+        while (0 != amp_atomic_int32_load_explicit(&group->pending_count,
+                                                   AMP_MEMORY_ORDER_ACQUIRE)) {
+            retval = amp_condition_variable_wait(group->all_done,
+                                                 group->mutex);
+            assert(AMP_SUCCESS == retval);
+        }
+    }
+    retval = amp_mutex_unlock(group->mutex);
+    assert(AMP_SUCCESS == retval);
+    (void)retval;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_wait_group_create(amp_thread_pool_wait_group_t* group,
+                                      amp_allocator_t allocator)
+{
+    amp_thread_pool_wait_group_t tmp_group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != group);
+    assert(NULL != allocator);
+
+    tmp_group = (amp_thread_pool_wait_group_t)AMP_ALLOC(allocator, sizeof(*tmp_group));
+    if (NULL == tmp_group) {
+        return AMP_NOMEM;
+    }
+
+    retval = amp_mutex_create(&tmp_group->mutex, allocator);
+    if (AMP_SUCCESS != retval) {
+        int const rc = AMP_DEALLOC(allocator, tmp_group);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+
+        return retval;
+    }
+
+    retval = amp_condition_variable_create(&tmp_group->all_done, allocator);
+    if (AMP_SUCCESS != retval) {
+        int rc = amp_mutex_destroy(&tmp_group->mutex, allocator);
+        assert(AMP_SUCCESS == rc);
+        rc = AMP_DEALLOC(allocator, tmp_group);
+        assert(AMP_SUCCESS == rc);
+        (void)rc;
+
+        return retval;
+    }
+
+    amp_atomic_int32_store(&tmp_group->pending_count, 0);
+
+    *group = tmp_group;
+
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_thread_pool_wait_group_destroy(amp_thread_pool_wait_group_t* group,
+                                       amp_allocator_t allocator)
+{
+    int retval = AMP_UNSUPPORTED;
+
+    assert(NULL != group);
+    assert(NULL != *group);
+    assert(NULL != allocator);
+
+    if (0 != amp_atomic_int32_load(&(*group)->pending_count)) {
+        return AMP_BUSY;
+    }
+
+    retval = amp_condition_variable_destroy(&(*group)->all_done, allocator);
+    if (AMP_SUCCESS != retval) {
+        return retval;
+    }
+
+    retval = amp_mutex_destroy(&(*group)->mutex, allocator);
+    assert(AMP_SUCCESS == retval);
+
+    retval = AMP_DEALLOC(allocator, *group);
+    assert(AMP_SUCCESS == retval);
+    if (AMP_SUCCESS == retval) {
+        *group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+    }
+
+    return retval;
+}
+
+
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Pool of persistent worker threads executing submitted tasks. Each worker
+ * owns a Chase-Lev work-stealing deque: tasks submitted from inside a task
+ * are pushed onto the deque of the submitting worker and idle workers steal
+ * from the other end of the deques of their peers. Tasks submitted from
+ * threads outside the pool go into a shared injection queue. Idle workers
+ * park on a semaphore until new tasks arrive.
+ *
+ * Submitting a task therefore costs a deque push instead of a thread
+ * creation.
+ *
+ * Tasks are grouped by wait groups to wait for their completion. Threads
+ * waiting for a group help executing queued tasks, therefore tasks can
+ * submit sub-tasks and wait for them without starving the pool.
+ *
+ * Never pass an invalid, e.g. non-created thread pool or wait group to any
+ * of the functions other than the create functions.
+ *
+ * TODO: @todo Add a way to cancel queued tasks.
+ */
+
+#ifndef AMP_amp_thread_pool_H
+#define AMP_amp_thread_pool_H
+
+
+#include <stddef.h>
+
+#include <amp/amp_memory.h>
+
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+
+#define AMP_THREAD_POOL_UNINITIALIZED NULL
+#define AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED NULL
+
+    /**
+     * Queue capacity used when 0 is passed to amp_thread_pool_create.
+     */
+#define AMP_THREAD_POOL_DEFAULT_QUEUE_CAPACITY 256
+
+
+    /**
+     * Opaque thread pool type.
+     */
+    typedef struct amp_thread_pool_s *amp_thread_pool_t;
+
+    /**
+     * Opaque wait group type to wait for the completion of a group of tasks.
+     */
+    typedef struct amp_thread_pool_wait_group_s *amp_thread_pool_wait_group_t;
+
+    /**
+     * Function type of tasks executed by the thread pool.
+     */
+    typedef void (*amp_thread_pool_task_func_t)(void *context);
+
+
+    /**
+     * Creates a thread pool and launches its worker_count worker threads.
+     *
+     * queue_capacity is the number of tasks each worker deque can hold and is
+     * rounded up to the next power of two, 0 selects
+     * AMP_THREAD_POOL_DEFAULT_QUEUE_CAPACITY. The injection queue for tasks
+     * submitted from outside the pool holds worker_count times as many.
+     *
+     * worker_count must not be 0.
+     *
+     * If the creation fails the allocator is called to free the already
+     * allocated memory which must not result in an error or otherwise
+     * behavior is undefined.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     *         AMP_ERROR if other system resources are insufficient, e.g. if
+     *         not all worker threads could be launched, or if worker_count
+     *         is 0.
+     */
+    int amp_thread_pool_create(amp_thread_pool_t* pool,
+                               amp_allocator_t allocator,
+                               size_t worker_count,
+                               size_t queue_capacity);
+
+
+    /**
+     * Shuts the pool down if this hasn't happened yet and frees its memory
+     * with the allocator.
+     *
+     * Don't call from inside a task of the pool.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         Error codes of amp_thread_pool_shutdown.
+     */
+    int amp_thread_pool_destroy(amp_thread_pool_t* pool,
+                                amp_allocator_t allocator);
+
+
+    /**
+     * Lets the workers execute all queued tasks, including tasks submitted by
+     * these tasks, and joins with the worker threads afterwards.
+     *
+     * Tasks mustn't be submitted from outside the pool after or during the
+     * shutdown. Only call from one thread and never from inside a task of the
+     * pool.
+     *
+     * @return AMP_SUCCESS after all workers have been joined.
+     *         AMP_ERROR if joining with the workers failed.
+     */
+    int amp_thread_pool_shutdown(amp_thread_pool_t pool);
+
+
+    /**
+     * Returns the number of worker threads of the pool in worker_count.
+     *
+     * @return AMP_SUCCESS.
+     */
+    int amp_thread_pool_get_worker_count(amp_thread_pool_t pool,
+                                         size_t* worker_count);
+
+
+    /**
+     * Submits a task calling func with context for execution by the pool.
+     * If group is not NULL the task is added to it and group can be used to
+     * wait for its completion.
+     *
+     * If the queue the task should go into is full the task is executed by
+     * the calling thread before the function returns.
+     *
+     * @return AMP_SUCCESS after submitting (or executing) the task.
+     *         AMP_ERROR if the pool has been shut down.
+     */
+    int amp_thread_pool_submit(amp_thread_pool_t pool,
+                               amp_thread_pool_wait_group_t group,
+                               amp_thread_pool_task_func_t func,
+                               void* context);
+
+
+    /**
+     * Blocks until all tasks submitted to group have been executed. While
+     * waiting the calling thread executes queued tasks of the pool.
+     *
+     * Can be called from inside a task of the pool.
+     *
+     * @return AMP_SUCCESS after all tasks of the group have been executed.
+     */
+    int amp_thread_pool_wait(amp_thread_pool_t pool,
+                             amp_thread_pool_wait_group_t group);
+
+
+    /**
+     * Allocates and initializes an empty wait group. A wait group can be
+     * reused after waiting for it and can be shared among pools.
+     *
+     * @return AMP_SUCCESS on successful creation.
+     *         AMP_NOMEM if memory is insufficient.
+     *         AMP_ERROR if other system resources are insufficient.
+     */
+    int amp_thread_pool_wait_group_create(amp_thread_pool_wait_group_t* group,
+                                          amp_allocator_t allocator);
+
+
+    /**
+     * Finalizes the wait group and frees its memory with the allocator.
+     *
+     * @return AMP_SUCCESS on successful destruction.
+     *         AMP_BUSY if tasks of the group haven't been executed yet.
+     */
+    int amp_thread_pool_wait_group_destroy(amp_thread_pool_wait_group_t* group,
+                                           amp_allocator_t allocator);
+
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif
+
+
+#endif /* AMP_amp_thread_pool_H */
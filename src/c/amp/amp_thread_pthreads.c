@@ -52,13 +52,24 @@
  */
 
 
+/* pthread_attr_setaffinity_np, pthread_setname_np, and cpu_set_t are GNU 
+ * extensions.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
 #include "amp_thread.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <stddef.h>
+#include <string.h>
 
+#include <pthread.h>
 #include <sched.h>
+#include <unistd.h>
 
 #include "amp_stddef.h"
 #include "amp_return_code.h"
@@ -85,6 +96,18 @@ void* amp_internal_native_thread_adapter_func(void *thread)
      */
     /* assert(0 != pthread_equal(thread_context->native_thread_description.thread , pthread_self()));*/
     
+    /* The thread names itself as Mac OS X only supports naming the calling
+     * thread. Names are a debugging aid, therefore errors are ignored.
+     */
+    if ((AMP_TRUE == thread_context->has_attributes)
+        && ('\0' != thread_context->attributes.name[0])) {
+#if defined(__linux__)
+        (void)pthread_setname_np(pthread_self(), thread_context->attributes.name);
+#elif defined(__APPLE__)
+        (void)pthread_setname_np(thread_context->attributes.name);
+#endif
+    }
+    
     thread_context->func(thread_context->func_context);
     
     /**
@@ -98,6 +121,164 @@ void* amp_internal_native_thread_adapter_func(void *thread)
 
 
 
+#if defined(__linux__)
+
+/**
+ * Converts the amp thread affinity to a Linux CPU set.
+ *
+ * Purely internal function.
+ */
+static void amp_internal_thread_affinity_to_cpu_set(struct amp_thread_affinity_s const* affinity,
+                                                    cpu_set_t* cpu_set);
+static void amp_internal_thread_affinity_to_cpu_set(struct amp_thread_affinity_s const* affinity,
+                                                    cpu_set_t* cpu_set)
+{
+    CPU_ZERO(cpu_set);
+    
+    for (size_t i = 0; i < AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY; ++i) {
+        if (AMP_TRUE == amp_thread_affinity_contains(affinity, i)) {
+            CPU_SET(i, cpu_set);
+        }
+    }
+}
+
+#endif /* defined(__linux__) */
+
+
+
+/**
+ * Maps the amp scheduling policy to the Pthreads scheduling policy.
+ *
+ * Purely internal function.
+ */
+static int amp_internal_thread_native_scheduling_policy(amp_thread_scheduling_policy_t policy,
+                                                        int* native_policy);
+static int amp_internal_thread_native_scheduling_policy(amp_thread_scheduling_policy_t policy,
+                                                        int* native_policy)
+{
+    assert(NULL != native_policy);
+    
+    switch (policy) {
+        case amp_default_thread_scheduling_policy:
+            *native_policy = SCHED_OTHER;
+            return AMP_SUCCESS;
+        case amp_fifo_thread_scheduling_policy:
+            *native_policy = SCHED_FIFO;
+            return AMP_SUCCESS;
+        case amp_round_robin_thread_scheduling_policy:
+            *native_policy = SCHED_RR;
+            return AMP_SUCCESS;
+        default:
+            assert(0); /* Programming error */
+            return AMP_ERROR;
+    }
+}
+
+
+
+/**
+ * Rounds the requested stack size up to the minimal stack size and to a 
+ * multiple of the page size.
+ *
+ * Purely internal function.
+ */
+static size_t amp_internal_thread_native_stack_size(size_t requested_size);
+static size_t amp_internal_thread_native_stack_size(size_t requested_size)
+{
+    long const page_size = sysconf(_SC_PAGESIZE);
+    size_t size = requested_size;
+    
+    if (size < (size_t)PTHREAD_STACK_MIN) {
+        size = (size_t)PTHREAD_STACK_MIN;
+    }
+    
+    if (0 < page_size) {
+        size_t const page = (size_t)page_size;
+        size = ((size + page - 1) / page) * page;
+    }
+    
+    return size;
+}
+
+
+
+/**
+ * Sets the creation attributes for the affinity and the attributes of 
+ * thread.
+ *
+ * Purely internal function.
+ */
+static int amp_internal_thread_set_creation_attributes(amp_thread_t thread,
+                                                       pthread_attr_t* attributes);
+static int amp_internal_thread_set_creation_attributes(amp_thread_t thread,
+                                                       pthread_attr_t* attributes)
+{
+    assert(NULL != thread);
+    assert(NULL != attributes);
+    
+#if defined(__linux__)
+    /* Create pinned threads already running on their hardware threads
+     * instead of migrating them after they started.
+     */
+    if (AMP_TRUE == thread->has_affinity) {
+        cpu_set_t cpu_set;
+        amp_internal_thread_affinity_to_cpu_set(&thread->affinity, &cpu_set);
+        int const affinity_retval = pthread_attr_setaffinity_np(attributes, 
+                                                                sizeof(cpu_set), 
+                                                                &cpu_set);
+        assert(0 == affinity_retval);
+        (void)affinity_retval;
+    }
+#endif
+    
+    if (AMP_TRUE != thread->has_attributes) {
+        return AMP_SUCCESS;
+    }
+    
+    struct amp_thread_attributes_s const* amp_attributes = &thread->attributes;
+    
+    if (0 != amp_attributes->stack_size) {
+        size_t const stack_size = amp_internal_thread_native_stack_size(amp_attributes->stack_size);
+        if (0 != pthread_attr_setstacksize(attributes, stack_size)) {
+            return AMP_ERROR;
+        }
+    }
+    
+    if (AMP_THREAD_DEFAULT_GUARD_SIZE != amp_attributes->guard_size) {
+        if (0 != pthread_attr_setguardsize(attributes, amp_attributes->guard_size)) {
+            return AMP_ERROR;
+        }
+    }
+    
+    if (amp_default_thread_scheduling_policy != amp_attributes->scheduling_policy) {
+        
+        int native_policy = SCHED_OTHER;
+        int retval = amp_internal_thread_native_scheduling_policy(amp_attributes->scheduling_policy,
+                                                                  &native_policy);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+        
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = amp_attributes->priority;
+        
+        /* Without explicit scheduling the policy of the creating thread is
+         * inherited and the attributes policy is ignored.
+         */
+        if ((0 != pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED))
+            || (0 != pthread_attr_setschedpolicy(attributes, native_policy))
+            || (0 != pthread_attr_setschedparam(attributes, &param))) {
+            
+            return AMP_ERROR;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
 int amp_internal_native_thread_set_invalid(struct amp_native_thread_s *native_thread)
 {
     assert(NULL != native_thread);
@@ -121,10 +302,41 @@ int amp_internal_thread_launch_configured(amp_thread_t thread)
         return AMP_ERROR;
     }
     
+    pthread_attr_t* attributes = NULL; /* Default thread creation attribs. */
+    pthread_attr_t creation_attributes;
+    
+    if ((AMP_TRUE == thread->has_affinity)
+        || (AMP_TRUE == thread->has_attributes)) {
+        
+        int const attr_retval = pthread_attr_init(&creation_attributes);
+        if (0 != attr_retval) {
+            assert(ENOMEM == attr_retval);
+            return AMP_NOMEM;
+        }
+        attributes = &creation_attributes;
+        
+        int const set_retval = amp_internal_thread_set_creation_attributes(thread,
+                                                                           attributes);
+        if (AMP_SUCCESS != set_retval) {
+            int const destroy_retval = pthread_attr_destroy(attributes);
+            assert(0 == destroy_retval);
+            (void)destroy_retval;
+            
+            return set_retval;
+        }
+    }
+    
     int retval = pthread_create(&(thread->native_thread_description.thread), 
-                                NULL, /* Default thread creation attribs. */
+                                attributes,
                                 amp_internal_native_thread_adapter_func, 
                                 thread);
+    
+    if (NULL != attributes) {
+        int const attr_retval = pthread_attr_destroy(attributes);
+        assert(0 == attr_retval);
+        (void)attr_retval;
+    }
+    
     if (0 == retval) {
         thread->state = amp_internal_thread_joinable_state;
     } else {
@@ -132,7 +344,20 @@ int amp_internal_thread_launch_configured(amp_thread_t thread)
             case EAGAIN:
                 retval = AMP_ERROR;
                 break;
-            default: /* EINVAL, EPERM - programming error */
+            case EINVAL:
+                /* Pinned to hardware threads that aren't online or 
+                 * attributes the system rejects.
+                 */
+                assert((AMP_TRUE == thread->has_affinity)
+                       || (AMP_TRUE == thread->has_attributes));
+                retval = AMP_ERROR;
+                break;
+            case EPERM:
+                /* Lacking the privileges for the scheduling policy. */
+                assert(AMP_TRUE == thread->has_attributes);
+                retval = AMP_ERROR;
+                break;
+            default: /* Programming error */
                 assert(0);
                 retval = AMP_ERROR;
         }
@@ -143,6 +368,103 @@ int amp_internal_thread_launch_configured(amp_thread_t thread)
 
 
 
+int amp_internal_thread_check_affinity(struct amp_thread_affinity_s const* affinity)
+{
+    assert(NULL != affinity);
+    
+#if defined(__linux__)
+    
+    for (size_t i = CPU_SETSIZE; i < AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY; ++i) {
+        if (AMP_TRUE == amp_thread_affinity_contains(affinity, i)) {
+            return AMP_UNSUPPORTED;
+        }
+    }
+    
+    return AMP_SUCCESS;
+    
+#else
+    
+    (void)affinity;
+    
+    /* Pthreads has no portable way to pin threads. */
+    return AMP_UNSUPPORTED;
+    
+#endif
+}
+
+
+
+int amp_internal_thread_check_attributes(struct amp_thread_attributes_s const* attributes)
+{
+    assert(NULL != attributes);
+    
+    if (NULL == memchr(attributes->name, '\0', sizeof(attributes->name))) {
+        assert(0); /* Programming error */
+        return AMP_ERROR;
+    }
+    
+    if (amp_default_thread_scheduling_policy != attributes->scheduling_policy) {
+        
+        int native_policy = SCHED_OTHER;
+        int const retval = amp_internal_thread_native_scheduling_policy(attributes->scheduling_policy,
+                                                                        &native_policy);
+        if (AMP_SUCCESS != retval) {
+            return retval;
+        }
+        
+        int const min_priority = sched_get_priority_min(native_policy);
+        int const max_priority = sched_get_priority_max(native_policy);
+        if ((-1 == min_priority) || (-1 == max_priority)) {
+            return AMP_UNSUPPORTED;
+        }
+        
+        if ((attributes->priority < min_priority) 
+            || (attributes->priority > max_priority)) {
+            return AMP_ERROR;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_thread_apply_affinity(amp_thread_t thread)
+{
+    assert(NULL != thread);
+    assert(amp_internal_thread_joinable_state == thread->state);
+    assert(AMP_TRUE == thread->has_affinity);
+    
+#if defined(__linux__)
+    
+    cpu_set_t cpu_set;
+    amp_internal_thread_affinity_to_cpu_set(&thread->affinity, &cpu_set);
+    
+    int const retval = pthread_setaffinity_np(thread->native_thread_description.thread,
+                                              sizeof(cpu_set),
+                                              &cpu_set);
+    switch (retval) {
+        case 0:
+            return AMP_SUCCESS;
+        case EINVAL:
+            /* None of the hardware threads is online. */
+            return AMP_ERROR;
+        default: /* EFAULT, ESRCH - programming error */
+            assert(0);
+            return AMP_ERROR;
+    }
+    
+#else
+    
+    (void)thread;
+    
+    return AMP_UNSUPPORTED;
+    
+#endif
+}
+
+
+
 int amp_raw_thread_join(amp_thread_t thread)
 {
     assert(0 != thread);
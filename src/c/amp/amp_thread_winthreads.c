@@ -45,6 +45,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <stddef.h>
 
 #include <process.h>
@@ -100,10 +101,49 @@ int amp_internal_native_thread_set_invalid(struct amp_native_thread_s *native_th
 
 
 
+/**
+ * Does nothing - runs instead of the user function of a thread that has
+ * been created suspended but couldn't be pinned.
+ *
+ * Purely internal function.
+ */
+static void amp_internal_thread_noop_func(void* context);
+static void amp_internal_thread_noop_func(void* context)
+{
+    (void)context;
+}
+
+
+
+/**
+ * Converts the amp thread affinity to a Windows affinity mask. Only call
+ * for affinities accepted by amp_internal_thread_check_affinity.
+ *
+ * Purely internal function.
+ */
+static DWORD_PTR amp_internal_thread_affinity_mask(struct amp_thread_affinity_s const* affinity);
+static DWORD_PTR amp_internal_thread_affinity_mask(struct amp_thread_affinity_s const* affinity)
+{
+    DWORD_PTR mask = 0;
+    size_t i = 0;
+    
+    for (i = 0; i < 8 * sizeof(DWORD_PTR); ++i) {
+        if (AMP_TRUE == amp_thread_affinity_contains(affinity, i)) {
+            mask |= ((DWORD_PTR)1) << i;
+        }
+    }
+    
+    return mask;
+}
+
+
+
 int amp_internal_thread_launch_configured(amp_thread_t thread)
 {
     unsigned int inter_process_thread_id = 0;
     uintptr_t thread_handle = 0;
+    unsigned int stack_size = 0; /* Default thread stack size. */
+    unsigned int creation_flags = 0;
     int retval = AMP_UNSUPPORTED;
     
     assert(NULL != thread);
@@ -117,14 +157,69 @@ int amp_internal_thread_launch_configured(amp_thread_t thread)
         return EINVAL;
     }
     
+    /* Only reserve the requested stack size instead of committing it. */
+    if ((AMP_TRUE == thread->has_attributes)
+        && (0 != thread->attributes.stack_size)) {
+        
+        stack_size = (unsigned int)thread->attributes.stack_size;
+        creation_flags |= STACK_SIZE_PARAM_IS_A_RESERVATION;
+    }
+    
+    /* Pinned threads are created suspended and only start running after
+     * they have been moved to their hardware threads.
+     */
+    if (AMP_TRUE == thread->has_affinity) {
+        creation_flags |= CREATE_SUSPENDED;
+    }
+    
     /* Thread creation for native code. */
     errno = 0;
     thread_handle = _beginthreadex(NULL, /* Non-inheritable security attribs. */
-                                   0,  /* Default thread stack size. */
+                                   stack_size,
                                    native_thread_adapter_func, 
                                    thread, 
-                                   0, /* Start thread running. */
+                                   creation_flags,
                                    &inter_process_thread_id);
+    if ((0 != thread_handle)
+        && (AMP_TRUE == thread->has_affinity)) {
+        
+        DWORD_PTR const previous_mask = SetThreadAffinityMask((HANDLE)thread_handle, 
+                                                              amp_internal_thread_affinity_mask(&thread->affinity));
+        DWORD resume_retval = 0;
+        
+        if (0 == previous_mask) {
+            /* The suspended thread hasn't run yet - let it run a function
+             * that does nothing instead of the user function and join it, 
+             * the thread stays unlaunched like after a failed creation.
+             */
+            amp_thread_func_t const func = thread->func;
+            DWORD wait_retval = 0;
+            BOOL close_retval = FALSE;
+            
+            thread->func = amp_internal_thread_noop_func;
+            
+            resume_retval = ResumeThread((HANDLE)thread_handle);
+            assert(((DWORD)-1) != resume_retval);
+            
+            wait_retval = WaitForSingleObject((HANDLE)thread_handle, INFINITE);
+            assert(WAIT_OBJECT_0 == wait_retval);
+            (void)wait_retval;
+            
+            close_retval = CloseHandle((HANDLE)thread_handle);
+            assert(close_retval);
+            (void)close_retval;
+            
+            thread->func = func;
+            
+            /* Pinned to hardware threads that aren't available. */
+            return AMP_ERROR;
+        }
+        
+        resume_retval = ResumeThread((HANDLE)thread_handle);
+        assert(((DWORD)-1) != resume_retval);
+        (void)resume_retval;
+    }
+    
     if (0 != thread_handle) {
         /* Thread launched successfully. */
         thread->native_thread_description.thread_handle = (HANDLE) thread_handle;
@@ -152,6 +247,67 @@ int amp_internal_thread_launch_configured(amp_thread_t thread)
 
 
 
+int amp_internal_thread_check_attributes(struct amp_thread_attributes_s const* attributes)
+{
+    assert(NULL != attributes);
+    
+    /* Thread names are ignored as naming threads needs a debugger 
+     * exception or Windows 10.
+     */
+    
+    if ((AMP_THREAD_DEFAULT_GUARD_SIZE != attributes->guard_size)
+        || (amp_default_thread_scheduling_policy != attributes->scheduling_policy)) {
+        
+        return AMP_UNSUPPORTED;
+    }
+    
+    if (UINT_MAX < attributes->stack_size) {
+        return AMP_ERROR;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_thread_check_affinity(struct amp_thread_affinity_s const* affinity)
+{
+    size_t i = 0;
+    
+    assert(NULL != affinity);
+    
+    /* Affinity masks only cover the processors of one processor group. */
+    for (i = 8 * sizeof(DWORD_PTR); i < AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY; ++i) {
+        if (AMP_TRUE == amp_thread_affinity_contains(affinity, i)) {
+            return AMP_UNSUPPORTED;
+        }
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
+int amp_internal_thread_apply_affinity(amp_thread_t thread)
+{
+    DWORD_PTR previous_mask = 0;
+    
+    assert(NULL != thread);
+    assert(amp_internal_thread_joinable_state == thread->state);
+    assert(AMP_TRUE == thread->has_affinity);
+    
+    previous_mask = SetThreadAffinityMask(thread->native_thread_description.thread_handle,
+                                          amp_internal_thread_affinity_mask(&thread->affinity));
+    if (0 == previous_mask) {
+        /* None of the processors is active. */
+        return AMP_ERROR;
+    }
+    
+    return AMP_SUCCESS;
+}
+
+
+
 /**
  * TODO: @todo Add better error detection and handling.
  */
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_arena_allocator.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_arena_allocator.h>
+#include <amp/amp_mutex.h>
+#include <amp/amp_semaphore.h>
+
+
+
+SUITE(amp_arena_allocator)
+{
+    TEST(create_and_destroy)
+    {
+        amp_allocator_t arena = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_arena_allocator_create(&arena,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t used = 1;
+        std::size_t capacity = 0;
+        amp_arena_allocator_get_usage(arena, &used, &capacity);
+        CHECK_EQUAL(static_cast<std::size_t>(0), used);
+        CHECK_EQUAL(static_cast<std::size_t>(1024), capacity);
+        
+        retval = amp_arena_allocator_destroy(&arena, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_ALLOCATOR_UNINITIALIZED == arena);
+    }
+    
+    
+    
+    TEST(allocations_are_aligned_disjoint_and_exhaust_the_arena)
+    {
+        amp_allocator_t arena = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_arena_allocator_create(&arena,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                256);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        char* first = static_cast<char*>(AMP_ALLOC(arena, 3));
+        char* second = static_cast<char*>(AMP_ALLOC(arena, 8));
+        CHECK(NULL != first);
+        CHECK(NULL != second);
+        CHECK(second >= first + 3);
+        CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(first) % sizeof(void*));
+        CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(second) % sizeof(void*));
+        
+        int* zeroed = static_cast<int*>(AMP_CALLOC(arena, 4, sizeof(int)));
+        CHECK(NULL != zeroed);
+        for (int i = 0; i < 4; ++i) {
+            CHECK_EQUAL(0, zeroed[i]);
+        }
+        
+        CHECK(NULL == AMP_ALLOC(arena, 1024));
+        CHECK(NULL == AMP_CALLOC(arena, ~static_cast<std::size_t>(0), 2));
+        
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(arena, second));
+        
+        amp_arena_allocator_reset(arena);
+        std::size_t used = 1;
+        amp_arena_allocator_get_usage(arena, &used, NULL);
+        CHECK_EQUAL(static_cast<std::size_t>(0), used);
+        
+        char* after_reset = static_cast<char*>(AMP_ALLOC(arena, 3));
+        CHECK_EQUAL(first, after_reset);
+        
+        retval = amp_arena_allocator_destroy(&arena, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(aligned_allocations_pad_the_arena)
+    {
+        amp_allocator_t arena = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_arena_allocator_create(&arena,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                4096);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        char* unaligned = static_cast<char*>(AMP_ALLOC(arena, 1));
+        char* aligned = static_cast<char*>(AMP_ALIGNED_ALLOC(arena, 256, 256));
+        CHECK(NULL != unaligned);
+        CHECK(NULL != aligned);
+        CHECK(aligned > unaligned);
+        CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(aligned) % 256);
+        CHECK_EQUAL(AMP_SUCCESS, AMP_ALIGNED_DEALLOC(arena, aligned));
+        
+        CHECK(NULL == AMP_ALIGNED_ALLOC(arena, 4096, 4096));
+        
+        retval = amp_arena_allocator_destroy(&arena, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(nested_marks_release_later_allocations)
+    {
+        amp_allocator_t arena = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_arena_allocator_create(&arena,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        void* before_outer = AMP_ALLOC(arena, 16);
+        CHECK(NULL != before_outer);
+        
+        amp_arena_allocator_mark_t outer_mark = 0;
+        amp_arena_allocator_get_mark(arena, &outer_mark);
+        void* in_outer = AMP_ALLOC(arena, 16);
+        
+        amp_arena_allocator_mark_t inner_mark = 0;
+        amp_arena_allocator_get_mark(arena, &inner_mark);
+        void* in_inner = AMP_ALLOC(arena, 16);
+        CHECK(NULL != in_inner);
+        
+        retval = amp_arena_allocator_release_to_mark(arena, inner_mark);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(in_inner, AMP_ALLOC(arena, 16));
+        
+        retval = amp_arena_allocator_release_to_mark(arena, outer_mark);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(in_outer, AMP_ALLOC(arena, 16));
+        
+        retval = amp_arena_allocator_destroy(&arena, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(create_primitives_from_arena)
+    {
+        std::size_t const primitive_count = 16;
+        
+        amp_allocator_t arena = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_arena_allocator_create(&arena,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                64 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_mutex_t mutexes[primitive_count];
+        amp_semaphore_t semaphores[primitive_count];
+        
+        for (std::size_t i = 0; i < primitive_count; ++i) {
+            retval = amp_mutex_create(&mutexes[i], arena);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_semaphore_create(&semaphores[i], arena, 1);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        for (std::size_t i = 0; i < primitive_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_mutex_lock(mutexes[i]));
+            CHECK_EQUAL(AMP_SUCCESS, amp_semaphore_wait(semaphores[i]));
+            CHECK_EQUAL(AMP_SUCCESS, amp_semaphore_signal(semaphores[i]));
+            CHECK_EQUAL(AMP_SUCCESS, amp_mutex_unlock(mutexes[i]));
+        }
+        
+        for (std::size_t i = 0; i < primitive_count; ++i) {
+            retval = amp_semaphore_destroy(&semaphores[i], arena);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_mutex_destroy(&mutexes[i], arena);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        amp_arena_allocator_reset(arena);
+        
+        retval = amp_arena_allocator_destroy(&arena, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+} // SUITE(amp_arena_allocator)
+
+
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_atomic and therefore indirectly amp_raw_atomic.
+ */
+
+#include <UnitTest++.h>
+
+#include <assert.h>
+#include <cstddef>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_thread_array.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+
+
+
+SUITE(amp_atomic)
+{
+    TEST(int32_load_store)
+    {
+        struct amp_raw_atomic_int32_s atomic = AMP_RAW_ATOMIC_INT32_INITIALIZER(7);
+
+        CHECK_EQUAL(7, amp_atomic_int32_load(&atomic));
+
+        amp_atomic_int32_store(&atomic, -42);
+        CHECK_EQUAL(-42, amp_atomic_int32_load(&atomic));
+
+        amp_atomic_int32_store_explicit(&atomic, 23, AMP_MEMORY_ORDER_RELEASE);
+        CHECK_EQUAL(23, amp_atomic_int32_load_explicit(&atomic,
+                                                       AMP_MEMORY_ORDER_ACQUIRE));
+
+        amp_atomic_int32_store_explicit(&atomic, 5, AMP_MEMORY_ORDER_RELAXED);
+        CHECK_EQUAL(5, amp_atomic_int32_load_explicit(&atomic,
+                                                      AMP_MEMORY_ORDER_RELAXED));
+    }
+
+
+
+    TEST(int32_exchange_and_fetch_add)
+    {
+        struct amp_raw_atomic_int32_s atomic = AMP_RAW_ATOMIC_INT32_INITIALIZER(1);
+
+        CHECK_EQUAL(1, amp_atomic_int32_exchange(&atomic, 2));
+        CHECK_EQUAL(2, amp_atomic_int32_exchange_explicit(&atomic,
+                                                          3,
+                                                          AMP_MEMORY_ORDER_ACQ_REL));
+        CHECK_EQUAL(3, amp_atomic_int32_fetch_add(&atomic, 10));
+        CHECK_EQUAL(13, amp_atomic_int32_fetch_add_explicit(&atomic,
+                                                            -13,
+                                                            AMP_MEMORY_ORDER_RELAXED));
+        CHECK_EQUAL(0, amp_atomic_int32_load(&atomic));
+    }
+
+
+
+    TEST(int32_compare_exchange)
+    {
+        struct amp_raw_atomic_int32_s atomic = AMP_RAW_ATOMIC_INT32_INITIALIZER(4);
+
+        int32_t expected = 5;
+        CHECK(AMP_FALSE == amp_atomic_int32_compare_exchange(&atomic,
+                                                             &expected,
+                                                             6));
+        CHECK_EQUAL(4, expected);
+        CHECK_EQUAL(4, amp_atomic_int32_load(&atomic));
+
+        CHECK(AMP_TRUE == amp_atomic_int32_compare_exchange(&atomic,
+                                                            &expected,
+                                                            6));
+        CHECK_EQUAL(6, amp_atomic_int32_load(&atomic));
+
+        expected = 6;
+        CHECK(AMP_TRUE == amp_atomic_int32_compare_exchange_explicit(&atomic,
+                                                                     &expected,
+                                                                     7,
+                                                                     AMP_MEMORY_ORDER_RELEASE,
+                                                                     AMP_MEMORY_ORDER_RELAXED));
+        CHECK_EQUAL(7, amp_atomic_int32_load(&atomic));
+    }
+
+
+
+    TEST(int64_operations)
+    {
+        int64_t const big = (static_cast<int64_t>(1) << 40) + 3;
+
+        struct amp_raw_atomic_int64_s atomic = AMP_RAW_ATOMIC_INT64_INITIALIZER(0);
+
+        amp_atomic_int64_store(&atomic, big);
+        CHECK(big == amp_atomic_int64_load(&atomic));
+
+        CHECK(big == amp_atomic_int64_fetch_add(&atomic, big));
+        CHECK(2 * big == amp_atomic_int64_exchange(&atomic, -1));
+
+        int64_t expected = -1;
+        CHECK(AMP_TRUE == amp_atomic_int64_compare_exchange(&atomic,
+                                                            &expected,
+                                                            big));
+        expected = 0;
+        CHECK(AMP_FALSE == amp_atomic_int64_compare_exchange_explicit(&atomic,
+                                                                      &expected,
+                                                                      0,
+                                                                      AMP_MEMORY_ORDER_ACQ_REL,
+                                                                      AMP_MEMORY_ORDER_ACQUIRE));
+        CHECK(big == expected);
+    }
+
+
+
+    TEST(pointer_operations)
+    {
+        char buffer[16] = {0};
+
+        struct amp_raw_atomic_pointer_s atomic = AMP_RAW_ATOMIC_POINTER_INITIALIZER(NULL);
+
+        CHECK(NULL == amp_atomic_pointer_load(&atomic));
+
+        amp_atomic_pointer_store(&atomic, &buffer[0]);
+        CHECK(&buffer[0] == amp_atomic_pointer_load(&atomic));
+
+        CHECK(&buffer[0] == amp_atomic_pointer_fetch_add(&atomic, 4));
+        CHECK(&buffer[4] == amp_atomic_pointer_load(&atomic));
+
+        CHECK(&buffer[4] == amp_atomic_pointer_fetch_add_explicit(&atomic,
+                                                                  -3,
+                                                                  AMP_MEMORY_ORDER_RELAXED));
+        CHECK(&buffer[1] == amp_atomic_pointer_exchange(&atomic, &buffer[8]));
+
+        void* expected = &buffer[8];
+        CHECK(AMP_TRUE == amp_atomic_pointer_compare_exchange(&atomic,
+                                                              &expected,
+                                                              NULL));
+        CHECK(AMP_FALSE == amp_atomic_pointer_compare_exchange(&atomic,
+                                                               &expected,
+                                                               &buffer[0]));
+        CHECK(NULL == expected);
+    }
+
+
+
+    namespace {
+
+        std::size_t const increments_per_thread = 10000;
+
+        struct counter_context {
+            struct amp_raw_atomic_int32_s counter32;
+            struct amp_raw_atomic_int64_s counter64;
+            struct amp_raw_atomic_int32_s cas_counter;
+        };
+
+        void concurrent_increment_func(void* ctxt);
+        void concurrent_increment_func(void* ctxt)
+        {
+            struct counter_context* context = static_cast<struct counter_context*>(ctxt);
+
+            for (std::size_t i = 0; i < increments_per_thread; ++i) {
+
+                (void)amp_atomic_int32_fetch_add_explicit(&context->counter32,
+                                                          1,
+                                                          AMP_MEMORY_ORDER_RELAXED);
+                (void)amp_atomic_int64_fetch_add(&context->counter64, 2);
+
+                int32_t expected = amp_atomic_int32_load_explicit(&context->cas_counter,
+                                                                  AMP_MEMORY_ORDER_RELAXED);
+                while (AMP_FALSE == amp_atomic_int32_compare_exchange(&context->cas_counter,
+                                                                      &expected,
+                                                                      expected + 1)) {
+                    /* Retry with the updated expected value. */
+                }
+            }
+        }
+
+    } // anonymous namespace
+
+
+
+    TEST(concurrent_increments)
+    {
+        std::size_t const thread_count = 8;
+
+        struct counter_context context;
+        amp_atomic_int32_store(&context.counter32, 0);
+        amp_atomic_int64_store(&context.counter64, 0);
+        amp_atomic_int32_store(&context.cas_counter, 0);
+
+        amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+        int retval = amp_thread_array_create(&threads,
+                                             AMP_DEFAULT_ALLOCATOR,
+                                             thread_count);
+        assert(AMP_SUCCESS == retval);
+
+        retval = amp_thread_array_configure(threads,
+                                            0,
+                                            thread_count,
+                                            &context,
+                                            &concurrent_increment_func);
+        assert(AMP_SUCCESS == retval);
+
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        assert(thread_count == joinable_count);
+
+        retval = amp_thread_array_join_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+
+        amp_atomic_thread_fence(AMP_MEMORY_ORDER_SEQ_CST);
+
+        CHECK_EQUAL(static_cast<int32_t>(thread_count * increments_per_thread),
+                    amp_atomic_int32_load(&context.counter32));
+        CHECK(static_cast<int64_t>(2 * thread_count * increments_per_thread)
+              == amp_atomic_int64_load(&context.counter64));
+        CHECK_EQUAL(static_cast<int32_t>(thread_count * increments_per_thread),
+                    amp_atomic_int32_load(&context.cas_counter));
+    }
+
+}
+
+
@@ -17,6 +17,7 @@
 
 #include <amp/amp.h>
 #include <amp/amp_return_code.h>
+#include <amp/amp_raw_atomic.h>
 
 
 
@@ -198,42 +199,79 @@ SUITE(amp_barrier)
             int after_first_wait;
             int after_second_wait;
             
-            int* shared_counter;
-            int observed_counter_before_end;
+            // Arrivals are counted before entering the barrier and observed
+            // after leaving it - no thread must leave before all arrivals of
+            // its phase have been counted, independent of how late the 
+            // threads of the previous phase leave.
+            int* shared_first_phase_arrival_counter;
+            int* shared_second_phase_arrival_counter;
+            int observed_first_phase_arrivals;
+            int observed_second_phase_arrivals;
         };
         
         
+        void count_arrival(amp_mutex_t mutex, int* counter);
+        void count_arrival(amp_mutex_t mutex, int* counter)
+        {
+            int rc = amp_mutex_lock(mutex);
+            assert(AMP_SUCCESS == rc);
+            {
+                ++(*counter);
+            }
+            rc = amp_mutex_unlock(mutex);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+        }
+        
+        
+        int observe_arrivals(amp_mutex_t mutex, int* counter);
+        int observe_arrivals(amp_mutex_t mutex, int* counter)
+        {
+            int observed_arrivals = 0;
+            
+            int rc = amp_mutex_lock(mutex);
+            assert(AMP_SUCCESS == rc);
+            {
+                observed_arrivals = *counter;
+            }
+            rc = amp_mutex_unlock(mutex);
+            assert(AMP_SUCCESS == rc);
+            (void)rc;
+            
+            return observed_arrivals;
+        }
+        
+        
         void wait_wake_others_wait(void* ctxt);
         void wait_wake_others_wait(void* ctxt)
         {
             struct no_passing* context = (struct no_passing*)ctxt;
             
-            int observed_counter_before_end = 0;
+            count_arrival(*context->shared_counter_mutex,
+                          context->shared_first_phase_arrival_counter);
             
             context->before_first_wait = 1;
             
             int rc = amp_barrier_wait(*context->shared_barrier);
             assert(AMP_SUCCESS == rc || AMP_BARRIER_SERIAL_THREAD == rc);
             
+            context->observed_first_phase_arrivals = observe_arrivals(*context->shared_counter_mutex,
+                                                                      context->shared_first_phase_arrival_counter);
             context->after_first_wait = 1;
             
+            count_arrival(*context->shared_counter_mutex,
+                          context->shared_second_phase_arrival_counter);
+            
             rc = amp_semaphore_signal(*context->shared_wakeup_sema);
             assert(AMP_SUCCESS == rc);
             
             rc = amp_barrier_wait(*context->shared_barrier);
             assert(AMP_SUCCESS == rc || AMP_BARRIER_SERIAL_THREAD == rc);
             
-            rc = amp_mutex_lock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            {
-                observed_counter_before_end = (*context->shared_counter)++;
-            }
-            rc = amp_mutex_unlock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            
+            context->observed_second_phase_arrivals = observe_arrivals(*context->shared_counter_mutex,
+                                                                       context->shared_second_phase_arrival_counter);
             context->after_second_wait = 1;
-            context->observed_counter_before_end = observed_counter_before_end;
-            
+            (void)rc;
         }
         
         
@@ -242,27 +280,21 @@ SUITE(amp_barrier)
         {
             struct no_passing* context = (struct no_passing*)ctxt;
             
-            int observed_counter_before_end = 0;
-            
             int rc = amp_semaphore_wait(*context->shared_wakeup_sema);
             assert(AMP_SUCCESS == rc);
             
+            count_arrival(*context->shared_counter_mutex,
+                          context->shared_second_phase_arrival_counter);
+            
             context->before_first_wait = 1;
             
             rc = amp_barrier_wait(*context->shared_barrier);
             assert(AMP_SUCCESS == rc || AMP_BARRIER_SERIAL_THREAD == rc);
             
-            rc = amp_mutex_lock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            {
-                observed_counter_before_end = (*context->shared_counter)++;
-            }
-            rc = amp_mutex_unlock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            
+            context->observed_second_phase_arrivals = observe_arrivals(*context->shared_counter_mutex,
+                                                                       context->shared_second_phase_arrival_counter);
             context->after_first_wait = 1;
-            context->observed_counter_before_end = observed_counter_before_end;
-            
+            (void)rc;
         }
         
         
@@ -271,23 +303,18 @@ SUITE(amp_barrier)
         {
             struct no_passing* context = (struct no_passing*)ctxt;
             
-            int observed_counter_before_end = 0;
+            count_arrival(*context->shared_counter_mutex,
+                          context->shared_first_phase_arrival_counter);
             
             context->before_first_wait = 1;
             
             int rc = amp_barrier_wait(*context->shared_barrier);
             assert(AMP_SUCCESS == rc || AMP_BARRIER_SERIAL_THREAD == rc);
+            (void)rc;
             
-            rc = amp_mutex_lock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            {
-                observed_counter_before_end = (*context->shared_counter)++;
-            }
-            rc = amp_mutex_unlock(*context->shared_counter_mutex);
-            assert(AMP_SUCCESS == rc);
-            
+            context->observed_first_phase_arrivals = observe_arrivals(*context->shared_counter_mutex,
+                                                                      context->shared_first_phase_arrival_counter);
             context->after_first_wait = 1;
-            context->observed_counter_before_end = observed_counter_before_end;
         }
         
         
@@ -325,7 +352,8 @@ SUITE(amp_barrier)
         std::size_t const a_third_of_thread_count = concurrency_level;
         std::size_t const thread_count = a_third_of_thread_count * 3;
         
-        int shared_counter = 0;
+        int shared_first_phase_arrival_counter = 0;
+        int shared_second_phase_arrival_counter = 0;
         
         amp_barrier_t shared_barrier = AMP_BARRIER_UNINITIALIZED;
         amp_mutex_t shared_counter_mutex = AMP_MUTEX_UNINITIALIZED;
@@ -362,7 +390,9 @@ SUITE(amp_barrier)
             0,
             0,
             0,
-            &shared_counter,
+            &shared_first_phase_arrival_counter,
+            &shared_second_phase_arrival_counter,
+            0,
             0
         };
         
@@ -429,19 +459,257 @@ SUITE(amp_barrier)
         threads = AMP_THREAD_ARRAY_UNINITIALIZED;
 
         
-        CHECK_EQUAL(static_cast<std::size_t>(shared_counter),thread_count);
+        int const phase_arrival_count = static_cast<int>(a_third_of_thread_count * 2);
+        CHECK_EQUAL(phase_arrival_count, shared_first_phase_arrival_counter);
+        CHECK_EQUAL(phase_arrival_count, shared_second_phase_arrival_counter);
         for (std::size_t i = 0; i < a_third_of_thread_count; ++i) {
-            CHECK(static_cast<std::size_t>(thread_contexts[i].observed_counter_before_end) >= a_third_of_thread_count);
-            CHECK(static_cast<std::size_t>(thread_contexts[i].observed_counter_before_end) < 3 * a_third_of_thread_count);
+            CHECK_EQUAL(phase_arrival_count, thread_contexts[i].observed_first_phase_arrivals);
+            CHECK_EQUAL(phase_arrival_count, thread_contexts[i].observed_second_phase_arrivals);
         }
         for (std::size_t i = a_third_of_thread_count; i < 2 * a_third_of_thread_count; ++i) {
-            CHECK(static_cast<std::size_t>(thread_contexts[i].observed_counter_before_end) < a_third_of_thread_count);
+            CHECK_EQUAL(phase_arrival_count, thread_contexts[i].observed_first_phase_arrivals);
         }
         for (std::size_t i = 2 * a_third_of_thread_count; i < 3 * a_third_of_thread_count; ++i) {
-            CHECK(static_cast<std::size_t>(thread_contexts[i].observed_counter_before_end) >= a_third_of_thread_count);
-            CHECK(static_cast<std::size_t>(thread_contexts[i].observed_counter_before_end) < 3 * a_third_of_thread_count);
+            CHECK_EQUAL(phase_arrival_count, thread_contexts[i].observed_second_phase_arrivals);
+        }
+        
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const repeated_phase_count = 200;
+        
+        struct repeated_phases_context {
+            amp_barrier_t barrier;
+            std::vector<struct amp_raw_atomic_int32_s>* arrival_counts;
+            std::vector<struct amp_raw_atomic_int32_s>* serial_counts;
+            struct amp_raw_atomic_int32_s* early_pass_count;
+            int32_t thread_count;
+        };
+        
+        
+        // Counts its arrival before each phase and checks that all threads
+        // arrived after passing the barrier.
+        void repeated_phases_thread_func(void* ctxt);
+        void repeated_phases_thread_func(void* ctxt)
+        {
+            struct repeated_phases_context* context = static_cast<struct repeated_phases_context*>(ctxt);
+            
+            for (std::size_t phase = 0; phase < repeated_phase_count; ++phase) {
+                (void)amp_atomic_int32_fetch_add(&(*context->arrival_counts)[phase], 1);
+                
+                int const rc = amp_barrier_wait(context->barrier);
+                assert(AMP_SUCCESS == rc || AMP_BARRIER_SERIAL_THREAD == rc);
+                
+                if (AMP_BARRIER_SERIAL_THREAD == rc) {
+                    (void)amp_atomic_int32_fetch_add(&(*context->serial_counts)[phase], 1);
+                }
+                
+                if (context->thread_count != amp_atomic_int32_load(&(*context->arrival_counts)[phase])) {
+                    (void)amp_atomic_int32_fetch_add(context->early_pass_count, 1);
+                }
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    TEST(repeated_phases_have_exactly_one_serial_thread)
+    {
+        // Not a multiple of common tree fan-ins.
+        std::size_t const thread_count = 9;
+        
+        amp_barrier_t barrier = AMP_BARRIER_UNINITIALIZED;
+        int retval = amp_barrier_create(&barrier,
+                                        AMP_DEFAULT_ALLOCATOR,
+                                        static_cast<amp_barrier_count_t>(thread_count));
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_int32_s const zero = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        std::vector<struct amp_raw_atomic_int32_s> arrival_counts(repeated_phase_count, zero);
+        std::vector<struct amp_raw_atomic_int32_s> serial_counts(repeated_phase_count, zero);
+        struct amp_raw_atomic_int32_s early_pass_count = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        
+        struct repeated_phases_context context = {
+            barrier,
+            &arrival_counts,
+            &serial_counts,
+            &early_pass_count,
+            static_cast<int32_t>(thread_count)
+        };
+        
+        amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&threads,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_configure(threads,
+                                            0,
+                                            thread_count,
+                                            &context,
+                                            &repeated_phases_thread_func);
+        assert(AMP_SUCCESS == retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_join_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_barrier_destroy(&barrier,
+                                     AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, amp_atomic_int32_load(&early_pass_count));
+        
+        for (std::size_t phase = 0; phase < repeated_phase_count; ++phase) {
+            CHECK_EQUAL(1, amp_atomic_int32_load(&serial_counts[phase]));
+        }
+    }
+    
+    
+    
+    TEST(timedwait_withdraws_arrival_on_timeout)
+    {
+        amp_barrier_t barrier = AMP_BARRIER_UNINITIALIZED;
+        int retval = amp_barrier_create(&barrier,
+                                        AMP_DEFAULT_ALLOCATOR,
+                                        1 + 1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // 10 milliseconds.
+        retval = amp_barrier_timedwait(barrier, 10000000);
+        CHECK_EQUAL(AMP_TIMEOUT, retval);
+        
+        retval = amp_barrier_timedwait(barrier, 0);
+        CHECK_EQUAL(AMP_TIMEOUT, retval);
+        
+        // No arrival left behind - the barrier is destroyable.
+        retval = amp_barrier_destroy(&barrier,
+                                     AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        struct timed_out_arrivals_context {
+            amp_barrier_t barrier;
+            struct amp_raw_atomic_int32_s timeout_count;
+        };
+        
+        
+        void timed_out_arrival_thread_func(void* ctxt);
+        void timed_out_arrival_thread_func(void* ctxt)
+        {
+            struct timed_out_arrivals_context* context = static_cast<struct timed_out_arrivals_context*>(ctxt);
+            
+            // 20 milliseconds.
+            int const rc = amp_barrier_timedwait(context->barrier, 20000000);
+            if (AMP_TIMEOUT == rc) {
+                (void)amp_atomic_int32_fetch_add(&context->timeout_count, 1);
+            }
         }
         
+    } // anonymous namespace
+    
+    
+    TEST(timed_out_arrivals_leave_barrier_usable)
+    {
+        std::size_t const thread_count = 9;
+        
+        amp_barrier_t barrier = AMP_BARRIER_UNINITIALIZED;
+        int retval = amp_barrier_create(&barrier,
+                                        AMP_DEFAULT_ALLOCATOR,
+                                        static_cast<amp_barrier_count_t>(thread_count));
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct timed_out_arrivals_context timeout_context;
+        timeout_context.barrier = barrier;
+        amp_atomic_int32_store(&timeout_context.timeout_count, 0);
+        
+        // One thread short of completing the phase - all time out.
+        amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&threads,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count - 1);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_configure(threads,
+                                            0,
+                                            thread_count - 1,
+                                            &timeout_context,
+                                            &timed_out_arrival_thread_func);
+        assert(AMP_SUCCESS == retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_join_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        CHECK_EQUAL(static_cast<int32_t>(thread_count - 1), 
+                    amp_atomic_int32_load(&timeout_context.timeout_count));
+        
+        // All withdrawn - a full set of threads passes phase after phase.
+        struct amp_raw_atomic_int32_s const zero = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        std::vector<struct amp_raw_atomic_int32_s> arrival_counts(repeated_phase_count, zero);
+        std::vector<struct amp_raw_atomic_int32_s> serial_counts(repeated_phase_count, zero);
+        struct amp_raw_atomic_int32_s early_pass_count = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        
+        struct repeated_phases_context context = {
+            barrier,
+            &arrival_counts,
+            &serial_counts,
+            &early_pass_count,
+            static_cast<int32_t>(thread_count)
+        };
+        
+        retval = amp_thread_array_create(&threads,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_configure(threads,
+                                            0,
+                                            thread_count,
+                                            &context,
+                                            &repeated_phases_thread_func);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_launch_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_join_all(threads, &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_barrier_destroy(&barrier,
+                                     AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, amp_atomic_int32_load(&early_pass_count));
+        
+        for (std::size_t phase = 0; phase < repeated_phase_count; ++phase) {
+            CHECK_EQUAL(1, amp_atomic_int32_load(&serial_counts[phase]));
+        }
     }
     
     
@@ -575,6 +575,139 @@ SUITE(amp_condition_variable)
     
     
     
+    TEST(timedwait_times_out_and_relocks_mutex)
+    {
+        amp_mutex_t mutex = AMP_MUTEX_UNINITIALIZED;
+        int retval = amp_mutex_create(&mutex,
+                                      AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        amp_condition_variable_t cond = AMP_CONDITION_VARIABLE_UNINITIALIZED;
+        retval = amp_condition_variable_create(&cond,
+                                               AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_lock(mutex);
+        assert(AMP_SUCCESS == retval);
+        
+        // 10 milliseconds. No thread signals, spurious wakeups are possible.
+        do {
+            retval = amp_condition_variable_timedwait(cond, mutex, 10000000);
+        } while (AMP_SUCCESS == retval);
+        CHECK_EQUAL(AMP_TIMEOUT, retval);
+        
+        // Mutex is owned by this thread again.
+        retval = amp_mutex_unlock(mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_condition_variable_destroy(&cond,
+                                                AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_destroy(&mutex,
+                                   AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+    }
+    
+    
+    
+    namespace {
+        
+        void cond_timed_waiting_thread_func(void *ctxt)
+        {
+            struct mutex_with_cond_s *context = static_cast<struct mutex_with_cond_s*>(ctxt);
+            
+            int retval = amp_mutex_lock(context->mutex);
+            assert(AMP_SUCCESS == retval);
+            
+            context->state = state_waiting_flag;
+            
+            retval = amp_semaphore_signal(context->ready_for_signal_sem);
+            assert(AMP_SUCCESS == retval);
+            
+            // 10 seconds - far longer than the test needs.
+            while (state_waiting_flag == context->state) {
+                retval = amp_condition_variable_timedwait(context->cond, 
+                                                          context->mutex,
+                                                          static_cast<uint64_t>(10) * 1000000000u);
+                if (AMP_SUCCESS != retval) {
+                    break;
+                }
+            }
+            
+            if (AMP_SUCCESS == retval) {
+                context->state = state_awake_after_waiting_flag;
+            }
+            
+            retval = amp_mutex_unlock(context->mutex);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(single_timed_waiting_thread_and_signal)
+    {
+        struct mutex_with_cond_s mwc;
+        
+        int retval = amp_mutex_create(&mwc.mutex,
+                                      AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_condition_variable_create(&mwc.cond,
+                                               AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_create(&mwc.ready_for_signal_sem,
+                                      AMP_DEFAULT_ALLOCATOR, 
+                                      0);
+        assert(AMP_SUCCESS == retval);
+        
+        mwc.state = state_initialized_flag;
+        
+        amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+        retval = amp_thread_create_and_launch(&thread, 
+                                              AMP_DEFAULT_ALLOCATOR,
+                                              &mwc, 
+                                              &cond_timed_waiting_thread_func);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_semaphore_wait(mwc.ready_for_signal_sem);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_mutex_lock(mwc.mutex);
+        assert(AMP_SUCCESS == retval);
+        
+        mwc.state = state_initialized_flag;
+        
+        retval = amp_condition_variable_signal(mwc.cond);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_unlock(mwc.mutex);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_join_and_destroy(&thread,
+                                             AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        CHECK_EQUAL(state_awake_after_waiting_flag, mwc.state);
+        
+        retval = amp_semaphore_destroy(&mwc.ready_for_signal_sem, 
+                                       AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_condition_variable_destroy(&mwc.cond,
+                                                AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_destroy(&mwc.mutex,
+                                   AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+    }
+    
+    
+    
     TEST(no_waiting_thread_and_broadcast)
     {
         amp_condition_variable_t cond;
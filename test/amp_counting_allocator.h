@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Counting allocator shared by tests that check that all memory handed out
+ * is returned. It counts allocations and deallocations to detect leaks and
+ * poisons freed nodes to detect accesses after they have been freed.
+ */
+
+#ifndef AMP_amp_counting_allocator_H
+#define AMP_amp_counting_allocator_H
+
+#include <cassert>
+#include <cstddef>
+
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+
+
+
+namespace {
+    
+    int32_t const live_magic = 0x600d;
+    int32_t const freed_magic = 0xdead;
+    
+    struct node {
+        int32_t magic;
+    };
+    
+    
+    // Counts allocations and deallocations and poisons freed nodes.
+    struct counting_context {
+        struct amp_raw_atomic_int64_s alloc_count;
+        struct amp_raw_atomic_int64_s dealloc_count;
+    };
+    
+    
+    void* counting_alloc(void* allocator_context, 
+                         std::size_t bytes_to_allocate,
+                         char const* filename,
+                         int line)
+    {
+        counting_context* context = static_cast<counting_context*>(allocator_context);
+        amp_atomic_int64_fetch_add(&context->alloc_count, 1);
+        
+        return amp_default_alloc(NULL, bytes_to_allocate, filename, line);
+    }
+    
+    
+    void* counting_calloc(void* allocator_context,
+                          std::size_t elem_count,
+                          std::size_t bytes_per_elem,
+                          char const* filename,
+                          int line)
+    {
+        counting_context* context = static_cast<counting_context*>(allocator_context);
+        amp_atomic_int64_fetch_add(&context->alloc_count, 1);
+        
+        return amp_default_calloc(NULL, elem_count, bytes_per_elem, filename, line);
+    }
+    
+    
+    int counting_dealloc(void* allocator_context, 
+                         void* pointer,
+                         char const* filename,
+                         int line)
+    {
+        counting_context* context = static_cast<counting_context*>(allocator_context);
+        amp_atomic_int64_fetch_add(&context->dealloc_count, 1);
+        
+        // All blocks deallocated this way are at least as large as a 
+        // node.
+        static_cast<node*>(pointer)->magic = freed_magic;
+        
+        return amp_default_dealloc(NULL, pointer, filename, line);
+    }
+    
+    
+    struct counting_fixture {
+        counting_fixture()
+        :   allocator(AMP_ALLOCATOR_UNINITIALIZED)
+        {
+            amp_atomic_int64_store(&context.alloc_count, 0);
+            amp_atomic_int64_store(&context.dealloc_count, 0);
+            
+            int const retval = amp_allocator_create(&allocator,
+                                                    AMP_DEFAULT_ALLOCATOR,
+                                                    &context,
+                                                    &counting_alloc,
+                                                    &counting_calloc,
+                                                    &counting_dealloc);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+        }
+        
+        
+        ~counting_fixture()
+        {
+            int const retval = amp_allocator_destroy(&allocator, 
+                                                     AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+        }
+        
+        
+        int64_t alloc_count()
+        {
+            return amp_atomic_int64_load(&context.alloc_count);
+        }
+        
+        
+        int64_t dealloc_count()
+        {
+            return amp_atomic_int64_load(&context.dealloc_count);
+        }
+        
+        
+        node* create_node()
+        {
+            node* n = static_cast<node*>(AMP_ALLOC(allocator, sizeof(node)));
+            assert(NULL != n);
+            n->magic = live_magic;
+            
+            return n;
+        }
+        
+        
+        counting_context context;
+        amp_allocator_t allocator;
+    };
+    
+} // anonymous namespace
+
+
+
+#endif /* AMP_amp_counting_allocator_H */
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_epoch.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_epoch.h>
+#include <amp/amp_thread.h>
+#include <amp/amp_thread_array.h>
+
+#include "amp_counting_allocator.h"
+
+
+
+SUITE(amp_epoch)
+{
+    TEST_FIXTURE(counting_fixture, destroy_frees_retired_nodes)
+    {
+        std::size_t const node_count = 100;
+        
+        amp_epoch_t epoch = AMP_EPOCH_UNINITIALIZED;
+        int retval = amp_epoch_create(&epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < node_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_epoch_retire(epoch, create_node()));
+        }
+        
+        retval = amp_epoch_destroy(&epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_EPOCH_UNINITIALIZED == epoch);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, nodes_retired_in_region_survive_until_exit)
+    {
+        std::size_t const node_count = 200;
+        
+        amp_epoch_t epoch = AMP_EPOCH_UNINITIALIZED;
+        int retval = amp_epoch_create(&epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // Nested regions.
+        CHECK_EQUAL(AMP_SUCCESS, amp_epoch_enter(epoch));
+        CHECK_EQUAL(AMP_SUCCESS, amp_epoch_enter(epoch));
+        
+        std::vector<node*> nodes(node_count);
+        for (std::size_t i = 0; i < node_count; ++i) {
+            nodes[i] = create_node();
+        }
+        
+        int64_t const dealloc_count_before_retire = dealloc_count();
+        
+        // Retiring more nodes than the collect threshold tries to reclaim.
+        for (std::size_t i = 0; i < node_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_epoch_retire(epoch, nodes[i]));
+        }
+        amp_epoch_exit(epoch);
+        amp_epoch_collect(epoch);
+        amp_epoch_collect(epoch);
+        
+        CHECK_EQUAL(dealloc_count_before_retire, dealloc_count());
+        for (std::size_t i = 0; i < node_count; ++i) {
+            CHECK_EQUAL(live_magic, nodes[i]->magic);
+        }
+        
+        amp_epoch_exit(epoch);
+        
+        // Advances the epoch twice.
+        amp_epoch_collect(epoch);
+        amp_epoch_collect(epoch);
+        
+        CHECK_EQUAL(dealloc_count_before_retire + static_cast<int64_t>(node_count), 
+                    dealloc_count());
+        
+        retval = amp_epoch_destroy(&epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const replacement_count = 20000;
+        
+        struct replace_context {
+            counting_fixture* fixture;
+            amp_epoch_t epoch;
+            struct amp_raw_atomic_pointer_s shared_node;
+            struct amp_raw_atomic_int32_s writer_done;
+            struct amp_raw_atomic_int32_s failure_count;
+        };
+        
+        
+        // Thread 0 replaces the shared node and retires the replaced one,
+        // all other threads read the shared node inside critical regions.
+        // Threads yield outside of critical regions so readers don't stall
+        // reclamation by being preempted inside regions on machines with few
+        // cores.
+        void replace_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            replace_context* context = static_cast<replace_context*>(ctxt);
+            
+            (void)thread_count;
+            
+            if (0 == thread_index) {
+                for (std::size_t i = 0; i < replacement_count; ++i) {
+                    node* old_node = static_cast<node*>(amp_atomic_pointer_exchange(&context->shared_node,
+                                                                                    context->fixture->create_node()));
+                    if (AMP_SUCCESS != amp_epoch_retire(context->epoch, old_node)) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                    }
+                    
+                    if (0 == (i % 64)) {
+                        amp_thread_yield();
+                    }
+                }
+                
+                amp_epoch_collect(context->epoch);
+                amp_atomic_int32_store(&context->writer_done, 1);
+            } else {
+                while (0 == amp_atomic_int32_load(&context->writer_done)) {
+                    if (AMP_SUCCESS != amp_epoch_enter(context->epoch)) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                        continue;
+                    }
+                    
+                    node* n = static_cast<node*>(amp_atomic_pointer_load(&context->shared_node));
+                    if (live_magic != n->magic) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                    }
+                    
+                    amp_epoch_exit(context->epoch);
+                    
+                    amp_thread_yield();
+                }
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, readers_never_see_freed_nodes)
+    {
+        std::size_t const thread_count = 4;
+        
+        replace_context context;
+        context.fixture = this;
+        context.epoch = AMP_EPOCH_UNINITIALIZED;
+        amp_atomic_pointer_store(&context.shared_node, create_node());
+        amp_atomic_int32_store(&context.writer_done, 0);
+        amp_atomic_int32_store(&context.failure_count, 0);
+        
+        int retval = amp_epoch_create(&context.epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_dispatch(thread_array, &replace_func, &context);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, amp_atomic_int32_load(&context.failure_count));
+        
+        // Replaced nodes have been freed before the domain is destroyed.
+        CHECK(0 < dealloc_count());
+        
+        retval = amp_epoch_destroy(&context.epoch, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = AMP_DEALLOC(allocator, amp_atomic_pointer_load(&context.shared_node));
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+} // SUITE(amp_epoch)
+
+
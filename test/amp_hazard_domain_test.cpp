@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_hazard_domain.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_hazard_domain.h>
+#include <amp/amp_thread.h>
+#include <amp/amp_thread_array.h>
+
+#include "amp_counting_allocator.h"
+
+
+
+SUITE(amp_hazard_domain)
+{
+    TEST_FIXTURE(counting_fixture, destroy_frees_retired_nodes)
+    {
+        std::size_t const node_count = 100;
+        
+        amp_hazard_domain_t domain = AMP_HAZARD_DOMAIN_UNINITIALIZED;
+        int retval = amp_hazard_domain_create(&domain, allocator, 2);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < node_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_retire(domain, create_node()));
+        }
+        
+        retval = amp_hazard_domain_destroy(&domain, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_HAZARD_DOMAIN_UNINITIALIZED == domain);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, protected_node_survives_scans)
+    {
+        std::size_t const node_count = 200;
+        
+        // One thread with one slot scans every 2 * 1 + 16 retired nodes.
+        int64_t const max_pending_count = 18;
+        
+        amp_hazard_domain_t domain = AMP_HAZARD_DOMAIN_UNINITIALIZED;
+        int retval = amp_hazard_domain_create(&domain, allocator, 1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_pointer_s shared_node;
+        node* protected_node = create_node();
+        amp_atomic_pointer_store(&shared_node, protected_node);
+        
+        void* node_pointer = NULL;
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_protect(domain, 0, &shared_node, &node_pointer));
+        CHECK_EQUAL(static_cast<void*>(protected_node), node_pointer);
+        
+        // Unlink and retire the protected node first.
+        amp_atomic_pointer_store(&shared_node, NULL);
+        
+        std::vector<node*> nodes(node_count);
+        for (std::size_t i = 0; i < node_count; ++i) {
+            nodes[i] = create_node();
+        }
+        
+        int64_t const dealloc_count_before_retire = dealloc_count();
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_retire(domain, protected_node));
+        for (std::size_t i = 0; i < node_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_retire(domain, nodes[i]));
+        }
+        
+        CHECK_EQUAL(live_magic, protected_node->magic);
+        CHECK(dealloc_count_before_retire + static_cast<int64_t>(node_count) - max_pending_count <= dealloc_count());
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_collect(domain));
+        CHECK_EQUAL(live_magic, protected_node->magic);
+        
+        amp_hazard_domain_clear(domain, 0);
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_collect(domain));
+        
+        CHECK(dealloc_count_before_retire + static_cast<int64_t>(node_count) + 1 <= dealloc_count());
+        
+        retval = amp_hazard_domain_destroy(&domain, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const replacement_count = 20000;
+        
+        struct replace_context {
+            counting_fixture* fixture;
+            amp_hazard_domain_t domain;
+            struct amp_raw_atomic_pointer_s shared_node;
+            struct amp_raw_atomic_int32_s writer_done;
+            struct amp_raw_atomic_int32_s failure_count;
+        };
+        
+        
+        // Thread 0 replaces the shared node and retires the replaced one,
+        // all other threads protect and read the shared node. Readers 
+        // preempted while protecting a node don't stall reclamation.
+        void replace_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            replace_context* context = static_cast<replace_context*>(ctxt);
+            
+            (void)thread_count;
+            
+            if (0 == thread_index) {
+                for (std::size_t i = 0; i < replacement_count; ++i) {
+                    node* old_node = static_cast<node*>(amp_atomic_pointer_exchange(&context->shared_node,
+                                                                                    context->fixture->create_node()));
+                    if (AMP_SUCCESS != amp_hazard_domain_retire(context->domain, old_node)) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                    }
+                }
+                
+                if (AMP_SUCCESS != amp_hazard_domain_collect(context->domain)) {
+                    amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                }
+                amp_atomic_int32_store(&context->writer_done, 1);
+            } else {
+                while (0 == amp_atomic_int32_load(&context->writer_done)) {
+                    void* node_pointer = NULL;
+                    if (AMP_SUCCESS != amp_hazard_domain_protect(context->domain, 
+                                                                 0, 
+                                                                 &context->shared_node, 
+                                                                 &node_pointer)) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                        continue;
+                    }
+                    
+                    if (live_magic != static_cast<node*>(node_pointer)->magic) {
+                        amp_atomic_int32_fetch_add(&context->failure_count, 1);
+                    }
+                    
+                    amp_hazard_domain_clear(context->domain, 0);
+                }
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, readers_never_see_freed_nodes)
+    {
+        std::size_t const thread_count = 4;
+        
+        replace_context context;
+        context.fixture = this;
+        context.domain = AMP_HAZARD_DOMAIN_UNINITIALIZED;
+        amp_atomic_pointer_store(&context.shared_node, create_node());
+        amp_atomic_int32_store(&context.writer_done, 0);
+        amp_atomic_int32_store(&context.failure_count, 0);
+        
+        int retval = amp_hazard_domain_create(&context.domain, allocator, 1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_dispatch(thread_array, &replace_func, &context);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, amp_atomic_int32_load(&context.failure_count));
+        
+        // The final scan keeps at most one node per hazard slot.
+        CHECK(static_cast<int64_t>(replacement_count - thread_count) <= dealloc_count());
+        
+        retval = amp_hazard_domain_destroy(&context.domain, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = AMP_DEALLOC(allocator, amp_atomic_pointer_load(&context.shared_node));
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+    
+    
+    namespace {
+        
+        struct release_context {
+            counting_fixture* fixture;
+            amp_hazard_domain_t domain;
+            node* protected_node;
+            int32_t failure_count;
+        };
+        
+        
+        // Retires the node protected by the main thread and a few others,
+        // then releases the record with the protected node still retired.
+        void retire_and_release_func(void* ctxt)
+        {
+            release_context* context = static_cast<release_context*>(ctxt);
+            
+            if (AMP_SUCCESS != amp_hazard_domain_retire(context->domain, context->protected_node)) {
+                ++context->failure_count;
+            }
+            
+            for (std::size_t i = 0; i < 4; ++i) {
+                if (AMP_SUCCESS != amp_hazard_domain_retire(context->domain, context->fixture->create_node())) {
+                    ++context->failure_count;
+                }
+            }
+            
+            if (AMP_SUCCESS != amp_hazard_domain_release(context->domain)) {
+                ++context->failure_count;
+            }
+        }
+        
+        
+        void protect_and_release_func(void* ctxt)
+        {
+            release_context* context = static_cast<release_context*>(ctxt);
+            
+            struct amp_raw_atomic_pointer_s empty_source;
+            amp_atomic_pointer_store(&empty_source, NULL);
+            
+            void* node_pointer = context;
+            if (AMP_SUCCESS != amp_hazard_domain_protect(context->domain, 0, &empty_source, &node_pointer)
+                || NULL != node_pointer) {
+                ++context->failure_count;
+            }
+            
+            if (AMP_SUCCESS != amp_hazard_domain_release(context->domain)) {
+                ++context->failure_count;
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, released_records_are_reused_and_adopted)
+    {
+        release_context context;
+        context.fixture = this;
+        context.domain = AMP_HAZARD_DOMAIN_UNINITIALIZED;
+        context.protected_node = create_node();
+        context.failure_count = 0;
+        
+        int retval = amp_hazard_domain_create(&context.domain, allocator, 1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_pointer_s shared_node;
+        amp_atomic_pointer_store(&shared_node, context.protected_node);
+        
+        void* node_pointer = NULL;
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_protect(context.domain, 0, &shared_node, &node_pointer));
+        CHECK_EQUAL(static_cast<void*>(context.protected_node), node_pointer);
+        amp_atomic_pointer_store(&shared_node, NULL);
+        
+        int64_t const dealloc_count_before_release = dealloc_count();
+        
+        amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+        retval = amp_thread_create_and_launch(&thread,
+                                              AMP_DEFAULT_ALLOCATOR,
+                                              &context,
+                                              &retire_and_release_func);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_thread_join_and_destroy(&thread, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // Only the protected node stays retired in the released record.
+        CHECK_EQUAL(dealloc_count_before_release + 4, dealloc_count());
+        CHECK_EQUAL(live_magic, context.protected_node->magic);
+        
+        // A thread registering later reuses the released record.
+        int64_t const alloc_count_before_reuse = alloc_count();
+        
+        retval = amp_thread_create_and_launch(&thread,
+                                              AMP_DEFAULT_ALLOCATOR,
+                                              &context,
+                                              &protect_and_release_func);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_thread_join_and_destroy(&thread, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count_before_reuse, alloc_count());
+        CHECK_EQUAL(live_magic, context.protected_node->magic);
+        CHECK_EQUAL(0, context.failure_count);
+        
+        // The scan of the main thread adopts the orphaned protected node.
+        int64_t const dealloc_count_before_adoption = dealloc_count();
+        
+        amp_hazard_domain_clear(context.domain, 0);
+        CHECK_EQUAL(AMP_SUCCESS, amp_hazard_domain_collect(context.domain));
+        
+        CHECK_EQUAL(dealloc_count_before_adoption + 1, dealloc_count());
+        
+        retval = amp_hazard_domain_destroy(&context.domain, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+} // SUITE(amp_hazard_domain)
+
+
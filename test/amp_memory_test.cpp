@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_memory.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_mutex.h>
+#include <amp/amp_condition_variable.h>
+#include <amp/amp_semaphore.h>
+#include <amp/amp_barrier.h>
+
+
+
+SUITE(amp_memory)
+{
+    namespace {
+        
+        bool is_aligned(void const* pointer, std::size_t alignment)
+        {
+            return 0 == (reinterpret_cast<std::size_t>(pointer) % alignment);
+        }
+        
+        
+        struct counting_context {
+            std::size_t alloc_count;
+            std::size_t dealloc_count;
+        };
+        
+        
+        void* counting_alloc(void* allocator_context, 
+                             std::size_t bytes_to_allocate,
+                             char const* filename,
+                             int line)
+        {
+            ++(static_cast<counting_context*>(allocator_context)->alloc_count);
+            
+            return amp_default_alloc(NULL, bytes_to_allocate, filename, line);
+        }
+        
+        
+        void* counting_calloc(void* allocator_context,
+                              std::size_t elem_count,
+                              std::size_t bytes_per_elem,
+                              char const* filename,
+                              int line)
+        {
+            ++(static_cast<counting_context*>(allocator_context)->alloc_count);
+            
+            return amp_default_calloc(NULL, elem_count, bytes_per_elem, filename, line);
+        }
+        
+        
+        int counting_dealloc(void* allocator_context, 
+                             void* pointer,
+                             char const* filename,
+                             int line)
+        {
+            ++(static_cast<counting_context*>(allocator_context)->dealloc_count);
+            
+            return amp_default_dealloc(NULL, pointer, filename, line);
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(default_aligned_alloc_aligns)
+    {
+        for (std::size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+            void* pointer = AMP_ALIGNED_ALLOC(AMP_DEFAULT_ALLOCATOR,
+                                              alignment,
+                                              3 * alignment);
+            CHECK(NULL != pointer);
+            CHECK(is_aligned(pointer, alignment));
+            
+            int const retval = AMP_ALIGNED_DEALLOC(AMP_DEFAULT_ALLOCATOR,
+                                                   pointer);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+    }
+    
+    
+    
+    TEST(created_allocator_uses_passed_functions)
+    {
+        // Aligned allocations of created allocators are served by the passed
+        // alloc and dealloc functions, too.
+        
+        counting_context context = {0, 0};
+        
+        amp_allocator_t allocator = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_allocator_create(&allocator,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          &context,
+                                          &counting_alloc,
+                                          &counting_calloc,
+                                          &counting_dealloc);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t expected_count = 0;
+        for (std::size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+            void* pointer = AMP_ALIGNED_ALLOC(allocator, alignment, 3);
+            CHECK(NULL != pointer);
+            CHECK(is_aligned(pointer, alignment));
+            CHECK_EQUAL(++expected_count, context.alloc_count);
+            
+            CHECK_EQUAL(AMP_SUCCESS, AMP_ALIGNED_DEALLOC(allocator, pointer));
+            CHECK_EQUAL(expected_count, context.dealloc_count);
+        }
+        
+        void* pointer = AMP_ALLOC(allocator, 16);
+        CHECK(NULL != pointer);
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(allocator, pointer));
+        CHECK_EQUAL(expected_count + 1, context.alloc_count);
+        CHECK_EQUAL(expected_count + 1, context.dealloc_count);
+        
+        // Primitives created with the allocator use it for their aligned 
+        // memory.
+        amp_mutex_t mutex = AMP_MUTEX_UNINITIALIZED;
+        CHECK_EQUAL(AMP_SUCCESS, amp_mutex_create(&mutex, allocator));
+        CHECK(is_aligned(mutex, AMP_CACHE_LINE_SIZE));
+        CHECK_EQUAL(expected_count + 2, context.alloc_count);
+        CHECK_EQUAL(AMP_SUCCESS, amp_mutex_destroy(&mutex, allocator));
+        CHECK_EQUAL(expected_count + 2, context.dealloc_count);
+        
+        retval = amp_allocator_destroy(&allocator, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_ALLOCATOR_UNINITIALIZED == allocator);
+    }
+    
+    
+    
+    TEST(primitives_are_cache_line_aligned)
+    {
+        std::size_t const primitive_count = 8;
+        
+        amp_mutex_t mutexes[primitive_count];
+        amp_condition_variable_t conds[primitive_count];
+        amp_semaphore_t semaphores[primitive_count];
+        amp_barrier_t barriers[primitive_count];
+        
+        for (std::size_t i = 0; i < primitive_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_mutex_create(&mutexes[i], AMP_DEFAULT_ALLOCATOR));
+            CHECK_EQUAL(AMP_SUCCESS, amp_condition_variable_create(&conds[i], AMP_DEFAULT_ALLOCATOR));
+            CHECK_EQUAL(AMP_SUCCESS, amp_semaphore_create(&semaphores[i], AMP_DEFAULT_ALLOCATOR, 0));
+            CHECK_EQUAL(AMP_SUCCESS, amp_barrier_create(&barriers[i], AMP_DEFAULT_ALLOCATOR, 1));
+            
+            CHECK(is_aligned(mutexes[i], AMP_CACHE_LINE_SIZE));
+            CHECK(is_aligned(conds[i], AMP_CACHE_LINE_SIZE));
+            CHECK(is_aligned(semaphores[i], AMP_CACHE_LINE_SIZE));
+            CHECK(is_aligned(barriers[i], AMP_CACHE_LINE_SIZE));
+        }
+        
+        for (std::size_t i = 0; i < primitive_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, amp_barrier_destroy(&barriers[i], AMP_DEFAULT_ALLOCATOR));
+            CHECK_EQUAL(AMP_SUCCESS, amp_semaphore_destroy(&semaphores[i], AMP_DEFAULT_ALLOCATOR));
+            CHECK_EQUAL(AMP_SUCCESS, amp_condition_variable_destroy(&conds[i], AMP_DEFAULT_ALLOCATOR));
+            CHECK_EQUAL(AMP_SUCCESS, amp_mutex_destroy(&mutexes[i], AMP_DEFAULT_ALLOCATOR));
+        }
+    }
+    
+} // SUITE(amp_memory)
+
+
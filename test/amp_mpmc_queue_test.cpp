@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_mpmc_queue.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_mpmc_queue.h>
+#include <amp/amp_thread_array.h>
+
+
+
+SUITE(amp_mpmc_queue)
+{
+    TEST(create_rounds_capacity_up_to_power_of_two)
+    {
+        std::size_t const capacities[] = {1, 2, 3, 64, 100};
+        std::size_t const expected_capacities[] = {2, 2, 4, 64, 128};
+        
+        for (std::size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); ++i) {
+            amp_mpmc_queue_t queue = AMP_MPMC_QUEUE_UNINITIALIZED;
+            int retval = amp_mpmc_queue_create(&queue, 
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               capacities[i]);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            std::size_t capacity = 0;
+            amp_mpmc_queue_get_capacity(queue, &capacity);
+            CHECK_EQUAL(expected_capacities[i], capacity);
+            
+            retval = amp_mpmc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK(AMP_MPMC_QUEUE_UNINITIALIZED == queue);
+        }
+    }
+    
+    
+    
+    TEST(try_push_and_try_pop_in_fifo_order)
+    {
+        std::size_t const capacity = 4;
+        int elements[capacity + 1];
+        
+        amp_mpmc_queue_t queue = AMP_MPMC_QUEUE_UNINITIALIZED;
+        int retval = amp_mpmc_queue_create(&queue, 
+                                           AMP_DEFAULT_ALLOCATOR,
+                                           capacity);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        void* element = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_mpmc_queue_try_pop(queue, &element));
+        CHECK(NULL == element);
+        
+        // Wrap around the slot array a few times.
+        for (int round = 0; round < 3; ++round) {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                CHECK_EQUAL(AMP_SUCCESS, amp_mpmc_queue_try_push(queue, &elements[i]));
+            }
+            CHECK_EQUAL(AMP_BUSY, amp_mpmc_queue_try_push(queue, &elements[capacity]));
+            
+            for (std::size_t i = 0; i < capacity; ++i) {
+                CHECK_EQUAL(AMP_SUCCESS, amp_mpmc_queue_try_pop(queue, &element));
+                CHECK_EQUAL(static_cast<void*>(&elements[i]), element);
+            }
+            CHECK_EQUAL(AMP_BUSY, amp_mpmc_queue_try_pop(queue, &element));
+        }
+        
+        retval = amp_mpmc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const element_count_per_producer = 20000;
+        
+        struct handoff_context {
+            amp_mpmc_queue_t queue;
+            std::size_t producer_count;
+            std::vector<std::size_t>* pop_counts;
+            std::vector<int>* failures;
+        };
+        
+        
+        // Even threads produce elements encoding their producer index and a
+        // sequence number, odd threads consume and check per-producer order.
+        void handoff_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            handoff_context* context = static_cast<handoff_context*>(ctxt);
+            std::size_t const producer_count = context->producer_count;
+            int failure_count = 0;
+            
+            (void)thread_count;
+            
+            if (0 == (thread_index % 2)) {
+                std::size_t const producer = thread_index / 2;
+                
+                for (std::size_t i = 0; i < element_count_per_producer; ++i) {
+                    std::size_t const value = 1 + producer + i * producer_count;
+                    if (AMP_SUCCESS != amp_mpmc_queue_push(context->queue, 
+                                                           reinterpret_cast<void*>(value))) {
+                        ++failure_count;
+                    }
+                }
+            } else {
+                std::vector<std::size_t> last_sequence(producer_count, 0);
+                std::vector<bool> seen(producer_count, false);
+                
+                for (std::size_t i = 0; i < element_count_per_producer; ++i) {
+                    void* element = NULL;
+                    if (AMP_SUCCESS != amp_mpmc_queue_pop(context->queue, &element)) {
+                        ++failure_count;
+                        continue;
+                    }
+                    
+                    std::size_t const value = reinterpret_cast<std::size_t>(element) - 1;
+                    std::size_t const producer = value % producer_count;
+                    std::size_t const sequence = value / producer_count;
+                    
+                    if (seen[producer] && (sequence <= last_sequence[producer])) {
+                        ++failure_count;
+                    }
+                    seen[producer] = true;
+                    last_sequence[producer] = sequence;
+                    
+                    ++((*context->pop_counts)[producer * element_count_per_producer + sequence]);
+                }
+            }
+            
+            (*context->failures)[thread_index] = failure_count;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(blocking_handoff_between_producers_and_consumers)
+    {
+        std::size_t const thread_count = 8;
+        std::size_t const producer_count = thread_count / 2;
+        
+        amp_mpmc_queue_t queue = AMP_MPMC_QUEUE_UNINITIALIZED;
+        int retval = amp_mpmc_queue_create(&queue, 
+                                           AMP_DEFAULT_ALLOCATOR,
+                                           16);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<std::size_t> pop_counts(producer_count * element_count_per_producer, 0);
+        std::vector<int> failures(thread_count, 0);
+        handoff_context context = {queue, producer_count, &pop_counts, &failures};
+        
+        retval = amp_thread_array_dispatch(thread_array, &handoff_func, &context);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            CHECK_EQUAL(0, failures[i]);
+        }
+        
+        std::size_t wrong_count = 0;
+        for (std::size_t i = 0; i < pop_counts.size(); ++i) {
+            if (1 != pop_counts[i]) {
+                ++wrong_count;
+            }
+        }
+        CHECK_EQUAL(static_cast<std::size_t>(0), wrong_count);
+        
+        void* element = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_mpmc_queue_try_pop(queue, &element));
+        
+        retval = amp_mpmc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+} // SUITE(amp_mpmc_queue)
+
+
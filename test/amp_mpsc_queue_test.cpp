@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_mpsc_queue.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_semaphore.h>
+#include <amp/amp_mpsc_queue.h>
+#include <amp/amp_raw_mpsc_queue.h>
+#include <amp/amp_thread_array.h>
+
+
+
+SUITE(amp_mpsc_queue)
+{
+    namespace {
+        
+        struct element {
+            struct amp_raw_mpsc_queue_node_s node;
+            std::size_t value;
+        };
+        
+        
+        void count_wakeup(void* wakeup_context)
+        {
+            ++(*static_cast<int*>(wakeup_context));
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(try_push_and_try_pop_in_fifo_order)
+    {
+        std::size_t const element_count = 5;
+        element elements[element_count];
+        
+        amp_mpsc_queue_t queue = AMP_MPSC_QUEUE_UNINITIALIZED;
+        int retval = amp_mpsc_queue_create(&queue, 
+                                           AMP_DEFAULT_ALLOCATOR,
+                                           NULL,
+                                           NULL);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_mpsc_queue_node_t node = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_pop(queue, &node));
+        CHECK(NULL == node);
+        
+        // Drain the queue completely a few times to move the stub around.
+        for (int round = 0; round < 3; ++round) {
+            for (std::size_t i = 0; i < element_count; ++i) {
+                elements[i].value = i;
+                amp_mpsc_queue_push(queue, &elements[i].node);
+            }
+            
+            for (std::size_t i = 0; i < element_count; ++i) {
+                CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_pop(queue, &node));
+                CHECK_EQUAL(&elements[i].node, node);
+                CHECK_EQUAL(i, reinterpret_cast<element*>(node)->value);
+            }
+            CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_pop(queue, &node));
+        }
+        
+        retval = amp_mpsc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_MPSC_QUEUE_UNINITIALIZED == queue);
+    }
+    
+    
+    
+    TEST(raw_init_embeds_queue)
+    {
+        struct amp_raw_mpsc_queue_s raw_queue;
+        element single;
+        
+        amp_raw_mpsc_queue_init(&raw_queue, NULL, NULL);
+        
+        amp_mpsc_queue_push(&raw_queue, &single.node);
+        
+        amp_mpsc_queue_node_t node = NULL;
+        CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_pop(&raw_queue, &node));
+        CHECK_EQUAL(&single.node, node);
+        CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_pop(&raw_queue, &node));
+        
+        amp_raw_mpsc_queue_finalize(&raw_queue);
+    }
+    
+    
+    
+    TEST(wakeup_only_on_push_to_sleeping_consumer)
+    {
+        element elements[3];
+        int wakeup_count = 0;
+        
+        amp_mpsc_queue_t queue = AMP_MPSC_QUEUE_UNINITIALIZED;
+        int retval = amp_mpsc_queue_create(&queue, 
+                                           AMP_DEFAULT_ALLOCATOR,
+                                           &count_wakeup,
+                                           &wakeup_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // Awake consumer, no wake-ups.
+        amp_mpsc_queue_push(queue, &elements[0].node);
+        CHECK_EQUAL(0, wakeup_count);
+        
+        // Non-empty queue, consumer can't sleep.
+        CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_sleep(queue));
+        
+        amp_mpsc_queue_node_t node = NULL;
+        CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_pop(queue, &node));
+        
+        // Only the first push after sleeping wakes up the consumer.
+        CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_sleep(queue));
+        amp_mpsc_queue_push(queue, &elements[1].node);
+        CHECK_EQUAL(1, wakeup_count);
+        amp_mpsc_queue_push(queue, &elements[2].node);
+        CHECK_EQUAL(1, wakeup_count);
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_pop(queue, &node));
+        CHECK_EQUAL(&elements[1].node, node);
+        CHECK_EQUAL(AMP_SUCCESS, amp_mpsc_queue_try_pop(queue, &node));
+        CHECK_EQUAL(&elements[2].node, node);
+        CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_pop(queue, &node));
+        
+        retval = amp_mpsc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const element_count_per_producer = 20000;
+        
+        struct mailbox_context {
+            amp_mpsc_queue_t queue;
+            amp_semaphore_t wakeup_semaphore;
+            std::vector<element>* elements;
+            std::vector<std::size_t>* pop_counts;
+            int failure_count;
+        };
+        
+        
+        // Thread 0 consumes and sleeps on the semaphore while the queue is 
+        // empty, all other threads produce their range of elements.
+        void mailbox_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            mailbox_context* context = static_cast<mailbox_context*>(ctxt);
+            std::size_t const producer_count = thread_count - 1;
+            
+            if (0 != thread_index) {
+                std::size_t const producer = thread_index - 1;
+                
+                for (std::size_t i = 0; i < element_count_per_producer; ++i) {
+                    element* e = &(*context->elements)[producer * element_count_per_producer + i];
+                    e->value = producer * element_count_per_producer + i;
+                    amp_mpsc_queue_push(context->queue, &e->node);
+                }
+            } else {
+                std::vector<std::size_t> next_sequence(producer_count, 0);
+                std::size_t popped_count = 0;
+                
+                while (popped_count < producer_count * element_count_per_producer) {
+                    amp_mpsc_queue_node_t node = NULL;
+                    
+                    if (AMP_SUCCESS == amp_mpsc_queue_try_pop(context->queue, &node)) {
+                        std::size_t const value = reinterpret_cast<element*>(node)->value;
+                        std::size_t const producer = value / element_count_per_producer;
+                        std::size_t const sequence = value % element_count_per_producer;
+                        
+                        if (sequence != next_sequence[producer]) {
+                            ++(context->failure_count);
+                        }
+                        next_sequence[producer] = sequence + 1;
+                        
+                        ++((*context->pop_counts)[value]);
+                        ++popped_count;
+                    } else if (AMP_SUCCESS == amp_mpsc_queue_try_sleep(context->queue)) {
+                        if (AMP_SUCCESS != amp_semaphore_wait(context->wakeup_semaphore)) {
+                            ++(context->failure_count);
+                        }
+                    }
+                }
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(producers_wake_sleeping_consumer)
+    {
+        std::size_t const thread_count = 5;
+        std::size_t const producer_count = thread_count - 1;
+        
+        amp_semaphore_t semaphore = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&semaphore, AMP_DEFAULT_ALLOCATOR, 0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_mpsc_queue_t queue = AMP_MPSC_QUEUE_UNINITIALIZED;
+        retval = amp_mpsc_queue_create(&queue, 
+                                       AMP_DEFAULT_ALLOCATOR,
+                                       &amp_mpsc_queue_semaphore_wakeup,
+                                       semaphore);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<element> elements(producer_count * element_count_per_producer);
+        std::vector<std::size_t> pop_counts(producer_count * element_count_per_producer, 0);
+        mailbox_context context = {queue, semaphore, &elements, &pop_counts, 0};
+        
+        retval = amp_thread_array_dispatch(thread_array, &mailbox_func, &context);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, context.failure_count);
+        
+        std::size_t wrong_count = 0;
+        for (std::size_t i = 0; i < pop_counts.size(); ++i) {
+            if (1 != pop_counts[i]) {
+                ++wrong_count;
+            }
+        }
+        CHECK_EQUAL(static_cast<std::size_t>(0), wrong_count);
+        
+        amp_mpsc_queue_node_t node = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_mpsc_queue_try_pop(queue, &node));
+        
+        retval = amp_mpsc_queue_destroy(&queue, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_destroy(&semaphore, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+} // SUITE(amp_mpsc_queue)
+
+
@@ -221,6 +221,62 @@ SUITE(amp_mutex)
         CHECK_EQUAL(AMP_SUCCESS, retval);
     }
     
+    namespace
+    {
+        void timed_out_timedlock_thread_func(void *ctxt)
+        {
+            struct mutex_and_one_check_flag_s *context = 
+            static_cast<struct mutex_and_one_check_flag_s*>(ctxt);
+            
+            // 10 milliseconds.
+            int const retval = amp_mutex_timedlock(context->mutex, 10000000);
+            if (AMP_TIMEOUT == retval) {
+                context->check_flag = CHECK_FLAG_SET;
+            }
+        }
+        
+    } // anonymous namespace
+    
+    TEST(two_threads_one_locks_one_timedlocks)
+    {
+        struct mutex_and_one_check_flag_s mutex_and_flag;
+        mutex_and_flag.check_flag = CHECK_FLAG_UNSET;
+        
+        int retval = amp_mutex_create(&mutex_and_flag.mutex,
+                                      AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_lock(mutex_and_flag.mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+        retval = amp_thread_create_and_launch(&thread,
+                                              AMP_DEFAULT_ALLOCATOR,
+                                              &mutex_and_flag, 
+                                              &timed_out_timedlock_thread_func);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_thread_join_and_destroy(&thread,
+                                             AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        CHECK_EQUAL(CHECK_FLAG_SET, mutex_and_flag.check_flag);
+        
+        retval = amp_mutex_unlock(mutex_and_flag.mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // An unlocked mutex is locked even with a zero timeout.
+        retval = amp_mutex_timedlock(mutex_and_flag.mutex, 0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_unlock(mutex_and_flag.mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_destroy(&mutex_and_flag.mutex,
+                                   AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
     // The following test will trigger an assert if NDEBUG isn't defined
     // and will result in undefined behavior if it is defined. Therefore
     // it makes no sense to run the test at all as long as the documented
@@ -438,6 +494,115 @@ SUITE(amp_mutex)
                                    AMP_DEFAULT_ALLOCATOR);
         CHECK_EQUAL(AMP_SUCCESS, retval);
         
+    }    
+    
+    namespace
+    {
+        size_t const contended_iteration_count = 20000;
+        
+        struct contended_counter_s {
+            amp_mutex_t mutex;
+            size_t count;
+        };
+        
+        void contended_increment_thread_func(void *ctxt)
+        {
+            struct contended_counter_s *context = 
+                static_cast<struct contended_counter_s*>(ctxt);
+            
+            for (size_t i = 0; i < contended_iteration_count; ++i) {
+                int retval = amp_mutex_lock(context->mutex);
+                assert(AMP_SUCCESS == retval);
+                
+                ++(context->count);
+                
+                retval = amp_mutex_unlock(context->mutex);
+                assert(AMP_SUCCESS == retval);
+            }
+        }
+        
+        
+        size_t run_contended_increments(amp_mutex_t mutex,
+                                        size_t thread_count)
+        {
+            struct contended_counter_s counter;
+            counter.mutex = mutex;
+            counter.count = 0;
+            
+            amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+            int retval = amp_thread_array_create(&threads,
+                                                 AMP_DEFAULT_ALLOCATOR,
+                                                 thread_count);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_array_configure(threads,
+                                                0,
+                                                thread_count,
+                                                &counter,
+                                                &contended_increment_thread_func);
+            assert(AMP_SUCCESS == retval);
+            
+            size_t joinable_count = 0;
+            retval = amp_thread_array_launch_all(threads, &joinable_count);
+            assert(AMP_SUCCESS == retval);
+            assert(thread_count == joinable_count);
+            
+            retval = amp_thread_array_join_all(threads, &joinable_count);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_array_destroy(&threads,
+                                              AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+            
+            return counter.count;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(many_threads_contend_for_short_critical_sections)
+    {
+        size_t const thread_count = 8;
+        
+        amp_mutex_t mutex = AMP_MUTEX_UNINITIALIZED;
+        int retval = amp_mutex_create(&mutex,
+                                      AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(thread_count * contended_iteration_count,
+                    run_contended_increments(mutex, thread_count));
+        
+        retval = amp_mutex_destroy(&mutex,
+                                   AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(many_threads_contend_for_spinning_mutex)
+    {
+        size_t const thread_count = 8;
+        unsigned int const spin_count = 200;
+        
+        amp_mutex_t mutex = AMP_MUTEX_UNINITIALIZED;
+        int retval = amp_mutex_create_with_spin(&mutex,
+                                                AMP_DEFAULT_ALLOCATOR,
+                                                spin_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_mutex_trylock(mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_mutex_unlock(mutex);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(thread_count * contended_iteration_count,
+                    run_contended_increments(mutex, thread_count));
+        
+        retval = amp_mutex_destroy(&mutex,
+                                   AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
     }
     
     
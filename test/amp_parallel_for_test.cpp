@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_parallel_for.
+ */
+
+#include <UnitTest++.h>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_platform.h>
+#include <amp/amp_thread.h>
+#include <amp/amp_thread_local_slot.h>
+#include <amp/amp_thread_pool.h>
+#include <amp/amp_parallel_for.h>
+
+
+
+SUITE(amp_parallel_for)
+{
+    namespace {
+        
+        std::size_t const range_begin = 7;
+        std::size_t const range_end = 10007;
+        std::size_t const concurrency_level = 4;
+        
+        amp_parallel_for_schedule_t const schedules[] = {
+            AMP_PARALLEL_FOR_SCHEDULE_STATIC,
+            AMP_PARALLEL_FOR_SCHEDULE_DYNAMIC,
+            AMP_PARALLEL_FOR_SCHEDULE_GUIDED
+        };
+        std::size_t const schedule_count = sizeof(schedules) / sizeof(schedules[0]);
+        
+        
+        // Counts how often each index of the range has been visited.
+        struct visit_context {
+            std::vector<struct amp_raw_atomic_int32_s> visits;
+            struct amp_raw_atomic_int32_s empty_chunk_count;
+            std::size_t grain;
+            struct amp_raw_atomic_int32_s small_chunk_count;
+        };
+        
+        
+        void visit_func(void* ctxt, std::size_t chunk_begin, std::size_t chunk_end);
+        void visit_func(void* ctxt, std::size_t chunk_begin, std::size_t chunk_end)
+        {
+            struct visit_context* context = static_cast<struct visit_context*>(ctxt);
+            
+            if (chunk_begin >= chunk_end) {
+                (void)amp_atomic_int32_fetch_add(&context->empty_chunk_count, 1);
+                return;
+            }
+            
+            // Only the last chunk may be smaller than the grain.
+            if ((chunk_end - chunk_begin < context->grain) && (range_end != chunk_end)) {
+                (void)amp_atomic_int32_fetch_add(&context->small_chunk_count, 1);
+            }
+            
+            for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+                (void)amp_atomic_int32_fetch_add(&context->visits[i - range_begin], 1);
+            }
+        }
+        
+        
+        void reset(struct visit_context& context, std::size_t grain);
+        void reset(struct visit_context& context, std::size_t grain)
+        {
+            struct amp_raw_atomic_int32_s const zero = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+            
+            context.visits.assign(range_end - range_begin, zero);
+            context.empty_chunk_count = zero;
+            context.grain = grain;
+            context.small_chunk_count = zero;
+        }
+        
+        
+        std::size_t count_not_visited_once(struct visit_context& context);
+        std::size_t count_not_visited_once(struct visit_context& context)
+        {
+            std::size_t count = 0;
+            
+            for (std::size_t i = 0; i < context.visits.size(); ++i) {
+                if (1 != amp_atomic_int32_load(&context.visits[i])) {
+                    ++count;
+                }
+            }
+            
+            return count;
+        }
+        
+        
+        // Counts the distinct threads calling arrival_func.
+        struct arrival_context {
+            amp_thread_local_slot_key_t slot;
+            struct amp_raw_atomic_int32_s arrival_count;
+            int32_t expected_arrival_count;
+        };
+        
+        
+        // On its first call on a thread arrival_func registers the thread and
+        // waits a bounded time for the expected number of threads to arrive
+        // so a single fast thread can't claim all chunks.
+        void arrival_func(void* ctxt, std::size_t chunk_begin, std::size_t chunk_end);
+        void arrival_func(void* ctxt, std::size_t chunk_begin, std::size_t chunk_end)
+        {
+            (void)chunk_begin;
+            (void)chunk_end;
+            
+            struct arrival_context* context = static_cast<struct arrival_context*>(ctxt);
+            
+            if (NULL != amp_thread_local_slot_value(context->slot)) {
+                return;
+            }
+            
+            int retval = amp_thread_local_slot_set_value(context->slot, context);
+            assert(AMP_SUCCESS == retval);
+            
+            (void)amp_atomic_int32_fetch_add(&context->arrival_count, 1);
+            
+            for (std::size_t i = 0; i < 1000000; ++i) {
+                if (amp_atomic_int32_load(&context->arrival_count) >= context->expected_arrival_count) {
+                    break;
+                }
+                
+                retval = amp_thread_yield();
+                assert(AMP_SUCCESS == retval);
+            }
+            
+            (void)retval;
+        }
+        
+        
+        // Returns the platform concurrency level or 1 if it can't be queried.
+        std::size_t query_platform_concurrency_level();
+        std::size_t query_platform_concurrency_level()
+        {
+            amp_platform_t platform = AMP_PLATFORM_UNINITIALIZED;
+            std::size_t level = 0;
+            
+            int retval = amp_platform_create(&platform, AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_platform_get_concurrency_level(platform, &level);
+            if ((AMP_SUCCESS != retval) || (0 == level)) {
+                level = 1;
+            }
+            
+            retval = amp_platform_destroy(&platform, AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+            
+            return level;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(each_schedule_visits_each_index_exactly_once)
+    {
+        std::size_t const grains[] = {0, 1, 13, 20000};
+        
+        struct visit_context context;
+        
+        for (std::size_t s = 0; s < schedule_count; ++s) {
+            for (std::size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g) {
+                reset(context, grains[g]);
+                
+                int const retval = amp_parallel_for(AMP_DEFAULT_ALLOCATOR,
+                                                    concurrency_level,
+                                                    range_begin,
+                                                    range_end,
+                                                    grains[g],
+                                                    &visit_func,
+                                                    &context,
+                                                    schedules[s]);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+                CHECK_EQUAL(0u, count_not_visited_once(context));
+                CHECK_EQUAL(0, amp_atomic_int32_load(&context.empty_chunk_count));
+                
+                if (AMP_PARALLEL_FOR_SCHEDULE_STATIC != schedules[s]) {
+                    CHECK_EQUAL(0, amp_atomic_int32_load(&context.small_chunk_count));
+                }
+            }
+        }
+    }
+    
+    
+    
+    TEST(empty_range_calls_no_function)
+    {
+        struct visit_context context;
+        
+        for (std::size_t s = 0; s < schedule_count; ++s) {
+            reset(context, 1);
+            
+            int const retval = amp_parallel_for(AMP_DEFAULT_ALLOCATOR,
+                                                concurrency_level,
+                                                range_begin,
+                                                range_begin,
+                                                1,
+                                                &visit_func,
+                                                &context,
+                                                schedules[s]);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(0, amp_atomic_int32_load(&context.empty_chunk_count));
+            CHECK_EQUAL(context.visits.size(), count_not_visited_once(context));
+        }
+    }
+    
+    
+    
+    // On single core platforms the loop legitimately runs on one thread,
+    // elsewhere it must use more than one.
+    TEST(zero_concurrency_level_uses_platform_concurrency_level)
+    {
+        std::size_t const platform_level = query_platform_concurrency_level();
+        
+        struct arrival_context context;
+        struct amp_raw_atomic_int32_s const zero = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        context.arrival_count = zero;
+        context.expected_arrival_count = static_cast<int32_t>(platform_level);
+        
+        int retval = amp_thread_local_slot_create(&context.slot,
+                                                  AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_parallel_for(AMP_DEFAULT_ALLOCATOR,
+                                  0,
+                                  range_begin,
+                                  range_end,
+                                  1,
+                                  &arrival_func,
+                                  &context,
+                                  AMP_PARALLEL_FOR_SCHEDULE_DYNAMIC);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(static_cast<int32_t>(platform_level),
+                    amp_atomic_int32_load(&context.arrival_count));
+        
+        retval = amp_thread_local_slot_set_value(context.slot, NULL);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_local_slot_destroy(&context.slot,
+                                               AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(each_schedule_visits_each_index_exactly_once_in_pool)
+    {
+        std::size_t const worker_count = 4;
+        std::size_t const grains[] = {1, 13, 20000};
+        
+        amp_thread_pool_t pool = AMP_THREAD_POOL_UNINITIALIZED;
+        int retval = amp_thread_pool_create(&pool,
+                                            AMP_DEFAULT_ALLOCATOR,
+                                            worker_count,
+                                            0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct visit_context context;
+        
+        for (std::size_t s = 0; s < schedule_count; ++s) {
+            for (std::size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g) {
+                reset(context, grains[g]);
+                
+                retval = amp_parallel_for_in_pool(pool,
+                                                  AMP_DEFAULT_ALLOCATOR,
+                                                  range_begin,
+                                                  range_end,
+                                                  grains[g],
+                                                  &visit_func,
+                                                  &context,
+                                                  schedules[s]);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+                CHECK_EQUAL(0u, count_not_visited_once(context));
+                CHECK_EQUAL(0, amp_atomic_int32_load(&context.empty_chunk_count));
+            }
+        }
+        
+        retval = amp_thread_pool_destroy(&pool,
+                                         AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+} // SUITE(amp_parallel_for)
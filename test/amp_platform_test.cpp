@@ -338,6 +338,94 @@ SUITE(amp_platform)
     
     
     
+    TEST_FIXTURE(amp_platform_test_fixture, topology_count_no_argument_change_on_error)
+    {
+        size_t const count_init_value = 666;
+        size_t count_that_must_not_be_touched_on_error = count_init_value;
+        int const error_code = amp_platform_get_topology_hwthread_count(platform, &count_that_must_not_be_touched_on_error);
+        
+        if (AMP_SUCCESS != error_code) {
+            CHECK_EQUAL(AMP_UNSUPPORTED, error_code);
+            CHECK(count_init_value == count_that_must_not_be_touched_on_error);
+        }
+    }
+    
+    
+    
+    TEST_FIXTURE(amp_platform_test_fixture, topology_hwthreads_are_consistent)
+    {
+        size_t hwthread_count = 0;
+        int error_code = amp_platform_get_topology_hwthread_count(platform, 
+                                                                  &hwthread_count);
+        if (AMP_SUCCESS != error_code) {
+            return;
+        }
+        
+        CHECK(0 < hwthread_count);
+        
+        size_t active_hwthread_count = 0;
+        error_code = amp_platform_get_active_hwthread_count(platform,
+                                                            &active_hwthread_count);
+        if (AMP_SUCCESS == error_code) {
+            CHECK_EQUAL(active_hwthread_count, hwthread_count);
+        }
+        
+        for (size_t i = 0; i < hwthread_count; ++i) {
+            struct amp_platform_hwthread_info_s info;
+            error_code = amp_platform_get_hwthread_info(platform, i, &info);
+            CHECK_EQUAL(AMP_SUCCESS, error_code);
+            
+            CHECK(0 < info.smt_sibling_count);
+            
+            if (0 < i) {
+                struct amp_platform_hwthread_info_s previous_info;
+                error_code = amp_platform_get_hwthread_info(platform, i - 1, &previous_info);
+                CHECK_EQUAL(AMP_SUCCESS, error_code);
+                CHECK(previous_info.os_id < info.os_id);
+            }
+            
+            for (size_t level = 0; level < AMP_PLATFORM_CACHE_LEVEL_COUNT; ++level) {
+                if (0 != info.caches[level].size_in_bytes) {
+                    CHECK(0 < info.caches[level].sharing_hwthread_count);
+                    CHECK(info.caches[level].sharing_id <= info.os_id);
+                }
+            }
+        }
+    }
+    
+    
+    
+    TEST_FIXTURE(amp_platform_test_fixture, topology_counts_are_ordered)
+    {
+        size_t hwthread_count = 0;
+        size_t core_count = 0;
+        size_t package_count = 0;
+        size_t numa_node_count = 0;
+        
+        int error_code = amp_platform_get_topology_hwthread_count(platform, 
+                                                                  &hwthread_count);
+        if (AMP_SUCCESS != error_code) {
+            CHECK_EQUAL(AMP_UNSUPPORTED, amp_platform_get_package_count(platform, &package_count));
+            CHECK_EQUAL(AMP_UNSUPPORTED, amp_platform_get_numa_node_count(platform, &numa_node_count));
+            return;
+        }
+        
+        error_code = amp_platform_get_topology_core_count(platform, &core_count);
+        CHECK_EQUAL(AMP_SUCCESS, error_code);
+        error_code = amp_platform_get_package_count(platform, &package_count);
+        CHECK_EQUAL(AMP_SUCCESS, error_code);
+        error_code = amp_platform_get_numa_node_count(platform, &numa_node_count);
+        CHECK_EQUAL(AMP_SUCCESS, error_code);
+        
+        CHECK(0 < package_count);
+        CHECK(package_count <= core_count);
+        CHECK(core_count <= hwthread_count);
+        CHECK(0 < numa_node_count);
+        CHECK(numa_node_count <= hwthread_count);
+    }
+    
+    
+    
     TEST(memory_allocation_and_deallocation)
     {
         amp_platform_t platform;
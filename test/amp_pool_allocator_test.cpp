@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_pool_allocator.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_pool_allocator.h>
+#include <amp/amp_mutex.h>
+#include <amp/amp_semaphore.h>
+#include <amp/amp_thread_array.h>
+
+#include "amp_counting_allocator.h"
+
+
+
+SUITE(amp_pool_allocator)
+{
+    TEST(create_and_destroy)
+    {
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               64 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_pool_allocator_destroy(&pool, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_ALLOCATOR_UNINITIALIZED == pool);
+    }
+    
+    
+    
+    TEST(deallocated_blocks_are_reused_by_same_size_class)
+    {
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               64 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        void* small = AMP_ALLOC(pool, 24);
+        void* large = AMP_ALLOC(pool, 200);
+        CHECK(NULL != small);
+        CHECK(NULL != large);
+        CHECK(small != large);
+        CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(small) % 16);
+        CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(large) % AMP_CACHE_LINE_SIZE);
+        
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, small));
+        CHECK_EQUAL(small, AMP_ALLOC(pool, 32));
+        
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, large));
+        CHECK_EQUAL(large, AMP_ALLOC(pool, 256));
+        
+        int* zeroed = static_cast<int*>(AMP_CALLOC(pool, 16, sizeof(int)));
+        CHECK(NULL != zeroed);
+        for (int i = 0; i < 16; ++i) {
+            CHECK_EQUAL(0, zeroed[i]);
+        }
+        
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, zeroed));
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, large));
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, small));
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, NULL));
+        
+        retval = amp_pool_allocator_destroy(&pool, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(aligned_allocations_use_pool_or_source_allocator)
+    {
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               64 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+            void* pointer = AMP_ALIGNED_ALLOC(pool, alignment, 24);
+            CHECK(NULL != pointer);
+            CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(pointer) % alignment);
+            CHECK_EQUAL(AMP_SUCCESS, AMP_ALIGNED_DEALLOC(pool, pointer));
+        }
+        
+        retval = amp_pool_allocator_destroy(&pool, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(large_requests_and_exhaustion_fall_back_to_source_allocator)
+    {
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        char* large = static_cast<char*>(AMP_ALLOC(pool, 
+                                                   AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE + 1));
+        CHECK(NULL != large);
+        large[AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE] = 1;
+        CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, large));
+        
+        // More blocks than fit into the pool memory.
+        std::size_t const block_count = 1024;
+        std::vector<void*> blocks(block_count, static_cast<void*>(NULL));
+        for (std::size_t i = 0; i < block_count; ++i) {
+            blocks[i] = AMP_ALLOC(pool, 64);
+            CHECK(NULL != blocks[i]);
+        }
+        
+        for (std::size_t i = 0; i < block_count; ++i) {
+            CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, blocks[i]));
+        }
+        
+        retval = amp_pool_allocator_destroy(&pool, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        struct churn_context {
+            amp_allocator_t pool;
+            std::size_t round_count;
+            std::vector<int>* failures;
+            std::vector<void*>* handed_over;
+        };
+        
+        
+        void churn_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            churn_context* context = static_cast<churn_context*>(ctxt);
+            amp_allocator_t pool = context->pool;
+            int failure_count = 0;
+            
+            // Free the block the previous thread allocated in the last
+            // dispatch to deallocate on another thread than allocated.
+            void*& handed_over = (*context->handed_over)[(thread_index + 1) % thread_count];
+            if (AMP_SUCCESS != AMP_DEALLOC(pool, handed_over)) {
+                ++failure_count;
+            }
+            handed_over = NULL;
+            
+            for (std::size_t i = 0; i < context->round_count; ++i) {
+                amp_mutex_t mutex = AMP_MUTEX_UNINITIALIZED;
+                amp_semaphore_t semaphore = AMP_SEMAPHORE_UNINITIALIZED;
+                
+                if (AMP_SUCCESS != amp_mutex_create(&mutex, pool)) {
+                    ++failure_count;
+                    continue;
+                }
+                
+                if (AMP_SUCCESS != amp_semaphore_create(&semaphore, pool, 0)) {
+                    ++failure_count;
+                } else {
+                    if (AMP_SUCCESS != amp_semaphore_destroy(&semaphore, pool)) {
+                        ++failure_count;
+                    }
+                }
+                
+                if (AMP_SUCCESS != amp_mutex_destroy(&mutex, pool)) {
+                    ++failure_count;
+                }
+            }
+            
+            (*context->handed_over)[thread_index] = AMP_ALLOC(pool, 48);
+            
+            (*context->failures)[thread_index] += failure_count;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(threads_create_and_destroy_primitives_concurrently)
+    {
+        std::size_t const thread_count = 4;
+        
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               AMP_DEFAULT_ALLOCATOR,
+                                               256 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<int> failures(thread_count, 0);
+        std::vector<void*> handed_over(thread_count, static_cast<void*>(NULL));
+        churn_context context = {pool, 1000, &failures, &handed_over};
+        
+        for (int d = 0; d < 8; ++d) {
+            retval = amp_thread_array_dispatch(thread_array,
+                                               &churn_func,
+                                               &context);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_array_wait(thread_array);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            CHECK_EQUAL(0, failures[i]);
+            CHECK_EQUAL(AMP_SUCCESS, AMP_DEALLOC(pool, handed_over[i]));
+        }
+        
+        retval = amp_pool_allocator_destroy(&pool, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        // Registers a cache for the calling thread and leaves a block in it.
+        void allocate_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            amp_allocator_t pool = static_cast<amp_allocator_t>(ctxt);
+            
+            (void)thread_index;
+            (void)thread_count;
+            
+            void* small = AMP_ALLOC(pool, 24);
+            void* large = AMP_ALLOC(pool, AMP_POOL_ALLOCATOR_MAX_BLOCK_SIZE + 1);
+            
+            (void)AMP_DEALLOC(pool, large);
+            (void)AMP_DEALLOC(pool, small);
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST_FIXTURE(counting_fixture, destroy_returns_all_memory_to_source_allocator)
+    {
+        std::size_t const thread_count = 4;
+        
+        amp_allocator_t pool = AMP_ALLOCATOR_UNINITIALIZED;
+        int retval = amp_pool_allocator_create(&pool,
+                                               allocator,
+                                               64 * 1024);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_dispatch(thread_array, &allocate_func, pool);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // Pool memory, one cache per thread, and the oversized blocks.
+        CHECK(static_cast<int64_t>(1 + 2 * thread_count) <= alloc_count());
+        
+        retval = amp_pool_allocator_destroy(&pool, allocator);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(alloc_count(), dealloc_count());
+    }
+    
+} // SUITE(amp_pool_allocator)
+
+
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_rwlock and therefore indirectly amp_raw_rwlock.
+ */
+
+
+#include <UnitTest++.h>
+
+
+
+#include <assert.h>
+#include <cstddef>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_thread.h>
+#include <amp/amp_thread_array.h>
+#include <amp/amp_rwlock.h>
+
+
+
+SUITE(amp_rwlock)
+{
+    
+    namespace
+    {
+        std::size_t const reader_slot_count = 16;
+        
+        
+        struct rwlock_and_result_s {
+            amp_rwlock_t rwlock;
+            int read_trylock_result;
+            int write_trylock_result;
+        };
+        
+        
+        void trylock_thread_func(void *ctxt)
+        {
+            struct rwlock_and_result_s *context = 
+                static_cast<struct rwlock_and_result_s*>(ctxt);
+            
+            context->read_trylock_result = amp_rwlock_read_trylock(context->rwlock);
+            if (AMP_SUCCESS == context->read_trylock_result) {
+                int const retval = amp_rwlock_read_unlock(context->rwlock);
+                assert(AMP_SUCCESS == retval);
+                (void)retval;
+            }
+            
+            context->write_trylock_result = amp_rwlock_write_trylock(context->rwlock);
+            if (AMP_SUCCESS == context->write_trylock_result) {
+                int const retval = amp_rwlock_write_unlock(context->rwlock);
+                assert(AMP_SUCCESS == retval);
+                (void)retval;
+            }
+        }
+        
+        
+        void run_trylock_thread(struct rwlock_and_result_s *context)
+        {
+            context->read_trylock_result = AMP_UNSUPPORTED;
+            context->write_trylock_result = AMP_UNSUPPORTED;
+            
+            amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+            int retval = amp_thread_create_and_launch(&thread,
+                                                      AMP_DEFAULT_ALLOCATOR,
+                                                      context,
+                                                      &trylock_thread_func);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_join_and_destroy(&thread,
+                                                 AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+        }
+        
+        
+        void check_lock_exclusion(amp_rwlock_t rwlock)
+        {
+            struct rwlock_and_result_s context;
+            context.rwlock = rwlock;
+            
+            // Unlocked - other thread gets both locks.
+            run_trylock_thread(&context);
+            CHECK_EQUAL(AMP_SUCCESS, context.read_trylock_result);
+            CHECK_EQUAL(AMP_SUCCESS, context.write_trylock_result);
+            
+            // Read locked - other thread can read but not write.
+            int retval = amp_rwlock_read_lock(rwlock);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            {
+                run_trylock_thread(&context);
+                CHECK_EQUAL(AMP_SUCCESS, context.read_trylock_result);
+                CHECK_EQUAL(AMP_BUSY, context.write_trylock_result);
+            }
+            retval = amp_rwlock_read_unlock(rwlock);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            // Write locked - other thread gets neither lock.
+            retval = amp_rwlock_write_lock(rwlock);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            {
+                run_trylock_thread(&context);
+                CHECK_EQUAL(AMP_BUSY, context.read_trylock_result);
+                CHECK_EQUAL(AMP_BUSY, context.write_trylock_result);
+            }
+            retval = amp_rwlock_write_unlock(rwlock);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        
+        
+        std::size_t const iterations_per_thread = 2000;
+        
+        struct shared_data_s {
+            amp_rwlock_t rwlock;
+            std::size_t first;
+            std::size_t second;
+            struct amp_raw_atomic_int32_s inconsistent_read_count;
+        };
+        
+        
+        void reader_writer_thread_func(void *ctxt)
+        {
+            struct shared_data_s *context = 
+                static_cast<struct shared_data_s*>(ctxt);
+            
+            for (std::size_t i = 0; i < iterations_per_thread; ++i) {
+                
+                if (0 == (i % 8)) {
+                    int retval = amp_rwlock_write_lock(context->rwlock);
+                    assert(AMP_SUCCESS == retval);
+                    {
+                        ++(context->first);
+                        ++(context->second);
+                    }
+                    retval = amp_rwlock_write_unlock(context->rwlock);
+                    assert(AMP_SUCCESS == retval);
+                    (void)retval;
+                } else {
+                    std::size_t first = 0;
+                    std::size_t second = 0;
+                    
+                    int retval = amp_rwlock_read_lock(context->rwlock);
+                    assert(AMP_SUCCESS == retval);
+                    {
+                        first = context->first;
+                        second = context->second;
+                    }
+                    retval = amp_rwlock_read_unlock(context->rwlock);
+                    assert(AMP_SUCCESS == retval);
+                    (void)retval;
+                    
+                    if (first != second) {
+                        (void)amp_atomic_int32_fetch_add(&context->inconsistent_read_count,
+                                                         1);
+                    }
+                }
+            }
+        }
+        
+        
+        void run_readers_and_writers(amp_rwlock_t rwlock)
+        {
+            std::size_t const thread_count = 8;
+            
+            struct shared_data_s context;
+            context.rwlock = rwlock;
+            context.first = 0;
+            context.second = 0;
+            amp_atomic_int32_store(&context.inconsistent_read_count, 0);
+            
+            amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+            int retval = amp_thread_array_create(&threads,
+                                                 AMP_DEFAULT_ALLOCATOR,
+                                                 thread_count);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_array_configure(threads,
+                                                0,
+                                                thread_count,
+                                                &context,
+                                                &reader_writer_thread_func);
+            assert(AMP_SUCCESS == retval);
+            
+            std::size_t joinable_count = 0;
+            retval = amp_thread_array_launch_all(threads, &joinable_count);
+            assert(AMP_SUCCESS == retval);
+            assert(thread_count == joinable_count);
+            
+            retval = amp_thread_array_join_all(threads, &joinable_count);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_array_destroy(&threads,
+                                              AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+            
+            std::size_t const expected_writes = 
+                thread_count * (iterations_per_thread / 8);
+            CHECK_EQUAL(expected_writes, context.first);
+            CHECK_EQUAL(expected_writes, context.second);
+            CHECK_EQUAL(0, amp_atomic_int32_load(&context.inconsistent_read_count));
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(create_lock_unlock_destroy)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        
+        int retval = amp_rwlock_create(&rwlock,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_read_lock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_rwlock_read_trylock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_rwlock_read_unlock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_rwlock_read_unlock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_write_lock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_rwlock_write_unlock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_RWLOCK_UNINITIALIZED == rwlock);
+    }
+    
+    
+    
+    TEST(lock_exclusion)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        int retval = amp_rwlock_create(&rwlock,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        check_lock_exclusion(rwlock);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(reader_biased_lock_exclusion)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        int retval = amp_rwlock_create_reader_biased(&rwlock,
+                                                     AMP_DEFAULT_ALLOCATOR,
+                                                     reader_slot_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        check_lock_exclusion(rwlock);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(reader_biased_destroy_while_read_locked_is_busy)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        int retval = amp_rwlock_create_reader_biased(&rwlock,
+                                                     AMP_DEFAULT_ALLOCATOR,
+                                                     1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_read_lock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_rwlock_read_unlock(rwlock);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(many_readers_and_writers)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        int retval = amp_rwlock_create(&rwlock,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        run_readers_and_writers(rwlock);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(many_readers_and_writers_reader_biased)
+    {
+        amp_rwlock_t rwlock = AMP_RWLOCK_UNINITIALIZED;
+        int retval = amp_rwlock_create_reader_biased(&rwlock,
+                                                     AMP_DEFAULT_ALLOCATOR,
+                                                     reader_slot_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        run_readers_and_writers(rwlock);
+        
+        retval = amp_rwlock_destroy(&rwlock,
+                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+}
+
+
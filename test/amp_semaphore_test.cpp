@@ -115,6 +115,101 @@ SUITE(amp_semaphore)
     
     
     
+    TEST(timedwait_times_out_on_unsignaled_semaphore)
+    {
+        amp_semaphore_t sem = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&sem,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // 10 milliseconds.
+        retval = amp_semaphore_timedwait(sem, 10000000);
+        CHECK_EQUAL(AMP_TIMEOUT, retval);
+        
+        retval = amp_semaphore_signal(sem);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        {
+            int const milliseconds = 50;
+            UNITTEST_TIME_CONSTRAINT(milliseconds);
+            
+            // The timed out wait mustn't have consumed the signal.
+            retval = amp_semaphore_timedwait(sem, 1000000000);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        retval = amp_semaphore_timedwait(sem, 0);
+        CHECK_EQUAL(AMP_TIMEOUT, retval);
+        
+        retval = amp_semaphore_destroy(&sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(trywait_on_unsignaled_and_signaled_semaphore)
+    {
+        amp_semaphore_t sem = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&sem,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_signal(sem);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(signal_n_then_wait_n_on_semaphore)
+    {
+        amp_semaphore_t sem = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&sem,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          1);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_signal_n(sem, 0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_semaphore_signal_n(sem, 4);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        {
+            int const milliseconds = 50;
+            UNITTEST_TIME_CONSTRAINT(milliseconds);
+            
+            retval = amp_semaphore_wait_n(sem, 0);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_semaphore_wait_n(sem, 5);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }    
+    
+    
     namespace 
     {
         int const CHECK_FLAG_UNSET = 0;
@@ -136,6 +231,19 @@ SUITE(amp_semaphore)
             sem_flag->check_flag = CHECK_FLAG_SET;
         }
         
+        
+        int const wait_n_batch_count = 3;
+        
+        void wait_n_on_semaphore_and_set_flag_func(void *context)
+        {
+            struct semaphore_flag_s *sem_flag = static_cast<struct semaphore_flag_s*>(context);
+            
+            int retval = amp_semaphore_wait_n(sem_flag->sem, wait_n_batch_count);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+            sem_flag->check_flag = CHECK_FLAG_SET;
+        }
+        
     } // anonymous namespace
     
     
@@ -212,6 +320,122 @@ SUITE(amp_semaphore)
     
     
     
+    TEST(thread_wait_n_on_individually_signaled_semaphore)
+    {
+        // The waiting thread collects its batch from single signals.
+        
+        struct semaphore_flag_s sem_flag;
+        int retval = amp_semaphore_create(&sem_flag.sem, 
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        sem_flag.check_flag = CHECK_FLAG_UNSET;
+        
+        
+        amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+        retval = amp_thread_create_and_launch(&thread,
+                                              AMP_DEFAULT_ALLOCATOR,
+                                              &sem_flag, 
+                                              &wait_n_on_semaphore_and_set_flag_func);
+        assert(AMP_SUCCESS == retval);
+        
+        for (int i = 0; i < wait_n_batch_count; ++i) {
+            retval = amp_semaphore_signal(sem_flag.sem);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        // Joins after the thread waited and passed the semaphore.
+        retval = amp_thread_join_and_destroy(&thread,
+                                             AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        CHECK_EQUAL(CHECK_FLAG_SET, sem_flag.check_flag);
+        
+        retval = amp_semaphore_trywait(sem_flag.sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&sem_flag.sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }    
+    
+    
+    namespace
+    {
+        struct batch_waiter_s {
+            amp_semaphore_t sem;
+            amp_semaphore_t done_sem;
+        };
+        
+        void wait_n_on_semaphore_and_signal_done_func(void *context)
+        {
+            struct batch_waiter_s *waiter = static_cast<struct batch_waiter_s*>(context);
+            
+            int retval = amp_semaphore_wait_n(waiter->sem, wait_n_batch_count);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_semaphore_signal(waiter->done_sem);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+        }
+        
+    } // anonymous namespace
+    
+    
+    TEST(thread_wait_n_batches_dont_block_each_other)
+    {
+        // Two threads wait for a batch each but only one batch is signaled
+        // until one of them passed. A thread holding a part of its batch
+        // would block the other one forever.
+        
+        struct batch_waiter_s waiter;
+        int retval = amp_semaphore_create(&waiter.sem, 
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_semaphore_create(&waiter.done_sem, 
+                                      AMP_DEFAULT_ALLOCATOR,
+                                      0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_t threads[2] = {AMP_THREAD_UNINITIALIZED, AMP_THREAD_UNINITIALIZED};
+        for (int i = 0; i < 2; ++i) {
+            retval = amp_thread_create_and_launch(&threads[i],
+                                                  AMP_DEFAULT_ALLOCATOR,
+                                                  &waiter, 
+                                                  &wait_n_on_semaphore_and_signal_done_func);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        for (int batch = 0; batch < 2; ++batch) {
+            for (int i = 0; i < wait_n_batch_count; ++i) {
+                retval = amp_semaphore_signal(waiter.sem);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+            }
+            
+            retval = amp_semaphore_wait(waiter.done_sem);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        for (int i = 0; i < 2; ++i) {
+            retval = amp_thread_join_and_destroy(&threads[i],
+                                                 AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        retval = amp_semaphore_trywait(waiter.sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&waiter.done_sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        retval = amp_semaphore_destroy(&waiter.sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
     namespace
     {
         struct some_threads_wait_one_signals_s {
@@ -318,4 +542,170 @@ SUITE(amp_semaphore)
         CHECK_EQUAL(AMP_SUCCESS, retval);
     }
     
+    
+    
+    
+    namespace
+    {
+        void thread_to_wait_once_func(void *context)
+        {
+            struct some_threads_wait_one_signals_s *data = static_cast<struct some_threads_wait_one_signals_s*>(context);
+            
+            int const retcode = amp_semaphore_wait(*data->sem_p);
+            assert(AMP_SUCCESS == retcode);
+            (void)retcode;
+            data->check_flag = CHECK_FLAG_SET;
+        }
+        
+    } // anonymous namespace
+    
+    TEST(some_threads_wait_one_signals_n)
+    {
+        // One batch signal lets all waiting threads pass.
+        
+        amp_semaphore_t sem = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&sem,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        
+        std::size_t const threads_to_wait_count = 4;
+        
+        struct some_threads_wait_one_signals_s checks[threads_to_wait_count];
+        for (std::size_t i = 0; i < threads_to_wait_count; ++i) {
+            checks[i].sem_p = &sem;
+            checks[i].check_flag = CHECK_FLAG_UNSET;
+        }
+        
+        amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&threads,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         threads_to_wait_count);
+        assert(AMP_SUCCESS == retval);
+        
+        for (std::size_t i = 0; i < threads_to_wait_count; ++i) {
+            retval = amp_thread_array_configure(threads,
+                                                i,
+                                                1,
+                                                &checks[i],
+                                                &thread_to_wait_once_func);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(threads,
+                                             &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        assert(threads_to_wait_count == joinable_count);
+        
+        retval = amp_semaphore_signal_n(sem, 
+                                        static_cast<amp_semaphore_counter_t>(threads_to_wait_count));
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        // Join all threads - which means they waited and passed the semaphore.
+        retval = amp_thread_array_join_all(threads,
+                                           &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        assert(0 == joinable_count);
+        
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        for (std::size_t i = 0; i < threads_to_wait_count; ++i) {
+            CHECK_EQUAL(CHECK_FLAG_SET, checks[i].check_flag);
+        }
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace
+    {
+        std::size_t const signals_per_producer_count = 10000;
+        
+        struct producer_consumer_s {
+            amp_semaphore_t sem;
+            amp_bool_t is_producer;
+        };
+        
+        void produce_or_consume_func(void *context)
+        {
+            struct producer_consumer_s *data = static_cast<struct producer_consumer_s*>(context);
+            
+            for (std::size_t i = 0; i < signals_per_producer_count; ++i) {
+                int const retcode = (AMP_TRUE == data->is_producer) ? amp_semaphore_signal(data->sem) : amp_semaphore_wait(data->sem);
+                assert(AMP_SUCCESS == retcode);
+                (void)retcode;
+            }
+        }
+        
+    } // anonymous namespace
+    
+    TEST(producers_and_consumers_balance_signals_and_waits)
+    {
+        // Every signal is consumed by exactly one wait - no wakeup is lost
+        // otherwise a consumer would block forever, and no count is left
+        // over.
+        
+        amp_semaphore_t sem = AMP_SEMAPHORE_UNINITIALIZED;
+        int retval = amp_semaphore_create(&sem,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t const pair_count = 2;
+        std::size_t const thread_count = 2 * pair_count;
+        
+        struct producer_consumer_s contexts[thread_count];
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            contexts[i].sem = sem;
+            contexts[i].is_producer = (0 == (i % 2)) ? AMP_TRUE : AMP_FALSE;
+        }
+        
+        amp_thread_array_t threads = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&threads,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         thread_count);
+        assert(AMP_SUCCESS == retval);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            retval = amp_thread_array_configure(threads,
+                                                i,
+                                                1,
+                                                &contexts[i],
+                                                &produce_or_consume_func);
+            assert(AMP_SUCCESS == retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(threads,
+                                             &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        assert(thread_count == joinable_count);
+        
+        retval = amp_thread_array_join_all(threads,
+                                           &joinable_count);
+        assert(AMP_SUCCESS == retval);
+        assert(0 == joinable_count);
+        
+        retval = amp_thread_array_destroy(&threads,
+                                          AMP_DEFAULT_ALLOCATOR);
+        assert(AMP_SUCCESS == retval);
+        
+        retval = amp_semaphore_trywait(sem);
+        CHECK_EQUAL(AMP_BUSY, retval);
+        
+        retval = amp_semaphore_destroy(&sem,
+                                       AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
 } // SUITE(amp_raw_semaphore)
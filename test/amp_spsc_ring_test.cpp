@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_spsc_ring.
+ */
+
+
+#include <UnitTest++.h>
+
+#include <cstddef>
+#include <vector>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_spsc_ring.h>
+#include <amp/amp_thread_array.h>
+
+
+
+SUITE(amp_spsc_ring)
+{
+    TEST(create_rounds_capacity_up_to_power_of_two)
+    {
+        amp_spsc_ring_t ring = AMP_SPSC_RING_UNINITIALIZED;
+        int retval = amp_spsc_ring_create(&ring,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          5,
+                                          AMP_SPSC_RING_MODE_NONBLOCKING);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t capacity = 0;
+        amp_spsc_ring_get_capacity(ring, &capacity);
+        CHECK_EQUAL(static_cast<std::size_t>(8), capacity);
+        
+        retval = amp_spsc_ring_destroy(&ring, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_SPSC_RING_UNINITIALIZED == ring);
+    }
+    
+    
+    
+    TEST(batches_are_transferred_in_order_up_to_capacity)
+    {
+        std::size_t const capacity = 8;
+        int values[3 * capacity];
+        void* elements[3 * capacity];
+        for (std::size_t i = 0; i < 3 * capacity; ++i) {
+            elements[i] = &values[i];
+        }
+        
+        amp_spsc_ring_t ring = AMP_SPSC_RING_UNINITIALIZED;
+        int retval = amp_spsc_ring_create(&ring,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          capacity,
+                                          AMP_SPSC_RING_MODE_NONBLOCKING);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        void* popped[3 * capacity];
+        std::size_t popped_count = 1;
+        CHECK_EQUAL(AMP_BUSY, amp_spsc_ring_pop_n(ring, popped, capacity, &popped_count));
+        CHECK_EQUAL(static_cast<std::size_t>(0), popped_count);
+        
+        std::size_t pushed_count = 0;
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_push_n(ring, elements, 5, &pushed_count));
+        CHECK_EQUAL(static_cast<std::size_t>(5), pushed_count);
+        
+        // Only three more fit.
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_push_n(ring, elements + 5, 5, &pushed_count));
+        CHECK_EQUAL(static_cast<std::size_t>(3), pushed_count);
+        CHECK_EQUAL(AMP_BUSY, amp_spsc_ring_try_push(ring, elements[8]));
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_pop_n(ring, popped, 6, &popped_count));
+        CHECK_EQUAL(static_cast<std::size_t>(6), popped_count);
+        
+        // Wrap around the end of the slots.
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_push_n(ring, elements + 8, 6, &pushed_count));
+        CHECK_EQUAL(static_cast<std::size_t>(6), pushed_count);
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_pop_n(ring, popped + 6, 3 * capacity, &popped_count));
+        CHECK_EQUAL(static_cast<std::size_t>(8), popped_count);
+        
+        for (std::size_t i = 0; i < 14; ++i) {
+            CHECK_EQUAL(elements[i], popped[i]);
+        }
+        
+        void* element = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_spsc_ring_try_pop(ring, &element));
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_try_push(ring, elements[0]));
+        CHECK_EQUAL(AMP_SUCCESS, amp_spsc_ring_try_pop(ring, &element));
+        CHECK_EQUAL(elements[0], element);
+        
+        retval = amp_spsc_ring_destroy(&ring, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    namespace {
+        
+        std::size_t const element_count = 100000;
+        std::size_t const batch_size = 7;
+        
+        struct pair_context {
+            amp_spsc_ring_t ring;
+            int failure_count;
+        };
+        
+        
+        // Thread 0 pushes ascending values in batches, thread 1 pops them
+        // blocking one at a time followed by a batch and checks the order.
+        void pair_func(void* ctxt, std::size_t thread_index, std::size_t thread_count)
+        {
+            pair_context* context = static_cast<pair_context*>(ctxt);
+            
+            (void)thread_count;
+            
+            if (0 == thread_index) {
+                void* batch[batch_size];
+                std::size_t next = 1;
+                
+                while (next <= element_count) {
+                    std::size_t count = 0;
+                    while ((count < batch_size) && (next + count <= element_count)) {
+                        batch[count] = reinterpret_cast<void*>(next + count);
+                        ++count;
+                    }
+                    
+                    // Push the first element blocking, the rest as a batch.
+                    if (AMP_SUCCESS != amp_spsc_ring_push(context->ring, batch[0])) {
+                        ++context->failure_count;
+                        return;
+                    }
+                    
+                    std::size_t pushed_count = 0;
+                    (void)amp_spsc_ring_push_n(context->ring, batch + 1, count - 1, &pushed_count);
+                    next += 1 + pushed_count;
+                }
+            } else {
+                std::size_t expected = 1;
+                
+                while (expected <= element_count) {
+                    void* batch[batch_size];
+                    if (AMP_SUCCESS != amp_spsc_ring_pop(context->ring, &batch[0])) {
+                        ++context->failure_count;
+                        return;
+                    }
+                    
+                    std::size_t popped_count = 0;
+                    (void)amp_spsc_ring_pop_n(context->ring, batch + 1, batch_size - 1, &popped_count);
+                    
+                    for (std::size_t i = 0; i < 1 + popped_count; ++i) {
+                        if (reinterpret_cast<void*>(expected) != batch[i]) {
+                            ++context->failure_count;
+                        }
+                        ++expected;
+                    }
+                }
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(blocking_handoff_between_producer_and_consumer)
+    {
+        amp_spsc_ring_t ring = AMP_SPSC_RING_UNINITIALIZED;
+        int retval = amp_spsc_ring_create(&ring,
+                                          AMP_DEFAULT_ALLOCATOR,
+                                          16,
+                                          AMP_SPSC_RING_MODE_BLOCKING);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        retval = amp_thread_array_create(&thread_array,
+                                         AMP_DEFAULT_ALLOCATOR,
+                                         2);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_launch_parked(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        pair_context context = {ring, 0};
+        
+        retval = amp_thread_array_dispatch(thread_array, &pair_func, &context);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_wait(thread_array);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_destroy(&thread_array, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(0, context.failure_count);
+        
+        void* element = NULL;
+        CHECK_EQUAL(AMP_BUSY, amp_spsc_ring_try_pop(ring, &element));
+        
+        retval = amp_spsc_ring_destroy(&ring, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+} // SUITE(amp_spsc_ring)
+
+
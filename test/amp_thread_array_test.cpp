@@ -47,6 +47,11 @@
 #include <amp/amp_return_code.h>
 #include <amp/amp_thread_array.h>
 #include <amp/amp_memory.h>
+#include <amp/amp_platform.h>
+
+#if defined(__linux__)
+#   include <sched.h>
+#endif
 
 
 
@@ -485,6 +490,468 @@ SUITE(amp_thread_array)
     
     
     
+    namespace {
+        
+        int const no_cpu_recorded = -2;
+        
+        void record_cpu_func(void* ctxt);
+        void record_cpu_func(void* ctxt)
+        {
+            int* cpu = static_cast<int*>(ctxt);
+            
+#if defined(__linux__)
+            *cpu = sched_getcpu();
+#else
+            *cpu = -1;
+#endif
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(affinity_policies_pin_threads_to_expected_hwthreads)
+    {
+        amp_platform_t platform = AMP_PLATFORM_UNINITIALIZED;
+        int retval = amp_platform_create(&platform, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t hwthread_count = 0;
+        retval = amp_platform_get_topology_hwthread_count(platform, &hwthread_count);
+        if (AMP_SUCCESS != retval) {
+            CHECK_EQUAL(AMP_UNSUPPORTED, retval);
+            
+            retval = amp_platform_destroy(&platform, AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            return;
+        }
+        
+        struct amp_platform_hwthread_info_s info;
+        retval = amp_platform_get_hwthread_info(platform, 0, &info);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_array_affinity_policy_t const policies[] = {
+            AMP_THREAD_ARRAY_AFFINITY_POLICY_COMPACT,
+            AMP_THREAD_ARRAY_AFFINITY_POLICY_SCATTER,
+            AMP_THREAD_ARRAY_AFFINITY_POLICY_PHYSICAL_CORE,
+            AMP_THREAD_ARRAY_AFFINITY_POLICY_EXPLICIT
+        };
+        std::size_t const policy_count = sizeof(policies) / sizeof(policies[0]);
+        
+        std::size_t const thread_count = 4;
+        
+        for (std::size_t p = 0; p < policy_count; ++p) {
+            
+            amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+            retval = amp_thread_array_create(&thread_array,
+                                             AMP_DEFAULT_ALLOCATOR,
+                                             thread_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            std::vector<int> cpus(thread_count, no_cpu_recorded);
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                retval = amp_thread_array_configure(thread_array,
+                                                    i,
+                                                    1,
+                                                    &cpus[i],
+                                                    &record_cpu_func);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+            }
+            
+            retval = amp_thread_array_configure_affinity(thread_array,
+                                                         AMP_DEFAULT_ALLOCATOR,
+                                                         platform,
+                                                         policies[p],
+                                                         &info.os_id,
+                                                         1);
+            
+            bool const pinned = (AMP_SUCCESS == retval);
+            if (!pinned) {
+                CHECK_EQUAL(AMP_UNSUPPORTED, retval);
+            }
+            
+            std::size_t joinable_count = 0;
+            retval = amp_thread_array_launch_all(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(thread_count, joinable_count);
+            
+            retval = amp_thread_array_join_all(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+            
+            retval = amp_thread_array_destroy(&thread_array,
+                                              AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                CHECK(no_cpu_recorded != cpus[i]);
+            }
+            
+#if defined(__linux__)
+            /* Threads pinned to a single hardware thread must run on it. */
+            if (pinned) {
+                if ((1 == hwthread_count) 
+                    || (AMP_THREAD_ARRAY_AFFINITY_POLICY_EXPLICIT == policies[p])) {
+                    for (std::size_t i = 0; i < thread_count; ++i) {
+                        CHECK_EQUAL(static_cast<int>(info.os_id), cpus[i]);
+                    }
+                }
+            }
+#endif
+        }
+        
+        retval = amp_platform_destroy(&platform, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(launch_with_shared_small_stack_attributes)
+    {
+        std::size_t const thread_count = 128;
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        int retval = amp_thread_array_create(&thread_array,
+                                             AMP_DEFAULT_ALLOCATOR,
+                                             thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_thread_attributes_s attributes;
+        amp_thread_attributes_init(&attributes);
+        attributes.stack_size = 32 * 1024;
+        attributes.guard_size = 4096;
+        
+        retval = amp_thread_array_configure_attributes(thread_array,
+                                                       0,
+                                                       thread_count,
+                                                       &attributes);
+        if (AMP_UNSUPPORTED == retval) {
+            // Guard sizes aren't supported everywhere.
+            attributes.guard_size = AMP_THREAD_DEFAULT_GUARD_SIZE;
+            retval = amp_thread_array_configure_attributes(thread_array,
+                                                           0,
+                                                           thread_count,
+                                                           &attributes);
+        }
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<int> context_vector(thread_count, 0);
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            retval = amp_thread_array_configure(thread_array,
+                                                i,
+                                                1,
+                                                &context_vector[i],
+                                                &set_int_context_to_fortytwo);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(thread_count, joinable_count);
+        
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+        
+        retval = amp_thread_array_destroy(&thread_array,
+                                          AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            CHECK_EQUAL(fortytwo, context_vector[i]); 
+        }
+    }
+    
+    
+    
+    namespace {
+        
+        int const user_data_increment_count = 1000;
+        
+        void increment_user_data_counter_func(void* ctxt);
+        void increment_user_data_counter_func(void* ctxt)
+        {
+            int* counter = static_cast<int*>(ctxt);
+            
+            for (int i = 0; i < user_data_increment_count; ++i) {
+                ++(*counter);
+            }
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(user_data_is_zeroed_cache_line_aligned_and_per_thread)
+    {
+        std::size_t const thread_count = 9;
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        int retval = amp_thread_array_create(&thread_array,
+                                             AMP_DEFAULT_ALLOCATOR,
+                                             thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<unsigned char*> user_data(thread_count, static_cast<unsigned char*>(NULL));
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            void* data = NULL;
+            retval = amp_thread_array_get_user_data(thread_array, i, &data);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK(NULL != data);
+            user_data[i] = static_cast<unsigned char*>(data);
+            
+            CHECK_EQUAL(static_cast<std::size_t>(0), reinterpret_cast<std::size_t>(data) % AMP_CACHE_LINE_SIZE);
+            
+            for (std::size_t k = 0; k < AMP_THREAD_ARRAY_USER_DATA_SIZE; ++k) {
+                CHECK_EQUAL(0, user_data[i][k]);
+            }
+            
+            if (0 < i) {
+                std::size_t const distance = static_cast<std::size_t>(user_data[i] - user_data[i - 1]);
+                CHECK(distance >= AMP_CACHE_LINE_SIZE);
+                CHECK_EQUAL(static_cast<std::size_t>(0), distance % AMP_CACHE_LINE_SIZE);
+            }
+            
+            retval = amp_thread_array_configure(thread_array,
+                                                i,
+                                                1,
+                                                data,
+                                                &increment_user_data_counter_func);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(thread_count, joinable_count);
+        
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            CHECK_EQUAL(user_data_increment_count, *reinterpret_cast<int*>(user_data[i]));
+        }
+        
+        retval = amp_thread_array_destroy(&thread_array,
+                                          AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(tree_launch_mode_runs_all_threads)
+    {
+        std::size_t const thread_counts[] = {1, 2, 3, 7, 100};
+        std::size_t const thread_count_count = sizeof(thread_counts) / sizeof(thread_counts[0]);
+        
+        for (std::size_t c = 0; c < thread_count_count; ++c) {
+            std::size_t const thread_count = thread_counts[c];
+            
+            amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+            int retval = amp_thread_array_create(&thread_array,
+                                                 AMP_DEFAULT_ALLOCATOR,
+                                                 thread_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_array_configure_launch_mode(thread_array,
+                                                            AMP_THREAD_ARRAY_LAUNCH_MODE_TREE);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            std::vector<int> context_vector(thread_count, 0);
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                retval = amp_thread_array_configure(thread_array,
+                                                    i,
+                                                    1,
+                                                    &context_vector[i],
+                                                    &set_int_context_to_fortytwo);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+            }
+            
+            std::size_t joinable_count = 0;
+            retval = amp_thread_array_launch_all(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(thread_count, joinable_count);
+            
+            retval = amp_thread_array_join_all(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+            
+            retval = amp_thread_array_get_joinable_thread_count(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+            
+            retval = amp_thread_array_destroy(&thread_array,
+                                              AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                CHECK_EQUAL(fortytwo, context_vector[i]); 
+            }
+        }
+    }
+    
+    
+    
+    TEST(tree_launch_mode_reports_failed_launches_from_launch_all)
+    {
+        // Thread 2 can't be launched, neither are its children 5 and 6.
+        std::size_t const thread_count = 7;
+        std::size_t const failing_index = 2;
+        
+        amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+        int retval = amp_thread_array_create(&thread_array,
+                                             AMP_DEFAULT_ALLOCATOR,
+                                             thread_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_array_configure_launch_mode(thread_array,
+                                                        AMP_THREAD_ARRAY_LAUNCH_MODE_TREE);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_thread_attributes_s attributes;
+        amp_thread_attributes_init(&attributes);
+        attributes.stack_size = AMP_SIZE_MAX / 2;
+        
+        retval = amp_thread_array_configure_attributes(thread_array,
+                                                       failing_index,
+                                                       1,
+                                                       &attributes);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::vector<int> context_vector(thread_count, 0);
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            retval = amp_thread_array_configure(thread_array,
+                                                i,
+                                                1,
+                                                &context_vector[i],
+                                                &set_int_context_to_fortytwo);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        std::size_t joinable_count = 0;
+        retval = amp_thread_array_launch_all(thread_array, &joinable_count);
+        CHECK(AMP_SUCCESS != retval);
+        CHECK_EQUAL(static_cast<std::size_t>(4), joinable_count);
+        
+        retval = amp_thread_array_join_all(thread_array, &joinable_count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+        
+        retval = amp_thread_array_destroy(&thread_array,
+                                          AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            bool const launched = (i != failing_index) && (i != 5) && (i != 6);
+            CHECK_EQUAL(launched ? fortytwo : 0, context_vector[i]); 
+        }
+    }
+    
+    
+    
+    namespace {
+        
+        struct dispatch_check_context {
+            std::vector<int>* counters;
+            int increment;
+        };
+        
+        void dispatch_check_func(void* ctxt, 
+                                 std::size_t thread_index, 
+                                 std::size_t thread_count);
+        void dispatch_check_func(void* ctxt, 
+                                 std::size_t thread_index, 
+                                 std::size_t thread_count)
+        {
+            dispatch_check_context* context = static_cast<dispatch_check_context*>(ctxt);
+            
+            assert(thread_count == context->counters->size());
+            (void)thread_count;
+            
+            (*context->counters)[thread_index] += context->increment;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(parked_threads_run_dispatched_functions_until_joined)
+    {
+        amp_thread_array_launch_mode_t const modes[] = {
+            AMP_THREAD_ARRAY_LAUNCH_MODE_SERIAL,
+            AMP_THREAD_ARRAY_LAUNCH_MODE_TREE
+        };
+        std::size_t const mode_count = sizeof(modes) / sizeof(modes[0]);
+        
+        std::size_t const thread_count = 8;
+        int const dispatch_count = 100;
+        
+        for (std::size_t m = 0; m < mode_count; ++m) {
+            
+            amp_thread_array_t thread_array = AMP_THREAD_ARRAY_UNINITIALIZED;
+            int retval = amp_thread_array_create(&thread_array,
+                                                 AMP_DEFAULT_ALLOCATOR,
+                                                 thread_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_array_configure_launch_mode(thread_array,
+                                                            modes[m]);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_array_launch_parked(thread_array);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            std::size_t joinable_count = 0;
+            retval = amp_thread_array_get_joinable_thread_count(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(thread_count, joinable_count);
+            
+            // Waiting without a dispatch returns immediately.
+            retval = amp_thread_array_wait(thread_array);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            std::vector<int> counters(thread_count, 0);
+            dispatch_check_context context = {&counters, 0};
+            
+            for (int d = 1; d <= dispatch_count; ++d) {
+                context.increment = d;
+                
+                retval = amp_thread_array_dispatch(thread_array,
+                                                   &dispatch_check_func,
+                                                   &context);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+                
+                retval = amp_thread_array_wait(thread_array);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+            }
+            
+            // Joining waits for the last dispatched function.
+            context.increment = 1;
+            retval = amp_thread_array_dispatch(thread_array,
+                                               &dispatch_check_func,
+                                               &context);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_array_join_all(thread_array, &joinable_count);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(static_cast<std::size_t>(0), joinable_count);
+            
+            retval = amp_thread_array_destroy(&thread_array,
+                                              AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            int const expected_sum = dispatch_count * (dispatch_count + 1) / 2 + 1;
+            for (std::size_t i = 0; i < thread_count; ++i) {
+                CHECK_EQUAL(expected_sum, counters[i]);
+            }
+        }
+    }
+    
+    
+    
 } // SUITE(amp_thread_array)
 
 
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2009-2010, Bjoern Knafla
+ * http://www.bjoernknafla.com/
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are 
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright 
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright 
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the Bjoern Knafla 
+ *     Parallelization + AI + Gamedev Consulting nor the names of its 
+ *     contributors may be used to endorse or promote products derived from 
+ *     this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for amp_thread_pool.
+ */
+
+#include <UnitTest++.h>
+
+#include <assert.h>
+#include <cstddef>
+
+#include <amp/amp_stddef.h>
+#include <amp/amp_stdint.h>
+#include <amp/amp_return_code.h>
+#include <amp/amp_memory.h>
+#include <amp/amp_atomic.h>
+#include <amp/amp_raw_atomic.h>
+#include <amp/amp_thread_pool.h>
+
+
+
+SUITE(amp_thread_pool)
+{
+    namespace {
+        
+        std::size_t const worker_count = 4;
+        
+        
+        void increment_task_func(void* ctxt);
+        void increment_task_func(void* ctxt)
+        {
+            struct amp_raw_atomic_int32_s* counter = 
+                static_cast<struct amp_raw_atomic_int32_s*>(ctxt);
+            
+            (void)amp_atomic_int32_fetch_add(counter, 1);
+        }
+        
+        
+        
+        struct tree_context {
+            amp_thread_pool_t pool;
+            struct amp_raw_atomic_int32_s* leaf_counter;
+            int depth;
+        };
+        
+        
+        // Each task spawns two sub-tasks and waits for them from inside the
+        // pool until the leaves count themselves.
+        void tree_task_func(void* ctxt);
+        void tree_task_func(void* ctxt)
+        {
+            struct tree_context* context = static_cast<struct tree_context*>(ctxt);
+            
+            if (0 == context->depth) {
+                (void)amp_atomic_int32_fetch_add(context->leaf_counter, 1);
+                return;
+            }
+            
+            struct tree_context children[2];
+            children[0].pool = context->pool;
+            children[0].leaf_counter = context->leaf_counter;
+            children[0].depth = context->depth - 1;
+            children[1] = children[0];
+            
+            amp_thread_pool_wait_group_t group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+            int retval = amp_thread_pool_wait_group_create(&group,
+                                                           AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_pool_submit(context->pool, group, &tree_task_func, &children[0]);
+            assert(AMP_SUCCESS == retval);
+            retval = amp_thread_pool_submit(context->pool, group, &tree_task_func, &children[1]);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_pool_wait(context->pool, group);
+            assert(AMP_SUCCESS == retval);
+            
+            retval = amp_thread_pool_wait_group_destroy(&group,
+                                                        AMP_DEFAULT_ALLOCATOR);
+            assert(AMP_SUCCESS == retval);
+            (void)retval;
+        }
+        
+    } // anonymous namespace
+    
+    
+    
+    TEST(create_and_destroy)
+    {
+        amp_thread_pool_t pool = AMP_THREAD_POOL_UNINITIALIZED;
+        int retval = amp_thread_pool_create(&pool,
+                                            AMP_DEFAULT_ALLOCATOR,
+                                            worker_count,
+                                            0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t count = 0;
+        retval = amp_thread_pool_get_worker_count(pool, &count);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK_EQUAL(worker_count, count);
+        
+        retval = amp_thread_pool_destroy(&pool,
+                                         AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        CHECK(AMP_THREAD_POOL_UNINITIALIZED == pool);
+    }
+    
+    
+    
+    TEST(wait_for_tasks_submitted_from_outside)
+    {
+        std::size_t const task_count = 10000;
+        
+        amp_thread_pool_t pool = AMP_THREAD_POOL_UNINITIALIZED;
+        int retval = amp_thread_pool_create(&pool,
+                                            AMP_DEFAULT_ALLOCATOR,
+                                            worker_count,
+                                            0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_pool_wait_group_t group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+        retval = amp_thread_pool_wait_group_create(&group,
+                                                   AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_int32_s counter = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        
+        // Run twice to check that wait groups are reusable.
+        for (int round = 1; round <= 2; ++round) {
+            for (std::size_t i = 0; i < task_count; ++i) {
+                retval = amp_thread_pool_submit(pool, group, &increment_task_func, &counter);
+                CHECK_EQUAL(AMP_SUCCESS, retval);
+            }
+            
+            retval = amp_thread_pool_wait(pool, group);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            CHECK_EQUAL(static_cast<int32_t>(round * task_count), 
+                        amp_atomic_int32_load(&counter));
+        }
+        
+        retval = amp_thread_pool_wait_group_destroy(&group,
+                                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_pool_destroy(&pool,
+                                         AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(nested_submit_and_wait_from_tasks)
+    {
+        int const depth = 10;
+        
+        amp_thread_pool_t pool = AMP_THREAD_POOL_UNINITIALIZED;
+        // Tiny queues to exercise the injection queue and running tasks
+        // inline when all queues are full.
+        int retval = amp_thread_pool_create(&pool,
+                                            AMP_DEFAULT_ALLOCATOR,
+                                            worker_count,
+                                            2);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        amp_thread_pool_wait_group_t group = AMP_THREAD_POOL_WAIT_GROUP_UNINITIALIZED;
+        retval = amp_thread_pool_wait_group_create(&group,
+                                                   AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_int32_s leaf_counter = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        struct tree_context root = {pool, &leaf_counter, depth};
+        
+        retval = amp_thread_pool_submit(pool, group, &tree_task_func, &root);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_pool_wait(pool, group);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(1 << depth, amp_atomic_int32_load(&leaf_counter));
+        
+        retval = amp_thread_pool_wait_group_destroy(&group,
+                                                    AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        retval = amp_thread_pool_destroy(&pool,
+                                         AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(shutdown_executes_queued_tasks)
+    {
+        std::size_t const task_count = 1000;
+        
+        amp_thread_pool_t pool = AMP_THREAD_POOL_UNINITIALIZED;
+        int retval = amp_thread_pool_create(&pool,
+                                            AMP_DEFAULT_ALLOCATOR,
+                                            worker_count,
+                                            0);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        struct amp_raw_atomic_int32_s counter = AMP_RAW_ATOMIC_INT32_INITIALIZER(0);
+        
+        for (std::size_t i = 0; i < task_count; ++i) {
+            retval = amp_thread_pool_submit(pool, NULL, &increment_task_func, &counter);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        retval = amp_thread_pool_shutdown(pool);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        CHECK_EQUAL(static_cast<int32_t>(task_count), amp_atomic_int32_load(&counter));
+        
+        retval = amp_thread_pool_destroy(&pool,
+                                         AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+}
+
+
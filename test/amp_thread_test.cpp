@@ -42,11 +42,17 @@
 
 // Include std::size_t
 #include <cstddef>
+#include <cstring>
+
+#if defined(__linux__)
+#   include <pthread.h>
+#endif
 
 // Include AMP_SUCCESS
 #include <amp/amp_stddef.h>
 #include <amp/amp_return_code.h>
 #include <amp/amp_memory.h>
+#include <amp/amp_platform.h>
 #include <amp/amp_thread.h>
 
 
@@ -61,6 +67,38 @@ namespace
         *value_to_set = launch_run_join_success_value;
     }
     
+    
+    void noop_thread_func(void *context)
+    {
+        (void)context;
+    }
+    
+    
+    char const attributes_thread_name[] = "amp_worker";
+    
+    struct attributes_thread_record {
+        int value;
+        bool name_matches;
+    };
+    
+    void attributes_thread_func(void *context)
+    {
+        attributes_thread_record* record = static_cast<attributes_thread_record*>(context);
+        
+        // Use a bit of the small stack.
+        char buffer[1024];
+        std::memset(buffer, launch_run_join_success_value, sizeof(buffer));
+        record->value = buffer[sizeof(buffer) - 1];
+        
+#if defined(__linux__)
+        char name[AMP_THREAD_NAME_CAPACITY] = {0};
+        int const retval = pthread_getname_np(pthread_self(), name, sizeof(name));
+        record->name_matches = (0 == retval) && (0 == std::strcmp(attributes_thread_name, name));
+#else
+        record->name_matches = true;
+#endif
+    }
+    
 } // anonymous namespace
 
 
@@ -93,5 +131,165 @@ SUITE(amp_thread)
         
     }
     
+    
+    
+    TEST(affinity_add_contains_count_clear)
+    {
+        struct amp_thread_affinity_s affinity;
+        amp_thread_affinity_clear(&affinity);
+        
+        CHECK_EQUAL(static_cast<std::size_t>(0), amp_thread_affinity_count(&affinity));
+        CHECK(!amp_thread_affinity_contains(&affinity, 0));
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_thread_affinity_add(&affinity, 0));
+        CHECK_EQUAL(AMP_SUCCESS, amp_thread_affinity_add(&affinity, 65));
+        CHECK_EQUAL(AMP_SUCCESS, amp_thread_affinity_add(&affinity, 65));
+        CHECK_EQUAL(AMP_SUCCESS, amp_thread_affinity_add(&affinity, AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY - 1));
+        CHECK_EQUAL(AMP_ERROR, amp_thread_affinity_add(&affinity, AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY));
+        
+        CHECK_EQUAL(static_cast<std::size_t>(3), amp_thread_affinity_count(&affinity));
+        CHECK(amp_thread_affinity_contains(&affinity, 0));
+        CHECK(amp_thread_affinity_contains(&affinity, 65));
+        CHECK(!amp_thread_affinity_contains(&affinity, 64));
+        CHECK(!amp_thread_affinity_contains(&affinity, AMP_THREAD_AFFINITY_HWTHREAD_CAPACITY));
+        
+        amp_thread_affinity_clear(&affinity);
+        CHECK_EQUAL(static_cast<std::size_t>(0), amp_thread_affinity_count(&affinity));
+    }
+    
+    
+    
+    TEST(pin_launched_thread_to_first_topology_hwthread)
+    {
+        amp_platform_t platform = AMP_PLATFORM_UNINITIALIZED;
+        int retval = amp_platform_create(&platform, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t hwthread_count = 0;
+        retval = amp_platform_get_topology_hwthread_count(platform, &hwthread_count);
+        
+        if (AMP_SUCCESS == retval) {
+            struct amp_platform_hwthread_info_s info;
+            retval = amp_platform_get_hwthread_info(platform, 0, &info);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            struct amp_thread_affinity_s affinity;
+            amp_thread_affinity_clear(&affinity);
+            retval = amp_thread_affinity_add(&affinity, info.os_id);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+            retval = amp_thread_create_and_launch(&thread,
+                                                  AMP_DEFAULT_ALLOCATOR,
+                                                  NULL, 
+                                                  &noop_thread_func);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            retval = amp_thread_configure_affinity(thread, &affinity);
+            CHECK(AMP_SUCCESS == retval || AMP_UNSUPPORTED == retval);
+            
+            retval = amp_thread_join_and_destroy(&thread,
+                                                 AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        } else {
+            CHECK_EQUAL(AMP_UNSUPPORTED, retval);
+        }
+        
+        retval = amp_platform_destroy(&platform, AMP_DEFAULT_ALLOCATOR);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+    }
+    
+    
+    
+    TEST(attributes_set_name)
+    {
+        struct amp_thread_attributes_s attributes;
+        amp_thread_attributes_init(&attributes);
+        
+        CHECK_EQUAL(static_cast<std::size_t>(0), attributes.stack_size);
+        CHECK(AMP_THREAD_DEFAULT_GUARD_SIZE == attributes.guard_size);
+        CHECK_EQUAL(AMP_THREAD_SCHEDULING_POLICY_DEFAULT, attributes.scheduling_policy);
+        CHECK_EQUAL('\0', attributes.name[0]);
+        
+        CHECK_EQUAL(AMP_SUCCESS, amp_thread_attributes_set_name(&attributes, "fifteen_chars__"));
+        CHECK_EQUAL(0, std::strcmp("fifteen_chars__", attributes.name));
+        
+        CHECK_EQUAL(AMP_ERROR, amp_thread_attributes_set_name(&attributes, "sixteen_chars___"));
+        CHECK_EQUAL(0, std::strcmp("fifteen_chars__", attributes.name));
+    }
+    
+    
+    
+    TEST(launch_with_small_stack_and_name)
+    {
+        struct amp_thread_attributes_s attributes;
+        amp_thread_attributes_init(&attributes);
+        attributes.stack_size = 64 * 1024;
+        int retval = amp_thread_attributes_set_name(&attributes, attributes_thread_name);
+        CHECK_EQUAL(AMP_SUCCESS, retval);
+        
+        std::size_t const thread_count = 64;
+        amp_thread_t threads[thread_count];
+        attributes_thread_record records[thread_count];
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            records[i].value = 0;
+            records[i].name_matches = false;
+            
+            retval = amp_thread_create_and_launch_with_attributes(&threads[i],
+                                                                  AMP_DEFAULT_ALLOCATOR,
+                                                                  &attributes,
+                                                                  &records[i], 
+                                                                  &attributes_thread_func);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+        }
+        
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            retval = amp_thread_join_and_destroy(&threads[i],
+                                                 AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            
+            CHECK_EQUAL(launch_run_join_success_value, records[i].value);
+            CHECK(records[i].name_matches);
+        }
+    }
+    
+    
+    
+    TEST(launch_with_real_time_scheduling_policy)
+    {
+        struct amp_thread_attributes_s attributes;
+        amp_thread_attributes_init(&attributes);
+        attributes.scheduling_policy = AMP_THREAD_SCHEDULING_POLICY_FIFO;
+        attributes.priority = -1;
+        
+        amp_thread_t thread = AMP_THREAD_UNINITIALIZED;
+        int value = 0;
+        int retval = amp_thread_create_and_launch_with_attributes(&thread,
+                                                                  AMP_DEFAULT_ALLOCATOR,
+                                                                  &attributes,
+                                                                  &value, 
+                                                                  &launch_run_join_thread_func);
+        CHECK(AMP_ERROR == retval || AMP_UNSUPPORTED == retval);
+        CHECK(AMP_THREAD_UNINITIALIZED == thread);
+        
+        attributes.priority = 1;
+        retval = amp_thread_create_and_launch_with_attributes(&thread,
+                                                              AMP_DEFAULT_ALLOCATOR,
+                                                              &attributes,
+                                                              &value, 
+                                                              &launch_run_join_thread_func);
+        
+        // Real-time scheduling needs privileges the tests might not have.
+        if (AMP_SUCCESS == retval) {
+            retval = amp_thread_join_and_destroy(&thread,
+                                                 AMP_DEFAULT_ALLOCATOR);
+            CHECK_EQUAL(AMP_SUCCESS, retval);
+            CHECK_EQUAL(launch_run_join_success_value, value);
+        } else {
+            CHECK(AMP_ERROR == retval || AMP_UNSUPPORTED == retval);
+            CHECK(AMP_THREAD_UNINITIALIZED == thread);
+        }
+    }
+    
 }
-